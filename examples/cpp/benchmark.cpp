@@ -0,0 +1,154 @@
+// -*- lsst-c++ -*-
+/* benchmark.cpp
+ *
+ * Timing of the simulation engine between Australia and New Zealand at
+ * Lord's: the same matches are simulated quietly with the commentary policy
+ * configured at run time (RuntimeCommentary) and fixed at compile time, both
+ * recording every delivery (QuietCommentary) and keeping only the scorecards
+ * (SummaryCommentary), and passing every delivery to an event sink
+ * (SinkCommentary), printing the matches per second of each. All use the
+ * same random numbers, so every match must have the same result. Matches are
+ * also timed with the multinomial logit delivery model, whose kernels are
+ * timed separately over batches of every pairing of the two XIs, along with
+ * lookups in a quantized table of the logit model, and with the logit model
+ * adjusted for the situation of the match through a cache of situations.
+ *
+ * Usage: benchmark [n_sims]
+ */
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <testmatch/helpers.hpp>
+#include <testmatch/logit.hpp>
+#include <testmatch/pregame.hpp>
+#include <testmatch/quantized.hpp>
+#include <testmatch/simulation.hpp>
+#include <testmatch/situation.hpp>
+#include <testmatch/team.hpp>
+#include <vector>
+
+#include "squads.hpp"
+
+// Simulate n matches from a fixed seed, returning the runs scored in each
+template <class Commentary>
+std::vector<int> run(Pregame pregame, int n, double& seconds,
+                     const DeliveryModel* model = nullptr,
+                     EventSink events = nullptr) {
+    std::vector<int> runs(n);
+    seed_rng(42);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++) {
+        Match match(pregame);
+        match.set_delivery_model(model);
+        match.set_event_sink(events);
+        match.pregame();
+        match.start_with<Commentary>();
+        for (int j = 0; j < match.get_num_innings(); j++)
+            runs[i] += match.get_innings(j)->get_team_score();
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    seconds = elapsed.count();
+
+    return runs;
+}
+
+// Evaluate a model n times over every pairing, returning the time taken
+double time_model(const DeliveryModel& model, std::vector<Matchup> matchups,
+                  int n) {
+    std::vector<double> output(matchups.size() * Model::NUM_DELIV_OUTCOMES);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++)
+        model.evaluate(matchups.data(), matchups.size(), output.data());
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+int main(int argc, char* argv[]) {
+
+    // Both XIs at Lord's
+    Squads squads;
+    Pregame pregame = squads.pregame;
+
+    int n = argc > 1 ? std::stoi(argv[1]) : 2000;
+
+    // Warm up the caches and allocator before timing
+    double seconds;
+    run<QuietCommentary>(pregame, n / 10 + 1, seconds);
+
+    // The sink only counts the deliveries, which must all be passed to it
+    long long n_events = 0;
+    EventSink count = [&n_events](Innings&, const Ball&) { n_events++; };
+
+    double t_runtime, t_quiet, t_summary, t_sink;
+    std::vector<int> runtime = run<RuntimeCommentary>(pregame, n, t_runtime);
+    std::vector<int> quiet = run<QuietCommentary>(pregame, n, t_quiet);
+    std::vector<int> summary = run<SummaryCommentary>(pregame, n, t_summary);
+    std::vector<int> sink =
+        run<SinkCommentary>(pregame, n, t_sink, nullptr, count);
+
+    std::cout << "policy,matches,seconds,matches_per_second" << std::endl;
+    std::cout << "runtime," << n << "," << t_runtime << ","
+              << n / t_runtime << std::endl;
+    std::cout << "quiet," << n << "," << t_quiet << "," << n / t_quiet
+              << std::endl;
+    std::cout << "summary," << n << "," << t_summary << ","
+              << n / t_summary << std::endl;
+    std::cout << "sink," << n << "," << t_sink << "," << n / t_sink
+              << std::endl;
+
+    LogitDeliveryModel logit;
+    double t_logit;
+    run<QuietCommentary>(pregame, n, t_logit, &logit);
+    std::cout << "logit," << n << "," << t_logit << "," << n / t_logit
+              << std::endl;
+
+    SituationDeliveryModel situation(&logit);
+    double t_situation;
+    run<QuietCommentary>(pregame, n, t_situation, &situation);
+    std::cout << "situation," << n << "," << t_situation << ","
+              << n / t_situation << std::endl;
+
+    // Every pairing of the XIs, as evaluated for a MatchupTable
+    std::vector<Matchup> matchups;
+    for (Player* bat : squads.aus.players) {
+        for (Player* bowl : squads.nz.players) {
+            BatterCard bat_card(bat);
+            BowlerCard bowl_card(bowl);
+            Matchup matchup = {};
+            matchup.bat = bat_card.get_sim_stats();
+            matchup.bowl = bowl_card.get_sim_stats();
+            matchup.pitch = squads.lords_pf;
+            matchups.push_back(matchup);
+        }
+    }
+    LogitDeliveryModel scalar(LogitDeliveryModel::default_coefficients(),
+                              false);
+    BuiltinDeliveryModel builtin;
+    int n_tables = 20 * n;
+    std::cout << std::endl
+              << "kernel,tables,seconds,ns_per_matchup" << std::endl;
+    auto print_kernel = [&](std::string name, const DeliveryModel& model) {
+        double t = time_model(model, matchups, n_tables);
+        std::cout << name << "," << n_tables << "," << t << ","
+                  << 1e9 * t / n_tables / matchups.size() << std::endl;
+    };
+    print_kernel("builtin", builtin);
+    print_kernel("logit_scalar", scalar);
+    if (logit.get_use_simd())
+        print_kernel("logit_avx2", logit);
+    QuantizedTableOptions quant_opts;
+    quant_opts.pitch = squads.lords_pf;
+    QuantizedDeliveryModel quantized(logit, quant_opts);
+    print_kernel("quantized", quantized);
+
+    if (runtime != quiet || runtime != summary || runtime != sink ||
+        n_events == 0) {
+        std::cerr << "Policies gave different results" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,48 @@
+// -*- lsst-c++ -*-
+/* live.cpp
+ *
+ * Following a match from a live ball-by-ball feed between Australia and New
+ * Zealand at Lord's, printing win probabilities after every delivery as
+ * comma-separated lines. The feed is read from the file given as the first
+ * argument (which may be a named pipe being written to as the match goes on),
+ * or from standard input if none is given. See live.hpp for the feed format.
+ *
+ * Usage: live [feed] [n_sims]
+ */
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <testmatch/live.hpp>
+#include <testmatch/pregame.hpp>
+#include <testmatch/team.hpp>
+
+#include "squads.hpp"
+
+int main(int argc, char* argv[]) {
+
+    // Both XIs at Lord's
+    Squads squads;
+    Pregame pregame = squads.pregame;
+
+    // Australia won the toss and elected to bat
+    TossResult toss = {&squads.aus, &squads.nz, bat};
+
+    BatchOptions opts;
+    opts.n_sims = argc > 2 ? std::stoi(argv[2]) : 200;
+
+    LiveMatch live(pregame, toss, opts);
+    auto print = [](LiveUpdate& update) {
+        std::cout << update.print() << std::endl;
+    };
+
+    std::cout << "ball,state,home_win,away_win,draw,tie,ms" << std::endl;
+    if (argc > 1) {
+        std::ifstream feed(argv[1]);
+        live.follow(feed, print);
+    } else {
+        live.follow(std::cin, print);
+    }
+
+    return 0;
+}
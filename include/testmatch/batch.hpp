@@ -0,0 +1,449 @@
+// -*- lsst-c++ -*-
+/* batch.hpp
+ *
+ * Running many independent simulations of the same fixture in parallel and
+ * aggregating the results across the batch. Each worker thread collects its
+ * own shard of counters, which are merged once the batch is complete, so no
+ * synchronisation is needed while matches are being simulated.
+ *
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "cards.hpp"
+#include "enums.hpp"
+#include "pregame.hpp"
+#include "query.hpp"
+#include "simulation.hpp"
+#include "snapshot.hpp"
+#include "tactics.hpp"
+#include "team.hpp"
+#include "workers.hpp"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Streaming aggregates of a single player's performances across a
+ * batch of simulated matches.
+ *
+ * Batting figures are collected for each innings in which the player came to
+ * the crease, and bowling figures for each innings in which the player bowled
+ * at least one ball. All probabilities are therefore per innings. Run, ball
+ * and wicket distributions are stored as histograms, where the final bin also
+ * counts every value beyond the range of the histogram.
+ */
+class PlayerProjection {
+  private:
+    Player* player;
+
+    // Batting
+    unsigned int bat_innings;
+    unsigned int not_outs;
+    unsigned long long runs;
+    unsigned long long balls;
+    unsigned int fifties;
+    unsigned int hundreds;
+    unsigned int dismissals[6];
+    std::vector<unsigned int> runs_hist;
+    std::vector<unsigned int> balls_hist;
+
+    // Bowling
+    unsigned int bowl_innings;
+    unsigned long long legal_balls;
+    unsigned long long runs_conceded;
+    unsigned long long wickets;
+    unsigned int five_fors;
+    std::vector<unsigned int> wickets_hist;
+
+    static double ratio(double num, double den);
+
+  public:
+    // Number of bins in the runs and balls faced histograms
+    static int RUNS_BINS;
+    static int BALLS_BINS;
+
+    PlayerProjection(){};
+    PlayerProjection(Player* c_player);
+
+    /**
+     * @brief Add the final state of a batting card to the aggregates. Cards
+     * for batters who did not come to the crease are ignored.
+     * @param card Pointer to the BatterCard at the end of an innings.
+     */
+    void record_batting(BatterCard* card);
+
+    /**
+     * @brief Add the final state of a bowling card to the aggregates. Cards
+     * for players who did not bowl are ignored.
+     * @param card Pointer to the BowlerCard at the end of an innings.
+     */
+    void record_bowling(BowlerCard* card);
+
+    /**
+     * @brief Merge the counters of another shard for the same player.
+     */
+    PlayerProjection& operator+=(const PlayerProjection& rhs);
+
+    // Getters
+    Player* get_player();
+    unsigned int get_bat_innings();
+    unsigned int get_bowl_innings();
+    const std::vector<unsigned int>& get_runs_hist();
+    const std::vector<unsigned int>& get_balls_hist();
+    const std::vector<unsigned int>& get_wickets_hist();
+
+    /** @defgroup projection_batting Batting projections, per innings batted.
+     * @{
+     */
+    double mean_runs();
+    double mean_balls();
+    double prob_not_out();
+    double prob_fifty();
+    double prob_hundred();
+    double prob_dism(DismType mode);
+
+    /**
+     * @brief Probability of scoring at least the given number of runs.
+     */
+    double prob_runs_at_least(int n_runs);
+
+    /**
+     * @brief Smallest score s such that P(runs <= s) >= q.
+     */
+    int runs_quantile(double q);
+    /** @} // end of projection_batting */
+
+    /** @defgroup projection_bowling Bowling projections, per innings bowled.
+     * @{
+     */
+    double mean_wickets();
+    double economy();
+    double prob_five_for();
+    /** @} // end of projection_bowling */
+};
+
+/**
+ * @brief Summary of a single simulated match, kept when a batch uses a
+ * variance reduction technique.
+ */
+struct MatchRecord {
+    /**
+     * @brief Index of the match within the batch.
+     */
+    unsigned int index;
+    /**
+     * @brief Toss stratum, encoded as 2 * (away team won toss) + (elected to
+     * field). Zero when the toss is not stratified.
+     */
+    int stratum;
+    /**
+     * @brief Winner of the match: 0 for the home team, 1 for the away team and
+     * -1 if there is no winner.
+     */
+    int winner;
+    ResultType type;
+    /**
+     * @brief Control variates, each with known mean zero: the difference
+     * between actual and expected runs, and between actual and expected
+     * wickets, in home innings minus away innings.
+     */
+    double controls[2];
+};
+
+/**
+ * @brief Estimate of a result probability, along with its precision.
+ */
+struct Estimate {
+    double value;
+    double std_error;
+    /**
+     * @brief Standard error of plain Monte Carlo with the same number of
+     * matches.
+     */
+    double plain_std_error;
+    /**
+     * @brief Ratio of the plain variance to the achieved variance, i.e. how
+     * many times more matches plain Monte Carlo needs for equal precision.
+     */
+    double variance_reduction;
+};
+
+/**
+ * @brief Aggregated results of a batch of simulations of a single fixture.
+ *
+ * Stores the frequency of each result type and winner, along with a
+ * PlayerProjection for each player in both XIs (home team first, in batting
+ * order).
+ */
+class BatchResult {
+  private:
+    Team* home_team;
+    Team* away_team;
+
+    unsigned int n_sims;
+    unsigned int result_counts[5];
+    unsigned int home_wins;
+    unsigned int away_wins;
+
+    std::vector<PlayerProjection> projections;
+
+    // Whether an adaptive batch met its precision target
+    bool converged;
+
+    // Variance reduction techniques in use, and the per-match records they
+    // require
+    bool stratified;
+    bool antithetic;
+    bool control_variates;
+    double stratum_weights[4];
+    std::vector<MatchRecord> records;
+
+    // Value of the controls at the starting state, for batches continuing a
+    // match in progress
+    double control_offset[2];
+
+    // Control variates of a completed match, before the offset
+    void match_controls(Match& match, double* controls);
+
+    /**
+     * @brief Estimate the expectation of a function of a match, combining
+     * whichever variance reduction techniques are in use.
+     */
+    Estimate estimate(std::function<double(const MatchRecord&)> f);
+
+    // Plain proportion estimate, from the counters alone
+    Estimate plain_estimate(unsigned int successes);
+
+  public:
+    BatchResult(){};
+    BatchResult(Team* c_home_team, Team* c_away_team);
+
+    /**
+     * @brief Add a completed match to the aggregates.
+     * @param match Match which has been simulated to completion.
+     * @param index Index of the match within the batch.
+     * @param stratum Toss stratum of the match, if stratified.
+     */
+    void record(Match& match, unsigned int index = 0, int stratum = 0);
+
+    /**
+     * @brief Merge the counters of another shard of the same fixture.
+     */
+    BatchResult& operator+=(const BatchResult& rhs);
+
+    // Getters
+    Team* get_home_team();
+    Team* get_away_team();
+    unsigned int get_n_sims();
+    unsigned int get_wins(Team* team);
+    unsigned int get_result_count(ResultType type);
+    std::vector<PlayerProjection>& get_projections();
+
+    /**
+     * @brief Get the projection of a player from either XI, or nullptr if the
+     * player is not playing in this fixture.
+     */
+    PlayerProjection* get_projection(Player* player);
+
+    /**
+     * @brief Whether the batch stopped because the precision target given by
+     * BatchOptions::target_half_width was met. Always false for a batch of
+     * fixed size.
+     */
+    bool is_converged();
+
+    // Probabilities of each result
+    double win_prob(Team* team);
+    double result_prob(ResultType type);
+
+    /**
+     * @brief Largest half-width of the confidence intervals for the
+     * probabilities of a home win, away win, draw and tie. With variance
+     * reduction, each half-width uses the reduced standard error, but is
+     * never below the Wilson half-width of the raw counts divided by the
+     * square root of the variance reduction, so a run of identical outcomes
+     * does not give a half-width of zero.
+     * @param confidence Confidence level of the intervals, e.g. 0.95.
+     * @return Half-width, as a probability (e.g. 0.005 for +/- 0.5%).
+     */
+    double max_half_width(double confidence);
+
+    /**
+     * @brief Estimate a result probability using the variance reduction
+     * techniques enabled for the batch. Without any, this is the plain
+     * proportion of matches.
+     */
+    Estimate win_estimate(Team* team);
+    Estimate result_estimate(ResultType type);
+
+    /**
+     * @brief Format result probabilities and player projections as a table.
+     */
+    std::string print();
+
+    friend class BatchRunner;
+};
+
+/**
+ * @brief Options controlling a batch of simulations.
+ */
+struct BatchOptions {
+    /**
+     * @brief Number of matches to simulate. When a precision target is set,
+     * this is the maximum number of matches.
+     */
+    unsigned int n_sims = 1000;
+    /**
+     * @brief Number of worker threads. A value of 0 uses the number of
+     * hardware threads available.
+     */
+    unsigned int n_threads = 0;
+    /**
+     * @brief Base seed. Match i of the batch is simulated with a random stream
+     * derived from (seed, i), so results do not depend on the number of
+     * threads.
+     */
+    unsigned long long seed = 0;
+
+    /**
+     * @brief Target half-width of the confidence interval of each result
+     * probability, e.g. 0.005 for +/- 0.5%. When positive, the batch stops at
+     * the first check where every interval is within the target. The number
+     * of matches actually simulated is given by BatchResult::get_n_sims().
+     */
+    double target_half_width = 0;
+    /**
+     * @brief Confidence level of the precision target.
+     */
+    double confidence = 0.95;
+    /**
+     * @brief Number of matches simulated between precision checks. Checks are
+     * only made once every match in the block has finished, so the stopping
+     * point does not depend on the number of threads.
+     */
+    unsigned int check_every = 1000;
+
+    /** @defgroup variance_reduction Variance reduction techniques. Each may be
+     * enabled independently, and the achieved reduction is reported by
+     * BatchResult::win_estimate() and BatchResult::result_estimate().
+     * @{
+     */
+    /**
+     * @brief Stratify over the toss winner and choice, allocating matches to
+     * each of the four toss results in proportion to its probability. Ignored
+     * when continuing a match in progress.
+     */
+    bool stratify_toss = false;
+    /**
+     * @brief Simulate matches in pairs sharing a random stream, where the
+     * second match of the pair uses the antithetic uniform 1 - u for every
+     * uniform u of the first.
+     */
+    bool antithetic = false;
+    /**
+     * @brief Adjust estimates using the difference between actual and
+     * expected runs and wickets under the delivery model.
+     */
+    bool control_variates = false;
+    /** @} // end of variance_reduction */
+
+    /**
+     * @brief Tactics making declarations and batting order promotions in
+     * every match of the batch, shared between the worker threads, or nullptr
+     * to never declare and always follow the batting order. Overrides the
+     * tactics of a snapshot being continued.
+     */
+    RolloutTactics* tactics = nullptr;
+
+    /**
+     * @brief Delivery model of every match of the batch, shared between the
+     * worker threads, or nullptr for the built-in model. When continuing a
+     * match in progress, the innings in progress keeps its distributions.
+     */
+    const DeliveryModel* delivery_model = nullptr;
+};
+
+/**
+ * @brief Simulates a fixture many times in parallel and aggregates the results.
+ */
+class BatchRunner {
+  private:
+    Pregame detail;
+    BatchOptions opts;
+
+    // State to continue from, or empty to simulate from the toss
+    MatchSnapshot start;
+
+    // Probability of each toss stratum
+    double stratum_weights[4];
+
+    // Toss stratum of the i-th match of the batch
+    int stratum_of(unsigned int i);
+
+    // Seed the random stream of the i-th match of the batch and set up the
+    // match, ready to simulate from the toss or the snapshot
+    Match prepare(unsigned int i, int stratum);
+
+    // Simulate a single match of the batch, recording it in the given shard
+    // and returning its winner, or nullptr if drawn or tied
+    Team* simulate_one(unsigned int i, BatchResult& shard);
+
+    // Simulate the i-th match until the query is settled, recording the
+    // answer in the given shard
+    void query_one(unsigned int i, const MatchQuery& query,
+                   QueryResult& shard);
+
+    // Simulate matches [begin, end) of the batch across the worker threads,
+    // using the pool if one is given
+    void run_range(unsigned int begin, unsigned int end,
+                   std::vector<BatchResult>& shards, WorkerPool* pool);
+
+    // Aggregates with no matches, set up for the options of the batch
+    BatchResult empty_result();
+
+    // Merge the shards of each worker, ordering records by match index
+    static BatchResult merge(const std::vector<BatchResult>& shards);
+
+  public:
+    BatchRunner(Pregame c_detail, BatchOptions c_opts = BatchOptions());
+
+    /**
+     * @brief Set up a batch of continuations of a match in progress. Each
+     * continuation is simulated from a clone of the snapshot, with its own
+     * random stream derived from the seed as for a batch from the toss.
+     * Player projections include runs and wickets from before the snapshot.
+     * @param c_start Snapshot of the match to continue.
+     * @param c_opts Options for the batch.
+     */
+    BatchRunner(MatchSnapshot c_start, BatchOptions c_opts = BatchOptions());
+
+    /**
+     * @brief Run the batch, blocking until all simulations are complete or
+     * the precision target has been met.
+     * @param pool Persistent worker threads to run the batch on, in place of
+     * BatchOptions::n_threads new threads. Useful when running many small
+     * batches in quick succession.
+     * @return Merged aggregates across all worker threads.
+     */
+    BatchResult run(WorkerPool* pool = nullptr);
+
+    /**
+     * @brief Estimate the probability of a query, simulating each match of
+     * the batch only until the answer is settled. Matches use the same random
+     * streams as BatchRunner::run(), so each answer is the one the complete
+     * match would give. The precision target and control variates are
+     * ignored.
+     * @param query Query to answer.
+     * @param pool Persistent worker threads, as for BatchRunner::run().
+     * @return Proportion of matches for which the query holds.
+     */
+    QueryResult run_query(const MatchQuery& query, WorkerPool* pool = nullptr);
+
+    // Allow sweeps to interleave the matches of many batches
+    friend class SweepRunner;
+};
+
+#endif // BATCH_H
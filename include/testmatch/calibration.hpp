@@ -0,0 +1,250 @@
+// -*- lsst-c++ -*-
+/* calibration.hpp
+ *
+ * Calibration of the delivery and dismissal models from historical
+ * ball-by-ball data in the Cricsheet JSON format (https://cricsheet.org).
+ * Match files are stream-parsed in parallel, one file per worker at a time,
+ * into outcome frequency tables by type of bowler and phase of the innings,
+ * so memory use does not grow with the size or number of files. The tables
+ * are fitted to model coefficients and written to a versioned, checksummed
+ * binary coefficient file, which the engine maps into memory at startup from
+ * the path in the TESTMATCH_COEFFICIENTS environment variable, and which a
+ * long-running process may publish in place of the coefficients in use.
+ *
+ */
+
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include "enums.hpp"
+#include "models.hpp"
+#include "workers.hpp"
+
+#include <cstddef>
+#include <istream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Outcome frequencies of a set of deliveries, by type of bowler and
+ * phase of the innings.
+ */
+class CalibrationTables {
+  private:
+    // Counts indexed by bowling type, then phase, then outcome (in the order
+    // of Model::DELIV_OUTCOMES) or mode of dismissal (in the order of
+    // Model::DISM_MODES_STATIC)
+    std::vector<unsigned long long> outcome_counts;
+    std::vector<unsigned long long> dism_counts;
+
+    unsigned long long n_files;
+    unsigned long long n_matches;
+    unsigned long long n_failed;
+    unsigned long long n_skipped;
+
+    // Fitted coefficients over the given phase, or all phases if negative
+    Model::Coefficients fit_phase(int phase) const;
+
+  public:
+    /**
+     * @brief Number of bowling types: one for each BowlType, followed by one
+     * for bowlers whose type is unknown.
+     */
+    static const int NUM_TYPES = 7;
+    static const int UNKNOWN_TYPE = 6;
+
+    /**
+     * @brief Phases of an innings: the new ball (the first 20 overs), the
+     * middle overs and the second new ball (from the 80th over).
+     */
+    static const int NUM_PHASES = 3;
+    static int phase_of_over(int over);
+
+    CalibrationTables();
+
+    /**
+     * @brief Count a delivery.
+     * @param type Bowling type, a BowlType or UNKNOWN_TYPE.
+     * @param phase Phase of the innings.
+     * @param outcome Index of the outcome in Model::DELIV_OUTCOMES.
+     * @param dism Index of the mode of dismissal of a wicket in
+     * Model::DISM_MODES_STATIC, or -1 if it is not modelled (e.g. hit
+     * wicket).
+     */
+    void add_delivery(int type, int phase, int outcome, int dism = -1);
+
+    /**
+     * @brief Count a delivery whose outcome cannot be represented, e.g. three
+     * wides.
+     */
+    void skip_delivery();
+
+    // Count a file read (or one which could not be parsed), and a match
+    // counted in the tables
+    void add_file(bool failed = false);
+    void add_match();
+
+    CalibrationTables& operator+=(const CalibrationTables& rhs);
+
+    unsigned long long get_outcome_count(int type, int phase,
+                                         int outcome) const;
+    unsigned long long get_dism_count(int type, int phase, int dism) const;
+    unsigned long long get_n_deliveries() const;
+    unsigned long long get_n_files() const;
+    unsigned long long get_n_matches() const;
+    unsigned long long get_n_failed() const;
+    unsigned long long get_n_skipped() const;
+
+    /**
+     * @brief Fit the coefficients of the delivery and dismissal models by the
+     * proportion of each outcome. Slow bowlers (as for is_slow_bowler()) make
+     * up the spin tables, and the rest the pace tables. Bowlers of unknown
+     * type are only used for a table with no deliveries from bowlers of known
+     * type, and a table with no deliveries at all keeps the published
+     * coefficients, as do the toss and follow-on models.
+     * @param phase Phase to fit, or -1 for every phase.
+     */
+    Model::Coefficients fit(int phase = -1) const;
+
+    /**
+     * @brief Write the tables and the fitted coefficients (over all phases,
+     * then for each phase) to a binary coefficient file, in the byte order of
+     * the host, with a checksum of its contents. Throws std::runtime_error if
+     * the file cannot be written.
+     *
+     * The file is written under a temporary name in the same directory, then
+     * renamed over the path, so any process with the old file mapped (see
+     * CoefficientFile) keeps reading the old contents. Deployed coefficient
+     * files must always be replaced this way, never rewritten in place.
+     */
+    void save(std::string path) const;
+
+    /**
+     * @brief Read the tables back from a coefficient file. Throws
+     * std::runtime_error if the file cannot be read or is not a coefficient
+     * file of this version.
+     */
+    static CalibrationTables load(std::string path);
+};
+
+/**
+ * @brief Options for reading a directory of Cricsheet match files.
+ */
+struct CalibrationOptions {
+    /**
+     * @brief Only count matches of this type (as in the "match_type" field of
+     * the file, e.g. "Test"), or every match if empty.
+     */
+    std::string match_type = "Test";
+    /**
+     * @brief Number of worker threads. A value of 0 uses the number of
+     * hardware threads available.
+     */
+    unsigned int n_threads = 0;
+};
+
+/**
+ * @brief Reads Cricsheet JSON match files into CalibrationTables.
+ *
+ * Cricsheet files do not give the type of each bowler, which is looked up by
+ * the bowler's name as it appears in the files. Bowlers without a known type
+ * are counted under CalibrationTables::UNKNOWN_TYPE.
+ */
+class CricsheetReader {
+  private:
+    CalibrationOptions opts;
+    std::unordered_map<std::string, int> styles;
+
+  public:
+    CricsheetReader(CalibrationOptions c_opts = CalibrationOptions());
+
+    /**
+     * @brief Set the bowling type of a bowler.
+     */
+    void add_style(std::string name, BowlType type);
+
+    /**
+     * @brief Read bowling types from lines of the form "name,type", where the
+     * type is as accepted by str_to_bowltype(). Lines with an unknown type
+     * are ignored.
+     * @return Number of bowling types read.
+     */
+    unsigned int read_styles(std::istream& input);
+
+    /**
+     * @brief Parse a single match file, adding its deliveries to the tables
+     * if the match is of the required type. Throws std::runtime_error if the
+     * file is not valid JSON.
+     * @return Whether the match was counted.
+     */
+    bool read(std::istream& input, CalibrationTables& tables);
+
+    /**
+     * @brief Parse every .json file in a directory (not recursively) across
+     * the worker threads. Files which cannot be parsed are counted by
+     * CalibrationTables::get_n_failed() rather than stopping the run.
+     * @param dir Directory of match files.
+     * @param pool Persistent worker threads to read the files on, in place of
+     * CalibrationOptions::n_threads new threads.
+     */
+    CalibrationTables read_dir(std::string dir, WorkerPool* pool = nullptr);
+};
+
+/**
+ * @brief A coefficient file written by CalibrationTables::save(), mapped
+ * read-only into memory, so every process on a machine shares one copy.
+ *
+ * The file is checked when it is opened: its version, the size of its tables
+ * and a checksum of everything after the header, so a truncated or corrupted
+ * file is rejected before any of its coefficients are used. The mapping is
+ * shared with the file, so a mapped file must never be modified in place:
+ * truncating or rewriting it may crash the process or change coefficients
+ * after they were checked. Replace it with a new file instead, as
+ * CalibrationTables::save() does.
+ */
+class CoefficientFile {
+  private:
+    void* mapping;
+    size_t mapping_size;
+
+    // Counts of files and deliveries, then the tables, as stored by
+    // CalibrationTables::save(), and the coefficients over all phases, then
+    // for each phase
+    const unsigned long long* counts;
+    const Model::Coefficients* coefs;
+
+    friend class CalibrationTables;
+
+  public:
+    /**
+     * @brief Map a coefficient file. Throws std::runtime_error if the file
+     * cannot be read, is not a coefficient file of this version or fails its
+     * checksum.
+     */
+    CoefficientFile(std::string path);
+
+    CoefficientFile(const CoefficientFile&) = delete;
+    CoefficientFile& operator=(const CoefficientFile&) = delete;
+
+    /**
+     * @brief Coefficients fitted over the given phase, or every phase if -1.
+     */
+    const Model::Coefficients& get(int phase = -1) const;
+
+    ~CoefficientFile();
+};
+
+/**
+ * @brief Map a coefficient file and publish the coefficients fitted over all
+ * phases (see Model::publish_coefficients()), keeping the file mapped for as
+ * long as any thread holds them. The calling thread uses them at once, unless
+ * its coefficients are pinned, and other threads from the next match they
+ * prepare, so the file may be loaded while simulations are in progress.
+ * Throws std::runtime_error if the file cannot be read, in which case the
+ * coefficients in use are unchanged.
+ */
+void load_coefficients(std::string path);
+
+#endif // CALIBRATION_H
@@ -67,6 +67,17 @@ struct BowlStats {
 // Match details required in delivery model
 struct MatchStats {
     int innings;
+    // Legal deliveries bowled with the current ball, which is replaced after
+    // every 80 overs
+    int ball_age;
+    // Legal deliveries faced by the striker
+    int bat_balls;
+    // Runs required per over in the fourth innings, over the overs left at the
+    // nominal over rate of the match clock (or of five days of 90 overs,
+    // without a clock), or zero in other innings
+    double req_rate;
+    // Legal deliveries bowled in the match so far, as a measure of pitch wear
+    int match_balls;
 };
 
 /**
@@ -126,21 +137,31 @@ class Fatigue {
   private:
     double value;
 
-    // Normal distribution object for generating values
-    static std::random_device RD;
-    static std::mt19937 GEN;
-    std::normal_distribution<double>* dist;
+    // Parameters of the normal distribution of fatigue added per ball, sampled
+    // using the thread-local engine from helpers.hpp. Stored by value so that
+    // cards (and the innings holding them) can be copied.
+    double mean;
+    double sd;
 
-    // Parameters
-    static double MEAN_PACE_FATIGUE;
-    static double MEAN_SPIN_FATIGUE;
-    static double EXTRA_PACE_PENALTY;
-    static double VAR_PACE_FATIGUE;
-    static double VAR_SPIN_FATIGUE;
+    // Balls bowled since the value was last updated. Their fatigue is
+    // sampled together, as a single normal with the summed mean and
+    // variance, only when the value is needed
+    int pending;
+
+    // Add the fatigue of any pending balls to the value
+    void flush();
+
+    // Parameters, thread-local so that concurrent simulations (e.g. the
+    // points of a parameter sweep) can use different values
+    static thread_local double MEAN_PACE_FATIGUE;
+    static thread_local double MEAN_SPIN_FATIGUE;
+    static thread_local double EXTRA_PACE_PENALTY;
+    static thread_local double VAR_PACE_FATIGUE;
+    static thread_local double VAR_SPIN_FATIGUE;
 
   public:
     // Constructor
-    Fatigue(){};
+    Fatigue() : pending(0){};
     Fatigue(BowlType c_bowl_type);
 
     // Getter
@@ -151,8 +172,7 @@ class Fatigue {
     void wicket();
     void rest(double time);
 
-    // Destructor
-    ~Fatigue();
+    friend class ParamRegistry;
 };
 
 /**
@@ -175,7 +195,8 @@ class PlayerCard {
     virtual void update_score(std::string outcome) = 0;
     virtual std::string print_card(void) = 0;
 
-    // Default destructor
+    // Default destructor, virtual as cards are polymorphic
+    virtual ~PlayerCard() = default;
 };
 
 /**
@@ -206,14 +227,21 @@ class BatterCard : public PlayerCard {
 
     void activate(void);
     void update_score(std::string outcome); //, float mins);
+
+    /**
+     * @brief Equivalent to update_score("0") repeated n times.
+     */
+    void add_dots(int n);
+
     void dismiss(DismType d_mode, Player* d_bowler = nullptr,
                  Player* d_fielder = nullptr);
     std::string print_card(void);
     std::string print_short(void);
     std::string print_dism(void);
 
-    // Copy constructor
-    // BatterCard(const BatterCard& bc);
+    // Copy constructor, duplicating the dismissal
+    BatterCard(const BatterCard& bc);
+    BatterCard& operator=(const BatterCard& bc) = delete;
 
     ~BatterCard();
 };
@@ -243,14 +271,32 @@ class BowlerCard : public PlayerCard {
     // Determine whether a given player is considered a "parttime bowler"
     static int DETERMINE_COMPETENCY(Player* player);
 
+    // Bowling average/strike rate inflation for "cheating" part-time bowlers
+    static thread_local double INFLATION_FACTOR;
+
   public:
     BowlerCard() : PlayerCard(){};
     BowlerCard(Player* c_player);
 
     BowlStats get_sim_stats(void);
     void update_score(std::string outcome);
+
+    /**
+     * @brief Equivalent to update_score("0") repeated n times.
+     */
+    void add_dots(int n);
+
     void start_new_spell();
 
+    /**
+     * @brief Inflate the bowling average and strike rate used in simulation.
+     *
+     * Applied to the card rather than the Player, so that the career
+     * statistics (which may be shared between concurrent simulations) are
+     * never modified.
+     */
+    void inflate_bowl_avg();
+
     // Get fatigue
     double get_tiredness();
     int get_competency();
@@ -260,6 +306,8 @@ class BowlerCard : public PlayerCard {
 
     std::string print_card(void);
     std::string print_spell(void);
+
+    friend class ParamRegistry;
 };
 
 template <typename T>
@@ -320,6 +368,14 @@ class Over {
     Over(){};
     Over(int c_over_num);
 
+    /**
+     * @brief Copy constructor, duplicating each ball of the over, along with
+     * the counts of any balls which were not recorded. The copy is not linked
+     * to the next over.
+     */
+    Over(const Over& over);
+    Over& operator=(const Over& over) = delete;
+
     /**
      * @brief
      * @param p_next
@@ -339,6 +395,13 @@ class Over {
      */
     void add_ball(Ball* ball);
 
+    /**
+     * @brief Count a delivery in the over without recording it, so the
+     * counts of balls run ahead of the list of Ball objects.
+     * @param legal Whether the delivery was legal.
+     */
+    void count_ball(bool legal);
+
     ~Over();
 };
 
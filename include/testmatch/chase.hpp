@@ -0,0 +1,169 @@
+// -*- lsst-c++ -*-
+/* chase.hpp
+ *
+ * Precomputed values of fourth innings chases. For a given batting XI,
+ * bowling XI and venue, the probabilities of winning and drawing from every
+ * combination of runs needed, wickets in hand and overs left are calculated
+ * once by backward dynamic programming over the same states as ExactInnings,
+ * and stored in a flat binary file. The file is memory-mapped when opened, so
+ * a table is shared between processes and queries only touch the pages they
+ * need.
+ *
+ */
+
+#ifndef CHASE_H
+#define CHASE_H
+
+#include "models.hpp"
+#include "pregame.hpp"
+#include "team.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Options controlling the construction of a ChaseTable.
+ */
+struct ChaseTableOptions {
+    /**
+     * @brief Largest number of runs needed in the table.
+     */
+    int max_runs = 500;
+    /**
+     * @brief Largest number of overs left in the table. Queries with more time
+     * left use the values at this many overs.
+     */
+    int max_overs = 120;
+    /**
+     * @brief Bowlers of each over, as indices in the bowling XI, counted back
+     * from the last over available. If empty, the four bowlers with the
+     * highest wicket probabilities bowl in turn.
+     */
+    std::vector<int> rotation;
+    /**
+     * @brief Transitions of a delivery less likely than this are discarded.
+     */
+    double min_prob = 1e-10;
+    /**
+     * @brief Session of the match in which the chase starts, from 0 on the
+     * first morning. The whole chase is played on the pitch as worn by then
+     * (see Model::MODEL_PITCH_WEAR). By default, the first session of the
+     * fourth day.
+     */
+    int session = 9;
+};
+
+/**
+ * @brief Header of a chase table file, followed by the win and then the draw
+ * probabilities, as floats indexed by wickets in hand (from 1), overs left
+ * (from 0) and runs needed (from 0).
+ */
+struct ChaseTableHeader {
+    char magic[8];
+    unsigned int version;
+    unsigned int max_runs;
+    unsigned int max_overs;
+    /**
+     * @brief Session whose worn pitch the table was built on.
+     */
+    unsigned int session;
+    /**
+     * @brief MatchupTable::fingerprint() of the delivery model used.
+     */
+    unsigned long long fingerprint;
+    /**
+     * @brief Names of the teams and venue, each at most 63 characters.
+     */
+    char bat_team[64];
+    char bowl_team[64];
+    char venue[64];
+};
+
+/**
+ * @brief Probabilities of winning and drawing a fourth innings chase, by runs
+ * needed, wickets in hand and time left.
+ *
+ * The chase is won once the batting team takes the lead, as in
+ * Innings::check_state(), and drawn if time runs out first. Values are
+ * calculated with the batters at the crease weighted by how often each pair
+ * bats together after the given number of wickets, and the time left is in
+ * overs of six legal deliveries.
+ */
+class ChaseTable {
+  private:
+    // Either a memory-mapped file or a table built in memory
+    void* mapping;
+    size_t mapping_size;
+    std::vector<char> buffer;
+
+    const ChaseTableHeader* header;
+    const float* win;
+    const float* draw;
+
+    // Point the header and values at the start of the given data
+    void attach(const char* data, size_t size);
+
+    // Value from one of the grids, interpolated linearly in overs left
+    double lookup(const float* values, int runs_needed, int wkts_in_hand,
+                  double balls_left) const;
+
+  public:
+    /**
+     * @brief Build a table by dynamic programming. Throws
+     * std::invalid_argument if a team or venue name is longer than 63
+     * characters, as the table could never be matched to it, or if the
+     * session is not one of the match.
+     * @param bat_team Team chasing the target.
+     * @param bowl_team Team bowling.
+     * @param venue Venue of the match.
+     * @param opts Size of the table and bowling rotation.
+     */
+    ChaseTable(Team* bat_team, Team* bowl_team, Venue* venue,
+               ChaseTableOptions opts = ChaseTableOptions());
+
+    /**
+     * @brief Open a table previously written with save(), mapping the file
+     * into memory.
+     * @param path Path of the table file.
+     */
+    ChaseTable(std::string path);
+
+    ChaseTable(const ChaseTable&) = delete;
+    ChaseTable& operator=(const ChaseTable&) = delete;
+
+    /**
+     * @brief Write the table to a file.
+     */
+    void save(std::string path) const;
+
+    /**
+     * @brief Whether the table was built for the given teams and venue, with
+     * the current statistics of every player and the current wear of the
+     * pitch in the session of the table.
+     */
+    bool matches(Team* bat_team, Team* bowl_team, Venue* venue) const;
+
+    /**
+     * @brief Probability of the chasing team winning.
+     * @param runs_needed Runs needed to win, i.e. one more than the deficit.
+     * @param wkts_in_hand Number of wickets in hand, from 0 to 10.
+     * @param balls_left Number of legal deliveries left in the match. Values
+     * are interpolated linearly between whole overs.
+     */
+    double win_prob(int runs_needed, int wkts_in_hand,
+                    double balls_left) const;
+
+    /**
+     * @brief Probability of the chase ending in a draw, with time running out.
+     */
+    double draw_prob(int runs_needed, int wkts_in_hand,
+                     double balls_left) const;
+
+    const ChaseTableHeader& get_header() const;
+
+    ~ChaseTable();
+};
+
+#endif // CHASE_H
@@ -0,0 +1,207 @@
+// -*- lsst-c++ -*-
+/* compose.hpp
+ *
+ * Fast approximate match estimates composed from innings distributions.
+ * Ignoring declarations, the total of each innings depends only on the
+ * batting and bowling XIs and the conditions, so the distribution of totals,
+ * and the playing time taken to make each total, is simulated once for each
+ * pairing and cached. A match is then evaluated by combining the cached
+ * distributions innings by innings, following the same rules as Match for
+ * the follow-on, wins by an innings, chases and ties, and drawn when the
+ * innings take longer than the scheduled play of the match.
+ *
+ */
+
+#ifndef COMPOSE_H
+#define COMPOSE_H
+
+#include "models.hpp"
+#include "pregame.hpp"
+#include "team.hpp"
+
+#include <map>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Key of a cached innings distribution.
+ */
+struct InningsKey {
+    /**
+     * @brief MatchupTable::fingerprint() of the batting XI against the
+     * bowling XI.
+     */
+    unsigned long long fingerprint;
+    // Pitch factors, rounded to the bucket width
+    int seam_bucket;
+    int spin_bucket;
+    int inns_no;
+
+    bool operator<(const InningsKey& rhs) const;
+};
+
+/**
+ * @brief Empirical distribution of the outcome of a completed innings.
+ */
+struct InningsTotals {
+    /**
+     * @brief Probability of each total, indexed by runs.
+     */
+    std::vector<double> runs;
+    /**
+     * @brief Probability of each number of wickets, from 0 to 10.
+     */
+    std::vector<double> wkts;
+    /**
+     * @brief Mean scheduled playing time used, in seconds, by the innings
+     * ending on each total (zero for totals never made).
+     */
+    std::vector<double> play;
+    unsigned int n_sims;
+
+    double mean_runs() const;
+
+    /**
+     * @brief Mean playing time used, in seconds.
+     */
+    double mean_play() const;
+
+    /**
+     * @brief Mean playing time used per run scored, in seconds.
+     */
+    double play_per_run() const;
+
+    /**
+     * @brief Probability of scoring more than the given number of runs.
+     */
+    double prob_runs_above(int n_runs) const;
+};
+
+/**
+ * @brief Options controlling the simulations of an InningsCache.
+ */
+struct InningsCacheOptions {
+    /**
+     * @brief Number of innings simulated for each cache miss.
+     */
+    unsigned int n_sims = 2000;
+    /**
+     * @brief Number of worker threads. A value of 0 uses the number of
+     * hardware threads available.
+     */
+    unsigned int n_threads = 0;
+    /**
+     * @brief Base seed. The innings of each entry use random streams derived
+     * from the seed and the key, so entries do not depend on the order in
+     * which they are requested.
+     */
+    unsigned long long seed = 0;
+    /**
+     * @brief Width of the buckets that seam and spin pitch factors are
+     * rounded to.
+     */
+    double bucket_width = 0.1;
+};
+
+/**
+ * @brief Cache of innings distributions, keyed by the delivery model of the
+ * batting XI against the bowling XI, the pitch bucket and the innings number.
+ * Each innings is played on the pitch as worn by the session it starts in,
+ * so innings starting in sessions whose worn pitches share a bucket share
+ * an entry.
+ *
+ * Any change in a player's statistics changes the delivery model, and so the
+ * key, so entries never go stale.
+ */
+class InningsCache {
+  private:
+    InningsCacheOptions opts;
+    std::map<InningsKey, InningsTotals> entries;
+    unsigned int hits;
+    unsigned int misses;
+
+    // Simulate complete innings for an entry
+    InningsTotals simulate(Team* bat_team, Team* bowl_team,
+                           PitchFactors* pitch, int inns_no,
+                           std::shared_ptr<const MatchupTable> table,
+                           const InningsKey& key);
+
+  public:
+    InningsCache(InningsCacheOptions c_opts = InningsCacheOptions());
+
+    /**
+     * @brief Key of an innings.
+     */
+    InningsKey make_key(const MatchupTable& table, PitchFactors* pitch,
+                        int inns_no) const;
+
+    /**
+     * @brief Distribution of a complete innings, simulated on a cache miss.
+     * A fourth innings is simulated without a target, so the probability of
+     * a chase succeeding is that of the total passing the target.
+     * @param bat_team Team batting.
+     * @param bowl_team Team bowling.
+     * @param venue Venue of the match.
+     * @param inns_no Innings number, from 1 to 4.
+     * @param session Session of the match in which the innings starts, from
+     * 0 on the first morning, which the pitch is worn to (see
+     * Model::MODEL_PITCH_WEAR).
+     */
+    const InningsTotals& get(Team* bat_team, Team* bowl_team, Venue* venue,
+                             int inns_no, int session = 0);
+
+    unsigned int size() const;
+    unsigned int get_hits() const;
+    unsigned int get_misses() const;
+    void clear();
+};
+
+/**
+ * @brief Approximate result probabilities of a match.
+ */
+struct MatchEstimate {
+    double home_win;
+    double away_win;
+    double draw;
+    double tie;
+};
+
+/**
+ * @brief Evaluates matches by composing cached innings distributions.
+ *
+ * Innings totals are treated as independent, and each innings is taken to
+ * use the mean playing time of innings ending on the same total. Each
+ * innings is played on the pitch of the session in which it starts when
+ * every earlier innings takes its mean time. A chase is
+ * taken to score at the mean rate of a fourth innings. The match is drawn if
+ * the innings so far, and any innings breaks, leave no time to finish it.
+ */
+class MatchEvaluator {
+  private:
+    InningsCache* cache;
+
+    // Probabilities of each result with the given team batting first, in the
+    // order (first team wins, second team wins, tie, draw)
+    void evaluate_order(Team* first, Team* second, Venue* venue,
+                        double* probs);
+
+  public:
+    /**
+     * @param c_cache Cache of innings distributions, which may be shared
+     * between evaluators (on the same thread).
+     */
+    MatchEvaluator(InningsCache* c_cache);
+
+    /**
+     * @brief Evaluate a match before the toss, weighting each toss result by
+     * its probability.
+     */
+    MatchEstimate evaluate(Pregame detail);
+
+    /**
+     * @brief Evaluate a match after the toss.
+     */
+    MatchEstimate evaluate(Pregame detail, TossResult toss);
+};
+
+#endif // COMPOSE_H
@@ -0,0 +1,111 @@
+// -*- lsst-c++ -*-
+/* curve.hpp
+ *
+ * Win-probability curves for a completed match, estimated at every ball of
+ * the recorded ball-by-ball feed. Every state of the match is captured as a
+ * snapshot while replaying the feed, and the continuations from all states
+ * are then scheduled together across a pool of worker threads.
+ *
+ * Continuation j from every state uses the same random stream, so the
+ * estimates at adjacent states share common random numbers. The noise in the
+ * curve is then strongly correlated from ball to ball, and the change in win
+ * probability due to each delivery is estimated far more precisely than the
+ * probabilities themselves.
+ *
+ */
+
+#ifndef CURVE_H
+#define CURVE_H
+
+#include "pregame.hpp"
+#include "simulation.hpp"
+
+#include <istream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Options controlling a win-probability curve.
+ */
+struct WinCurveOptions {
+    /**
+     * @brief Number of continuations simulated from each state.
+     */
+    unsigned int n_sims = 200;
+    /**
+     * @brief Number of worker threads. A value of 0 uses the number of
+     * hardware threads available.
+     */
+    unsigned int n_threads = 0;
+    /**
+     * @brief Base seed. Continuation j from every state uses a random stream
+     * derived from (seed, j), so results do not depend on the number of
+     * threads.
+     */
+    unsigned long long seed = 0;
+};
+
+/**
+ * @brief Win probabilities at every state of a match, stored column by
+ * column. Row 0 is the state before the first ball, and row k the state after
+ * the k-th delivery of the feed.
+ */
+struct WinCurve {
+    std::vector<unsigned int> ball;
+    /**
+     * @brief Innings in progress (from 1), or of the final delivery once the
+     * match is over.
+     */
+    std::vector<int> innings;
+    std::vector<int> score;
+    std::vector<int> wkts;
+    std::vector<double> home_win;
+    std::vector<double> away_win;
+    std::vector<double> draw;
+    std::vector<double> tie;
+
+    /**
+     * @brief Number of states in the curve.
+     */
+    unsigned int size() const;
+
+    /**
+     * @brief Format as comma-separated values, with a header row.
+     */
+    std::string to_csv() const;
+};
+
+/**
+ * @brief Estimates the win-probability curve of a recorded match.
+ *
+ * The matchup tables of the delivery model are built once for each batting
+ * team while replaying the feed, and shared by every snapshot and
+ * continuation.
+ */
+class WinCurveRunner {
+  private:
+    Pregame detail;
+    TossResult toss;
+    WinCurveOptions opts;
+
+  public:
+    /**
+     * @brief Set up a curve for a match.
+     * @param c_detail Teams and venue.
+     * @param c_toss Actual result of the toss.
+     * @param c_opts Options for the continuations.
+     */
+    WinCurveRunner(Pregame c_detail, TossResult c_toss,
+                   WinCurveOptions c_opts = WinCurveOptions());
+
+    /**
+     * @brief Replay a ball-by-ball feed (in the format read by LiveMatch), and
+     * estimate the win probabilities at every state. Reads until the end of
+     * the feed or the end of the match.
+     * @param feed Stream of feed lines.
+     * @return Curve with one row per state.
+     */
+    WinCurve run(std::istream& feed);
+};
+
+#endif // CURVE_H
@@ -0,0 +1,236 @@
+// -*- lsst-c++ -*-
+/* emulator.hpp
+ *
+ * A surrogate model of the full simulation, for interactive tools which
+ * cannot wait for thousands of matches per query. Match states are sampled
+ * offline by simulating a pool of fixtures, each state is continued many
+ * times with the full engine, and a small regression is fitted to the
+ * results. Queries then cost a few dot products.
+ *
+ * For each innings number there is a logistic regression for the probability
+ * of the batting team winning, another for the probability of a draw, and a
+ * linear regression for the runs still to come in the innings in progress,
+ * all on the same polynomial features of the lead, wickets, balls bowled and
+ * time left in the match.
+ *
+ */
+
+#ifndef EMULATOR_H
+#define EMULATOR_H
+
+#include "pregame.hpp"
+#include "simulation.hpp"
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief State of a match in progress, from the point of view of the team
+ * batting.
+ */
+struct EmulatorState {
+    /**
+     * @brief Innings in progress, from 1 to 4.
+     */
+    int inns_no;
+    /**
+     * @brief Score of the batting team in the innings.
+     */
+    int score;
+    /**
+     * @brief Lead of the batting team, negative if it is behind.
+     */
+    int lead;
+    int wkts;
+    /**
+     * @brief Legal deliveries bowled in the innings.
+     */
+    int balls;
+    bool home_batting;
+    /**
+     * @brief Overs left in the match at the nominal over rate of its clock
+     * (see MatchTime::overs_left()), which decides how likely a draw is.
+     */
+    double overs_left = MatchTime::NUM_DAYS * MatchTime::MIN_OVERS;
+
+    /**
+     * @brief State of the innings in progress.
+     */
+    static EmulatorState from_match(Match& match);
+};
+
+/**
+ * @brief A sampled state and the outcomes of its continuations.
+ */
+struct EmulatorSample {
+    EmulatorState state;
+    unsigned int n_sims;
+    // Continuations won by the batting team, drawn and tied
+    unsigned int wins;
+    unsigned int draws;
+    unsigned int ties;
+    /**
+     * @brief Mean final total of the innings in progress.
+     */
+    double mean_total;
+};
+
+/**
+ * @brief Error of an emulator on samples not used to fit it, alongside the
+ * error of predicting the average of the samples for every state.
+ */
+struct EmulatorValidation {
+    unsigned int n_states;
+    /**
+     * @brief Mean squared error of the batting team's win probability,
+     * against the proportion of continuations won.
+     */
+    double win_brier;
+    double baseline_win_brier;
+    /**
+     * @brief Root mean squared error of the expected innings total.
+     */
+    double total_rmse;
+    double baseline_total_rmse;
+
+    /**
+     * @brief Format the errors.
+     */
+    std::string print() const;
+};
+
+/**
+ * @brief Predicted outcome of a match from a given state.
+ */
+struct EmulatorPrediction {
+    double home_win;
+    double away_win;
+    double draw;
+    /**
+     * @brief Expected final total of the innings in progress.
+     */
+    double exp_total;
+};
+
+/**
+ * @brief Fitted surrogate model of the outcome of a match.
+ */
+class Emulator {
+  private:
+    // Coefficients of the win, draw and total regressions for each innings
+    std::vector<double> coefs[4][3];
+    EmulatorValidation validation;
+
+    // Polynomial features of a state
+    static void features(const EmulatorState& state, double* x);
+
+  public:
+    /**
+     * @brief Number of features in each regression.
+     */
+    static const int NUM_FEATURES = 12;
+
+    Emulator();
+
+    /**
+     * @brief Load an emulator previously written with save().
+     * @param path Path of the coefficients file.
+     */
+    Emulator(std::string path);
+
+    /**
+     * @brief Fit the regressions to sampled states.
+     * @param samples States with the outcomes of their continuations, which
+     * should cover every innings.
+     * @param ridge Penalty on the squared coefficients (other than the
+     * intercept), on the scale of one state.
+     */
+    static Emulator fit(const std::vector<EmulatorSample>& samples,
+                        double ridge = 1e-3);
+
+    /**
+     * @brief Compare predictions with the outcomes of sampled states, and
+     * keep the result as the emulator's validation error.
+     */
+    EmulatorValidation validate(const std::vector<EmulatorSample>& samples);
+
+    /**
+     * @brief Validation error from the last call to validate().
+     */
+    const EmulatorValidation& get_validation() const;
+
+    /**
+     * @brief Predict the outcome from a state.
+     */
+    EmulatorPrediction predict(const EmulatorState& state) const;
+
+    /**
+     * @brief Predict the outcome of a match from its current state. A
+     * completed match gives its actual result.
+     */
+    EmulatorPrediction predict(Match& match) const;
+
+    /**
+     * @brief Write the coefficients and validation error to a text file.
+     */
+    void save(std::string path) const;
+};
+
+/**
+ * @brief Options controlling the training of an emulator.
+ */
+struct EmulatorTrainerOptions {
+    /**
+     * @brief Number of states sampled for fitting. The same number of fresh
+     * states is sampled for validation.
+     */
+    unsigned int n_states = 2000;
+    /**
+     * @brief Number of continuations simulated from each state.
+     */
+    unsigned int n_sims = 100;
+    /**
+     * @brief Number of worker threads. A value of 0 uses the number of
+     * hardware threads available.
+     */
+    unsigned int n_threads = 0;
+    unsigned long long seed = 0;
+    double ridge = 1e-3;
+};
+
+/**
+ * @brief Samples states from a pool of fixtures, and fits an emulator to
+ * their continuations.
+ *
+ * States are taken at random deliveries of matches simulated from the start,
+ * cycling through the fixtures, so they follow the distribution of states
+ * the engine itself produces.
+ */
+class EmulatorTrainer {
+  private:
+    std::vector<Pregame> fixtures;
+    EmulatorTrainerOptions opts;
+
+  public:
+    /**
+     * @param c_fixtures Teams and venues to sample states from.
+     * @param c_opts Options for the sampling and fit.
+     */
+    EmulatorTrainer(std::vector<Pregame> c_fixtures,
+                    EmulatorTrainerOptions c_opts = EmulatorTrainerOptions());
+
+    /**
+     * @brief Sample states and simulate their continuations.
+     * @param n_states Number of states.
+     * @param seed Seed of the states and continuations.
+     */
+    std::vector<EmulatorSample> sample(unsigned int n_states,
+                                       unsigned long long seed);
+
+    /**
+     * @brief Sample states, fit an emulator and validate it on fresh states.
+     */
+    Emulator train();
+};
+
+#endif // EMULATOR_H
@@ -73,8 +73,10 @@ char chr(Arm arm);
 
 std::string str(BowlType bowltype);
 std::string long_str(Arm arm, BowlType bowltype);
+BowlType str_to_bowltype(std::string str);
 
 std::string str(DismType dismtype);
+DismType str_to_dism(std::string str);
 
 std::string str(TossChoice tosschoice);
 
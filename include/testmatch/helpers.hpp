@@ -21,6 +21,7 @@
 
 #include <cmath>
 #include <exception>
+#include <random>
 #include <stdexcept>
 #include <string>
 #include <utility>
@@ -108,11 +109,70 @@ inline std::string join_str(std::vector<std::string> str_comp,
     return output.substr(0, output.size() - join.size());
 }
 
+/**
+ * @brief Random number state owned by each thread.
+ *
+ * Each thread owns an independent engine, so simulations may be run
+ * concurrently without sharing (or locking) a global generator as rand()
+ * does. All random draws in the simulation should go through this engine.
+ */
+struct RngState {
+    std::mt19937_64 engine;
+
+    // When set, runif() returns 1 - u in place of each uniform u, so that a
+    // second pass over the same stream produces the antithetic path
+    bool antithetic = false;
+};
+
+/**
+ * @brief Access the random number state of the calling thread.
+ */
+RngState& rng_state();
+
+/**
+ * @brief Access the pseudo-random number engine of the calling thread.
+ * @return Reference to the thread-local engine.
+ */
+inline std::mt19937_64& rng_engine() { return rng_state().engine; }
+
+/**
+ * @brief Switch antithetic sampling on or off for the calling thread.
+ */
+inline void set_antithetic(bool antithetic) {
+    rng_state().antithetic = antithetic;
+}
+
+/**
+ * @brief Reseed the pseudo-random number engine of the calling thread.
+ * @param seed New seed value.
+ */
+void seed_rng(unsigned long long seed);
+
+/**
+ * @brief Derive a well-mixed seed from a base seed and a stream index, using
+ * the SplitMix64 finaliser. Used to give each simulation in a batch its own
+ * reproducible stream, independent of which thread runs it.
+ */
+inline unsigned long long mix_seed(unsigned long long seed,
+                                   unsigned long long stream) {
+    unsigned long long z = seed + (stream + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Generates a uniform random number on [0, 1)
+inline double runif() {
+    RngState& state = rng_state();
+    double u = (state.engine() >> 11) * (1.0 / 9007199254740992.0);
+    return state.antithetic ? 1 - u : u;
+}
+
 template <typename T>
-T sample_cdf(T* values, int length, double* dist) {
+T sample_cdf(T* values, int length, const double* dist) {
 
     // Generate random number
-    double r = ((double)rand() / (RAND_MAX));
+    double r = runif();
 
     // Iterate through distribution until first entry > r
     int i = 0;
@@ -129,19 +189,27 @@ inline std::pair<int, int> balls_to_ov(unsigned int balls) {
     return output;
 }
 
-// Generates a realisation of a truncated exponential distribution
+// Generates a realisation of an exponential distribution with the given mean,
+// truncated to [min, max]
 inline double rtexp(double mean, double min, double max) {
-    double Fmin = exp(min);
-    double Fmax = exp(max);
+    double Fmin = 1 - exp(-min / mean);
+    double Fmax = 1 - exp(-max / mean);
 
     // Generate uniform random number
-    double r = ((double)rand() / (RAND_MAX));
+    double r = runif();
 
     // Inverse sampling
     double p = r * (Fmax - Fmin) + Fmin;
     return -mean * log(1 - p);
 }
 
+// Mean of the truncated exponential distribution sampled by rtexp
+inline double rtexp_mean(double mean, double min, double max) {
+    double Smin = exp(-min / mean);
+    double Smax = exp(-max / mean);
+    return mean + (min * Smin - max * Smax) / (Smin - Smax);
+}
+
 template <typename T>
 inline void delete_linkedlist(T* first) {
     T* next = first;
@@ -208,4 +276,44 @@ inline double boxcox(double x, double lambda) {
     }
 }
 
+/**
+ * @brief Quantile function of the standard normal distribution
+ *
+ * Uses the rational approximation of Acklam, which has a relative error
+ * below 1.15e-9 across (0, 1).
+ *
+ * @param p Probability, strictly between 0 and 1
+ * @return z such that P(Z <= z) = p for a standard normal Z
+ */
+double qnorm(double p);
+
+/**
+ * @brief Whether the processor supports the AVX2 and FMA instructions used by
+ * the vectorised kernels (e.g. LogitDeliveryModel). Those kernels are
+ * compiled for their own target, so the library as a whole still runs on
+ * processors without them.
+ */
+bool avx2_available();
+
+/**
+ * @brief Half-width of the Wilson score interval for a binomial proportion
+ *
+ * Preferred over the normal approximation since it remains sensible when
+ * the observed proportion is at (or very near) 0 or 1, as happens early in a
+ * batch of a lopsided fixture.
+ *
+ * @param successes Number of successes observed
+ * @param n Number of trials
+ * @param z Standard normal quantile for the desired confidence level
+ * @return Half-width of the interval, or 1 if there are no trials
+ */
+inline double wilson_half_width(double successes, double n, double z) {
+    if (n <= 0)
+        return 1;
+
+    double p = successes / n;
+    double z2 = z * z;
+    return z * sqrt(p * (1 - p) / n + z2 / (4 * n * n)) / (1 + z2 / n);
+}
+
 #endif // UTILITY_H
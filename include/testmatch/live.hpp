@@ -0,0 +1,146 @@
+// -*- lsst-c++ -*-
+/* live.hpp
+ *
+ * In-play win probabilities from a live ball-by-ball feed. Each delivery from
+ * the feed is applied to a live Match with the same score-update code used in
+ * simulation, and a batch of continuations is then simulated from the new
+ * state on a persistent pool of worker threads.
+ *
+ * Feeds are plain text, with one delivery per line in the form
+ *      outcome[,dismissal[,bowler]]
+ * where outcome is one of Model::DELIV_OUTCOMES (e.g. "0", "4", "1lb", "W"),
+ * dismissal is the abbreviated mode of dismissal for a wicket (e.g. "c",
+ * "lbw"), sampled if left blank, and bowler is the last name of the bowler,
+ * which overrides the bowling manager's choice. Blank lines and lines
+ * starting with # are ignored.
+ *
+ */
+
+#ifndef LIVE_H
+#define LIVE_H
+
+#include "batch.hpp"
+#include "enums.hpp"
+#include "pregame.hpp"
+#include "simulation.hpp"
+#include "workers.hpp"
+
+#include <functional>
+#include <istream>
+#include <string>
+
+/**
+ * @brief A single delivery from a ball-by-ball feed.
+ */
+struct FeedBall {
+    std::string outcome;
+    bool has_dism;
+    DismType dism;
+    /**
+     * @brief Last name of the bowler, or empty to keep the current bowler.
+     */
+    std::string bowler;
+};
+
+/**
+ * @brief Parse a line of a ball-by-ball feed.
+ * @param line Line of the feed.
+ * @param ball Parsed delivery, only set if the line contains one.
+ * @return Whether the line contains a delivery, rather than being blank or a
+ * comment.
+ */
+bool parse_feed_line(std::string line, FeedBall& ball);
+
+/**
+ * @brief Apply a delivery from a feed to a match in progress.
+ * @param match Match which has been set up with Match::pregame().
+ * @param ball Delivery to apply. A named bowler must be in the bowling XI.
+ * @return Whether the match is over.
+ */
+bool apply_feed_ball(Match& match, const FeedBall& ball);
+
+/**
+ * @brief Win probabilities after a delivery from the feed.
+ */
+struct LiveUpdate {
+    /**
+     * @brief Number of deliveries applied from the feed so far.
+     */
+    unsigned int ball;
+    /**
+     * @brief Score of the current innings, e.g. "Australia 123/4 (40.2 ov)".
+     */
+    std::string state;
+    /**
+     * @brief Results of the continuations from the current state.
+     */
+    BatchResult result;
+    /**
+     * @brief Wall time taken to simulate the continuations.
+     */
+    double elapsed_ms;
+
+    /**
+     * @brief Format as a single comma-separated line of the ball, state, home
+     * win, away win, draw and tie probabilities, and elapsed time.
+     */
+    std::string print();
+};
+
+/**
+ * @brief A match in progress, updated from a live ball-by-ball feed.
+ *
+ * The same seed is used for every update, so successive estimates share
+ * common random numbers and change smoothly from ball to ball. Details of
+ * deliveries from the feed (e.g. the fielder for a catch) are sampled from a
+ * stream of the match's own, so the random stream of the calling thread is
+ * left as it was.
+ */
+class LiveMatch {
+  private:
+    Match match;
+    BatchOptions opts;
+    WorkerPool pool;
+    unsigned int n_balls;
+
+    // Random stream of the deliveries applied from the feed, swapped in for
+    // the stream of the calling thread while each is applied
+    RngState feed_rng;
+
+  public:
+    /**
+     * @brief Set up a live match after the toss.
+     * @param detail Teams and venue.
+     * @param toss Actual result of the toss.
+     * @param c_opts Options for the batch of continuations after each ball.
+     * The number of threads sets the size of the worker pool.
+     */
+    LiveMatch(Pregame detail, TossResult toss,
+              BatchOptions c_opts = BatchOptions());
+
+    /**
+     * @brief Apply a delivery from the feed to the live match.
+     * @return Whether the match is over.
+     */
+    bool apply(const FeedBall& ball);
+
+    /**
+     * @brief Simulate continuations from the current state of the match.
+     */
+    LiveUpdate update();
+
+    /**
+     * @brief Apply each delivery from a feed in turn, updating the win
+     * probabilities after each. Reads until the end of the feed (e.g. the
+     * writer closing a pipe) or the end of the match.
+     * @param feed Stream of feed lines, e.g. a file or named pipe.
+     * @param callback Function called with each update.
+     * @return Number of deliveries applied.
+     */
+    unsigned int follow(std::istream& feed,
+                        std::function<void(LiveUpdate&)> callback);
+
+    Match& get_match();
+};
+
+#endif // LIVE_H
@@ -0,0 +1,106 @@
+// -*- lsst-c++ -*-
+/* logit.hpp
+ *
+ * A multinomial logit model of the outcome of a delivery, over features of
+ * the batter, the bowler and the pitch. Unlike the built-in model, in which
+ * the run outcomes depend only on the type of bowler, every outcome depends
+ * on both players. Inference over all 22 outcomes is vectorised with AVX2
+ * where the processor supports it, with a scalar fallback chosen at run time,
+ * and is only done once for each pairing of batter and bowler in a
+ * MatchupTable, so the model costs the same per ball as the built-in one.
+ *
+ */
+
+#ifndef LOGIT_H
+#define LOGIT_H
+
+#include "models.hpp"
+
+/**
+ * @brief Coefficients of a multinomial logit delivery model.
+ */
+struct LogitCoefficients {
+    /**
+     * @brief Number of features of a matchup (see
+     * LogitDeliveryModel::features()).
+     */
+    static const int NUM_FEATURES = 8;
+
+    /**
+     * @brief Coefficient of each feature for each outcome, in the order of
+     * Model::DELIV_OUTCOMES. Only differences between outcomes matter, and
+     * the first outcome (a dot ball) is conventionally all zero.
+     */
+    double weights[22][NUM_FEATURES];
+};
+
+/**
+ * @brief Multinomial logit model of the outcome of a delivery.
+ *
+ * The probability of each outcome is proportional to the exponential of its
+ * linear predictor, the dot product of its coefficients with the features of
+ * the matchup.
+ */
+class LogitDeliveryModel : public DeliveryModel {
+  private:
+    // Outcomes, padded to a whole number of AVX2 vectors of four doubles
+    static const int NUM_PADDED = 24;
+
+    // Coefficients by feature then outcome, so that the linear predictors of
+    // every outcome are accumulated a feature at a time. Padding is zero
+    double weights[LogitCoefficients::NUM_FEATURES][NUM_PADDED];
+
+    bool use_simd;
+
+    // Kernels writing the cumulative distribution of a single matchup from
+    // its features
+    void evaluate_scalar(const double* x, double* dist) const;
+    void evaluate_avx2(const double* x, double* dist) const;
+
+  public:
+    /**
+     * @brief Create a model.
+     * @param c_coefs Coefficients, by default those of
+     * LogitDeliveryModel::default_coefficients().
+     * @param c_simd Whether to use the AVX2 kernel where it is available.
+     */
+    LogitDeliveryModel(LogitCoefficients c_coefs = default_coefficients(),
+                       bool c_simd = true);
+
+    /**
+     * @brief Heuristic coefficients, reproducing the built-in model (with the
+     * coefficients of the calling thread) for a batter averaging 30 at a
+     * strike rate of 50 facing a pace bowler averaging 30 at a strike rate of
+     * 60. Wickets become likelier against better bowlers and worse batters,
+     * and runs likelier for faster-scoring batters and more expensive
+     * bowlers, while spin bowlers take on the outcome proportions of spin.
+     */
+    static LogitCoefficients default_coefficients();
+
+    /**
+     * @brief Features of a matchup, in order: an intercept; the logarithms of
+     * the batting average over 30, batting strike rate over 50, bowling
+     * average over 30 and bowling strike rate over 60; whether the bowler is
+     * slow (as for is_slow_bowler()); the pitch factor for the type of bowler
+     * less one half (zero if the pitch is unknown); and whether the batter
+     * bats on the side the bowler bowls from.
+     * @param matchup Matchup.
+     * @param x Array of LogitCoefficients::NUM_FEATURES values to fill.
+     */
+    static void features(const Matchup& matchup, double* x);
+
+    /**
+     * @brief Whether the processor supports the AVX2 kernel.
+     */
+    static bool simd_available();
+
+    /**
+     * @brief Whether evaluations use the AVX2 kernel.
+     */
+    bool get_use_simd() const;
+
+    void evaluate(const Matchup* matchups, int n,
+                  double* output) const override;
+};
+
+#endif // LOGIT_H
@@ -1,6 +1,12 @@
 // -*- lsst-c++ -*-
-/* MatchTime.h
+/* matchtime.hpp
  *
+ * The clock of a five day Test match, kept in whole seconds. Each delivery
+ * takes a sampled time, and the drinks breaks, intervals and close of play of
+ * each day are taken at the end of the first over after they fall due, from
+ * a schedule fixed at compile time, so the clock costs an addition per
+ * delivery and a comparison per over. A match still in progress at the close
+ * of the last day is drawn.
  *
  */
 
@@ -21,11 +27,17 @@ class TimeOfDay {
     uint _hrs;
 
     static std::string two_digits(int val);
+
+    // Carry seconds and minutes above 59 into the next unit
     void rounder();
 
   public:
     TimeOfDay();
-    TimeOfDay(uint hrs, uint min, uint sec);
+    TimeOfDay(uint sec, uint min, uint hrs);
+
+    /**
+     * @brief Time written as hours and minutes, e.g. 10.30 for 10:30.
+     */
     TimeOfDay(double dr);
 
     // Explicit casts
@@ -37,7 +49,7 @@ class TimeOfDay {
     uint min();
     uint hrs();
 
-    // Explicit setter
+    // Explicit setter, from hours and minutes as for TimeOfDay(double)
     void set(double dr);
 
     // Overloaded operators
@@ -47,95 +59,157 @@ class TimeOfDay {
     TimeOfDay& operator+=(const TimeOfDay& rhs);
     TimeOfDay& operator+=(const int& rhs);
 
-    friend bool operator==(const TimeOfDay& lhs, const TimeOfDay& rhs);
     friend bool operator==(const TimeOfDay& lhs, const TimeOfDay& rhs);
 
     friend TimeOfDay operator+(TimeOfDay lhs, const TimeOfDay& rhs);
     friend TimeOfDay operator+(TimeOfDay lhs, const int& rhs);
 };
 
+/**
+ * @brief Time of day and day of a match, and the schedule of play.
+ *
+ * Play runs in three sessions a day, from START_TIME to lunch, lunch to tea
+ * and tea to CLOSE_PLAY, with a drinks break in the middle of each. Breaks
+ * are taken at the end of the first over after they are due, and a session
+ * which runs late is made up from the next. Play at the close continues until
+ * MIN_OVERS overs have been bowled in the day, for at most MAXIMUM_EXTEND
+ * more.
+ */
 class MatchTime {
+  public:
+    // Schedule of each day, in seconds after midnight, and durations in
+    // seconds
+    static constexpr int START_TIME = 10 * 3600 + 30 * 60; // 10:30
+    static constexpr int LUNCH_START = 12 * 3600 + 30 * 60;
+    static constexpr int LUNCH_DUR = 2400; // 40 minutes
+    static constexpr int TEA_START = 15 * 3600 + 10 * 60;
+    static constexpr int TEA_DUR = 1200; // 20 minutes
+    static constexpr int CLOSE_PLAY = 17 * 3600 + 30 * 60;
+
+    static constexpr int OVERCHA_DUR = 30;
+    static constexpr int DRINKS_DUR = 300; // 5 minutes
+    static constexpr int INNBRE_DUR = 600; // 10 minutes
+    static constexpr int WICKET_DUR = 120; // 2 minutes
+
+    // Overs to be bowled in a day, and the longest the last session may be
+    // extended by to bowl them
+    static constexpr int MIN_OVERS = 90;
+    static constexpr int MAXIMUM_EXTEND = 1800; // 30 minutes
+
+    static constexpr int NUM_DAYS = 5;
+    static constexpr int SESSIONS_PER_DAY = 3;
+
+    /**
+     * @brief Duration of an over at the required rate of 15 overs an hour,
+     * for estimates of the overs left in the match.
+     */
+    static constexpr int NOMINAL_OVER_DUR = 240;
 
   private:
-    // Parameters
-    static float START_TIME;
-    static float LUNCH_START;
-    static int LUNCH_DUR; // 40 minutes
-    static float TEA_START;
-    static int TEA_DUR; // 20 minutes
-    static float CLOSE_PLAY;
-
-    static int OVERCHA_DUR;
-    static int DRINKS_DUR; // 5 minutes
-    static int INNBRE_DUR; // 10 minutes
-
-    // Maximum amount of time which a session can be extended by
-    static int MAXIMUM_EXTEND; // 30 minutes
-
-    // Delivery duration statistics
-    static double PACE_MINDUR;
-    static double PACE_MAXDUR;
-    static double SPIN_MINDUR;
-    static double SPIN_MAXDUR;
-    static double PACE_MEANDUR;
-    static double SPIN_MEANDUR;
-    // static double DEL_STDDUR = 0.5;
-    static double RUN_DUR;
-
-    TimeOfDay time;
+    // Delivery duration statistics, in seconds: a truncated exponential for
+    // each type of bowler, and the time taken by each run. Thread-local so
+    // that concurrent simulations can use different values
+    static thread_local double PACE_MINDUR;
+    static thread_local double PACE_MAXDUR;
+    static thread_local double SPIN_MINDUR;
+    static thread_local double SPIN_MAXDUR;
+    static thread_local double PACE_MEANDUR;
+    static thread_local double SPIN_MEANDUR;
+    static thread_local double RUN_DUR;
+
+    int time;
     int day;
 
-    std::string state;
-    /* Permissable match states
-        "Match Start"   - Time at start of session 1, day 1
-        "Session 1"     - Session 1, as defined in Parameters.h
-        "Drinks 1"      - Drinks break during session 1
-        "Lunch"         - Lunch break, as defined in Parameters.h
-        "Session 2"     - As above
-        "Drinks 2"      - As above
-        "Tea"           - Tea break, as defined in Parameters.h
-        "Session 3"     - As above
-        "Drinks 3"      - As above
-        "Innings Break" - Break between team innings
-        "Stumps"        - End of day
-        "Rain Delay"    - Currently unused
-    */
-
-    // Indicates whether current session has been extended by 30 minutes
-    bool extended;
-
-    // Indicates whether drinks have been taken in the current session
-    bool after_drinks;
-
-    // Private utility functions
-    bool take_lunch();
-    bool take_tea();
-    bool close_day();
-    void check_state_change();
+    // Next event in the schedule of the day, and overs bowled in the day
+    int next;
+    int day_overs;
+
+    // Delivery duration statistics of a pace bowler (0) and a spinner (1),
+    // and the time taken by each run, fixed when the clock is created
+    double mean_dur[2];
+    double min_dur[2];
+    double max_dur[2];
+    double run_dur;
+
+    // Take every break in the schedule which has fallen due, returning
+    // whether play stopped
+    bool take_breaks();
 
   public:
     // Default constructor - start of match, day 1
     MatchTime();
-    // MatchTime(Time c_tm, int c_day, std::string c_state);
-
-    // Time controls for use by simulation
-    std::pair<int, std::string> delivery(bool type, int runs);
-    std::pair<int, std::string> wicket();
-    std::pair<int, std::string> end_over();
-    std::pair<int, std::string> drinks();
-    std::string force_early_break();
-    std::string extend_session();
-    std::string end_innings();
-    // Returned strings indicate match state, used for error checking and
-    // interaction with Match object
+
+    /**
+     * @brief Sample the time taken by a delivery, and by any runs scored
+     * from it.
+     * @param is_spin Whether the bowler is a slow bowler.
+     * @param runs Runs scored, including extras.
+     */
+    void delivery(bool is_spin, int runs);
+
+    /**
+     * @brief Add the time taken by a run of dot balls, sampling the
+     * duration of each as in delivery().
+     */
+    void dots(bool is_spin, int n);
+
+    /**
+     * @brief Add the time taken by a wicket, including the delivery and the
+     * arrival of the new batter.
+     */
+    void wicket(bool is_spin);
+
+    /**
+     * @brief Change ends, then take any break which is due.
+     * @return Whether play stopped for a break, e.g. lunch or the close of
+     * play.
+     */
+    bool end_over();
+
+    /**
+     * @brief Change innings, then take any break which is due.
+     * @return Whether play stopped for a break.
+     */
+    bool end_innings();
+
+    /**
+     * @brief Whether time has run out, at the close of the last day.
+     */
+    bool is_over() const;
+
+    /**
+     * @brief Session of the match, from 0 on the first morning to
+     * NUM_DAYS * SESSIONS_PER_DAY - 1 on the last evening.
+     */
+    int get_session() const;
+
+    /**
+     * @brief Scheduled playing time left in the match, in seconds, and as
+     * overs at the nominal over rate.
+     */
+    int play_left() const;
+    double overs_left() const;
+
+    /**
+     * @brief Scheduled playing time left in the day, in seconds.
+     */
+    int play_left_today() const;
 
     // Getters
     TimeOfDay get_time();
-    int get_day();
-    std::string get_state();
+    int get_seconds() const;
+    int get_day() const;
+
+    /**
+     * @brief Session of the day in play ("Session 1" to "Session 3"), or
+     * "Stumps" once time has run out.
+     */
+    std::string get_state() const;
 
     // Overloaded operators
     operator std::string();
+
+    friend class ParamRegistry;
 };
 
-#endif // MATCHTIME_H
\ No newline at end of file
+#endif // MATCHTIME_H
@@ -3,8 +3,13 @@
 
 #include "cards.hpp"
 #include "enums.hpp"
+#include "pregame.hpp"
 #include "team.hpp"
 
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -34,15 +39,106 @@ double MODEL_TOSS_ELECT(double spin_factor);
 double prob_wkt(BatStats bat, BowlStats bowl, MatchStats match);
 
 /**
- * @brief
+ * @brief Coefficients of the delivery and dismissal models, against pace and
+ * spin bowling.
+ */
+struct Coefficients {
+    /**
+     * @brief Cumulative distribution of the outcomes other than a wicket,
+     * before rescaling by the probability of survival.
+     */
+    double pace_cdf[21];
+    double spin_cdf[21];
+    /**
+     * @brief Cumulative distribution of the mode of dismissal, in the order of
+     * DISM_MODES_STATIC.
+     */
+    double pace_dism_cdf[6];
+    double spin_dism_cdf[6];
+    /**
+     * @brief Probability of electing to field at the toss on a pitch with no
+     * spin, and on one with nothing but spin (see MODEL_TOSS_ELECT).
+     */
+    double toss_elect[2];
+    /**
+     * @brief Box-Cox parameter of the lead, then the intercept and slope of
+     * the logistic regression of MODEL_FOLLOW_ON.
+     */
+    double follow_on[3];
+    /**
+     * @brief Change in the probability of a wicket, and in that of the modes
+     * of dismissal favoured by the pitch, per unit of suitability of the
+     * pitch for the bowler, then the share of the seam left in a pitch which
+     * turns to spin each session (see MODEL_PITCH_WEAR).
+     */
+    double pitch[3];
+};
+
+/**
+ * @brief Built-in coefficients: placeholder data proportions, published at
+ * startup unless replaced by a fitted coefficient file (see calibration.hpp).
+ */
+extern const Coefficients DEFAULT_COEFFICIENTS;
+
+/**
+ * @brief Coefficients in use on the calling thread, copied from the published
+ * coefficients when the thread first uses them, so that concurrent
+ * simulations can use different values (see params.hpp).
+ */
+extern thread_local Coefficients COEFFICIENTS;
+
+/**
+ * @brief Coefficients which threads copy when they prepare a match.
+ */
+std::shared_ptr<const Coefficients> published_coefficients();
+
+/**
+ * @brief Replace the published coefficients, e.g. with those of a newly
+ * fitted coefficient file, while other threads are simulating.
+ *
+ * Publication is a single atomic swap of a pointer, so it never waits for
+ * simulations in progress, nor they for it. Each thread copies the new
+ * coefficients the next time it prepares a match (see sync_coefficients()),
+ * so matches in progress finish with the coefficients they started with. The
+ * previous coefficients are released once no thread holds them.
+ */
+void publish_coefficients(std::shared_ptr<const Coefficients> coefs);
+
+/**
+ * @brief Copy the published coefficients to the calling thread, if they have
+ * been replaced since it last did so and it has not pinned its own. Called by
+ * Match::pregame().
+ * @return Whether the coefficients of the thread changed.
+ */
+bool sync_coefficients();
+
+/**
+ * @brief Keep (or stop keeping) the coefficients of the calling thread when
+ * others are published, e.g. while it simulates with values of its own. Set
+ * by ParamRegistry::set() and cleared by ParamRegistry::reset().
+ */
+void pin_coefficients(bool pinned);
+bool coefficients_pinned();
+
+/**
+ * @brief Cumulative distribution of the outcome of a delivery: the data
+ * proportions of the outcomes other than a wicket, scaled by the probability
+ * of survival.
  *
  * @param bat
  * @param bowl
- * @param match
- * @return double*
+ * @return double* Array of NUM_DELIV_OUTCOMES values, owned by the caller
  */
 double* MODEL_DELIVERY(BatStats bat, BowlStats bowl);
 
+/**
+ * @brief Expected runs from a delivery, including extras.
+ *
+ * @param dist Outcome distribution, as returned by MODEL_DELIVERY
+ * @return double Expected number of runs
+ */
+double expected_runs(const double* dist);
+
 /**
  * @brief
  *
@@ -51,6 +147,30 @@ double* MODEL_DELIVERY(BatStats bat, BowlStats bowl);
  */
 DismType MODEL_WICKET_TYPE(BowlType bowltype);
 
+/**
+ * @brief Cumulative distribution of the mode of dismissal, in the order of
+ * DISM_MODES_STATIC. A pitch which suits the type of bowler brings more edges
+ * for pace bowlers, and more batters beaten (bowled, lbw and stumped) by spin.
+ *
+ * @param bowltype Type of the bowler
+ * @param pitch Pitch conditions, or all zero if unknown
+ * @param output Array of NUM_DISM_MODES values
+ */
+void dism_cdf(BowlType bowltype, PitchFactors pitch, double* output);
+
+/**
+ * @brief Pitch conditions during a session, as the pitch wears and turns to
+ * suit spin bowling more and seam bowling less. The spin factor approaches
+ * one exponentially, by a share of the remainder each session (5% unless
+ * the coefficients say otherwise).
+ *
+ * @param pitch Conditions at the start of the match, or all zero if unknown
+ * @param session Number of sessions already played in the match, e.g. 0 on
+ * the first morning and 14 on the last evening of the fifth day
+ * @return PitchFactors Conditions during the session, all zero if unknown
+ */
+PitchFactors MODEL_PITCH_WEAR(PitchFactors pitch, int session);
+
 /**
  * @brief Evaluates the "value" in bringing a bowler into the attack, based on
  * their ability and fatigue
@@ -65,10 +185,10 @@ double OBJ_AVG_FATIG(double bowl_avg, double bowl_sr, double fatigue);
 /**
  * @brief Determine the probability of declaring on a given ball.
  *
- * @param lead
- * @param match_balls
- * @param is_wkt
- * @param innings
+ * @param lead Lead of the batting team.
+ * @param match_balls Number of balls bowled in the match so far.
+ * @param is_wkt Whether a wicket has just fallen.
+ * @param innings Innings number, from 1 to 4.
  * @return double
  */
 double MODEL_DECLARATION(int lead, int match_balls, bool is_wkt, int innings);
@@ -83,4 +203,317 @@ double MODEL_FOLLOW_ON(int lead);
 
 }; // namespace Model
 
+/**
+ * @brief A batter facing a bowler, as input to a DeliveryModel.
+ */
+struct Matchup {
+    BatStats bat;
+    BowlStats bowl;
+    // Pitch conditions, or all zero if unknown
+    PitchFactors pitch;
+    // State of the match, or all zero if unknown
+    MatchStats situation;
+};
+
+/**
+ * @brief Model of the outcome of a delivery, given the batter and bowler.
+ *
+ * Models are evaluated in batches, so implementations can amortise their
+ * cost (e.g. vectorising over matchups). Implementations must be safe to
+ * evaluate from several threads at once.
+ */
+class DeliveryModel {
+  public:
+    virtual ~DeliveryModel() = default;
+
+    /**
+     * @brief Evaluate the outcome distribution of each matchup.
+     * @param matchups Array of n matchups.
+     * @param n Number of matchups.
+     * @param output Array of n * Model::NUM_DELIV_OUTCOMES values, filled with
+     * the cumulative distribution of each matchup in turn, in the form
+     * returned by Model::MODEL_DELIVERY.
+     */
+    virtual void evaluate(const Matchup* matchups, int n,
+                          double* output) const = 0;
+
+    /**
+     * @brief Whether the distributions depend on the situation of each
+     * matchup. If not, innings evaluate the model once per pairing (see
+     * MatchupTable), and otherwise once per pairing and bucket of situations
+     * (see SituationTable).
+     */
+    virtual bool uses_situation() const { return false; }
+
+    /**
+     * @brief The built-in model, Model::MODEL_DELIVERY, with the coefficients
+     * of the calling thread.
+     */
+    static const DeliveryModel* builtin();
+};
+
+/**
+ * @brief Model::MODEL_DELIVERY as a DeliveryModel.
+ */
+class BuiltinDeliveryModel : public DeliveryModel {
+  public:
+    void evaluate(const Matchup* matchups, int n,
+                  double* output) const override;
+};
+
+/**
+ * @brief Distributions of a delivery between a batter and bowler, as stored by
+ * MatchupTable and SituationTable.
+ */
+struct DeliveryDists {
+    // Cumulative outcome distribution, as returned by Model::MODEL_DELIVERY
+    double cdf[22];
+
+    // Cumulative distribution given that the delivery is not a dot ball, and
+    // the probability of a dot ball
+    double scoring_cdf[22];
+    double dot_prob;
+
+    // Expected runs and wickets of the delivery
+    double exp_runs;
+    double exp_wkts;
+};
+
+/**
+ * @brief Delivery outcome distributions for every pairing of batter and bowler
+ * from two XIs.
+ *
+ * The delivery model only depends on the career statistics stored on each
+ * card, so distributions can be evaluated once per pairing rather than on
+ * every ball. Tables are immutable once built, and are shared between an
+ * innings, later innings with the same batting and bowling teams, and clones
+ * of the match.
+ */
+class MatchupTable {
+  private:
+    // Distributions of each pairing, indexed by batter, then bowler
+    std::vector<DeliveryDists> dists;
+
+    // Cumulative distribution of the mode of dismissal of each bowler
+    std::vector<double> dism_cdfs;
+
+    // Evaluate the model for each pairing
+    void evaluate(const std::vector<Matchup>& matchups,
+                  const DeliveryModel* model);
+
+  public:
+    /**
+     * @brief Evaluate the delivery model for each pairing, as a single batch.
+     * @param batters BatterCards of the batting XI, in batting order.
+     * @param bowlers BowlerCards of the bowling XI, in batting order.
+     * @param model Delivery model, or nullptr for the built-in model.
+     * @param pitch Pitch conditions, or nullptr if unknown.
+     */
+    MatchupTable(BatterCard** batters, BowlerCard** bowlers,
+                 const DeliveryModel* model = nullptr,
+                 const PitchFactors* pitch = nullptr);
+
+    /**
+     * @brief Evaluate the delivery model for the given matchups, as a single
+     * batch.
+     * @param matchups Matchup of each pairing, indexed by batter, then
+     * bowler.
+     * @param model Delivery model, or nullptr for the built-in model.
+     */
+    MatchupTable(const std::vector<Matchup>& matchups,
+                 const DeliveryModel* model = nullptr);
+
+    /**
+     * @brief Cumulative outcome distribution, as returned by
+     * Model::MODEL_DELIVERY, for the given batter and bowler (indices in the
+     * XIs).
+     */
+    const double* cdf(int bat, int bowl) const;
+
+    // Expected runs and wickets of a delivery, as control variates
+    double expected_runs(int bat, int bowl) const;
+    double expected_wkts(int bat, int bowl) const;
+
+    /**
+     * @brief Probability that a delivery is a dot ball.
+     */
+    double dot_prob(int bat, int bowl) const;
+
+    /**
+     * @brief Cumulative outcome distribution given that the delivery is not a
+     * dot ball, in the same form as cdf().
+     */
+    const double* scoring_cdf(int bat, int bowl) const;
+
+    /**
+     * @brief Every distribution for the given batter and bowler.
+     */
+    const DeliveryDists& get(int bat, int bowl) const;
+
+    /**
+     * @brief Cumulative distribution of the mode of dismissal, as returned by
+     * Model::dism_cdf(), for the given bowler.
+     */
+    const double* dism_cdf(int bowl) const;
+
+    /**
+     * @brief Hash of every distribution in the table, identifying results
+     * precomputed from it (e.g. a ChaseTable).
+     */
+    unsigned long long fingerprint() const;
+};
+
+/**
+ * @brief MatchupTables for every session of a five day match, each with the
+ * pitch as worn by the start of the session (see Model::MODEL_PITCH_WEAR).
+ *
+ * The table of a session is evaluated once, the first time it is needed, and
+ * shared by every innings and clone of the match, so an innings only switches
+ * between tables at the end of an over which crosses into a new session.
+ * Innings of a match take their session from its clock (see MatchTime), while
+ * sessions of an innings played without one are a nominal 30 overs, and stay
+ * in the last session beyond the fifth day. Sessions with the same pitch
+ * conditions (e.g. every session, if the pitch is unknown) share a table.
+ * Every table is evaluated with the coefficients in use when the
+ * SessionTables were made, even if another thread evaluates it after picking
+ * up newly published ones.
+ */
+class SessionTables {
+  public:
+    static const int NUM_SESSIONS = 15;
+    static const int SESSION_BALLS = 30 * 6;
+
+  private:
+    const DeliveryModel* model;
+    Model::Coefficients coefs;
+
+    // Matchups of each pairing, indexed by batter, then bowler, on the pitch
+    // at the start of the match
+    std::vector<Matchup> matchups;
+
+    // Tables evaluated so far, which may be shared by several threads
+    mutable std::shared_ptr<const MatchupTable> tables[NUM_SESSIONS];
+    mutable std::mutex mutex;
+
+  public:
+    /**
+     * @param batters BatterCards of the batting XI, in batting order.
+     * @param bowlers BowlerCards of the bowling XI, in batting order.
+     * @param model Delivery model, or nullptr for the built-in model.
+     * @param pitch Pitch conditions at the start of the match, or nullptr if
+     * unknown.
+     */
+    SessionTables(BatterCard** batters, BowlerCard** bowlers,
+                  const DeliveryModel* model = nullptr,
+                  const PitchFactors* pitch = nullptr);
+
+    SessionTables(const SessionTables&) = delete;
+    SessionTables& operator=(const SessionTables&) = delete;
+
+    /**
+     * @brief Session, from 0 to NUM_SESSIONS - 1, in which a delivery is
+     * bowled.
+     * @param match_balls Legal deliveries bowled in the match before it.
+     */
+    static int session_of(int match_balls);
+
+    /**
+     * @brief Table of the given session, evaluating it if it has not been.
+     */
+    std::shared_ptr<const MatchupTable> get(int session) const;
+
+    /**
+     * @brief Number of distinct tables evaluated so far.
+     */
+    int size() const;
+};
+
+/**
+ * @brief Delivery outcome distributions for every pairing of batter and bowler
+ * from two XIs, and every bucket of match situations, for delivery models
+ * which depend on the situation.
+ *
+ * Situations are bucketed by the age of the ball, balls faced by the batter,
+ * required rate and day of the match, and the model is evaluated at a
+ * representative situation of each bucket, separately for each innings, with
+ * the pitch as worn by the middle of the day.
+ * Distributions are evaluated the first time they are needed, and, like a
+ * MatchupTable, the table is shared between innings with the same batting
+ * and bowling teams and clones of the match, which may be simulated from
+ * several threads at once. As for SessionTables, every distribution is
+ * evaluated with the coefficients in use when the table was made.
+ */
+class SituationTable {
+  private:
+    // Number of buckets of each input
+    static const int AGE_BUCKETS = 4;
+    static const int FACED_BUCKETS = 4;
+    static const int RATE_BUCKETS = 5;
+    static const int DAY_BUCKETS = 5;
+
+    const DeliveryModel* model;
+    Model::Coefficients coefs;
+
+    // Matchups of each pairing, indexed by batter, then bowler
+    std::vector<Matchup> matchups;
+
+    // Distributions of each innings and bucket, allocated on first use, then
+    // of each pairing in the bucket, evaluated on first use. Both are owned by
+    // the deques, which never move their elements
+    struct Bucket {
+        std::atomic<const DeliveryDists*> dists[11 * 11];
+    };
+    std::atomic<Bucket*> buckets[4 * AGE_BUCKETS * FACED_BUCKETS *
+                                 RATE_BUCKETS * DAY_BUCKETS];
+    std::deque<Bucket> bucket_store;
+    std::deque<DeliveryDists> dists_store;
+    mutable std::mutex mutex;
+
+    // Evaluate the model for a pairing in a bucket of an innings, unless
+    // another thread already has
+    const DeliveryDists& fill(int bat, int bowl, int innings, int bucket);
+
+  public:
+    /**
+     * @brief Number of buckets of situations in an innings.
+     */
+    static const int NUM_BUCKETS =
+        AGE_BUCKETS * FACED_BUCKETS * RATE_BUCKETS * DAY_BUCKETS;
+
+    /**
+     * @param batters BatterCards of the batting XI, in batting order.
+     * @param bowlers BowlerCards of the bowling XI, in batting order.
+     * @param model Delivery model.
+     * @param pitch Pitch conditions, or nullptr if unknown.
+     */
+    SituationTable(BatterCard** batters, BowlerCard** bowlers,
+                   const DeliveryModel* model,
+                   const PitchFactors* pitch = nullptr);
+
+    SituationTable(const SituationTable&) = delete;
+    SituationTable& operator=(const SituationTable&) = delete;
+
+    /**
+     * @brief Bucket of a situation, from 0 to NUM_BUCKETS - 1. The innings
+     * number is not part of the bucket.
+     */
+    static int bucket(const MatchStats& situation);
+
+    /**
+     * @brief Situation at which the model is evaluated for a bucket.
+     */
+    static MatchStats representative(int bucket, int innings);
+
+    /**
+     * @brief Distributions for the given batter and bowler (indices in the
+     * XIs) in the innings and bucket of the given situation.
+     */
+    const DeliveryDists& get(int bat, int bowl, const MatchStats& situation);
+
+    /**
+     * @brief Number of pairings and buckets evaluated so far.
+     */
+    int size() const;
+};
+
 #endif // PREDICTION_H
@@ -0,0 +1,114 @@
+// -*- lsst-c++ -*-
+/* params.hpp
+ *
+ * Named access to the tunable constants of the simulation models, such as the
+ * rate at which bowlers tire or the hard-coded delivery outcome proportions.
+ * The constants are thread-local, so each thread may simulate with its own
+ * values (e.g. a different point of a parameter sweep on each worker) while
+ * every other thread keeps the defaults.
+ *
+ */
+
+#ifndef PARAMS_H
+#define PARAMS_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Registry of the model constants which may be changed by name.
+ *
+ * Names are of the form "group.constant", e.g. "fatigue.mean_pace" or
+ * "fielding.wk_catch_prob". Entries of the delivery outcome and dismissal
+ * tables are indexed, e.g. "delivery.pace_cdf.1". Every get or set applies to
+ * the calling thread only.
+ */
+class ParamRegistry {
+  private:
+    struct Entry {
+        std::string name;
+        // Location of the constant for the calling thread
+        std::function<double*()> locate;
+        double default_value;
+        // Default shared with other code (the published model coefficients),
+        // if any, in place of default_value
+        std::function<double()> shared_default;
+
+        double get_default() const;
+    };
+
+    // Every entry, with defaults captured before main() is entered
+    static std::vector<Entry>& entries();
+
+    // Entry with the given name, throwing std::invalid_argument if there is
+    // none
+    static Entry& find(const std::string& name);
+
+  public:
+    /**
+     * @brief Names of every constant, in registration order.
+     */
+    static std::vector<std::string> names();
+
+    static bool has(const std::string& name);
+
+    /**
+     * @brief Value of a constant on the calling thread.
+     */
+    static double get(const std::string& name);
+
+    /**
+     * @brief Change a constant on the calling thread. When a match already in
+     * progress on the thread sees the new value depends on the constant:
+     * - bowling.take_off_*, fielding.wk_catch_prob, toss.* and follow_on.*
+     *   are read at each decision (the next change of bowler, dismissal,
+     *   toss or follow-on);
+     * - fatigue.* and bowling.inflation_factor are fixed when the scorecards
+     *   of each innings are created;
+     * - delivery.*, dismissal.* and pitch.* are fixed in the tables of each
+     *   session, which a match builds for both teams before the first
+     *   innings;
+     * - time.* are fixed when the clock of the match is created, with the
+     *   match.
+     * Changing a model coefficient pins the coefficients of the thread, which
+     * no longer picks up newly published ones until reset().
+     */
+    static void set(const std::string& name, double value);
+
+    /**
+     * @brief Value of a constant at program start, or as currently published
+     * for a model coefficient (see Model::publish_coefficients()).
+     */
+    static double get_default(const std::string& name);
+
+    /**
+     * @brief Restore every constant on the calling thread to its default,
+     * and unpin its coefficients.
+     */
+    static void reset();
+};
+
+/**
+ * @brief Values of some constants on the calling thread for the lifetime of
+ * the object. On destruction the previous values are restored, and the
+ * coefficients of the thread are pinned again only if they were before. Throws
+ * std::invalid_argument if a name is unknown or the numbers of names and
+ * values differ, leaving every constant unchanged.
+ */
+class ParamOverride {
+  private:
+    std::vector<std::string> names;
+    std::vector<double> saved;
+    bool was_pinned;
+
+  public:
+    ParamOverride(const std::vector<std::string>& c_names,
+                  const std::vector<double>& values);
+    ~ParamOverride();
+
+    ParamOverride(const ParamOverride&) = delete;
+    ParamOverride& operator=(const ParamOverride&) = delete;
+};
+
+#endif // PARAMS_H
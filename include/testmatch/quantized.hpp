@@ -0,0 +1,148 @@
+// -*- lsst-c++ -*-
+/* quantized.hpp
+ *
+ * Precomputed delivery outcome distributions over a grid of player inputs:
+ * batting average and strike rate, bowling average and strike rate, and type
+ * of bowler. A table is built once from any DeliveryModel, stored as compact
+ * fixed-point or float cumulative distributions in a flat binary file, and
+ * memory-mapped when opened, so every process on a machine shares a single
+ * copy. Evaluating a matchup interpolates between the nearest grid points
+ * rather than running the source model.
+ *
+ */
+
+#ifndef QUANTIZED_H
+#define QUANTIZED_H
+
+#include "models.hpp"
+#include "pregame.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Options controlling the construction of a QuantizedDeliveryModel.
+ *
+ * Inputs are indexed in the order of batting average, batting strike rate,
+ * bowling average and bowling strike rate.
+ */
+struct QuantizedTableOptions {
+    /**
+     * @brief Number of grid points for each input, at least two.
+     */
+    unsigned int n_points[4] = {12, 12, 12, 12};
+    /**
+     * @brief Smallest and largest grid point of each input. Points are evenly
+     * spaced on a log scale, and inputs outside the range are clamped to it.
+     */
+    double low[4] = {2, 20, 15, 25};
+    double high[4] = {100, 120, 1000, 1000};
+    /**
+     * @brief Whether to store distributions as 16-bit fixed point (accurate to
+     * 1 / 65535), rather than 32-bit floats.
+     */
+    bool fixed_point = true;
+    /**
+     * @brief Pitch conditions at which the source model is evaluated. The
+     * batter and bowler are always on opposite sides.
+     */
+    PitchFactors pitch = {0, 0};
+};
+
+/**
+ * @brief Header of a quantized table file, followed by the cumulative
+ * distribution at each grid point, indexed by bowling type, then each input
+ * in turn, then outcome. The distribution at each point is padded with zeros
+ * to 24 values.
+ */
+struct QuantizedTableHeader {
+    char magic[8];
+    unsigned int version;
+    unsigned int fixed_point;
+    unsigned int n_outcomes;
+    unsigned int n_types;
+    unsigned int n_points[4];
+    double low[4];
+    double high[4];
+    double pitch_seam;
+    double pitch_spin;
+};
+
+/**
+ * @brief A delivery model evaluated by multilinear interpolation in a
+ * precomputed grid, with the logarithm of each input.
+ *
+ * Interpolated distributions are weighted averages of cumulative
+ * distributions, so they are always valid. Pitch conditions and batting and
+ * bowling arms are fixed when the table is built, and ignored when it is
+ * evaluated.
+ */
+class QuantizedDeliveryModel : public DeliveryModel {
+  private:
+    // Either a memory-mapped file or a table built in memory
+    void* mapping;
+    size_t mapping_size;
+    std::vector<char> buffer;
+
+    const QuantizedTableHeader* header;
+    const void* values;
+
+    // Logarithm of the lowest grid point of each input, and grid points per
+    // unit of log input
+    double log_low[4];
+    double scale[4];
+
+    // Offset in the values of a step in each input, and of each corner of a
+    // grid cell from its lowest corner
+    size_t strides[4];
+    size_t corner_offsets[16];
+
+    // Point the header and values at the start of the given data
+    void attach(const char* data, size_t size);
+
+  public:
+    /**
+     * @brief Number of bowling types in a table, one for each BowlType.
+     */
+    static const int NUM_TYPES = 6;
+
+    /**
+     * @brief Build a table by evaluating a model at every grid point.
+     * @param source Model to quantize.
+     * @param opts Grid and storage of the table.
+     */
+    QuantizedDeliveryModel(
+        const DeliveryModel& source,
+        QuantizedTableOptions opts = QuantizedTableOptions());
+
+    /**
+     * @brief Open a table previously written with save(), mapping the file
+     * into memory. Throws std::runtime_error if the file cannot be read or is
+     * not a quantized table of this version.
+     * @param path Path of the table file.
+     */
+    QuantizedDeliveryModel(std::string path);
+
+    QuantizedDeliveryModel(const QuantizedDeliveryModel&) = delete;
+    QuantizedDeliveryModel& operator=(const QuantizedDeliveryModel&) = delete;
+
+    /**
+     * @brief Write the table to a file.
+     */
+    void save(std::string path) const;
+
+    const QuantizedTableHeader& get_header() const;
+
+    /**
+     * @brief Size of the table in bytes, including the header.
+     */
+    size_t size() const;
+
+    void evaluate(const Matchup* matchups, int n,
+                  double* output) const override;
+
+    ~QuantizedDeliveryModel();
+};
+
+#endif // QUANTIZED_H
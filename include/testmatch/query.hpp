@@ -0,0 +1,139 @@
+// -*- lsst-c++ -*-
+/* query.hpp
+ *
+ * Narrow questions about a match, such as "do Australia make 300 in their
+ * first innings?" or "does Smith score a fifty?", which are usually settled
+ * long before the match is over. A query is a rule on the state of a Match
+ * as it is simulated by Match::start(), answering yes, no or not yet. Batches
+ * of simulations check the rule as they go and stop each match as soon as
+ * the answer is settled, rather than simulating the remaining innings.
+ *
+ */
+
+#ifndef QUERY_H
+#define QUERY_H
+
+#include "simulation.hpp"
+#include "team.hpp"
+
+#include <functional>
+#include <string>
+
+/**
+ * @brief A yes/no question about a match, which can be answered from the
+ * state of the match part of the way through.
+ *
+ * The rule of a query returns 1 once the answer is known to be yes, 0 once it
+ * is known to be no, and MatchQuery::UNSETTLED otherwise. Queries combine
+ * with &&, || and !, settling as soon as the combined answer is known.
+ */
+class MatchQuery {
+  private:
+    std::string name;
+    std::function<int(Match&)> rule;
+
+    // Whether the answer can be settled part-way through an innings, or only
+    // when an innings closes
+    bool by_delivery;
+
+  public:
+    static const int UNSETTLED = -1;
+
+    /**
+     * @param c_name Description of the query.
+     * @param c_rule Rule giving the answer from the state of a match.
+     * @param c_by_delivery Whether the rule needs to be checked after every
+     * delivery, rather than only at the end of each innings.
+     */
+    MatchQuery(std::string c_name, std::function<int(Match&)> c_rule,
+               bool c_by_delivery = true);
+
+    std::string get_name() const;
+    bool is_by_delivery() const;
+
+    /**
+     * @brief Answer the query for the current state of a match. A query
+     * which is still unsettled when the match is over has the answer no.
+     * @return 1, 0 or MatchQuery::UNSETTLED.
+     */
+    int settle(Match& match) const;
+
+    MatchQuery operator&&(const MatchQuery& rhs) const;
+    MatchQuery operator||(const MatchQuery& rhs) const;
+    MatchQuery operator!() const;
+
+    /**
+     * @brief Whether a team scores at least the given number of runs in one
+     * of its innings. Settled when the total is reached or the innings
+     * closes.
+     * @param team Team batting.
+     * @param team_inns Innings of the team, 1 or 2.
+     * @param runs Runs required.
+     */
+    static MatchQuery team_runs_at_least(Team* team, int team_inns, int runs);
+
+    /**
+     * @brief Whether a player scores at least the given number of runs in
+     * any innings of the match. Settled when the score is reached, or once the
+     * player can no longer bat in the team's second innings.
+     */
+    static MatchQuery player_runs_at_least(Player* player, int runs);
+
+    /**
+     * @brief Whether a team wins the match.
+     */
+    static MatchQuery wins(Team* team);
+};
+
+/**
+ * @brief Answers to a query across a batch of simulated matches.
+ */
+class QueryResult {
+  private:
+    std::string name;
+
+    // Counts for each toss stratum, or in the first entry if the toss is not
+    // stratified
+    unsigned int n_sims[4];
+    unsigned int n_true[4];
+    bool stratified;
+    double stratum_weights[4];
+
+    // Total number of innings started before the answers were settled
+    unsigned long long innings;
+
+  public:
+    QueryResult() : QueryResult("") {}
+    QueryResult(std::string c_name);
+
+    /**
+     * @brief Merge the counters of another shard of the same query.
+     */
+    QueryResult& operator+=(const QueryResult& rhs);
+
+    std::string get_name();
+    unsigned int get_n_sims();
+    unsigned int get_n_true();
+
+    /**
+     * @brief Mean number of innings started in each match before the answer
+     * was settled, out of at most four.
+     */
+    double mean_innings();
+
+    /**
+     * @brief Probability of the query holding, weighting each toss stratum
+     * by its probability if the toss was stratified.
+     */
+    double prob();
+
+    /**
+     * @brief Standard error of prob(). Pairs of antithetic matches are
+     * treated as independent, so the error is overstated when they are used.
+     */
+    double std_error();
+
+    friend class BatchRunner;
+};
+
+#endif // QUERY_H
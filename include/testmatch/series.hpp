@@ -0,0 +1,266 @@
+// -*- lsst-c++ -*-
+/* series.hpp
+ *
+ * Simulating whole series and tournaments, e.g. a five-Test Ashes series or
+ * a season of a league decided by points. Each replicate of the tournament
+ * spawns a task for each series, which spawns a task for each of its
+ * matches, all on a single work-stealing scheduler, so a tournament of a few
+ * long series keeps every worker busy as well as one of many short series.
+ *
+ */
+
+#ifndef SERIES_H
+#define SERIES_H
+
+#include "pregame.hpp"
+#include "simulation.hpp"
+#include "tactics.hpp"
+#include "team.hpp"
+#include "workers.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief A series of matches between two teams, all hosted by the home team.
+ */
+struct Series {
+    std::string name;
+    Team* home_team;
+    Team* away_team;
+    /**
+     * @brief Venue of each match of the series, in order.
+     */
+    std::vector<Venue*> venues;
+};
+
+/**
+ * @brief Points awarded to each team for the result of a match. Defaults are
+ * those of the World Test Championship.
+ */
+struct PointsRules {
+    double win = 12;
+    double tie = 6;
+    double draw = 4;
+    double loss = 0;
+};
+
+/**
+ * @brief Distribution of the outcome of a series across the replicates of a
+ * tournament.
+ */
+class SeriesResult {
+  private:
+    Team* home_team;
+    Team* away_team;
+    unsigned int n_matches;
+    unsigned int n_sims;
+
+    // Number of replicates with each scoreline, indexed by home wins, then
+    // away wins
+    std::vector<unsigned int> scorelines;
+
+    // Number of replicates in which each match was won by the home team, won
+    // by the away team, drawn and tied
+    std::vector<unsigned int> match_results;
+
+  public:
+    SeriesResult(){};
+    SeriesResult(const Series& series);
+
+    /**
+     * @brief Add a completed series to the distribution.
+     * @param results Result of each match of the series.
+     */
+    void record(const std::vector<MatchResult*>& results);
+
+    /**
+     * @brief Merge the counts of another shard of the same series.
+     */
+    SeriesResult& operator+=(const SeriesResult& rhs);
+
+    // Getters
+    Team* get_home_team();
+    Team* get_away_team();
+    unsigned int get_n_matches();
+    unsigned int get_n_sims();
+
+    /**
+     * @brief Probability that the home team wins home_wins matches and the
+     * away team wins away_wins.
+     */
+    double scoreline_prob(unsigned int home_wins, unsigned int away_wins);
+
+    /**
+     * @brief Probability that a team wins more matches of the series than
+     * its opponent, and that both win as many.
+     */
+    double win_prob(Team* team);
+    double drawn_prob();
+
+    /**
+     * @brief Mean number of matches of the series won by a team.
+     */
+    double mean_wins(Team* team);
+
+    /**
+     * @brief Probabilities of each result of the i-th match of the series
+     * (zero-indexed), as for BatchResult.
+     */
+    double match_win_prob(unsigned int i, Team* team);
+    double match_result_prob(unsigned int i, ResultType type);
+
+    /**
+     * @brief Format the series win probabilities and the most likely
+     * scorelines as a table.
+     */
+    std::string print();
+};
+
+/**
+ * @brief Distribution of a team's points and final position across the
+ * replicates of a tournament.
+ */
+class Standing {
+  private:
+    Team* team;
+    unsigned int n_sims;
+    double total_points;
+    double total_pct;
+
+    // Number of replicates finishing in each position, from first
+    std::vector<unsigned int> positions;
+
+  public:
+    Standing(){};
+    Standing(Team* c_team, unsigned int n_teams);
+
+    /**
+     * @brief Add the team's standing in a completed replicate.
+     * @param points Points won by the team.
+     * @param pct Percentage of the points contested which the team won.
+     * @param position Final position, from 0 for first.
+     */
+    void record(double points, double pct, unsigned int position);
+
+    Standing& operator+=(const Standing& rhs);
+
+    // Getters
+    Team* get_team();
+    double mean_points();
+    double mean_pct();
+
+    /**
+     * @brief Probability of finishing in the given position, from 0 for
+     * first, and of finishing in that position or higher.
+     */
+    double position_prob(unsigned int position);
+    double top_prob(unsigned int n_places);
+};
+
+/**
+ * @brief Options controlling the simulation of a tournament.
+ */
+struct TournamentOptions {
+    /**
+     * @brief Number of replicates of the whole tournament.
+     */
+    unsigned int n_sims = 1000;
+    /**
+     * @brief Number of worker threads. A value of 0 uses the number of
+     * hardware threads available.
+     */
+    unsigned int n_threads = 0;
+    /**
+     * @brief Base seed. Each match of each replicate is simulated with a
+     * random stream derived from (seed, replicate, match), so results do not
+     * depend on the number of threads or the order tasks are run in.
+     */
+    unsigned long long seed = 0;
+
+    PointsRules points;
+
+    /**
+     * @brief Tactics and delivery model of every match, shared between the
+     * worker threads (see BatchOptions).
+     */
+    RolloutTactics* tactics = nullptr;
+    const DeliveryModel* delivery_model = nullptr;
+};
+
+/**
+ * @brief Results of every series of a tournament, and the standings of the
+ * teams.
+ *
+ * Teams are ranked in each replicate by the percentage of the points they
+ * contested which they won, as in the World Test Championship, with ties
+ * broken by total points and then by the order teams first appear in.
+ */
+class TournamentResult {
+  private:
+    unsigned int n_sims;
+    std::vector<SeriesResult> series;
+    std::vector<Standing> standings;
+
+  public:
+    TournamentResult(){};
+    TournamentResult(const std::vector<Series>& fixtures);
+
+    TournamentResult& operator+=(const TournamentResult& rhs);
+
+    unsigned int get_n_sims();
+    std::vector<SeriesResult>& get_series();
+    std::vector<Standing>& get_standings();
+
+    /**
+     * @brief Get the standing of a team, or nullptr if it does not play in
+     * the tournament.
+     */
+    Standing* get_standing(Team* team);
+
+    /**
+     * @brief Format the expected standings and the result of each series.
+     */
+    std::string print();
+
+    friend class TournamentRunner;
+};
+
+/**
+ * @brief Simulates a tournament of one or more series many times in
+ * parallel, with nested tasks for replicates, series and matches.
+ */
+class TournamentRunner {
+  private:
+    std::vector<Series> fixtures;
+    TournamentOptions opts;
+
+    // Index of the first match of each series, counting across the
+    // tournament
+    std::vector<unsigned int> first_match;
+
+    // Simulate a replicate of the tournament, recording it in the given
+    // shard
+    void simulate_one(unsigned int i, TaskScheduler& scheduler,
+                      TournamentResult& shard);
+
+    // Simulate the j-th match of series k in replicate i, returning a copy
+    // of its result
+    std::unique_ptr<MatchResult> simulate_match(unsigned int i,
+                                                unsigned int k,
+                                                unsigned int j);
+
+  public:
+    TournamentRunner(std::vector<Series> c_fixtures,
+                     TournamentOptions c_opts = TournamentOptions());
+
+    /**
+     * @brief Run every replicate, blocking until all are complete.
+     * @param scheduler Scheduler to run the tasks on, or nullptr to start one
+     * with TournamentOptions::n_threads workers for this run.
+     */
+    TournamentResult run(TaskScheduler* scheduler = nullptr);
+};
+
+#endif // SERIES_H
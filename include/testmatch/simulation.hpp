@@ -15,13 +15,71 @@
 #include "team.hpp"
 
 #include <functional>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
-//#include "MatchTime.h"
 
 // Forward declaration allows for referencing Innings object in managers
 class Innings;
+class Match;
+class RolloutTactics;
+struct DecisionCache;
+
+/**
+ * @brief Commentary policies, fixing at compile time what the simulation loop
+ * of an innings or match does with each delivery besides scoring it:
+ * enabled() decides whether ball-by-ball commentary is printed, record
+ * whether the delivery is kept as a Ball in the over log (see
+ * Innings::get_overs()) or only counted, and sink whether it is passed to the
+ * event sink of the innings. The loop is instantiated once for each policy,
+ * so the hot path carries no code and no checks for what a policy leaves
+ * out.
+ *
+ * QuietCommentary and FullCommentary record every delivery, without and with
+ * commentary. SummaryCommentary keeps only the scorecards, partnerships and
+ * fall of wickets, allocating nothing for each delivery. SinkCommentary is
+ * the same, but passes every delivery to the event sink as it is bowled.
+ * RuntimeCommentary is the engine configured at run time, checking whether
+ * the innings is quiet on every delivery.
+ */
+struct QuietCommentary {
+    static constexpr bool enabled(bool) { return false; }
+    static constexpr bool record = true;
+    static constexpr bool sink = false;
+};
+
+struct FullCommentary {
+    static constexpr bool enabled(bool) { return true; }
+    static constexpr bool record = true;
+    static constexpr bool sink = false;
+};
+
+struct SummaryCommentary {
+    static constexpr bool enabled(bool) { return false; }
+    static constexpr bool record = false;
+    static constexpr bool sink = false;
+};
+
+struct SinkCommentary {
+    static constexpr bool enabled(bool) { return false; }
+    static constexpr bool record = false;
+    static constexpr bool sink = true;
+};
+
+struct RuntimeCommentary {
+    static constexpr bool enabled(bool quiet) { return !quiet; }
+    static constexpr bool record = true;
+    static constexpr bool sink = false;
+};
+
+/**
+ * @brief Receiver of the deliveries of an innings simulated with
+ * SinkCommentary, called once the innings has been updated with each one. A
+ * run of dot balls is passed once the innings has been updated with the whole
+ * run.
+ */
+using EventSink = std::function<void(Innings&, const Ball&)>;
 
 /**
  * @brief Manages batting order by passing BatterCard pointers to Innings
@@ -33,7 +91,9 @@ class BattingManager {
     BatterCard* cards[11];
     bool batted[11];
 
-    // Various options for determining next batter
+    // Various options for determining next batter. The alternatives to the
+    // batting order only suggest a batter (or nullptr if there is no sensible
+    // alternative), without marking them as having batted
     BatterCard* next_ordered();
     BatterCard* nightwatch();
     BatterCard* promote_hitter();
@@ -54,6 +114,10 @@ class BattingManager {
      * @return Pointer to BatterCard corresponding to the new batter
      */
     BatterCard* next_in(Innings* inns_obj);
+
+    // Allow a cloned Innings to point the manager at its own cards
+    friend class Innings;
+    friend class RolloutTactics;
 };
 
 /**
@@ -65,6 +129,10 @@ class BowlingManager {
 
     int n_over_calls;
 
+    // Midpoint and growth rate of the logistic curve in take_off_prob()
+    static thread_local double TAKE_OFF_MIDPOINT;
+    static thread_local double TAKE_OFF_RATE;
+
     /**
      * @brief
      * @param bowl_avg
@@ -110,16 +178,16 @@ class BowlingManager {
         double new_obj;
         BowlerCard* best = nullptr;
         BowlerCard* curr;
-        Player* curr_ply;
         for (int i = 0; i < 11; i++) {
             curr = cards[i];
-            curr_ply = curr->get_player_ptr();
 
             // Only consider if pace bowler and full-time
             if (predicate(curr)) {
-                // Calculate objective function
-                new_obj = Model::OBJ_AVG_FATIG(curr_ply->get_bowl_avg(),
-                                               curr_ply->get_bowl_sr(),
+                // Calculate objective function, using the (possibly inflated)
+                // averages stored on the card
+                BowlStats curr_stats = curr->get_sim_stats();
+                new_obj = Model::OBJ_AVG_FATIG(curr_stats.bowl_avg,
+                                               curr_stats.strike_rate,
                                                curr->get_tiredness());
 
                 // Compare to current best
@@ -146,6 +214,10 @@ class BowlingManager {
      * next over
      */
     BowlerCard* end_over(Innings* inns_obj);
+
+    // Allow a cloned Innings to point the manager at its own cards
+    friend class Innings;
+    friend class ParamRegistry;
 };
 
 /**
@@ -153,7 +225,7 @@ class BowlingManager {
  */
 class FieldingManager {
   private:
-    static double C_WK_PROB;
+    static thread_local double C_WK_PROB;
 
     Player* players[11];
     int wk_idx;
@@ -170,6 +242,8 @@ class FieldingManager {
      * @return
      */
     Player* select_catcher(Player* bowler, DismType dism_type);
+
+    friend class ParamRegistry;
 };
 
 /**
@@ -182,7 +256,6 @@ class Innings {
     Team* team_bowl;
 
     // General innings info
-    static int NO_INNS;
     int inns_no;
     static double PRINT_DELAY;
     bool is_quiet;
@@ -194,15 +267,45 @@ class Innings {
     int lead;
     int wkts;
 
+    // Sum over deliveries of the expected runs and wickets under the delivery
+    // model, used as control variates
+    double exp_runs;
+    double exp_wkts;
+
     bool is_open;
 
-    // MatchTime* time;
+    // Clock of the match the innings belongs to, or nullptr for an innings
+    // played without one, which never ends in a draw
+    MatchTime* time;
     PitchFactors* pitch;
 
-    // Ball-by-ball detail
-    Over* first_over;
+    // Delivery outcome distributions for each batter and bowler
+    std::shared_ptr<const MatchupTable> table;
+
+    // Distributions for each batter, bowler and bucket of situations, if the
+    // delivery model depends on the situation
+    std::shared_ptr<SituationTable> situations;
+
+    // Legal deliveries bowled in earlier innings of the match
+    int prior_balls;
+
+    // Tables for each session of the match, if the innings belongs to one,
+    // and the session of the current table
+    std::shared_ptr<const SessionTables> sessions;
+    int session;
+
+    // Match the innings belongs to, if any, consulted for tactical decisions
+    Match* match;
+
+    // Ball-by-ball detail. Completed overs are never modified, so they are
+    // shared between an innings and its clones (copy-on-write), and only the
+    // current over is duplicated when cloning.
+    std::vector<std::shared_ptr<Over>> over_log;
     Over* last_over;
 
+    // Receiver of deliveries simulated with SinkCommentary, if any
+    EventSink events;
+
     // Scorecards
     BatterCard** batters;
     BowlerCard** bowlers;
@@ -234,15 +337,35 @@ class Innings {
     // Simulate a delivery and update appropriate statistics
     void simulate_delivery();
 
+    // Distributions of the next delivery between the striker and bowler of
+    // the current over (indices in the XIs)
+    const DeliveryDists& current_dists(int bat_i, int bowl_i);
+
+    // Update scorecards, partnerships and fall of wickets with the outcome of
+    // a delivery. The mode of dismissal is sampled if not given.
+    template <class Commentary = RuntimeCommentary>
+    void update_state(std::string outcome, const DismType* dism_ptr);
+
+    // Equivalent to update_state("0", nullptr) repeated n times, for dot
+    // balls within the current over
+    template <class Commentary = RuntimeCommentary> void update_dots(int n);
+
+    // Throw an exception unless the outcome can be applied to the innings
+    void check_outcome(std::string outcome);
+
     // Called after each delivery, checks for changes in game state, such as end
     // of over, end of innings, declaration, scheduled break, etc.
-    std::string check_state();
+    template <class Commentary = RuntimeCommentary> std::string check_state();
 
-    // Check for declaration
+    // Check for declaration, at the start of each over
     bool check_declaration();
 
+    // Send in a new batter after a wicket
+    template <class Commentary = RuntimeCommentary>
+    void bring_in(BatterCard* card);
+
     // Handle end of over
-    void end_over();
+    template <class Commentary = RuntimeCommentary> void end_over();
 
     /**
      * @brief Functions for swapping batter and bowler pointers respectively
@@ -282,20 +405,116 @@ class Innings {
   public:
     // Constructor
     Innings(Team* c_team_bat, Team* c_team_bowl, int c_lead,
-            PitchFactors* c_pitch); // MatchTime* c_time);
+            PitchFactors* c_pitch, int c_inns_no = 1,
+            std::shared_ptr<const MatchupTable> c_table = nullptr,
+            const DeliveryModel* c_model = nullptr,
+            std::shared_ptr<SituationTable> c_situations = nullptr);
+
+    /**
+     * @brief Copy constructor, producing an independent clone of the innings
+     * in its current state. Scorecards, the current over, partnerships and
+     * managers are all duplicated, while completed overs, Team, Player and
+     * pitch data are shared.
+     */
+    Innings(const Innings& other);
+    Innings& operator=(const Innings& other) = delete;
 
     // Returns state string explainining why innings has ended
     std::string simulate(bool quiet = true);
 
+    /**
+     * @brief Simulate the rest of the innings as in Innings::simulate(), with
+     * the commentary policy fixed at compile time. simulate() runs the
+     * QuietCommentary or FullCommentary instantiation, and RuntimeCommentary
+     * prints according to whether the innings was last simulated quietly.
+     * Every policy uses the same random numbers.
+     * @tparam Commentary QuietCommentary, FullCommentary, SummaryCommentary,
+     * SinkCommentary or RuntimeCommentary.
+     */
+    template <class Commentary> std::string simulate_with();
+
+    /**
+     * @brief Set the receiver of deliveries simulated with SinkCommentary.
+     * Clones of the innings share the same sink.
+     * @param c_events Event sink, or nullptr to discard the deliveries.
+     */
+    void set_event_sink(EventSink c_events);
+
+    /**
+     * @brief Simulate a single delivery, without printing.
+     * @return State string, which is empty unless the innings has closed (see
+     * Innings::simulate()).
+     */
+    std::string step();
+
+    /**
+     * @brief Simulate deliveries up to and including the next one which is
+     * not a dot ball, or to the end of the over if that comes first, without
+     * printing. The number of dot balls is sampled directly, from a geometric
+     * distribution, so the innings has the same distribution as with repeated
+     * calls to step(). The score, wickets, striker and bowler only change on
+     * the last delivery.
+     * @return State string, as for Innings::step().
+     */
+    template <class Commentary = RuntimeCommentary>
+    std::string step_to_event();
+
+    /**
+     * @brief Apply the known outcome of a delivery (e.g. from a live feed),
+     * updating the innings in exactly the same way as a simulated delivery.
+     * @param outcome Encoded outcome, one of Model::DELIV_OUTCOMES.
+     * @param dism Mode of dismissal, if the outcome is a wicket. If not given,
+     * the mode is sampled from the model.
+     * @return State string, as for Innings::step().
+     */
+    std::string apply_delivery(std::string outcome);
+    std::string apply_delivery(std::string outcome, DismType dism);
+
+    /**
+     * @brief Override the bowler of the current over, e.g. to follow a live
+     * feed rather than the choice of the bowling manager.
+     * @param player Player in the bowling team.
+     */
+    void set_bowler(Player* player);
+
+    /**
+     * @brief Close the innings by declaration.
+     */
+    void declare();
+
     std::string print(void);
 
     // Getters
     BatterCard** get_batters();
     BowlerCard** get_bowlers();
+    // Table of the current session, and its index (see SessionTables)
+    std::shared_ptr<const MatchupTable> get_table();
+    int get_session();
+    std::shared_ptr<SituationTable> get_situations();
+    const std::vector<std::shared_ptr<Over>>& get_overs();
 
     bool get_is_open();
+    int get_inns_no();
+    int get_team_score();
+    int get_balls();
     int get_lead();
     int get_wkts();
+
+    /**
+     * @brief Situation of the match, as passed to a delivery model which
+     * depends on it.
+     * @param dots Number of dot balls bowled before the delivery, e.g. 0 for
+     * the next delivery.
+     */
+    MatchStats get_situation(int dots = 0);
+
+    /**
+     * @brief Expected runs and wickets so far, summing the delivery model's
+     * expectation over every ball bowled. The difference between these and
+     * the actual score has mean zero, making it a useful control variate.
+     */
+    double get_exp_runs();
+    double get_exp_wkts();
     Team* get_bat_team();
     Team* get_bowl_team();
 
@@ -306,6 +525,9 @@ class Innings {
     friend class BattingManager;
     friend class BowlingManager;
     friend class FieldingManager;
+    friend class InningsCache;
+    friend class Match;
+    friend class RolloutTactics;
 };
 
 /**
@@ -322,7 +544,8 @@ class Match {
     bool ready;
     TossResult toss;
 
-    // MatchTime time;
+    // Time of day and day of the match, which is drawn when it runs out
+    MatchTime time;
     std::string match_state;
 
     // Tracking current game state
@@ -331,21 +554,72 @@ class Match {
     int lead;
     int match_balls;
 
+    // Delivery outcome distributions with the home team batting (first) and
+    // the away team batting (second), for each pairing and session, prepared
+    // before the first innings, and for each bucket of situations if the
+    // model depends on them, built with the first such innings
+    std::shared_ptr<const SessionTables> sessions[2];
+    std::shared_ptr<SituationTable> situations[2];
+
     // Storing winner detail
     MatchResult* result;
 
+    // Tactical decisions made by rollouts, or nullptr to never declare and
+    // always follow the batting order
+    RolloutTactics* tactics;
+
+    // Decisions already made for this match by its tactics, created on the
+    // first decision. Clones take a copy, never a share, so the decisions of
+    // a match only depend on its own state
+    std::unique_ptr<DecisionCache> decisions;
+
+    // Model evaluated for the tables of new innings, or nullptr for the
+    // built-in model
+    const DeliveryModel* model;
+
+    // Receiver of deliveries simulated with SinkCommentary, passed to every
+    // innings
+    EventSink events;
+
     // Private helper functions
 
+    /**
+     * @brief Handle the close of the current innings, either deciding the
+     * result or starting the next innings.
+     * @param inns_state State string returned by the closed innings.
+     * @return Whether the match is over.
+     */
+    bool end_innings(std::string inns_state);
+
     /**
      * @brief
      */
     void simulate_toss();
 
+    /**
+     * @brief Create the first innings according to the result of the toss.
+     */
+    void setup_first_innings();
+
     /**
      * @brief
      */
     void change_innings();
 
+    /**
+     * @brief Prepare the SessionTables of a batting team, unless they already
+     * have been.
+     * @param k 0 for the home team, 1 for the away team.
+     */
+    void prepare_sessions(int k);
+
+    /**
+     * @brief Create a new innings, with the SessionTables of its batting team
+     * and the table of the session in which it starts.
+     */
+    Innings* new_innings(Team* bat_team, Team* bowl_team, int c_lead,
+                         int inns_no);
+
     /**
      * @brief Decide whether to enforce the follow-on, based on the lead.
      *
@@ -369,23 +643,170 @@ class Match {
     Match(Pregame detail);
 
     /**
-     * @brief
+     * @brief Copy constructor, producing an independent clone of the match in
+     * its current state, which may then be continued separately.
+     */
+    Match(const Match& other);
+    Match& operator=(const Match& other) = delete;
+
+    /**
+     * @brief Simulate the toss and set up the first innings. The calling
+     * thread first copies any newly published model coefficients (see
+     * Model::sync_coefficients()), which its delivery tables keep throughout.
      */
     void pregame();
 
+    /**
+     * @brief Set up the match with a predetermined toss result, rather than
+     * simulating the toss. Coefficients are picked up as for pregame().
+     * @param c_toss Result of the toss.
+     */
+    void pregame(TossResult c_toss);
+
+    /**
+     * @brief Probability that a given team wins the toss at a venue and makes
+     * a given choice, as used by simulate_toss(). The toss itself is fair, so
+     * this is the same for either team.
+     * @param venue Venue of the match.
+     * @param choice Choice made by the winner of the toss.
+     * @return Probability of the toss result.
+     */
+    static double PROB_TOSS(Venue* venue, TossChoice choice);
+
+    /**
+     * @brief Probability of enforcing the follow-on, as used by
+     * DECIDE_FOLLOW_ON().
+     * @param lead Lead of bowling team at end of previous innings.
+     * @return Probability that the follow-on is enforced.
+     */
+    static double PROB_FOLLOW_ON(int lead);
+
     /**
      * @brief
      * @param quiet
      */
     void start(bool quiet = true);
 
+    /**
+     * @brief Simulate the match as in Match::start(), with the commentary
+     * policy fixed at compile time (see Innings::simulate_with()).
+     * @tparam Commentary QuietCommentary, FullCommentary, SummaryCommentary,
+     * SinkCommentary or RuntimeCommentary.
+     */
+    template <class Commentary> void start_with();
+
+    /**
+     * @brief Set the receiver of deliveries simulated with SinkCommentary, in
+     * every innings of the match. Clones of the match share the same sink.
+     * @param c_events Event sink, or nullptr to discard the deliveries.
+     */
+    void set_event_sink(EventSink c_events);
+
+    /**
+     * @brief Continue the match ball-by-ball, without printing, until the
+     * given condition holds or the match is over. The condition is checked
+     * before the first delivery and after every delivery. Without a
+     * condition, the match is simulated to completion.
+     * @param until Condition on the state of the match.
+     * @return Whether the condition was met.
+     */
+    bool advance(std::function<bool(Match&)> until = nullptr);
+
+    /**
+     * @brief Simulate the match as in Match::start(), without printing, but
+     * stop as soon as the given condition holds. The condition is checked
+     * before the first delivery, at the end of every innings and, if
+     * by_delivery is set, after every delivery which is not a dot ball (dot
+     * balls change neither the score nor the wickets). Uses the same random
+     * numbers as Match::start(), so a match which is not stopped early has
+     * the same result.
+     * @param until Condition on the state of the match.
+     * @param by_delivery Whether the condition can change part-way through
+     * an innings.
+     * @return Whether the condition was met.
+     */
+    bool simulate_until(std::function<bool(Match&)> until,
+                        bool by_delivery = true);
+
+    /**
+     * @brief Apply the known outcome of a delivery to the current innings,
+     * moving on to the next innings or deciding the result as needed.
+     * @param outcome Encoded outcome, one of Model::DELIV_OUTCOMES.
+     * @param dism Mode of dismissal, if the outcome is a wicket.
+     * @return Whether the match is over.
+     */
+    bool apply_delivery(std::string outcome);
+    bool apply_delivery(std::string outcome, DismType dism);
+
+    /**
+     * @brief Declare the innings in progress closed (e.g. from a live feed),
+     * and start the next innings. The fourth innings cannot be declared.
+     */
+    void declare();
+
+    /**
+     * @brief Make declarations and promotions in the batting order by
+     * rollouts. Clones of the match share the same tactics, and start with
+     * a copy of the decisions made so far.
+     * @param c_tactics Tactics, which must outlive the match, or nullptr to
+     * never declare and always follow the batting order.
+     */
+    void set_tactics(RolloutTactics* c_tactics);
+    RolloutTactics* get_tactics();
+
+    /**
+     * @brief Evaluate the given delivery model for innings started from now
+     * on. Clones of the match share the same model.
+     * @param c_model Model, which must outlive the match, or nullptr for the
+     * built-in model.
+     */
+    void set_delivery_model(const DeliveryModel* c_model);
+    const DeliveryModel* get_delivery_model();
+
     /**
      * @brief
      * @return
      */
     std::string print_all();
 
+    // Getters
+    Team* get_home_team();
+    Team* get_away_team();
+    Venue* get_venue();
+
+    /**
+     * @brief Number of innings started so far, between 1 and 4.
+     */
+    int get_num_innings();
+
+    /**
+     * @brief Get the i-th innings of the match (zero-indexed), or nullptr if
+     * it has not been started.
+     */
+    Innings* get_innings(int i);
+
+    /**
+     * @brief Get the innings currently in progress (or the final innings, if
+     * the match is over).
+     */
+    Innings* get_current_innings();
+
+    /**
+     * @brief Get the result of the match, or nullptr if it has not finished.
+     */
+    MatchResult* get_result();
+
+    /**
+     * @brief Clock of the match, which is drawn if the clock runs out before
+     * a result.
+     */
+    const MatchTime& get_time();
+
     ~Match();
+
+    friend class Innings;
+    friend class BattingManager;
+    friend class RolloutTactics;
 };
 
 #endif // SIMULATION_h
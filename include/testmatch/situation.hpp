@@ -0,0 +1,94 @@
+// -*- lsst-c++ -*-
+/* situation.hpp
+ *
+ * A delivery model which adjusts the distribution of another model for the
+ * situation of the match: the age of the ball, how long the batter has been
+ * in, the rate required in a fourth innings chase and the wear of the pitch.
+ * Innings evaluate it once per pairing and bucket of situations (see
+ * SituationTable), so it costs little more per ball than the model it wraps.
+ *
+ */
+
+#ifndef SITUATION_H
+#define SITUATION_H
+
+#include "models.hpp"
+
+/**
+ * @brief Size of each effect of the situation on a delivery. Multipliers
+ * apply to the probability of a wicket, or to the probabilities of runs off
+ * the bat relative to dot balls and extras.
+ */
+struct SituationEffects {
+    /**
+     * @brief Wicket multiplier of pace bowling with a new ball, decaying
+     * exponentially over the given number of overs.
+     */
+    double new_ball = 1.3;
+    double new_ball_overs = 15;
+    /**
+     * @brief Wicket multiplier of a batter on their first ball, decaying
+     * exponentially over the given number of balls faced.
+     */
+    double new_batter = 1.5;
+    double new_batter_balls = 15;
+    /**
+     * @brief Change in the wicket multiplier of spin and pace bowling for
+     * each day of wear, beyond the effect of the worn pitch conditions (see
+     * Model::MODEL_PITCH_WEAR) on the wrapped model.
+     */
+    double spin_wear = 0;
+    double pace_wear = 0;
+    /**
+     * @brief Wicket multiplier in the fourth innings.
+     */
+    double fourth_innings = 1.1;
+    /**
+     * @brief Change in the multipliers of runs and wickets for each run per
+     * over that a chase requires above the par rate.
+     */
+    double par_rate = 3;
+    double chase_runs = 0.15;
+    double chase_wkts = 0.1;
+};
+
+/**
+ * @brief A delivery model adjusting another model for the situation of the
+ * match.
+ *
+ * The probability of a wicket is scaled by the product of the multipliers of
+ * the situation, and the other outcomes share the probability of survival in
+ * proportion to their probability under the wrapped model, with runs off the
+ * bat scaled up in a chase.
+ */
+class SituationDeliveryModel : public DeliveryModel {
+  private:
+    const DeliveryModel* base;
+    SituationEffects effects;
+
+    // Whether each outcome is runs off the bat
+    bool is_scoring[22];
+
+  public:
+    /**
+     * @param c_base Model to adjust, which must outlive this one, or nullptr
+     * for the built-in model.
+     * @param c_effects Size of each effect.
+     */
+    SituationDeliveryModel(const DeliveryModel* c_base = nullptr,
+                           SituationEffects c_effects = SituationEffects());
+
+    /**
+     * @brief Multipliers of the probability of a wicket and of runs off the
+     * bat for the given matchup.
+     */
+    void multipliers(const Matchup& matchup, double* wkt_mult,
+                     double* runs_mult) const;
+
+    bool uses_situation() const override;
+
+    void evaluate(const Matchup* matchups, int n,
+                  double* output) const override;
+};
+
+#endif // SITUATION_H
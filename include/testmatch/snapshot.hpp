@@ -0,0 +1,60 @@
+// -*- lsst-c++ -*-
+/* snapshot.hpp
+ *
+ * Capturing the state of a match part-way through, so that it can be resumed,
+ * modified or continued many times over. A snapshot is immutable and cheap to
+ * copy, and the ball-by-ball log of each innings is shared (copy-on-write)
+ * between the snapshot and every match cloned from it.
+ *
+ */
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "helpers.hpp"
+#include "simulation.hpp"
+
+#include <memory>
+
+/**
+ * @brief Immutable capture of a match in progress, along with the position of
+ * the random number engine at the time of capture.
+ *
+ * The captured state includes every innings so far, with scorecards, bowler
+ * fatigue, partnerships and the state of the batting and bowling managers.
+ * Copies of a snapshot share the same underlying state, so may be passed
+ * between threads freely.
+ */
+class MatchSnapshot {
+  private:
+    std::shared_ptr<const Match> state;
+    std::shared_ptr<const RngState> rng;
+
+  public:
+    MatchSnapshot(){};
+
+    /**
+     * @brief Capture the current state of a match, along with the random
+     * number engine of the calling thread.
+     * @param match Match which has been set up with Match::pregame().
+     */
+    MatchSnapshot(const Match& match);
+
+    bool is_empty() const;
+
+    /**
+     * @brief Create an independent copy of the captured match, which may be
+     * modified or continued (e.g. with Match::advance()).
+     */
+    Match clone() const;
+
+    /**
+     * @brief Create an independent copy of the captured match, and restore
+     * the random number engine of the calling thread to its position at the
+     * time of capture. Continuing the copy then reproduces the original match
+     * exactly.
+     */
+    Match resume() const;
+};
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,141 @@
+// -*- lsst-c++ -*-
+/* splitting.hpp
+ *
+ * Estimating the probability of rare outcomes (e.g. a tie) by multilevel
+ * splitting. Rather than simulating every match from the toss, matches which
+ * reach an intermediate level on the way to the rare outcome (e.g. a close
+ * fourth innings chase) are cloned and continued many times, so most of the
+ * simulation effort is spent on the promising part of the state space.
+ *
+ */
+
+#ifndef SPLITTING_H
+#define SPLITTING_H
+
+#include "pregame.hpp"
+#include "simulation.hpp"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Description of a rare outcome, along with a sequence of intermediate
+ * levels leading to it.
+ *
+ * Levels and the event are conditions on the state of a match, checked after
+ * every delivery. For the estimate to be unbiased, any match in which the
+ * event occurs must also satisfy every level at the moment the event occurs
+ * (e.g. by including completed innings in the condition), and the event must
+ * remain satisfied once it has occurred. Levels should be ordered so that each
+ * is roughly as hard to reach from the previous as the others.
+ */
+struct RareEvent {
+    std::string name;
+    std::vector<std::function<bool(Match&)>> levels;
+    std::function<bool(Match&)> event;
+
+    /**
+     * @brief The match is tied. Levels are reached by the fourth innings
+     * becoming close, with few wickets in hand.
+     */
+    static RareEvent tie();
+
+    /**
+     * @brief A successful fourth innings chase of at least the given target.
+     * Levels are the target being set, and then the chasing team reaching half
+     * and three quarters of it.
+     */
+    static RareEvent fourth_innings_chase(int target = 450);
+
+    /**
+     * @brief Either team is bowled out for less than the given score in any
+     * innings. Levels are an innings reaching 3, 5, 7 and 9 wickets down for
+     * less than that score.
+     */
+    static RareEvent bowled_out_under(int runs = 50);
+};
+
+/**
+ * @brief Options controlling a splitting estimate.
+ */
+struct SplittingOptions {
+    /**
+     * @brief Number of trajectories simulated from each level (fixed effort).
+     * The first stage simulates this many matches from the toss.
+     */
+    unsigned int n_per_level = 1000;
+    /**
+     * @brief Number of independent replications, from which the standard error
+     * is estimated. Replications are run in parallel.
+     */
+    unsigned int n_reps = 8;
+    /**
+     * @brief Number of worker threads. A value of 0 uses the number of
+     * hardware threads available.
+     */
+    unsigned int n_threads = 0;
+    /**
+     * @brief Base seed. Replication r uses a random stream derived from
+     * (seed, r), so results do not depend on the number of threads.
+     */
+    unsigned long long seed = 0;
+};
+
+/**
+ * @brief Result of a splitting estimate.
+ */
+struct SplittingResult {
+    /**
+     * @brief Unbiased estimate of the probability of the event, the average of
+     * the replications.
+     */
+    double estimate;
+    double std_error;
+    /**
+     * @brief Average over replications of the estimated probability of
+     * reaching each level from the previous, with the final entry the
+     * probability of the event from the last level.
+     */
+    std::vector<double> stage_probs;
+    /**
+     * @brief Total number of deliveries simulated, as a measure of cost.
+     */
+    unsigned long long n_deliveries;
+
+    /**
+     * @brief Format the estimate and stage probabilities.
+     */
+    std::string print();
+};
+
+/**
+ * @brief Fixed-effort multilevel splitting estimator.
+ *
+ * In each stage, a fixed number of trajectories are started from states
+ * sampled uniformly (with replacement) from those which entered the current
+ * level, and each is continued until it enters the next level or the match
+ * ends. The product of the fractions of trajectories succeeding at each stage
+ * is an unbiased estimate of the probability of the event.
+ */
+class SplittingEstimator {
+  private:
+    Pregame detail;
+    RareEvent event;
+    SplittingOptions opts;
+
+    // Run a single replication, adding the cost to the given counter
+    double replicate(unsigned int r, std::vector<double>& stage_probs,
+                     unsigned long long& n_deliveries);
+
+  public:
+    SplittingEstimator(Pregame c_detail, RareEvent c_event,
+                       SplittingOptions c_opts = SplittingOptions());
+
+    /**
+     * @brief Run every replication, blocking until all are complete.
+     */
+    SplittingResult run();
+};
+
+#endif // SPLITTING_H
@@ -0,0 +1,172 @@
+// -*- lsst-c++ -*-
+/* sweep.hpp
+ *
+ * Sensitivity analysis of the simulation to its model constants. A sweep runs
+ * a batch of matches at each point of a design over named parameters (see
+ * params.hpp), e.g. a grid over the rate at which pace bowlers tire and the
+ * keeper's share of catches. Match i of every batch uses the same random
+ * stream, so differences between points are estimated far more precisely
+ * than by independent batches. The matches of every point are interleaved
+ * across a single pool of workers, with each worker switching its own copy of
+ * the constants as it moves between points.
+ *
+ */
+
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include "batch.hpp"
+#include "pregame.hpp"
+#include "snapshot.hpp"
+#include "team.hpp"
+#include "workers.hpp"
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief Values to take for one parameter of a grid.
+ */
+struct SweepAxis {
+    std::string name;
+    std::vector<double> values;
+};
+
+/**
+ * @brief Range to sample one parameter of a random design from.
+ */
+struct SweepRange {
+    std::string name;
+    double low;
+    double high;
+};
+
+/**
+ * @brief Points in the space of model parameters at which to simulate.
+ */
+class SweepDesign {
+  private:
+    std::vector<std::string> names;
+    std::vector<std::vector<double>> points;
+
+  public:
+    /**
+     * @brief Start an empty design over the given parameters.
+     * @param c_names Names of the parameters, each registered with
+     * ParamRegistry. Throws std::invalid_argument otherwise.
+     */
+    SweepDesign(std::vector<std::string> c_names);
+
+    /**
+     * @brief Add a point, with a value for each parameter in order.
+     */
+    void add_point(std::vector<double> values);
+
+    /**
+     * @brief Full factorial design: every combination of the values of each
+     * axis, with the last axis varying fastest.
+     */
+    static SweepDesign grid(std::vector<SweepAxis> axes);
+
+    /**
+     * @brief Latin hypercube design: each range is split into n_points equal
+     * strata, and each stratum of each parameter is sampled exactly once.
+     * @param ranges Range of each parameter.
+     * @param n_points Number of points.
+     * @param seed Seed of the sampling. The caller's random stream is
+     * unaffected.
+     */
+    static SweepDesign random(std::vector<SweepRange> ranges,
+                              unsigned int n_points,
+                              unsigned long long seed = 0);
+
+    std::vector<std::string> get_names() const;
+    unsigned int size() const;
+    const std::vector<double>& get_point(unsigned int k) const;
+};
+
+/**
+ * @brief Results of a sweep: a batch result for each point of the design.
+ */
+class SweepResult {
+  private:
+    SweepDesign design;
+    std::vector<BatchResult> results;
+
+    // Winner of each match at each point, indexed by point then match: 0 for
+    // the home team, 1 for the away team and -1 if there is no winner
+    std::vector<std::vector<signed char>> winners;
+
+  public:
+    SweepResult(SweepDesign c_design);
+
+    SweepDesign& get_design();
+    unsigned int size();
+    BatchResult& get_result(unsigned int k);
+
+    /**
+     * @brief Change in a team's win probability from the first point of the
+     * design to point k, estimated from the paired matches sharing a random
+     * stream.
+     */
+    Estimate win_diff(unsigned int k, Team* team);
+
+    /**
+     * @brief Format as comma-separated values, with a column for each
+     * parameter followed by the result probabilities, and a header row.
+     */
+    std::string to_csv();
+
+    /**
+     * @brief Format as a table, including the change in the home win
+     * probability from the first point.
+     */
+    std::string print();
+
+    friend class SweepRunner;
+};
+
+/**
+ * @brief Runs a batch of matches of a fixture at every point of a design.
+ */
+class SweepRunner {
+  private:
+    SweepDesign design;
+    BatchOptions opts;
+
+    // Batch at each point, which differ only in the parameters in force
+    std::vector<BatchRunner> runners;
+
+  public:
+    /**
+     * @brief Set up a sweep.
+     * @param c_detail Fixture to simulate.
+     * @param c_design Points at which to simulate.
+     * @param c_opts Options for the batch at each point. BatchOptions::n_sims
+     * matches are simulated at every point. Any precision target is
+     * ignored. Tactics roll out each decision under the parameters of the
+     * point of its match.
+     */
+    SweepRunner(Pregame c_detail, SweepDesign c_design,
+                BatchOptions c_opts = BatchOptions());
+
+    /**
+     * @brief Set up a sweep of continuations of a match in progress, as for
+     * BatchRunner::BatchRunner(MatchSnapshot, BatchOptions).
+     * @param c_start Snapshot of the match to continue.
+     * @param c_design Points at which to simulate.
+     * @param c_opts Options for the batch at each point, as above.
+     */
+    SweepRunner(MatchSnapshot c_start, SweepDesign c_design,
+                BatchOptions c_opts = BatchOptions());
+
+    /**
+     * @brief Run the sweep, blocking until every batch is complete. The
+     * constants of the calling thread are unchanged afterwards.
+     * @param pool Persistent worker threads to run the sweep on, in place of
+     * BatchOptions::n_threads new threads.
+     */
+    SweepResult run(WorkerPool* pool = nullptr);
+};
+
+#endif // SWEEP_H
@@ -0,0 +1,187 @@
+// -*- lsst-c++ -*-
+/* tactics.hpp
+ *
+ * Tactical decisions made during a match by nested Monte Carlo: whether to
+ * declare, and whether to send in a nightwatchman or promote a hitter up the
+ * order. Each option is played out to the end of the match from clones of the
+ * current state, with common random numbers, and the alternative is taken
+ * only if it does clearly better than the default. Rollouts never make
+ * decisions themselves, and each decision has a strict budget of rollouts and
+ * time. Each match caches its decisions by a quantised description of its
+ * state, so a situation which recurs in the match is only rolled out once.
+ * Rollouts start from the exact state of the match, so the cache is never
+ * shared between matches, whose decisions would otherwise depend on which
+ * of them reached a situation first.
+ *
+ */
+
+#ifndef TACTICS_H
+#define TACTICS_H
+
+#include "cards.hpp"
+#include "simulation.hpp"
+#include "team.hpp"
+
+#include <atomic>
+#include <functional>
+#include <map>
+
+/**
+ * @brief Options controlling the rollouts and caching of RolloutTactics.
+ */
+struct TacticsOptions {
+    /**
+     * @brief Maximum number of rollouts of each option per decision.
+     */
+    unsigned int n_rollouts = 8;
+    /**
+     * @brief Maximum time spent on each decision, in microseconds, or 0 (the
+     * default) for no limit, so that n_rollouts is the only budget. At least
+     * one rollout of each option is always made. Without a limit, each
+     * decision depends only on the state of its match and the seed, so
+     * results do not depend on the threads they are simulated on or the load
+     * of the machine; with one, they do.
+     */
+    unsigned int budget_us = 0;
+    /**
+     * @brief Improvement in the expected result (1 for a win, 0.5 for a draw
+     * or tie and 0 for a loss) needed to take the alternative to the default.
+     */
+    double margin = 0.02;
+    /**
+     * @brief Number of standard errors by which the mean improvement over the
+     * rollouts must exceed the margin.
+     */
+    double z = 1.645;
+    /**
+     * @brief Probability of declaring under Model::MODEL_DECLARATION above
+     * which a declaration is rolled out, and a hitter may be promoted.
+     */
+    double consider_prob = 0.5;
+    /**
+     * @brief Number of overs before the close of each day, at the nominal
+     * over rate of the match clock, in which a nightwatchman is considered.
+     */
+    int nightwatch_overs = 3;
+    /**
+     * @brief Width of the buckets the lead is rounded down to, in runs, when
+     * quantising states for the cache.
+     */
+    int lead_bucket = 100;
+    /**
+     * @brief Base seed. Rollouts use random streams derived from the seed and
+     * the quantised state.
+     */
+    unsigned long long seed = 0;
+};
+
+/**
+ * @brief Quantised state of a decision, used as the cache key.
+ */
+struct DecisionKey {
+    /**
+     * @brief MatchupTable::fingerprint() of the innings in progress.
+     */
+    unsigned long long fingerprint;
+    // Type of decision, and the position of the batter for a promotion
+    int kind;
+    int candidate;
+    int inns_no;
+    int lead_bucket;
+    // Wickets down, in buckets of three
+    int wkts_bucket;
+    /**
+     * @brief Day of the match, from 0 for the first day.
+     */
+    int day;
+
+    bool operator<(const DecisionKey& rhs) const;
+};
+
+/**
+ * @brief Decisions made in a match, by key.
+ */
+struct DecisionCache {
+    std::map<DecisionKey, bool> decisions;
+};
+
+/**
+ * @brief Declarations and promotions in the batting order, decided by short
+ * rollouts of the rest of the match.
+ *
+ * A single object may be shared by any number of matches, including matches
+ * simulated concurrently on different threads.
+ */
+class RolloutTactics {
+  private:
+    TacticsOptions opts;
+
+    std::atomic<unsigned long long> n_decisions;
+    std::atomic<unsigned long long> n_hits;
+    std::atomic<unsigned long long> n_rollouts;
+
+    // Balls bowled in the match so far
+    static int match_balls(Match& match);
+
+    DecisionKey make_key(Match& match, int kind, int candidate);
+
+    // Result of a completed match for the given team, from 1 for a win to 0
+    // for a loss
+    static double value(Match& match, Team* team);
+
+    // Whether the alternative does better than the default for the team
+    // batting, each given by a function which applies the option to a clone
+    // of the match, cached in the match
+    bool prefer_alternative(Match& match, const DecisionKey& key,
+                            std::function<void(Match&)> base,
+                            std::function<void(Match&)> alt);
+
+  public:
+    RolloutTactics(TacticsOptions c_opts = TacticsOptions());
+    RolloutTactics(const RolloutTactics&) = delete;
+    RolloutTactics& operator=(const RolloutTactics&) = delete;
+
+    /**
+     * @brief Whether the team batting declares at the start of the current
+     * over. Only rolled out when Model::MODEL_DECLARATION makes a declaration
+     * plausible.
+     */
+    bool declare(Match& match);
+
+    /**
+     * @brief Whether the current over is close enough to the end of a day's
+     * play for a nightwatchman to be considered.
+     */
+    bool is_close_of_day(Match& match);
+
+    /**
+     * @brief Whether the team batting is pushing for a declaration, so that
+     * a hitter may be promoted.
+     */
+    bool wants_quick_runs(Match& match);
+
+    /**
+     * @brief Whether to send in the given batter after a wicket, rather than
+     * the next batter in the order.
+     * @param match Match in progress, part-way through the wicket.
+     * @param card Card of the alternative batter in the current innings.
+     */
+    bool send_in(Match& match, BatterCard* card);
+
+    /**
+     * @brief Number of decisions made, including those taken from the cache.
+     */
+    unsigned long long get_decisions();
+    unsigned long long get_hits();
+    /**
+     * @brief Number of rollouts of each option made, over all decisions.
+     */
+    unsigned long long get_rollouts();
+
+    /**
+     * @brief Reset the counts of decisions, hits and rollouts.
+     */
+    void clear();
+};
+
+#endif // TACTICS_H
@@ -0,0 +1,209 @@
+// -*- lsst-c++ -*-
+/* workers.hpp
+ *
+ * A pool of persistent worker threads, for workloads which run many small
+ * parallel batches in quick succession (e.g. re-estimating win probabilities
+ * after every ball). Threads are created once and kept warm between batches,
+ * rather than being spawned for each one.
+ *
+ * A work-stealing scheduler, for nested workloads (e.g. series spawning
+ * matches), where tasks spawn further tasks and wait for them. Each worker
+ * keeps its own queue, and idle workers steal from the others.
+ *
+ */
+
+#ifndef WORKERS_H
+#define WORKERS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Fixed-size pool of persistent worker threads.
+ *
+ * The calling thread takes part in each parallel loop as worker 0, so a pool
+ * of size n creates n - 1 threads.
+ */
+class WorkerPool {
+  private:
+    std::vector<std::thread> threads;
+
+    // Current loop
+    std::function<void(unsigned int, unsigned int)> task;
+    std::atomic<unsigned int> next;
+    unsigned int end;
+
+    // First exception thrown by an iteration of the current loop
+    std::exception_ptr error;
+
+    // Synchronisation between loops
+    std::mutex mutex;
+    std::condition_variable start_cv;
+    std::condition_variable done_cv;
+    unsigned long long generation;
+    unsigned int n_busy;
+    bool stopping;
+
+    // Main loop of each thread
+    void work(unsigned int worker);
+
+    // Run iterations of the current loop until none are left
+    void drain(unsigned int worker);
+
+  public:
+    /**
+     * @brief Start the worker threads.
+     * @param n_threads Number of workers, including the calling thread. A
+     * value of 0 uses the number of hardware threads available.
+     */
+    WorkerPool(unsigned int n_threads = 0);
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    /**
+     * @brief Number of workers, including the calling thread.
+     */
+    unsigned int size();
+
+    /**
+     * @brief Run f(i, worker) for each i in [begin, end) across the pool,
+     * blocking until every iteration is complete. Iterations are handed out
+     * one at a time, and worker (less than size()) identifies the worker
+     * running the iteration, so per-worker state can be used without locking.
+     * If an iteration throws, no more are started, and the first exception is
+     * rethrown once the iterations already running have finished. Must not be
+     * called concurrently from multiple threads.
+     */
+    void parallel_for(unsigned int begin, unsigned int end,
+                      std::function<void(unsigned int, unsigned int)> f);
+
+    ~WorkerPool();
+};
+
+/**
+ * @brief Fixed-size pool of worker threads running tasks which may spawn and
+ * wait for further tasks (see TaskGroup).
+ *
+ * Each worker keeps a queue of the tasks it spawns at each depth of nesting.
+ * It runs its own newest, most deeply nested task first, while idle workers
+ * steal the oldest of the least deeply nested tasks of other workers. A
+ * thread waiting for a group runs other tasks in the meantime, but only tasks
+ * nested more deeply than the one it is running, so waiting never deadlocks
+ * and the stack grows no deeper than the nesting. When there are none, it
+ * sleeps until a task is queued or the group finishes. As for WorkerPool,
+ * the calling thread takes part as worker 0, and tasks must only be spawned
+ * from outside the pool by one thread at a time.
+ */
+class TaskScheduler {
+  private:
+    struct Queue {
+        std::mutex mutex;
+        // Tasks of each depth, from 1 for a task spawned outside the pool,
+        // oldest first
+        std::vector<std::deque<std::function<void(unsigned int)>>> by_depth;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+
+    // Tasks queued and not yet taken, and sleeping of idle workers
+    std::atomic<unsigned int> n_queued;
+    std::mutex mutex;
+    std::condition_variable wake_cv;
+    bool stopping;
+
+    // Sleeping of threads waiting for a group, which are woken whenever a
+    // task is queued or a group finishes, as counted by events
+    std::condition_variable wait_cv;
+    std::atomic<unsigned long long> events;
+    unsigned int n_waiting;
+
+    // Main loop of each thread
+    void work(unsigned int worker);
+
+    // Queue a task from the calling thread
+    void push(std::function<void(unsigned int)> f);
+
+    // Run a single task nested more deeply than min_depth, from the worker's
+    // own queue or stolen from another, returning whether one was found
+    bool run_one(unsigned int worker, unsigned int min_depth);
+
+    // Worker running on the calling thread, or 0 outside the pool
+    unsigned int current_worker();
+
+    // Count an event, waking any threads waiting for a group
+    void notify_waiting();
+
+    // Sleep until an event after the given count, or until nothing is
+    // pending
+    void park(unsigned long long seen,
+              const std::atomic<unsigned int>& pending);
+
+  public:
+    /**
+     * @brief Start the worker threads.
+     * @param n_threads Number of workers, including the calling thread. A
+     * value of 0 uses the number of hardware threads available.
+     */
+    TaskScheduler(unsigned int n_threads = 0);
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    /**
+     * @brief Number of workers, including the calling thread.
+     */
+    unsigned int size();
+
+    ~TaskScheduler();
+
+    friend class TaskGroup;
+};
+
+/**
+ * @brief Tasks spawned together on a TaskScheduler, which may be waited for
+ * as a whole. Groups may be created inside tasks, to any depth.
+ */
+class TaskGroup {
+  private:
+    TaskScheduler& scheduler;
+    std::atomic<unsigned int> pending;
+
+    // First exception thrown by a task of the group
+    std::mutex error_mutex;
+    std::exception_ptr error;
+
+    // Run other tasks until every task of the group has finished, sleeping
+    // while there are none to run
+    void join();
+
+  public:
+    TaskGroup(TaskScheduler& c_scheduler);
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    /**
+     * @brief Spawn f(worker) as a task of the group, where worker (less than
+     * TaskScheduler::size()) identifies the worker running it, so per-worker
+     * state can be used without locking.
+     */
+    void run(std::function<void(unsigned int)> f);
+
+    /**
+     * @brief Block until every task of the group has finished, running other
+     * tasks in the meantime, then rethrow the first exception thrown by any
+     * of them.
+     */
+    void wait();
+
+    // Waits for any tasks still running, discarding their exceptions
+    ~TaskGroup();
+};
+
+#endif // WORKERS_H
@@ -0,0 +1,764 @@
+#include "testmatch/batch.hpp"
+
+#include "testmatch/cards.hpp"
+#include "testmatch/enums.hpp"
+#include "testmatch/helpers.hpp"
+#include "testmatch/pregame.hpp"
+#include "testmatch/simulation.hpp"
+#include "testmatch/team.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+//~~~~~~~~~~~~~~ PlayerProjection implementations ~~~~~~~~~~~~~~//
+int PlayerProjection::RUNS_BINS = 401;
+int PlayerProjection::BALLS_BINS = 801;
+
+PlayerProjection::PlayerProjection(Player* c_player)
+    : player(c_player), bat_innings(0), not_outs(0), runs(0), balls(0),
+      fifties(0), hundreds(0), runs_hist(RUNS_BINS, 0),
+      balls_hist(BALLS_BINS, 0), bowl_innings(0), legal_balls(0),
+      runs_conceded(0), wickets(0), five_fors(0), wickets_hist(11, 0) {
+    for (int i = 0; i < 6; i++)
+        dismissals[i] = 0;
+}
+
+double PlayerProjection::ratio(double num, double den) {
+    return den > 0 ? num / den : 0;
+}
+
+void PlayerProjection::record_batting(BatterCard* card) {
+    if (!card->is_active())
+        return;
+
+    BatStats stats = card->get_sim_stats();
+    bat_innings++;
+    runs += stats.runs;
+    balls += stats.balls;
+
+    if (stats.runs >= 50)
+        fifties++;
+    if (stats.runs >= 100)
+        hundreds++;
+
+    if (card->is_out())
+        dismissals[card->get_dism()->get_mode()]++;
+    else
+        not_outs++;
+
+    runs_hist[std::min(stats.runs, RUNS_BINS - 1)]++;
+    balls_hist[std::min(stats.balls, BALLS_BINS - 1)]++;
+}
+
+void PlayerProjection::record_bowling(BowlerCard* card) {
+    BowlStats stats = card->get_sim_stats();
+    if (stats.balls == 0)
+        return;
+
+    bowl_innings++;
+    legal_balls += 6 * stats.overs + stats.over_balls;
+    runs_conceded += stats.runs;
+    wickets += stats.wickets;
+
+    if (stats.wickets >= 5)
+        five_fors++;
+
+    wickets_hist[std::min(stats.wickets, 10)]++;
+}
+
+PlayerProjection& PlayerProjection::operator+=(const PlayerProjection& rhs) {
+    bat_innings += rhs.bat_innings;
+    not_outs += rhs.not_outs;
+    runs += rhs.runs;
+    balls += rhs.balls;
+    fifties += rhs.fifties;
+    hundreds += rhs.hundreds;
+    for (int i = 0; i < 6; i++)
+        dismissals[i] += rhs.dismissals[i];
+    for (int i = 0; i < RUNS_BINS; i++)
+        runs_hist[i] += rhs.runs_hist[i];
+    for (int i = 0; i < BALLS_BINS; i++)
+        balls_hist[i] += rhs.balls_hist[i];
+
+    bowl_innings += rhs.bowl_innings;
+    legal_balls += rhs.legal_balls;
+    runs_conceded += rhs.runs_conceded;
+    wickets += rhs.wickets;
+    five_fors += rhs.five_fors;
+    for (int i = 0; i < 11; i++)
+        wickets_hist[i] += rhs.wickets_hist[i];
+
+    return *this;
+}
+
+// Getters
+Player* PlayerProjection::get_player() { return player; }
+
+unsigned int PlayerProjection::get_bat_innings() { return bat_innings; }
+
+unsigned int PlayerProjection::get_bowl_innings() { return bowl_innings; }
+
+const std::vector<unsigned int>& PlayerProjection::get_runs_hist() {
+    return runs_hist;
+}
+
+const std::vector<unsigned int>& PlayerProjection::get_balls_hist() {
+    return balls_hist;
+}
+
+const std::vector<unsigned int>& PlayerProjection::get_wickets_hist() {
+    return wickets_hist;
+}
+
+// Batting projections
+double PlayerProjection::mean_runs() { return ratio(runs, bat_innings); }
+
+double PlayerProjection::mean_balls() { return ratio(balls, bat_innings); }
+
+double PlayerProjection::prob_not_out() {
+    return ratio(not_outs, bat_innings);
+}
+
+double PlayerProjection::prob_fifty() { return ratio(fifties, bat_innings); }
+
+double PlayerProjection::prob_hundred() {
+    return ratio(hundreds, bat_innings);
+}
+
+double PlayerProjection::prob_dism(DismType mode) {
+    return ratio(dismissals[mode], bat_innings);
+}
+
+double PlayerProjection::prob_runs_at_least(int n_runs) {
+    if (n_runs <= 0)
+        return bat_innings > 0 ? 1 : 0;
+
+    unsigned int below = 0;
+    for (int i = 0; i < std::min(n_runs, RUNS_BINS); i++)
+        below += runs_hist[i];
+    return ratio(bat_innings - below, bat_innings);
+}
+
+int PlayerProjection::runs_quantile(double q) {
+    unsigned int cumul = 0;
+    for (int i = 0; i < RUNS_BINS; i++) {
+        cumul += runs_hist[i];
+        if (cumul >= q * bat_innings)
+            return i;
+    }
+    return RUNS_BINS - 1;
+}
+
+// Bowling projections
+double PlayerProjection::mean_wickets() {
+    return ratio(wickets, bowl_innings);
+}
+
+double PlayerProjection::economy() {
+    return ratio(6.0 * runs_conceded, legal_balls);
+}
+
+double PlayerProjection::prob_five_for() {
+    return ratio(five_fors, bowl_innings);
+}
+
+//~~~~~~~~~~~~~~ BatchResult implementations ~~~~~~~~~~~~~~//
+BatchResult::BatchResult(Team* c_home_team, Team* c_away_team)
+    : home_team(c_home_team), away_team(c_away_team), n_sims(0),
+      home_wins(0), away_wins(0), converged(false), stratified(false),
+      antithetic(false), control_variates(false) {
+    for (int i = 0; i < 5; i++)
+        result_counts[i] = 0;
+    for (int i = 0; i < 4; i++)
+        stratum_weights[i] = 0.25;
+    control_offset[0] = control_offset[1] = 0;
+
+    // Home XI followed by away XI, in batting order
+    projections.reserve(22);
+    for (int i = 0; i < 11; i++)
+        projections.push_back(PlayerProjection(home_team->players[i]));
+    for (int i = 0; i < 11; i++)
+        projections.push_back(PlayerProjection(away_team->players[i]));
+}
+
+void BatchResult::record(Match& match, unsigned int index, int stratum) {
+    MatchResult* result = match.get_result();
+    if (result == nullptr)
+        return;
+
+    n_sims++;
+    result_counts[result->get_type()]++;
+    int winner = -1;
+    if (result->get_winner() == home_team) {
+        home_wins++;
+        winner = 0;
+    } else if (result->get_winner() == away_team) {
+        away_wins++;
+        winner = 1;
+    }
+
+    if (stratified || antithetic || control_variates) {
+        MatchRecord rec = {index, stratum, winner, result->get_type(), {0, 0}};
+        match_controls(match, rec.controls);
+        rec.controls[0] -= control_offset[0];
+        rec.controls[1] -= control_offset[1];
+        records.push_back(rec);
+    }
+
+    // Cards are created in the order of each team's XI, so the offset of the
+    // team gives the slot of each player directly
+    for (int i = 0; i < match.get_num_innings(); i++) {
+        Innings* inns = match.get_innings(i);
+        int bat_offset = inns->get_bat_team() == home_team ? 0 : 11;
+        int bowl_offset = 11 - bat_offset;
+
+        BatterCard** batters = inns->get_batters();
+        BowlerCard** bowlers = inns->get_bowlers();
+        for (int j = 0; j < 11; j++) {
+            projections[bat_offset + j].record_batting(batters[j]);
+            projections[bowl_offset + j].record_bowling(bowlers[j]);
+        }
+    }
+}
+
+void BatchResult::match_controls(Match& match, double* controls) {
+    controls[0] = controls[1] = 0;
+    for (int i = 0; i < match.get_num_innings(); i++) {
+        Innings* inns = match.get_innings(i);
+        int sign = inns->get_bat_team() == home_team ? 1 : -1;
+        controls[0] += sign * (inns->get_team_score() - inns->get_exp_runs());
+        controls[1] += sign * (inns->get_wkts() - inns->get_exp_wkts());
+    }
+}
+
+BatchResult& BatchResult::operator+=(const BatchResult& rhs) {
+    n_sims += rhs.n_sims;
+    for (int i = 0; i < 5; i++)
+        result_counts[i] += rhs.result_counts[i];
+    home_wins += rhs.home_wins;
+    away_wins += rhs.away_wins;
+
+    for (int i = 0; i < 22; i++)
+        projections[i] += rhs.projections[i];
+
+    records.insert(records.end(), rhs.records.begin(), rhs.records.end());
+
+    return *this;
+}
+
+// Getters
+unsigned int BatchResult::get_n_sims() { return n_sims; }
+
+Team* BatchResult::get_home_team() { return home_team; }
+
+Team* BatchResult::get_away_team() { return away_team; }
+
+unsigned int BatchResult::get_wins(Team* team) {
+    if (team == home_team)
+        return home_wins;
+    else if (team == away_team)
+        return away_wins;
+    else
+        return 0;
+}
+
+unsigned int BatchResult::get_result_count(ResultType type) {
+    return result_counts[type];
+}
+
+std::vector<PlayerProjection>& BatchResult::get_projections() {
+    return projections;
+}
+
+PlayerProjection* BatchResult::get_projection(Player* player) {
+    for (PlayerProjection& proj : projections) {
+        if (proj.get_player() == player)
+            return &proj;
+    }
+    return nullptr;
+}
+
+bool BatchResult::is_converged() { return converged; }
+
+double BatchResult::win_prob(Team* team) {
+    return n_sims > 0 ? (double)get_wins(team) / n_sims : 0;
+}
+
+double BatchResult::result_prob(ResultType type) {
+    return n_sims > 0 ? (double)result_counts[type] / n_sims : 0;
+}
+
+Estimate BatchResult::estimate(std::function<double(const MatchRecord&)> f) {
+    Estimate output = {0, 0, 0, 1};
+    int n = records.size();
+    if (n == 0)
+        return output;
+
+    std::vector<double> x(n);
+    double mean = 0, plain_var = 0;
+    for (int i = 0; i < n; i++) {
+        x[i] = f(records[i]);
+        mean += x[i] / n;
+    }
+    for (int i = 0; i < n; i++)
+        plain_var += (x[i] - mean) * (x[i] - mean);
+    plain_var /= std::max(1, n - 1) * (double)n;
+
+    if (control_variates) {
+        // Regress on the controls within each stratum, so the coefficients
+        // are not confounded by differences between strata
+        double mx[4] = {0}, mc[4][2] = {{0}}, ns[4] = {0};
+        for (int i = 0; i < n; i++) {
+            int s = records[i].stratum;
+            ns[s]++;
+            mx[s] += x[i];
+            mc[s][0] += records[i].controls[0];
+            mc[s][1] += records[i].controls[1];
+        }
+        for (int s = 0; s < 4; s++) {
+            if (ns[s] > 0) {
+                mx[s] /= ns[s];
+                mc[s][0] /= ns[s];
+                mc[s][1] /= ns[s];
+            }
+        }
+
+        double scc[2][2] = {{0}}, scx[2] = {0};
+        for (int i = 0; i < n; i++) {
+            int s = records[i].stratum;
+            double dc0 = records[i].controls[0] - mc[s][0];
+            double dc1 = records[i].controls[1] - mc[s][1];
+            double dx = x[i] - mx[s];
+            scc[0][0] += dc0 * dc0;
+            scc[0][1] += dc0 * dc1;
+            scc[1][1] += dc1 * dc1;
+            scx[0] += dc0 * dx;
+            scx[1] += dc1 * dx;
+        }
+
+        // Solve the 2x2 normal equations, falling back to no adjustment if
+        // they are singular (e.g. a result which never occurred)
+        double det = scc[0][0] * scc[1][1] - scc[0][1] * scc[0][1];
+        if (det > 1e-12 * scc[0][0] * scc[1][1]) {
+            double beta0 = (scc[1][1] * scx[0] - scc[0][1] * scx[1]) / det;
+            double beta1 = (scc[0][0] * scx[1] - scc[0][1] * scx[0]) / det;
+
+            // Controls have known mean zero
+            for (int i = 0; i < n; i++) {
+                x[i] -= beta0 * records[i].controls[0] +
+                        beta1 * records[i].controls[1];
+            }
+        }
+    }
+
+    // Antithetic pairs are averaged into a single unit
+    std::vector<double> units;
+    std::vector<int> unit_strata;
+    if (antithetic) {
+        std::vector<int> order(n);
+        for (int i = 0; i < n; i++)
+            order[i] = i;
+        std::sort(order.begin(), order.end(), [this](int a, int b) {
+            return records[a].index < records[b].index;
+        });
+
+        int i = 0;
+        while (i < n) {
+            int j = order[i];
+            if (i + 1 < n &&
+                records[order[i + 1]].index / 2 == records[j].index / 2) {
+                units.push_back(0.5 * (x[j] + x[order[i + 1]]));
+                i += 2;
+            } else {
+                units.push_back(x[j]);
+                i++;
+            }
+            unit_strata.push_back(records[j].stratum);
+        }
+    } else {
+        units = x;
+        for (int i = 0; i < n; i++)
+            unit_strata.push_back(records[i].stratum);
+    }
+
+    // Combine units, weighting each stratum by its probability
+    int n_strata = stratified ? 4 : 1;
+    double sum[4] = {0}, sum_sq[4] = {0}, count[4] = {0};
+    for (unsigned int i = 0; i < units.size(); i++) {
+        int s = stratified ? unit_strata[i] : 0;
+        sum[s] += units[i];
+        sum_sq[s] += units[i] * units[i];
+        count[s]++;
+    }
+
+    double total_weight = 0;
+    for (int s = 0; s < n_strata; s++) {
+        if (count[s] > 0)
+            total_weight += stratified ? stratum_weights[s] : 1;
+    }
+
+    double var = 0;
+    for (int s = 0; s < n_strata; s++) {
+        if (count[s] == 0)
+            continue;
+
+        double w = (stratified ? stratum_weights[s] : 1) / total_weight;
+        double m = sum[s] / count[s];
+        output.value += w * m;
+        if (count[s] > 1) {
+            double v = (sum_sq[s] - count[s] * m * m) / (count[s] - 1);
+            var += w * w * std::max(0.0, v) / count[s];
+        }
+    }
+
+    output.std_error = sqrt(var);
+    output.plain_std_error = sqrt(plain_var);
+    output.variance_reduction = var > 0 ? plain_var / var : 1;
+    return output;
+}
+
+Estimate BatchResult::plain_estimate(unsigned int successes) {
+    double p = n_sims > 0 ? (double)successes / n_sims : 0;
+    double se = n_sims > 0 ? sqrt(p * (1 - p) / n_sims) : 0;
+    return {p, se, se, 1};
+}
+
+Estimate BatchResult::win_estimate(Team* team) {
+    if (records.empty())
+        return plain_estimate(get_wins(team));
+
+    int winner = team == home_team ? 0 : (team == away_team ? 1 : -2);
+    return estimate([winner](const MatchRecord& rec) {
+        return rec.winner == winner ? 1.0 : 0.0;
+    });
+}
+
+Estimate BatchResult::result_estimate(ResultType type) {
+    if (records.empty())
+        return plain_estimate(get_result_count(type));
+
+    return estimate([type](const MatchRecord& rec) {
+        return rec.type == type ? 1.0 : 0.0;
+    });
+}
+
+// Half-width of the interval of a reduced estimate. The sample standard
+// error is zero when every match so far has had the same outcome, as early in
+// a batch of a lopsided fixture, so it is never taken below the Wilson
+// half-width of the raw counts, narrowed by the variance reduction achieved
+static double reduced_half_width(const Estimate& est, unsigned int successes,
+                                 unsigned int n, double z) {
+    double floor = wilson_half_width(successes, n, z);
+    if (est.variance_reduction > 0)
+        floor /= sqrt(est.variance_reduction);
+    return std::max(z * est.std_error, floor);
+}
+
+double BatchResult::max_half_width(double confidence) {
+    double z = qnorm(0.5 + confidence / 2);
+
+    // Use the reduced standard errors when they are available
+    if (!records.empty()) {
+        double output = std::max(
+            reduced_half_width(win_estimate(home_team), home_wins, n_sims, z),
+            reduced_half_width(win_estimate(away_team), away_wins, n_sims, z));
+        output = std::max(output,
+                          reduced_half_width(result_estimate(draw),
+                                             result_counts[draw], n_sims, z));
+        output = std::max(output,
+                          reduced_half_width(result_estimate(tie),
+                                             result_counts[tie], n_sims, z));
+        return output;
+    }
+
+    double output = std::max(wilson_half_width(home_wins, n_sims, z),
+                             wilson_half_width(away_wins, n_sims, z));
+    output = std::max(output,
+                      wilson_half_width(result_counts[draw], n_sims, z));
+    output =
+        std::max(output, wilson_half_width(result_counts[tie], n_sims, z));
+    return output;
+}
+
+std::string BatchResult::print() {
+    std::stringstream output;
+    output << std::fixed << std::setprecision(3);
+
+    output << n_sims << " simulations\n"
+           << home_team->name << " win: " << win_prob(home_team) << "\n"
+           << away_team->name << " win: " << win_prob(away_team) << "\n"
+           << "Draw: " << result_prob(draw) << "\n"
+           << "Tie: " << result_prob(tie) << "\n\n";
+
+    if (!records.empty()) {
+        output << "Variance reduction\n"
+               << "Result   Estimate   Std err   Plain std err   Reduction\n";
+        std::pair<std::string, Estimate> rows[4] = {
+            {home_team->name + " win", win_estimate(home_team)},
+            {away_team->name + " win", win_estimate(away_team)},
+            {"Draw", result_estimate(draw)},
+            {"Tie", result_estimate(tie)}};
+        for (auto& row : rows) {
+            output << row.first << "   " << row.second.value << "   "
+                   << row.second.std_error << "   "
+                   << row.second.plain_std_error << "   "
+                   << row.second.variance_reduction << "x\n";
+        }
+        output << "\n";
+    }
+
+    output << "Batting (per innings)\n"
+           << "Player   Inns   Mean R   Mean B   P(50+)   P(100+)   P(NO)\n";
+    for (PlayerProjection& proj : projections) {
+        output << proj.get_player()->get_full_initials() << "   "
+               << proj.get_bat_innings() << "   " << proj.mean_runs() << "   "
+               << proj.mean_balls() << "   " << proj.prob_fifty() << "   "
+               << proj.prob_hundred() << "   " << proj.prob_not_out() << "\n";
+    }
+
+    output << "\nBowling (per innings)\n"
+           << "Player   Inns   Mean W   Econ   P(5W)\n";
+    for (PlayerProjection& proj : projections) {
+        if (proj.get_bowl_innings() > 0) {
+            output << proj.get_player()->get_full_initials() << "   "
+                   << proj.get_bowl_innings() << "   " << proj.mean_wickets()
+                   << "   " << proj.economy() << "   " << proj.prob_five_for()
+                   << "\n";
+        }
+    }
+
+    return output.str();
+}
+
+//~~~~~~~~~~~~~~ BatchRunner implementations ~~~~~~~~~~~~~~//
+BatchRunner::BatchRunner(Pregame c_detail, BatchOptions c_opts)
+    : detail(c_detail), opts(c_opts) {
+    if (opts.n_threads == 0)
+        opts.n_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    // Either team is as likely to win the toss, so strata differ only by the
+    // choice made
+    for (int s = 0; s < 4; s++) {
+        TossChoice choice = s % 2 ? field : bat;
+        stratum_weights[s] = Match::PROB_TOSS(detail.venue, choice);
+    }
+}
+
+BatchRunner::BatchRunner(MatchSnapshot c_start, BatchOptions c_opts)
+    : opts(c_opts), start(c_start) {
+    Match match = start.clone();
+    detail = {match.get_venue(), match.get_home_team(), match.get_away_team()};
+
+    if (opts.n_threads == 0)
+        opts.n_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    // The toss has already happened
+    opts.stratify_toss = false;
+    for (int s = 0; s < 4; s++)
+        stratum_weights[s] = 0.25;
+}
+
+int BatchRunner::stratum_of(unsigned int i) {
+    if (!opts.stratify_toss)
+        return 0;
+
+    // Both matches of an antithetic pair share a stratum
+    unsigned int unit = opts.antithetic ? i / 2 : i;
+
+    // Golden ratio sequence allocates close to proportionally over any block
+    // of consecutive matches, so adaptive stopping stays balanced
+    double u = fmod((unit + 0.5) * 0.6180339887498949, 1.0);
+    int s = 0;
+    double cumul = stratum_weights[0];
+    while (s < 3 && u >= cumul)
+        cumul += stratum_weights[++s];
+    return s;
+}
+
+Match BatchRunner::prepare(unsigned int i, int stratum) {
+    // Each match gets its own reproducible random stream, shared by the two
+    // matches of an antithetic pair
+    if (opts.antithetic) {
+        seed_rng(mix_seed(opts.seed, i / 2));
+        set_antithetic(i % 2 == 1);
+    } else {
+        seed_rng(mix_seed(opts.seed, i));
+    }
+
+    // Continue from the snapshot
+    if (!start.is_empty()) {
+        Match match = start.clone();
+        match.set_tactics(opts.tactics);
+        match.set_delivery_model(opts.delivery_model);
+        return match;
+    }
+
+    Match match(detail);
+    match.set_tactics(opts.tactics);
+    match.set_delivery_model(opts.delivery_model);
+    if (opts.stratify_toss) {
+        bool home_wins = stratum / 2 == 0;
+        Team* winner = home_wins ? detail.home_team : detail.away_team;
+        Team* loser = home_wins ? detail.away_team : detail.home_team;
+        match.pregame({winner, loser, stratum % 2 ? field : bat});
+    } else {
+        match.pregame();
+    }
+    return match;
+}
+
+Team* BatchRunner::simulate_one(unsigned int i, BatchResult& shard) {
+    int stratum = stratum_of(i);
+    Match match = prepare(i, stratum);
+    if (!start.is_empty())
+        match.advance();
+    else
+        match.start_with<SummaryCommentary>();
+    set_antithetic(false);
+
+    shard.record(match, i, stratum);
+    return match.get_result()->get_winner();
+}
+
+void BatchRunner::query_one(unsigned int i, const MatchQuery& query,
+                            QueryResult& shard) {
+    int stratum = stratum_of(i);
+    Match match = prepare(i, stratum);
+    int answer = MatchQuery::UNSETTLED;
+    match.simulate_until(
+        [&query, &answer](Match& m) {
+            answer = query.settle(m);
+            return answer != MatchQuery::UNSETTLED;
+        },
+        query.is_by_delivery());
+    set_antithetic(false);
+
+    shard.n_sims[stratum]++;
+    shard.n_true[stratum] += answer == 1;
+    shard.innings += match.get_num_innings();
+}
+
+void BatchRunner::run_range(unsigned int begin, unsigned int end,
+                            std::vector<BatchResult>& shards,
+                            WorkerPool* pool) {
+    if (pool != nullptr) {
+        pool->parallel_for(begin, end, [this, &shards](unsigned int i,
+                                                       unsigned int worker) {
+            simulate_one(i, shards[worker]);
+        });
+        return;
+    }
+
+    unsigned int n_threads = std::min((unsigned int)shards.size(), end - begin);
+
+    // Matches are handed out one at a time, so threads which draw short
+    // matches simply take more of them
+    std::atomic<unsigned int> next(begin);
+    auto worker = [this, &next, end](BatchResult& shard) {
+        unsigned int i;
+        while ((i = next.fetch_add(1)) < end)
+            simulate_one(i, shard);
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned int t = 1; t < n_threads; t++)
+        threads.emplace_back(worker, std::ref(shards[t]));
+    worker(shards[0]);
+    for (std::thread& th : threads)
+        th.join();
+}
+
+QueryResult BatchRunner::run_query(const MatchQuery& query,
+                                   WorkerPool* pool) {
+    QueryResult empty(query.get_name());
+    empty.stratified = opts.stratify_toss;
+    for (int s = 0; s < 4; s++)
+        empty.stratum_weights[s] = stratum_weights[s];
+
+    std::unique_ptr<WorkerPool> own;
+    if (pool == nullptr) {
+        own.reset(new WorkerPool(std::min(opts.n_threads, opts.n_sims)));
+        pool = own.get();
+    }
+
+    std::vector<QueryResult> shards(pool->size(), empty);
+    pool->parallel_for(0, opts.n_sims,
+                       [this, &query, &shards](unsigned int i,
+                                               unsigned int worker) {
+                           query_one(i, query, shards[worker]);
+                       });
+
+    QueryResult output = shards[0];
+    for (unsigned int t = 1; t < shards.size(); t++)
+        output += shards[t];
+    return output;
+}
+
+BatchResult BatchRunner::empty_result() {
+    BatchResult output(detail.home_team, detail.away_team);
+    output.stratified = opts.stratify_toss;
+    output.antithetic = opts.antithetic;
+    output.control_variates = opts.control_variates;
+    for (int s = 0; s < 4; s++)
+        output.stratum_weights[s] = stratum_weights[s];
+
+    // Controls only count deliveries after the snapshot, so they keep mean
+    // zero
+    if (!start.is_empty()) {
+        Match match = start.clone();
+        output.match_controls(match, output.control_offset);
+    }
+    return output;
+}
+
+BatchResult BatchRunner::merge(const std::vector<BatchResult>& shards) {
+    BatchResult output = shards[0];
+    for (unsigned int t = 1; t < shards.size(); t++)
+        output += shards[t];
+
+    // Order records by index, so estimates do not depend on which thread
+    // simulated each match
+    std::sort(output.records.begin(), output.records.end(),
+              [](const MatchRecord& x, const MatchRecord& y) {
+                  return x.index < y.index;
+              });
+    return output;
+}
+
+BatchResult BatchRunner::run(WorkerPool* pool) {
+    BatchResult empty = empty_result();
+    unsigned int n_shards = pool != nullptr
+                                ? pool->size()
+                                : std::min(opts.n_threads, opts.n_sims);
+    std::vector<BatchResult> shards(std::max(1u, n_shards), empty);
+
+    // Without a precision target, the whole batch is a single block
+    bool adaptive = opts.target_half_width > 0;
+    unsigned int block =
+        adaptive ? std::max(1u, opts.check_every) : opts.n_sims;
+
+    BatchResult output = empty;
+    unsigned int done = 0;
+    while (done < opts.n_sims) {
+        unsigned int end = std::min(opts.n_sims, done + block);
+        run_range(done, end, shards, pool);
+        done = end;
+        output = merge(shards);
+
+        if (adaptive &&
+            output.max_half_width(opts.confidence) <= opts.target_half_width) {
+            output.converged = true;
+            break;
+        }
+    }
+
+    return output;
+}
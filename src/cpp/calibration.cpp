@@ -0,0 +1,720 @@
+#include "testmatch/calibration.hpp"
+
+#include "testmatch/enums.hpp"
+#include "testmatch/helpers.hpp"
+#include "testmatch/models.hpp"
+#include "testmatch/workers.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Coefficient file header, followed by the counts of files and deliveries,
+// the tables, then the coefficients over all phases and for each phase. The
+// checksum is an FNV-1a hash of everything after the header
+static const char COEF_MAGIC[4] = {'T', 'M', 'C', 'F'};
+static const uint32_t COEF_VERSION = 3;
+
+struct CoefficientHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t n_types;
+    uint32_t n_phases;
+    uint32_t n_outcomes;
+    uint32_t n_dism_modes;
+    // Size of each set of coefficients, in bytes
+    uint32_t coefs_size;
+    uint32_t reserved;
+    uint64_t checksum;
+};
+
+static uint64_t checksum(const char* data, size_t size) {
+    uint64_t output = 14695981039346656037ull;
+    for (size_t i = 0; i < size; i++) {
+        output ^= (unsigned char)data[i];
+        output *= 1099511628211ull;
+    }
+    return output;
+}
+
+// Number of counts stored in a coefficient file
+static size_t num_counts() {
+    return 4 + CalibrationTables::NUM_TYPES * CalibrationTables::NUM_PHASES *
+                   (Model::NUM_DELIV_OUTCOMES + Model::NUM_DISM_MODES);
+}
+
+/**
+ * @brief Minimal streaming JSON parser, reporting each value by its path of
+ * object keys (separated by '/', with array indices omitted) without building
+ * a document.
+ */
+class JsonStream {
+  private:
+    std::streambuf* buf;
+    std::string path;
+
+    int peek() { return buf->sgetc(); }
+    int next() { return buf->sbumpc(); }
+
+    void skip_space() {
+        int c = peek();
+        while (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+            next();
+            c = peek();
+        }
+    }
+
+    [[noreturn]] void fail(std::string what) {
+        throw std::runtime_error("Invalid JSON: " + what + " at " + path);
+    }
+
+    void expect(char c) {
+        skip_space();
+        if (next() != c)
+            fail(std::string("expected '") + c + "'");
+    }
+
+    std::string read_string() {
+        expect('"');
+        std::string output;
+        int c;
+        while ((c = next()) != '"') {
+            if (c == std::char_traits<char>::eof())
+                fail("unterminated string");
+            if (c == '\\') {
+                // Escapes are kept as the escaped character, except for
+                // unicode escapes, which are kept as written
+                c = next();
+                if (c == 'u')
+                    output += "\\u";
+                else if (c == 'n')
+                    output += '\n';
+                else if (c == 't')
+                    output += '\t';
+                else if (c != std::char_traits<char>::eof())
+                    output += (char)c;
+                continue;
+            }
+            output += (char)c;
+        }
+        return output;
+    }
+
+    // Number or literal, as written
+    std::string read_scalar() {
+        std::string output;
+        int c = peek();
+        while (c != std::char_traits<char>::eof() && c != ',' && c != '}' &&
+               c != ']' && c != ' ' && c != '\n' && c != '\r' && c != '\t') {
+            output += (char)next();
+            c = peek();
+        }
+        if (output.empty())
+            fail("expected a value");
+        return output;
+    }
+
+    template <class Handler> void read_value(Handler& handler) {
+        skip_space();
+        int c = peek();
+        if (c == '{') {
+            next();
+            handler.begin_object(path);
+            skip_space();
+            if (peek() == '}') {
+                next();
+            } else {
+                while (true) {
+                    std::string key = read_string();
+                    expect(':');
+                    size_t length = path.size();
+                    if (!path.empty())
+                        path += '/';
+                    path += key;
+                    read_value(handler);
+                    path.resize(length);
+
+                    skip_space();
+                    c = next();
+                    if (c == '}')
+                        break;
+                    if (c != ',')
+                        fail("expected ',' or '}'");
+                }
+            }
+            handler.end_object(path);
+        } else if (c == '[') {
+            next();
+            skip_space();
+            if (peek() == ']') {
+                next();
+                return;
+            }
+            while (true) {
+                read_value(handler);
+                skip_space();
+                c = next();
+                if (c == ']')
+                    break;
+                if (c != ',')
+                    fail("expected ',' or ']'");
+            }
+        } else if (c == '"') {
+            handler.value(path, read_string());
+        } else {
+            handler.value(path, read_scalar());
+        }
+    }
+
+  public:
+    JsonStream(std::istream& input) : buf(input.rdbuf()) {}
+
+    template <class Handler> void parse(Handler& handler) {
+        read_value(handler);
+        skip_space();
+        if (peek() != std::char_traits<char>::eof())
+            fail("trailing characters");
+    }
+};
+
+// Index of the outcome with the given representation, or -1 if the model has
+// no such outcome
+static int outcome_index(const std::string& outcome) {
+    for (int i = 0; i < Model::NUM_DELIV_OUTCOMES; i++) {
+        if (Model::DELIV_OUTCOMES[i] == outcome)
+            return i;
+    }
+    return -1;
+}
+
+// Index of a Cricsheet mode of dismissal in Model::DISM_MODES_STATIC, -1 for
+// a dismissal which is not modelled, or -2 if the batter is not out
+static int dism_index(const std::string& kind) {
+    DismType dism;
+    if (kind == "bowled")
+        dism = bowled;
+    else if (kind == "caught")
+        dism = caught;
+    else if (kind == "caught and bowled")
+        dism = c_and_b;
+    else if (kind == "lbw")
+        dism = lbw;
+    else if (kind == "run out")
+        dism = run_out;
+    else if (kind == "stumped")
+        dism = stumped;
+    else if (kind == "retired hurt" || kind == "retired not out")
+        return -2;
+    else
+        return -1;
+
+    for (int i = 0; i < Model::NUM_DISM_MODES; i++) {
+        if (Model::DISM_MODES_STATIC[i] == dism)
+            return i;
+    }
+    return -1;
+}
+
+/**
+ * @brief Collects the deliveries of one Cricsheet match file.
+ */
+class CricsheetHandler {
+  private:
+    const std::unordered_map<std::string, int>& styles;
+    CalibrationTables& tables;
+
+    int over;
+
+    // Delivery being read
+    std::string bowler;
+    int batter_runs, total_runs;
+    int wides, noballs, byes, legbyes, penalty;
+    int dism;
+    bool has_wicket;
+
+    static bool ends_with(const std::string& str, const char* suffix) {
+        size_t n = strlen(suffix);
+        return str.size() >= n &&
+               str.compare(str.size() - n, n, suffix) == 0;
+    }
+
+    void add_delivery() {
+        int phase = CalibrationTables::phase_of_over(over);
+        auto it = styles.find(bowler);
+        int type = it != styles.end() ? it->second
+                                      : CalibrationTables::UNKNOWN_TYPE;
+
+        if (has_wicket) {
+            tables.add_delivery(type, phase, Model::NUM_DELIV_OUTCOMES - 1,
+                                dism);
+            return;
+        }
+
+        // Extras are named by the total runs from the delivery, so that the
+        // leading digit is the number of runs scored
+        int runs = total_runs - penalty;
+        std::string outcome;
+        if (wides > 0)
+            outcome = std::to_string(runs) + "wd";
+        else if (noballs > 0)
+            outcome = std::to_string(runs) + "nb";
+        else if (byes > 0)
+            outcome = std::to_string(runs) + "b";
+        else if (legbyes > 0)
+            outcome = std::to_string(runs) + "lb";
+        else
+            outcome = std::to_string(batter_runs);
+
+        int index = outcome_index(outcome);
+        if (index < 0 || index == Model::NUM_DELIV_OUTCOMES - 1)
+            tables.skip_delivery();
+        else
+            tables.add_delivery(type, phase, index);
+    }
+
+  public:
+    std::string match_type;
+
+    CricsheetHandler(const std::unordered_map<std::string, int>& c_styles,
+                     CalibrationTables& c_tables)
+        : styles(c_styles), tables(c_tables), over(0) {}
+
+    void begin_object(const std::string& path) {
+        if (path == "innings/overs/deliveries") {
+            bowler.clear();
+            batter_runs = total_runs = 0;
+            wides = noballs = byes = legbyes = penalty = 0;
+            dism = -1;
+            has_wicket = false;
+        }
+    }
+
+    void end_object(const std::string& path) {
+        if (path == "innings/overs/deliveries")
+            add_delivery();
+    }
+
+    void value(const std::string& path, const std::string& value) {
+        static const std::string DELIVERY = "innings/overs/deliveries/";
+        if (path.compare(0, DELIVERY.size(), DELIVERY) != 0) {
+            if (path == "innings/overs/over")
+                over = std::stoi(value);
+            else if (path == "info/match_type")
+                match_type = value;
+            return;
+        }
+
+        if (ends_with(path, "deliveries/bowler"))
+            bowler = value;
+        else if (ends_with(path, "deliveries/runs/batter"))
+            batter_runs = std::stoi(value);
+        else if (ends_with(path, "deliveries/runs/total"))
+            total_runs = std::stoi(value);
+        else if (ends_with(path, "deliveries/extras/wides"))
+            wides = std::stoi(value);
+        else if (ends_with(path, "deliveries/extras/noballs"))
+            noballs = std::stoi(value);
+        else if (ends_with(path, "deliveries/extras/byes"))
+            byes = std::stoi(value);
+        else if (ends_with(path, "deliveries/extras/legbyes"))
+            legbyes = std::stoi(value);
+        else if (ends_with(path, "deliveries/extras/penalty"))
+            penalty = std::stoi(value);
+        else if (ends_with(path, "deliveries/wickets/kind")) {
+            // Only the first wicket of a delivery is modelled
+            int index = dism_index(value);
+            if (index != -2 && !has_wicket) {
+                has_wicket = true;
+                dism = index;
+            }
+        }
+    }
+};
+
+// Write a whole buffer to a file descriptor, returning whether it succeeded
+static bool write_all(int fd, const void* data, size_t size) {
+    const char* bytes = (const char*)data;
+    while (size > 0) {
+        ssize_t n = write(fd, bytes, size);
+        if (n < 0)
+            return false;
+        bytes += n;
+        size -= n;
+    }
+    return true;
+}
+
+//~~~~~~~~~~~~~~ CalibrationTables implementations ~~~~~~~~~~~~~~//
+CalibrationTables::CalibrationTables()
+    : outcome_counts(NUM_TYPES * NUM_PHASES * Model::NUM_DELIV_OUTCOMES, 0),
+      dism_counts(NUM_TYPES * NUM_PHASES * Model::NUM_DISM_MODES, 0),
+      n_files(0), n_matches(0), n_failed(0), n_skipped(0) {}
+
+int CalibrationTables::phase_of_over(int over) {
+    if (over < 20)
+        return 0;
+    return over < 80 ? 1 : 2;
+}
+
+void CalibrationTables::add_delivery(int type, int phase, int outcome,
+                                     int dism) {
+    outcome_counts[(type * NUM_PHASES + phase) * Model::NUM_DELIV_OUTCOMES +
+                   outcome]++;
+    if (dism >= 0)
+        dism_counts[(type * NUM_PHASES + phase) * Model::NUM_DISM_MODES +
+                    dism]++;
+}
+
+void CalibrationTables::skip_delivery() { n_skipped++; }
+
+void CalibrationTables::add_file(bool failed) {
+    n_files++;
+    n_failed += failed;
+}
+
+void CalibrationTables::add_match() { n_matches++; }
+
+CalibrationTables&
+CalibrationTables::operator+=(const CalibrationTables& rhs) {
+    for (unsigned int i = 0; i < outcome_counts.size(); i++)
+        outcome_counts[i] += rhs.outcome_counts[i];
+    for (unsigned int i = 0; i < dism_counts.size(); i++)
+        dism_counts[i] += rhs.dism_counts[i];
+    n_files += rhs.n_files;
+    n_matches += rhs.n_matches;
+    n_failed += rhs.n_failed;
+    n_skipped += rhs.n_skipped;
+    return *this;
+}
+
+unsigned long long CalibrationTables::get_outcome_count(int type, int phase,
+                                                        int outcome) const {
+    return outcome_counts[(type * NUM_PHASES + phase) *
+                              Model::NUM_DELIV_OUTCOMES +
+                          outcome];
+}
+
+unsigned long long CalibrationTables::get_dism_count(int type, int phase,
+                                                     int dism) const {
+    return dism_counts[(type * NUM_PHASES + phase) * Model::NUM_DISM_MODES +
+                       dism];
+}
+
+unsigned long long CalibrationTables::get_n_deliveries() const {
+    unsigned long long output = 0;
+    for (unsigned long long count : outcome_counts)
+        output += count;
+    return output;
+}
+
+unsigned long long CalibrationTables::get_n_files() const { return n_files; }
+
+unsigned long long CalibrationTables::get_n_matches() const {
+    return n_matches;
+}
+
+unsigned long long CalibrationTables::get_n_failed() const {
+    return n_failed;
+}
+
+unsigned long long CalibrationTables::get_n_skipped() const {
+    return n_skipped;
+}
+
+Model::Coefficients CalibrationTables::fit_phase(int phase) const {
+    Model::Coefficients output = *Model::published_coefficients();
+    int n_outcomes = Model::NUM_DELIV_OUTCOMES, n_modes = Model::NUM_DISM_MODES;
+
+    for (int slow = 0; slow < 2; slow++) {
+        // Sum the counts of the bowling types in the class, falling back to
+        // bowlers of unknown type if there are none
+        std::vector<unsigned long long> outcomes(n_outcomes, 0);
+        std::vector<unsigned long long> modes(n_modes, 0);
+        auto add_type = [&](int type) {
+            for (int p = 0; p < NUM_PHASES; p++) {
+                if (phase >= 0 && p != phase)
+                    continue;
+                for (int i = 0; i < n_outcomes; i++)
+                    outcomes[i] += get_outcome_count(type, p, i);
+                for (int j = 0; j < n_modes; j++)
+                    modes[j] += get_dism_count(type, p, j);
+            }
+        };
+        for (int type = 0; type < UNKNOWN_TYPE; type++) {
+            if (is_slow_bowler((BowlType)type) == (bool)slow)
+                add_type(type);
+        }
+
+        // Wickets are modelled separately, so only the other outcomes count
+        unsigned long long total = 0, total_modes = 0;
+        for (int i = 0; i < n_outcomes - 1; i++)
+            total += outcomes[i];
+        if (total == 0) {
+            add_type(UNKNOWN_TYPE);
+            total = 0;
+            for (int i = 0; i < n_outcomes - 1; i++)
+                total += outcomes[i];
+        }
+        for (int j = 0; j < n_modes; j++)
+            total_modes += modes[j];
+
+        double* cdf = slow ? output.spin_cdf : output.pace_cdf;
+        if (total > 0) {
+            unsigned long long cumul = 0;
+            for (int i = 0; i < n_outcomes - 1; i++) {
+                cdf[i] = (double)cumul / total;
+                cumul += outcomes[i];
+            }
+        }
+
+        double* dism_cdf = slow ? output.spin_dism_cdf : output.pace_dism_cdf;
+        if (total_modes > 0) {
+            unsigned long long cumul = 0;
+            for (int j = 0; j < n_modes; j++) {
+                dism_cdf[j] = (double)cumul / total_modes;
+                cumul += modes[j];
+            }
+        }
+    }
+    return output;
+}
+
+Model::Coefficients CalibrationTables::fit(int phase) const {
+    if (phase >= NUM_PHASES)
+        throw std::invalid_argument("No such phase: " + std::to_string(phase));
+    return fit_phase(phase < 0 ? -1 : phase);
+}
+
+void CalibrationTables::save(std::string path) const {
+    // The body is assembled first, so the header can carry its checksum
+    std::vector<unsigned long long> counts = {n_files, n_matches, n_failed,
+                                              n_skipped};
+    counts.insert(counts.end(), outcome_counts.begin(), outcome_counts.end());
+    counts.insert(counts.end(), dism_counts.begin(), dism_counts.end());
+    std::vector<Model::Coefficients> coefs;
+    for (int phase = -1; phase < NUM_PHASES; phase++)
+        coefs.push_back(fit(phase));
+
+    std::vector<char> body(counts.size() * sizeof(unsigned long long) +
+                           coefs.size() * sizeof(Model::Coefficients));
+    memcpy(body.data(), counts.data(),
+           counts.size() * sizeof(unsigned long long));
+    memcpy(body.data() + counts.size() * sizeof(unsigned long long),
+           coefs.data(), coefs.size() * sizeof(Model::Coefficients));
+
+    CoefficientHeader header = {};
+    memcpy(header.magic, COEF_MAGIC, 4);
+    header.version = COEF_VERSION;
+    header.n_types = NUM_TYPES;
+    header.n_phases = NUM_PHASES;
+    header.n_outcomes = Model::NUM_DELIV_OUTCOMES;
+    header.n_dism_modes = Model::NUM_DISM_MODES;
+    header.coefs_size = sizeof(Model::Coefficients);
+    header.checksum = checksum(body.data(), body.size());
+
+    // Written to a new file in the same directory, which then replaces the
+    // target, so a process with the old file mapped keeps its contents
+    std::string temp = path + ".XXXXXX";
+    int fd = mkstemp(temp.data());
+    if (fd < 0)
+        throw std::runtime_error("Could not open coefficient file: " + path);
+    bool written = fchmod(fd, 0644) == 0 &&
+                   write_all(fd, &header, sizeof(header)) &&
+                   write_all(fd, body.data(), body.size());
+    written = close(fd) == 0 && written;
+    if (!written || std::rename(temp.c_str(), path.c_str()) != 0) {
+        unlink(temp.c_str());
+        throw std::runtime_error("Could not write coefficient file: " + path);
+    }
+}
+
+CalibrationTables CalibrationTables::load(std::string path) {
+    CoefficientFile file(path);
+    const unsigned long long* counts = file.counts;
+
+    CalibrationTables output;
+    output.n_files = counts[0];
+    output.n_matches = counts[1];
+    output.n_failed = counts[2];
+    output.n_skipped = counts[3];
+    const unsigned long long* it = counts + 4;
+    std::copy(it, it + output.outcome_counts.size(),
+              output.outcome_counts.begin());
+    it += output.outcome_counts.size();
+    std::copy(it, it + output.dism_counts.size(), output.dism_counts.begin());
+    return output;
+}
+
+//~~~~~~~~~~~~~~ CoefficientFile implementations ~~~~~~~~~~~~~~//
+CoefficientFile::CoefficientFile(std::string path)
+    : mapping(nullptr), mapping_size(0) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Could not open coefficient file: " + path);
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw std::runtime_error("Could not read coefficient file: " + path);
+    }
+    mapping_size = st.st_size;
+    if (mapping_size < sizeof(CoefficientHeader)) {
+        close(fd);
+        throw std::runtime_error("Not a coefficient file: " + path);
+    }
+    mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        throw std::runtime_error("Could not map coefficient file: " + path);
+    }
+
+    // Checked in order, so the most useful error is reported
+    const char* data = (const char*)mapping;
+    const CoefficientHeader* header = (const CoefficientHeader*)data;
+    size_t body_size = num_counts() * sizeof(unsigned long long) +
+                       (1 + CalibrationTables::NUM_PHASES) *
+                           sizeof(Model::Coefficients);
+    std::string error;
+    if (memcmp(header->magic, COEF_MAGIC, 4) != 0)
+        error = "Not a coefficient file: ";
+    else if (header->version != COEF_VERSION ||
+             header->n_types != (uint32_t)CalibrationTables::NUM_TYPES ||
+             header->n_phases != (uint32_t)CalibrationTables::NUM_PHASES ||
+             header->n_outcomes != (uint32_t)Model::NUM_DELIV_OUTCOMES ||
+             header->n_dism_modes != (uint32_t)Model::NUM_DISM_MODES ||
+             header->coefs_size != sizeof(Model::Coefficients))
+        error = "Unsupported coefficient file version: ";
+    else if (mapping_size != sizeof(CoefficientHeader) + body_size)
+        error = "Truncated coefficient file: ";
+    else if (checksum(data + sizeof(CoefficientHeader), body_size) !=
+             header->checksum)
+        error = "Corrupt coefficient file: ";
+    if (!error.empty()) {
+        munmap(mapping, mapping_size);
+        throw std::runtime_error(error + path);
+    }
+
+    counts = (const unsigned long long*)(data + sizeof(CoefficientHeader));
+    coefs = (const Model::Coefficients*)(counts + num_counts());
+}
+
+const Model::Coefficients& CoefficientFile::get(int phase) const {
+    if (phase < -1 || phase >= CalibrationTables::NUM_PHASES)
+        throw std::invalid_argument("No such phase: " + std::to_string(phase));
+    return coefs[phase + 1];
+}
+
+CoefficientFile::~CoefficientFile() {
+    if (mapping != nullptr)
+        munmap(mapping, mapping_size);
+}
+
+void load_coefficients(std::string path) {
+    // The published coefficients share ownership of the mapping
+    std::shared_ptr<const CoefficientFile> file =
+        std::make_shared<const CoefficientFile>(path);
+    Model::publish_coefficients(
+        std::shared_ptr<const Model::Coefficients>(file, &file->get()));
+    Model::sync_coefficients();
+}
+
+//~~~~~~~~~~~~~~ CricsheetReader implementations ~~~~~~~~~~~~~~//
+CricsheetReader::CricsheetReader(CalibrationOptions c_opts) : opts(c_opts) {
+    if (opts.n_threads == 0)
+        opts.n_threads = std::max(1u, std::thread::hardware_concurrency());
+}
+
+void CricsheetReader::add_style(std::string name, BowlType type) {
+    styles[name] = type;
+}
+
+unsigned int CricsheetReader::read_styles(std::istream& input) {
+    unsigned int output = 0;
+    std::string line;
+    while (std::getline(input, line)) {
+        size_t comma = line.rfind(',');
+        if (comma == std::string::npos)
+            continue;
+
+        std::string type = line.substr(comma + 1);
+        if (!type.empty() && type.back() == '\r')
+            type.pop_back();
+        try {
+            add_style(line.substr(0, comma), str_to_bowltype(type));
+            output++;
+        } catch (std::invalid_argument&) {
+            // Header row, or a type which is not modelled
+        }
+    }
+    return output;
+}
+
+bool CricsheetReader::read(std::istream& input, CalibrationTables& tables) {
+    // Count into a table of its own, as the type of match may only be known
+    // once the file has been read
+    CalibrationTables match;
+    CricsheetHandler handler(styles, match);
+    JsonStream(input).parse(handler);
+
+    if (!opts.match_type.empty() && handler.match_type != opts.match_type)
+        return false;
+    match.add_match();
+    tables += match;
+    return true;
+}
+
+CalibrationTables CricsheetReader::read_dir(std::string dir,
+                                            WorkerPool* pool) {
+    // Sorted, so that any failures are reported in a consistent order
+    std::vector<std::string> paths;
+    for (auto& entry : std::filesystem::directory_iterator(dir)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".json")
+            paths.push_back(entry.path().string());
+    }
+    std::sort(paths.begin(), paths.end());
+
+    std::unique_ptr<WorkerPool> own;
+    if (pool == nullptr) {
+        own.reset(new WorkerPool(std::min(
+            opts.n_threads, std::max(1u, (unsigned int)paths.size()))));
+        pool = own.get();
+    }
+
+    // Each worker streams one file at a time into its own tables
+    std::vector<CalibrationTables> shards(pool->size());
+    pool->parallel_for(0, paths.size(),
+                       [this, &paths, &shards](unsigned int i,
+                                               unsigned int worker) {
+                           std::ifstream file(paths[i]);
+                           bool failed = !file;
+                           if (!failed) {
+                               try {
+                                   read(file, shards[worker]);
+                               } catch (std::exception&) {
+                                   failed = true;
+                               }
+                           }
+                           shards[worker].add_file(failed);
+                       });
+
+    CalibrationTables output;
+    for (CalibrationTables& shard : shards)
+        output += shard;
+    return output;
+}
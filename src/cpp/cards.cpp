@@ -70,20 +70,16 @@ Player* Dismissal::get_fielder() { return fielder; }
     Fatigue implementations
 */
 // Distribution parameters
-double Fatigue::MEAN_PACE_FATIGUE = 5;
-double Fatigue::MEAN_SPIN_FATIGUE = 0.5;
-double Fatigue::EXTRA_PACE_PENALTY = 1;
-double Fatigue::VAR_PACE_FATIGUE = 1;
-double Fatigue::VAR_SPIN_FATIGUE = 0.1;
+thread_local double Fatigue::MEAN_PACE_FATIGUE = 5;
+thread_local double Fatigue::MEAN_SPIN_FATIGUE = 0.5;
+thread_local double Fatigue::EXTRA_PACE_PENALTY = 1;
+thread_local double Fatigue::VAR_PACE_FATIGUE = 1;
+thread_local double Fatigue::VAR_SPIN_FATIGUE = 0.1;
 
-// Uniform number generators
-std::random_device Fatigue::RD;
-std::mt19937 Fatigue::GEN{RD()};
-
-Fatigue::Fatigue(BowlType c_bowl_type) : value(0) {
+Fatigue::Fatigue(BowlType c_bowl_type) : value(0), pending(0) {
 
     // Set up sampling distribution
-    double mean, var;
+    double var;
     if (is_slow_bowler(c_bowl_type)) {
         mean = MEAN_SPIN_FATIGUE;
         var = VAR_SPIN_FATIGUE;
@@ -97,27 +93,39 @@ Fatigue::Fatigue(BowlType c_bowl_type) : value(0) {
         }
     }
 
-    dist = new std::normal_distribution<double>(mean, sqrt(var));
+    sd = sqrt(var);
+}
+
+double Fatigue::get_value() {
+    flush();
+    return value;
 }
 
-double Fatigue::get_value() { return value; }
+void Fatigue::flush() {
+    if (pending > 0) {
+        value += std::normal_distribution<double>(pending * mean,
+                                                  sqrt(pending) * sd)(
+            rng_engine());
+        pending = 0;
+    }
+}
 
-void Fatigue::ball_bowled() { value += (*dist)(GEN); }
+void Fatigue::ball_bowled() { pending++; }
 
 void Fatigue::wicket() {
     // Player gets a boost
+    flush();
     if (value > 0)
-        value -= 3 * dist->mean();
+        value -= 3 * mean;
 }
 
 void Fatigue::rest(double time) {
     // Ease fatigue
+    flush();
     if (value > 0)
-        value -= 3 * dist->mean();
+        value -= 3 * mean;
 }
 
-Fatigue::~Fatigue() { delete dist; }
-
 /*
     PlayerCard implementations
 */
@@ -146,6 +154,14 @@ BatterCard::BatterCard(Player* c_player) : PlayerCard(c_player) {
 
     active = false;
     out = false;
+    mins = 0;
+}
+
+BatterCard::BatterCard(const BatterCard& bc)
+    : PlayerCard(bc.player), stats(bc.stats), active(bc.active), out(bc.out),
+      mins(bc.mins), playstyle_flag(bc.playstyle_flag) {
+    if (out)
+        dism = new Dismissal(*bc.dism);
 }
 
 BatStats BatterCard::get_sim_stats() { return stats; }
@@ -228,6 +244,8 @@ void BatterCard::update_score(std::string outcome) {
     // Do nothing on wides
 }
 
+void BatterCard::add_dots(int n) { stats.balls += n; }
+
 void BatterCard::dismiss(DismType d_mode, Player* d_bowler, Player* d_fielder) {
     // Construct Dismissal structure
     dism = new Dismissal(d_mode, d_bowler, d_fielder);
@@ -311,6 +329,8 @@ BowlerCard::BowlerCard(Player* c_player)
     competency = DETERMINE_COMPETENCY(c_player);
 }
 
+thread_local double BowlerCard::INFLATION_FACTOR = 3;
+
 int BowlerCard::DETERMINE_COMPETENCY(Player* player) {
     if (player->get_innings() == 0) {
         // Debut case - check role
@@ -336,6 +356,11 @@ int BowlerCard::DETERMINE_COMPETENCY(Player* player) {
 
 BowlStats BowlerCard::get_sim_stats(void) { return stats; }
 
+void BowlerCard::inflate_bowl_avg() {
+    stats.bowl_avg *= INFLATION_FACTOR;
+    stats.strike_rate *= INFLATION_FACTOR;
+}
+
 void BowlerCard::start_new_spell() {
     stats.spell_balls = 0;
     stats.spell_overs = 0;
@@ -436,6 +461,17 @@ void BowlerCard::update_score(std::string outcome) {
     tiredness.ball_bowled();
 }
 
+void BowlerCard::add_dots(int n) {
+    for (int k = 0; k < n; k++) {
+        stats.balls++;
+        add_ball();
+
+        // As in update_score(), fatigue is added twice for each ball
+        tiredness.ball_bowled();
+        tiredness.ball_bowled();
+    }
+}
+
 template <typename T>
 PlayerCard** sort_array(PlayerCard** list, int len,
                         T (Player::*sort_val)() const) {
@@ -515,8 +551,12 @@ void Over::add_ball(Ball* ball) {
         last = ball;
     }
 
+    count_ball(ball->legal);
+}
+
+void Over::count_ball(bool legal) {
     // Check if legal delivery
-    if (ball->legal) {
+    if (legal) {
         num_legal_delivs++;
     }
 
@@ -537,6 +577,18 @@ Ball* Over::get_last() { return last; }
 
 Over* Over::get_next() { return next; }
 
+Over::Over(const Over& over)
+    : over_num(over.over_num), first(nullptr), last(nullptr), num_balls(0),
+      num_legal_delivs(0) {
+    for (Ball* ball = over.first; ball != nullptr; ball = ball->next) {
+        Ball* copy = new Ball(*ball);
+        copy->next = nullptr;
+        add_ball(copy);
+    }
+    num_balls = over.num_balls;
+    num_legal_delivs = over.num_legal_delivs;
+}
+
 Over::~Over() {
     // Delete each ball iteratively
     delete_linkedlist<Ball>(first);
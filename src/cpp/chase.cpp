@@ -0,0 +1,316 @@
+#include "testmatch/chase.hpp"
+
+#include "testmatch/exact.hpp"
+#include "testmatch/models.hpp"
+#include "testmatch/pregame.hpp"
+#include "testmatch/simulation.hpp"
+#include "testmatch/team.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static const char CHASE_MAGIC[8] = "TMCHASE";
+static const unsigned int CHASE_VERSION = 2;
+
+// Longest innings followed when weighting the batters at the crease
+static const int MAX_BALLS = 6000;
+
+// Names are stored whole, so that matches() compares them exactly
+static void copy_name(char* dest, std::string name) {
+    if (name.size() >= sizeof(ChaseTableHeader::venue))
+        throw std::invalid_argument("Name too long for a chase table: " +
+                                    name);
+    strncpy(dest, name.c_str(), sizeof(ChaseTableHeader::venue));
+}
+
+// Pitch of the venue as worn by the given session
+static PitchFactors worn_pitch(Venue* venue, int session) {
+    if (venue->pitch_factors == nullptr)
+        return {0, 0};
+    return Model::MODEL_PITCH_WEAR(*venue->pitch_factors, session);
+}
+
+// Number of values in each of the win and draw grids
+static size_t grid_size(const ChaseTableHeader& header) {
+    return (size_t)10 * (header.max_overs + 1) * (header.max_runs + 1);
+}
+
+//~~~~~~~~~~~~~~ ChaseTable implementations ~~~~~~~~~~~~~~//
+ChaseTable::ChaseTable(Team* bat_team, Team* bowl_team, Venue* venue,
+                       ChaseTableOptions opts)
+    : mapping(nullptr), mapping_size(0) {
+    if (opts.session < 0 || opts.session >= SessionTables::NUM_SESSIONS)
+        throw std::invalid_argument("No such session of a match: " +
+                                    std::to_string(opts.session));
+
+    // Delivery model, with the same bowling cards as a real innings, on the
+    // pitch of the session
+    PitchFactors pitch = worn_pitch(venue, opts.session);
+    Innings inns(bat_team, bowl_team, 0, &pitch, 4);
+    std::shared_ptr<const MatchupTable> table = inns.get_table();
+    BallKernels kernels(table, opts.min_prob);
+    std::vector<int> rotation =
+        opts.rotation.empty() ? kernels.default_rotation() : opts.rotation;
+
+    const int n_states = BallKernels::NUM_STATES;
+    int width = opts.max_runs + 1;
+    int n_overs = opts.max_overs + 1;
+
+    ChaseTableHeader head;
+    memset(&head, 0, sizeof(head));
+    memcpy(head.magic, CHASE_MAGIC, sizeof(head.magic));
+    head.version = CHASE_VERSION;
+    head.max_runs = opts.max_runs;
+    head.max_overs = opts.max_overs;
+    head.session = opts.session;
+    head.fingerprint = table->fingerprint();
+    copy_name(head.bat_team, bat_team->name);
+    copy_name(head.bowl_team, bowl_team->name);
+    copy_name(head.venue, venue->name);
+
+    size_t n_values = grid_size(head);
+    buffer.assign(sizeof(head) + 2 * n_values * sizeof(float), 0);
+    memcpy(buffer.data(), &head, sizeof(head));
+    float* win_out = (float*)(buffer.data() + sizeof(head));
+    float* draw_out = win_out + n_values;
+
+    // Weight the pairs of batters at the crease after each number of wickets
+    // by the expected number of deliveries they face together
+    std::vector<double> mass(n_states, 0), next_mass(n_states), occ(n_states);
+    mass[0] = 1;
+    double open = 1;
+    for (int t = 0; t < MAX_BALLS && open > 1e-9; t++) {
+        int bowler = rotation[(t / 6) % rotation.size()];
+        std::fill(next_mass.begin(), next_mass.end(), 0);
+        for (int w = 0; w < 10; w++) {
+            for (int a = 0; a <= w; a++) {
+                for (int s = 0; s < 2; s++) {
+                    int from = BallKernels::state_index(w, a, s);
+                    if (mass[from] == 0)
+                        continue;
+                    occ[from] += mass[from];
+                    int dests[4];
+                    BallKernels::destinations(w, a, s, t % 6 == 5, dests);
+                    for (const BallTransition& tr :
+                         kernels.get(s ? w + 1 : a, s ? a : w + 1, bowler)) {
+                        if (dests[tr.type] >= 0)
+                            next_mass[dests[tr.type]] += tr.prob * mass[from];
+                    }
+                }
+            }
+        }
+        mass.swap(next_mass);
+        open = 0;
+        for (double m : mass)
+            open += m;
+    }
+    for (int w = 0; w < 10; w++) {
+        double total = 0;
+        for (int i = BallKernels::state_index(w, 0, 0);
+             i < BallKernels::state_index(w + 1, 0, 0); i++)
+            total += occ[i];
+        for (int i = BallKernels::state_index(w, 0, 0);
+             i < BallKernels::state_index(w + 1, 0, 0); i++)
+            occ[i] = total > 0 ? occ[i] / total : 0;
+    }
+
+    // Probabilities of winning and drawing from each state, by runs needed,
+    // starting with no time left
+    std::vector<double> win_prev(n_states * width, 0), win_curr(win_prev);
+    std::vector<double> draw_prev(n_states * width, 1), draw_curr(draw_prev);
+    for (int i = 0; i < n_states; i++) {
+        win_prev[i * width] = 1;
+        draw_prev[i * width] = 0;
+    }
+
+    // Average over the batters at the crease at the end of each over
+    auto store = [&](int o) {
+        for (int w = 0; w < 10; w++) {
+            size_t offset = ((size_t)(9 - w) * n_overs + o) * width;
+            for (int a = 0; a <= w; a++) {
+                for (int s = 0; s < 2; s++) {
+                    int i = BallKernels::state_index(w, a, s);
+                    for (int r = 0; r < width; r++) {
+                        win_out[offset + r] += occ[i] * win_prev[i * width + r];
+                        draw_out[offset + r] +=
+                            occ[i] * draw_prev[i * width + r];
+                    }
+                }
+            }
+        }
+    };
+    store(0);
+
+    for (int t = 1; t <= 6 * opts.max_overs; t++) {
+        // Overs are counted back from the end, and the batters change ends
+        // when the remaining balls make up whole overs
+        int bowler = rotation[((t - 1) / 6) % rotation.size()];
+        bool end_over = (t - 1) % 6 == 0;
+
+        for (int w = 0; w < 10; w++) {
+            for (int a = 0; a <= w; a++) {
+                for (int s = 0; s < 2; s++) {
+                    int from = BallKernels::state_index(w, a, s);
+                    double* win_to = &win_curr[from * width];
+                    double* draw_to = &draw_curr[from * width];
+                    std::fill(win_to, win_to + width, 0);
+                    std::fill(draw_to, draw_to + width, 0);
+                    win_to[0] = 1;
+
+                    int dests[4];
+                    BallKernels::destinations(w, a, s, end_over, dests);
+                    for (const BallTransition& tr :
+                         kernels.get(s ? w + 1 : a, s ? a : w + 1, bowler)) {
+                        // Target reached, before any wicket
+                        int r = 1;
+                        for (; r <= std::min(tr.runs, width - 1); r++)
+                            win_to[r] += tr.prob;
+
+                        if (dests[tr.type] < 0)
+                            continue;
+                        const double* win_from =
+                            &win_prev[dests[tr.type] * width] - tr.runs;
+                        const double* draw_from =
+                            &draw_prev[dests[tr.type] * width] - tr.runs;
+                        for (; r < width; r++) {
+                            win_to[r] += tr.prob * win_from[r];
+                            draw_to[r] += tr.prob * draw_from[r];
+                        }
+                    }
+                }
+            }
+        }
+
+        win_prev.swap(win_curr);
+        draw_prev.swap(draw_curr);
+        if (t % 6 == 0)
+            store(t / 6);
+    }
+
+    attach(buffer.data(), buffer.size());
+}
+
+ChaseTable::ChaseTable(std::string path) : mapping(nullptr), mapping_size(0) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Unable to open chase table: " + path);
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw std::runtime_error("Unable to read chase table: " + path);
+    }
+    mapping_size = st.st_size;
+    mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        throw std::runtime_error("Unable to map chase table: " + path);
+    }
+
+    try {
+        attach((const char*)mapping, mapping_size);
+    } catch (...) {
+        munmap(mapping, mapping_size);
+        throw;
+    }
+}
+
+void ChaseTable::attach(const char* data, size_t size) {
+    header = (const ChaseTableHeader*)data;
+    if (size < sizeof(ChaseTableHeader) ||
+        memcmp(header->magic, CHASE_MAGIC, sizeof(CHASE_MAGIC)) != 0)
+        throw std::runtime_error("Not a chase table file.");
+    if (header->version != CHASE_VERSION)
+        throw std::runtime_error("Unsupported chase table version.");
+
+    size_t n_values = grid_size(*header);
+    if (size != sizeof(ChaseTableHeader) + 2 * n_values * sizeof(float))
+        throw std::runtime_error("Chase table file is truncated.");
+
+    win = (const float*)(data + sizeof(ChaseTableHeader));
+    draw = win + n_values;
+}
+
+void ChaseTable::save(std::string path) const {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+        throw std::runtime_error("Unable to write chase table: " + path);
+
+    size_t n_values = grid_size(*header);
+    file.write((const char*)header, sizeof(ChaseTableHeader));
+    file.write((const char*)win, n_values * sizeof(float));
+    file.write((const char*)draw, n_values * sizeof(float));
+    if (!file)
+        throw std::runtime_error("Unable to write chase table: " + path);
+}
+
+bool ChaseTable::matches(Team* bat_team, Team* bowl_team,
+                         Venue* venue) const {
+    if (bat_team->name != header->bat_team ||
+        bowl_team->name != header->bowl_team || venue->name != header->venue)
+        return false;
+
+    PitchFactors pitch = worn_pitch(venue, header->session);
+    Innings inns(bat_team, bowl_team, 0, &pitch, 4);
+    return inns.get_table()->fingerprint() == header->fingerprint;
+}
+
+double ChaseTable::lookup(const float* values, int runs_needed,
+                          int wkts_in_hand, double balls_left) const {
+    int n_overs = header->max_overs + 1;
+    int width = header->max_runs + 1;
+    runs_needed = std::min(runs_needed, (int)header->max_runs);
+    wkts_in_hand = std::min(wkts_in_hand, 10);
+
+    double overs = std::min(balls_left / 6, (double)header->max_overs);
+    int o = std::min((int)overs, (int)header->max_overs - 1);
+    double frac = overs - o;
+    if (header->max_overs == 0) {
+        o = 0;
+        frac = 0;
+    }
+
+    const float* grid = values + (size_t)(wkts_in_hand - 1) * n_overs * width;
+    double lower = grid[(size_t)o * width + runs_needed];
+    if (frac == 0)
+        return lower;
+    double upper = grid[(size_t)(o + 1) * width + runs_needed];
+    return (1 - frac) * lower + frac * upper;
+}
+
+double ChaseTable::win_prob(int runs_needed, int wkts_in_hand,
+                            double balls_left) const {
+    if (runs_needed <= 0)
+        return 1;
+    if (wkts_in_hand <= 0 || balls_left <= 0)
+        return 0;
+    return lookup(win, runs_needed, wkts_in_hand, balls_left);
+}
+
+double ChaseTable::draw_prob(int runs_needed, int wkts_in_hand,
+                             double balls_left) const {
+    if (runs_needed <= 0 || wkts_in_hand <= 0)
+        return 0;
+    if (balls_left <= 0)
+        return 1;
+    return lookup(draw, runs_needed, wkts_in_hand, balls_left);
+}
+
+const ChaseTableHeader& ChaseTable::get_header() const { return *header; }
+
+ChaseTable::~ChaseTable() {
+    if (mapping != nullptr)
+        munmap(mapping, mapping_size);
+}
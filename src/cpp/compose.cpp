@@ -0,0 +1,369 @@
+#include "testmatch/compose.hpp"
+
+#include "testmatch/enums.hpp"
+#include "testmatch/helpers.hpp"
+#include "testmatch/matchtime.hpp"
+#include "testmatch/simulation.hpp"
+#include "testmatch/workers.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+// Lead given to a fourth innings so that it is never chased down
+static const int NO_TARGET = -1000000;
+
+// Width of the buckets that the playing time used so far is rounded to, in
+// seconds
+static const int PLAY_BUCKET = 1800;
+
+//~~~~~~~~~~~~~~ InningsKey implementations ~~~~~~~~~~~~~~//
+bool InningsKey::operator<(const InningsKey& rhs) const {
+    return std::tie(fingerprint, seam_bucket, spin_bucket, inns_no) <
+           std::tie(rhs.fingerprint, rhs.seam_bucket, rhs.spin_bucket,
+                    rhs.inns_no);
+}
+
+//~~~~~~~~~~~~~~ InningsTotals implementations ~~~~~~~~~~~~~~//
+double InningsTotals::mean_runs() const {
+    double total = 0;
+    for (unsigned int r = 0; r < runs.size(); r++)
+        total += r * runs[r];
+    return total;
+}
+
+double InningsTotals::mean_play() const {
+    double total = 0;
+    for (unsigned int r = 0; r < runs.size(); r++)
+        total += runs[r] * play[r];
+    return total;
+}
+
+double InningsTotals::play_per_run() const {
+    double mean = mean_runs();
+    return mean > 0 ? mean_play() / mean : 0;
+}
+
+double InningsTotals::prob_runs_above(int n_runs) const {
+    double total = 0;
+    for (int r = std::max(n_runs + 1, 0); r < (int)runs.size(); r++)
+        total += runs[r];
+    return total;
+}
+
+//~~~~~~~~~~~~~~ InningsCache implementations ~~~~~~~~~~~~~~//
+InningsCache::InningsCache(InningsCacheOptions c_opts)
+    : opts(c_opts), hits(0), misses(0) {}
+
+InningsKey InningsCache::make_key(const MatchupTable& table,
+                                  PitchFactors* pitch, int inns_no) const {
+    InningsKey key;
+    key.fingerprint = table.fingerprint();
+    key.seam_bucket = (int)round(pitch->seam / opts.bucket_width);
+    key.spin_bucket = (int)round(pitch->spin / opts.bucket_width);
+    key.inns_no = inns_no;
+    return key;
+}
+
+InningsTotals InningsCache::simulate(Team* bat_team, Team* bowl_team,
+                                     PitchFactors* pitch, int inns_no,
+                                     std::shared_ptr<const MatchupTable> table,
+                                     const InningsKey& key) {
+    unsigned long long stream =
+        mix_seed(mix_seed(mix_seed(key.fingerprint, key.seam_bucket),
+                          key.spin_bucket),
+                 key.inns_no);
+    unsigned long long seed = mix_seed(opts.seed, stream);
+
+    // Histograms of runs and wickets, and total playing time by runs, kept
+    // by each worker
+    RngState saved = rng_state();
+    WorkerPool pool(opts.n_threads);
+    std::vector<std::vector<unsigned int>> run_counts(pool.size());
+    std::vector<std::vector<double>> play_sums(pool.size());
+    std::vector<std::vector<unsigned int>> wkt_counts(
+        pool.size(), std::vector<unsigned int>(11, 0));
+
+    pool.parallel_for(0, opts.n_sims, [&](unsigned int i, unsigned int worker) {
+        seed_rng(mix_seed(seed, i));
+        Innings inns(bat_team, bowl_team, inns_no == 4 ? NO_TARGET : 0, pitch,
+                     inns_no, table);
+
+        // A clock of its own times the innings
+        MatchTime clock;
+        inns.time = &clock;
+        inns.simulate_with<SummaryCommentary>();
+
+        std::vector<unsigned int>& counts = run_counts[worker];
+        std::vector<double>& play = play_sums[worker];
+        unsigned int score = inns.get_team_score();
+        if (counts.size() <= score) {
+            counts.resize(score + 1, 0);
+            play.resize(score + 1, 0);
+        }
+        counts[score]++;
+        play[score] += MatchTime().play_left() - clock.play_left();
+        wkt_counts[worker][inns.get_wkts()]++;
+    });
+    rng_state() = saved;
+
+    // Merge
+    InningsTotals output;
+    output.n_sims = opts.n_sims;
+    output.wkts.assign(11, 0);
+    for (unsigned int w = 0; w < pool.size(); w++) {
+        if (output.runs.size() < run_counts[w].size()) {
+            output.runs.resize(run_counts[w].size(), 0);
+            output.play.resize(run_counts[w].size(), 0);
+        }
+        for (unsigned int r = 0; r < run_counts[w].size(); r++) {
+            output.runs[r] += (double)run_counts[w][r] / opts.n_sims;
+            output.play[r] += play_sums[w][r];
+        }
+        for (int k = 0; k < 11; k++)
+            output.wkts[k] += (double)wkt_counts[w][k] / opts.n_sims;
+    }
+    for (unsigned int r = 0; r < output.runs.size(); r++) {
+        if (output.runs[r] > 0)
+            output.play[r] /= output.runs[r] * opts.n_sims;
+    }
+    return output;
+}
+
+const InningsTotals& InningsCache::get(Team* bat_team, Team* bowl_team,
+                                       Venue* venue, int inns_no,
+                                       int session) {
+    // Delivery model, with the same bowling cards as a real innings, on the
+    // worn pitch at the centre of its bucket, so that every pitch in the
+    // bucket has the same distributions
+    PitchFactors pitch =
+        Model::MODEL_PITCH_WEAR(*venue->pitch_factors, session);
+    double width = opts.bucket_width;
+    PitchFactors centre = {round(pitch.seam / width) * width,
+                           round(pitch.spin / width) * width};
+    Innings inns(bat_team, bowl_team, 0, &centre, inns_no);
+    std::shared_ptr<const MatchupTable> table = inns.get_table();
+    InningsKey key = make_key(*table, &centre, inns_no);
+
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+        hits++;
+        return it->second;
+    }
+
+    misses++;
+    InningsTotals totals =
+        simulate(bat_team, bowl_team, &centre, inns_no, table, key);
+    return entries.emplace(key, totals).first->second;
+}
+
+unsigned int InningsCache::size() const { return entries.size(); }
+
+unsigned int InningsCache::get_hits() const { return hits; }
+
+unsigned int InningsCache::get_misses() const { return misses; }
+
+void InningsCache::clear() {
+    entries.clear();
+    hits = 0;
+    misses = 0;
+}
+
+//~~~~~~~~~~~~~~ MatchEvaluator implementations ~~~~~~~~~~~~~~//
+MatchEvaluator::MatchEvaluator(InningsCache* c_cache) : cache(c_cache) {}
+
+void MatchEvaluator::evaluate_order(Team* first, Team* second, Venue* venue,
+                                    double* probs) {
+    // Scheduled play of the match, in buckets, from which each innings break
+    // also takes time
+    int budget = MatchTime().play_left();
+    int n_buckets = budget / PLAY_BUCKET + 1;
+
+    // Session in which an innings starts after the given play
+    double session_play =
+        (double)budget / (MatchTime::NUM_DAYS * MatchTime::SESSIONS_PER_DAY);
+    auto session_after = [session_play](double play) {
+        return std::min((int)(play / session_play),
+                        SessionTables::NUM_SESSIONS - 1);
+    };
+
+    const InningsTotals& t1 = cache->get(first, second, venue, 1);
+    double play2 = t1.mean_play() + MatchTime::INNBRE_DUR;
+    const InningsTotals& t2 =
+        cache->get(second, first, venue, 2, session_after(play2));
+    double play3 = play2 + t2.mean_play() + MatchTime::INNBRE_DUR;
+    int n1 = t1.runs.size(), n2 = t2.runs.size();
+
+    // Lead of the first team after two innings, offset by n2 - 1, split by
+    // whether the follow-on is enforced, and the buckets of play used by the
+    // two innings if there is time left
+    std::vector<double> no_follow(n1 + n2 - 1, 0), follow(n1 + n2 - 1, 0);
+    std::vector<double> used(n_buckets, 0);
+    bool any_follow = false;
+    for (int a = 0; a < n1; a++) {
+        for (int b = 0; b < n2; b++) {
+            double p = t1.runs[a] * t2.runs[b];
+            if (p == 0)
+                continue;
+            double p_follow = Match::PROB_FOLLOW_ON(a - b);
+            no_follow[a - b + n2 - 1] += p * (1 - p_follow);
+            follow[a - b + n2 - 1] += p * p_follow;
+            any_follow = any_follow || p_follow > 0;
+
+            double play = t1.play[a] + t2.play[b] + 2 * MatchTime::INNBRE_DUR;
+            if (play < budget)
+                used[(int)(play / PLAY_BUCKET)] += p;
+        }
+    }
+
+    // Third and fourth innings, given the lead of the team batting third
+    // before its innings. Indices of probs for the team batting third and
+    // fourth are given by bat3 and bat4. The play used so far is taken to be
+    // independent of the lead
+    auto finish = [&](const std::vector<double>& lead, int sign, Team* bat,
+                      Team* bowl, int bat3, int bat4) {
+        const InningsTotals& t3 =
+            cache->get(bat, bowl, venue, 3, session_after(play3));
+        double play4 = play3 + t3.mean_play() + MatchTime::INNBRE_DUR;
+        const InningsTotals& t4 =
+            cache->get(bowl, bat, venue, 4, session_after(play4));
+        int n4 = t4.runs.size();
+
+        // Probability of the fourth innings total being below each score,
+        // and of it also being bowled out with each number of buckets of
+        // play left
+        std::vector<double> cumul(n4 + 1, 0);
+        std::vector<double> below(n_buckets * (n4 + 1), 0);
+        for (int r = 0; r < n4; r++)
+            cumul[r + 1] = cumul[r] + t4.runs[r];
+        for (int h = 0; h < n_buckets; h++) {
+            double* row = &below[h * (n4 + 1)];
+            for (int r = 0; r < n4; r++) {
+                bool in_time = t4.play[r] <= h * PLAY_BUCKET;
+                row[r + 1] = row[r] + (in_time ? t4.runs[r] : 0);
+            }
+        }
+        double per_run = t4.play_per_run();
+
+        // Buckets of play left for the fourth innings when the third takes
+        // each number of buckets, with any break
+        std::vector<double> left(n_buckets * n_buckets, 0);
+        std::vector<double> in_time(n_buckets, 0);
+        for (int x = 0; x < n_buckets; x++) {
+            for (int h = 0; h < n_buckets; h++) {
+                double rest = budget - (h + x + 1) * PLAY_BUCKET -
+                              MatchTime::INNBRE_DUR;
+                if (rest >= 0) {
+                    left[x * n_buckets + (int)(rest / PLAY_BUCKET)] += used[h];
+                    in_time[x] += used[h];
+                }
+            }
+        }
+
+        // Probabilities of the team batting third winning, a tie and the
+        // team batting fourth winning, for each play used by the third
+        // innings and each target from 0 to n4 (out of reach). The match is
+        // drawn otherwise
+        int n3 = t3.runs.size();
+        std::vector<int> play3(n3);
+        std::vector<bool> needed(n_buckets, false);
+        for (int r = 0; r < n3; r++) {
+            play3[r] = (int)(t3.play[r] / PLAY_BUCKET);
+            if (t3.runs[r] > 0 && play3[r] < n_buckets)
+                needed[play3[r]] = true;
+        }
+        std::vector<double> results(n_buckets * (n4 + 1) * 3, 0);
+        for (int x = 0; x < n_buckets; x++) {
+            if (!needed[x])
+                continue;
+            for (int h = 0; h < n_buckets; h++) {
+                double p = left[x * n_buckets + h];
+                if (p == 0)
+                    continue;
+
+                // Bowled out in time, or the target reached in time at the
+                // mean rate
+                double play_left = h * PLAY_BUCKET;
+                double* res = &results[x * (n4 + 1) * 3];
+                const double* row = &below[h * (n4 + 1)];
+                for (int t = 0; t < n4; t++) {
+                    res[3 * t] += p * row[t];
+                    if (t4.play[t] <= play_left)
+                        res[3 * t + 1] += p * t4.runs[t];
+                    if ((t + 1) * per_run <= play_left)
+                        res[3 * t + 2] += p * (1 - cumul[t + 1]);
+                }
+                res[3 * n4] += p * row[n4];
+            }
+        }
+
+        for (int l = 0; l < (int)lead.size(); l++) {
+            if (lead[l] == 0)
+                continue;
+            int start = sign * (l - n2 + 1);
+            for (int r = 0; r < n3; r++) {
+                double p = lead[l] * t3.runs[r];
+                int x = play3[r];
+                int target = start + r;
+                if (p == 0 || x >= n_buckets) {
+                    continue;
+                } else if (target < 0) {
+                    // Win by an innings
+                    probs[bat4] += p * in_time[x];
+                } else {
+                    double* res =
+                        &results[(x * (n4 + 1) + std::min(target, n4)) * 3];
+                    probs[bat3] += p * res[0];
+                    probs[2] += p * res[1];
+                    probs[bat4] += p * res[2];
+                }
+            }
+        }
+    };
+
+    probs[0] = probs[1] = probs[2] = 0;
+    finish(no_follow, 1, first, second, 0, 1);
+    if (any_follow)
+        finish(follow, -1, second, first, 1, 0);
+    probs[3] = std::max(1 - probs[0] - probs[1] - probs[2], 0.0);
+}
+
+MatchEstimate MatchEvaluator::evaluate(Pregame detail, TossResult toss) {
+    Team* first = toss.get_bat_team();
+    Team* second = first == detail.home_team ? detail.away_team
+                                             : detail.home_team;
+    double probs[4];
+    evaluate_order(first, second, detail.venue, probs);
+
+    MatchEstimate output;
+    bool home_first = first == detail.home_team;
+    output.home_win = home_first ? probs[0] : probs[1];
+    output.away_win = home_first ? probs[1] : probs[0];
+    output.draw = probs[3];
+    output.tie = probs[2];
+    return output;
+}
+
+MatchEstimate MatchEvaluator::evaluate(Pregame detail) {
+    // Probability of the home team batting first, by winning the toss and
+    // batting or by the away team winning it and fielding
+    Venue* venue = detail.venue;
+    double p_home_first =
+        Match::PROB_TOSS(venue, bat) + Match::PROB_TOSS(venue, field);
+
+    TossResult home_first = {detail.home_team, detail.away_team, bat};
+    TossResult away_first = {detail.away_team, detail.home_team, bat};
+    MatchEstimate a = evaluate(detail, home_first);
+    MatchEstimate b = evaluate(detail, away_first);
+
+    MatchEstimate output;
+    output.home_win =
+        p_home_first * a.home_win + (1 - p_home_first) * b.home_win;
+    output.away_win =
+        p_home_first * a.away_win + (1 - p_home_first) * b.away_win;
+    output.draw = p_home_first * a.draw + (1 - p_home_first) * b.draw;
+    output.tie = p_home_first * a.tie + (1 - p_home_first) * b.tie;
+    return output;
+}
@@ -0,0 +1,113 @@
+#include "testmatch/curve.hpp"
+
+#include "testmatch/enums.hpp"
+#include "testmatch/helpers.hpp"
+#include "testmatch/live.hpp"
+#include "testmatch/simulation.hpp"
+#include "testmatch/snapshot.hpp"
+#include "testmatch/workers.hpp"
+
+#include <iomanip>
+#include <istream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//~~~~~~~~~~~~~~ WinCurve implementations ~~~~~~~~~~~~~~//
+unsigned int WinCurve::size() const { return ball.size(); }
+
+std::string WinCurve::to_csv() const {
+    std::stringstream output;
+    output << "ball,innings,score,wkts,home_win,away_win,draw,tie\n"
+           << std::fixed << std::setprecision(4);
+    for (unsigned int k = 0; k < size(); k++) {
+        output << ball[k] << "," << innings[k] << "," << score[k] << ","
+               << wkts[k] << "," << home_win[k] << "," << away_win[k] << ","
+               << draw[k] << "," << tie[k] << "\n";
+    }
+    return output.str();
+}
+
+//~~~~~~~~~~~~~~ WinCurveRunner implementations ~~~~~~~~~~~~~~//
+WinCurveRunner::WinCurveRunner(Pregame c_detail, TossResult c_toss,
+                               WinCurveOptions c_opts)
+    : detail(c_detail), toss(c_toss), opts(c_opts) {}
+
+WinCurve WinCurveRunner::run(std::istream& feed) {
+    // Replay the feed, capturing every state. Deliveries from the feed still
+    // sample some details (e.g. the fielder for a catch), so use a
+    // reproducible stream for them and restore the caller's afterwards
+    RngState saved = rng_state();
+    seed_rng(mix_seed(opts.seed, -1));
+
+    WinCurve output;
+    std::vector<MatchSnapshot> states;
+    Match match(detail);
+    match.pregame(toss);
+
+    auto capture = [&]() {
+        Innings* inns = match.get_current_innings();
+        output.ball.push_back(states.size());
+        output.innings.push_back(match.get_num_innings());
+        output.score.push_back(inns->get_team_score());
+        output.wkts.push_back(inns->get_wkts());
+        states.push_back(MatchSnapshot(match));
+    };
+
+    capture();
+    std::string line;
+    FeedBall ball;
+    while (match.get_result() == nullptr && std::getline(feed, line)) {
+        if (!parse_feed_line(line, ball))
+            continue;
+        apply_feed_ball(match, ball);
+        capture();
+    }
+    rng_state() = saved;
+
+    // Continuations from every state are scheduled as a single loop, with
+    // counts of home wins, away wins, draws and ties for each state kept by
+    // each worker
+    unsigned int n_states = states.size();
+    unsigned int n_sims = opts.n_sims;
+    WorkerPool pool(opts.n_threads);
+    std::vector<std::vector<unsigned int>> counts(
+        pool.size(), std::vector<unsigned int>(4 * n_states, 0));
+
+    Team* home_team = detail.home_team;
+    pool.parallel_for(
+        0, n_states * n_sims,
+        [&states, &counts, n_sims, home_team, this](unsigned int i,
+                                                     unsigned int worker) {
+            unsigned int s = i / n_sims, j = i % n_sims;
+
+            // Common random numbers across states
+            seed_rng(mix_seed(opts.seed, j));
+            Match cont = states[s].clone();
+            cont.advance();
+
+            MatchResult* result = cont.get_result();
+            int k;
+            if (result->get_type() == draw)
+                k = 2;
+            else if (result->get_type() == tie)
+                k = 3;
+            else
+                k = result->get_winner() == home_team ? 0 : 1;
+            counts[worker][4 * s + k]++;
+        });
+
+    // Merge
+    std::vector<double>* columns[4] = {&output.home_win, &output.away_win,
+                                       &output.draw, &output.tie};
+    for (unsigned int s = 0; s < n_states; s++) {
+        for (int k = 0; k < 4; k++) {
+            unsigned int total = 0;
+            for (std::vector<unsigned int>& shard : counts)
+                total += shard[4 * s + k];
+            columns[k]->push_back(n_sims > 0 ? (double)total / n_sims : 0);
+        }
+    }
+
+    return output;
+}
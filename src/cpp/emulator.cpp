@@ -0,0 +1,407 @@
+#include "testmatch/emulator.hpp"
+
+#include "testmatch/cards.hpp"
+#include "testmatch/enums.hpp"
+#include "testmatch/helpers.hpp"
+#include "testmatch/simulation.hpp"
+#include "testmatch/snapshot.hpp"
+#include "testmatch/workers.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Probability of capturing the state after each delivery of a sampled match
+static const double CAPTURE_PROB = 0.02;
+
+static const int MAX_NEWTON_ITER = 50;
+
+static double sigmoid(double z) { return 1 / (1 + exp(-z)); }
+
+static double dot(const std::vector<double>& coefs, const double* x) {
+    double z = 0;
+    for (int i = 0; i < (int)coefs.size(); i++)
+        z += coefs[i] * x[i];
+    return z;
+}
+
+// Solve the n x n system A x = b in place by Gaussian elimination with
+// partial pivoting, leaving the solution in b
+static void solve(std::vector<double>& A, std::vector<double>& b) {
+    int n = b.size();
+    for (int c = 0; c < n; c++) {
+        int pivot = c;
+        for (int r = c + 1; r < n; r++) {
+            if (std::abs(A[r * n + c]) > std::abs(A[pivot * n + c]))
+                pivot = r;
+        }
+        for (int k = 0; k < n; k++)
+            std::swap(A[c * n + k], A[pivot * n + k]);
+        std::swap(b[c], b[pivot]);
+
+        for (int r = c + 1; r < n; r++) {
+            double f = A[r * n + c] / A[c * n + c];
+            for (int k = c; k < n; k++)
+                A[r * n + k] -= f * A[c * n + k];
+            b[r] -= f * b[c];
+        }
+    }
+    for (int c = n - 1; c >= 0; c--) {
+        for (int k = c + 1; k < n; k++)
+            b[c] -= A[c * n + k] * b[k];
+        b[c] /= A[c * n + c];
+    }
+}
+
+// Proportion of continuations won by the batting team, with ties halved
+static double win_share(const EmulatorSample& sample) {
+    return (sample.wins + 0.5 * sample.ties) / sample.n_sims;
+}
+
+//~~~~~~~~~~~~~~ EmulatorState implementations ~~~~~~~~~~~~~~//
+EmulatorState EmulatorState::from_match(Match& match) {
+    Innings* inns = match.get_current_innings();
+    EmulatorState state;
+    state.inns_no = inns->get_inns_no();
+    state.score = inns->get_team_score();
+    state.lead = inns->get_lead();
+    state.wkts = inns->get_wkts();
+    state.balls = inns->get_balls();
+    state.home_batting = inns->get_bat_team() == match.get_home_team();
+    state.overs_left = match.get_time().overs_left();
+    return state;
+}
+
+//~~~~~~~~~~~~~~ EmulatorValidation implementations ~~~~~~~~~~~~~~//
+std::string EmulatorValidation::print() const {
+    std::stringstream output;
+    output << std::fixed << std::setprecision(4) << "Validation on "
+           << n_states << " states: win Brier score " << win_brier
+           << " (baseline " << baseline_win_brier << "), total RMSE "
+           << std::setprecision(1) << total_rmse << " (baseline "
+           << baseline_total_rmse << ")";
+    return output.str();
+}
+
+//~~~~~~~~~~~~~~ Emulator implementations ~~~~~~~~~~~~~~//
+Emulator::Emulator() : validation({0, 0, 0, 0, 0}) {
+    for (int i = 0; i < 4; i++) {
+        for (int k = 0; k < 3; k++)
+            coefs[i][k].assign(NUM_FEATURES, 0);
+    }
+}
+
+Emulator::Emulator(std::string path) : Emulator() {
+    std::ifstream file(path);
+    std::string magic;
+    int version;
+    if (!(file >> magic >> version) || magic != "TMEMULATOR" || version != 2)
+        throw std::runtime_error("Not an emulator file: " + path);
+
+    file >> validation.n_states >> validation.win_brier >>
+        validation.baseline_win_brier >> validation.total_rmse >>
+        validation.baseline_total_rmse;
+    for (int i = 0; i < 4; i++) {
+        for (int k = 0; k < 3; k++) {
+            for (int j = 0; j < NUM_FEATURES; j++)
+                file >> coefs[i][k][j];
+        }
+    }
+    if (!file)
+        throw std::runtime_error("Emulator file is truncated: " + path);
+}
+
+void Emulator::features(const EmulatorState& state, double* x) {
+    double l = state.lead / 100.0;
+    double w = state.wkts / 10.0;
+    double b = state.balls / 600.0;
+    double t = state.overs_left / 450.0;
+    x[0] = 1;
+    x[1] = l;
+    x[2] = l * l;
+    x[3] = l * l * l;
+    x[4] = w;
+    x[5] = w * w;
+    x[6] = l * w;
+    x[7] = b;
+    x[8] = l * b;
+    x[9] = state.home_batting;
+    x[10] = t;
+    x[11] = l * t;
+}
+
+Emulator Emulator::fit(const std::vector<EmulatorSample>& samples,
+                       double ridge) {
+    const int n = NUM_FEATURES;
+    Emulator output;
+
+    for (int i = 0; i < 4; i++) {
+        // Features and targets of the states in this innings
+        std::vector<double> X;
+        std::vector<double> y[3];
+        for (const EmulatorSample& sample : samples) {
+            if (sample.state.inns_no != i + 1 || sample.n_sims == 0)
+                continue;
+            double x[NUM_FEATURES];
+            features(sample.state, x);
+            X.insert(X.end(), x, x + n);
+
+            // Proportions are shrunk slightly towards one half, so that a
+            // state won (or drawn) by every continuation has a finite logit
+            double m = sample.n_sims;
+            y[0].push_back((m * win_share(sample) + 0.5) / (m + 1));
+            y[1].push_back((sample.draws + 0.5) / (m + 1));
+            y[2].push_back(sample.mean_total - sample.state.score);
+        }
+        int n_obs = y[0].size();
+        if (n_obs == 0)
+            continue;
+
+        // Logistic regressions for the win and draw probabilities, by
+        // Newton's method
+        for (int k = 0; k < 2; k++) {
+            std::vector<double>& beta = output.coefs[i][k];
+            for (int iter = 0; iter < MAX_NEWTON_ITER; iter++) {
+                std::vector<double> H(n * n, 0), g(n, 0);
+                for (int r = 0; r < n_obs; r++) {
+                    const double* x = &X[r * n];
+                    double p = sigmoid(dot(beta, x));
+                    double v = p * (1 - p);
+                    for (int a = 0; a < n; a++) {
+                        g[a] += (p - y[k][r]) * x[a] / n_obs;
+                        for (int c = 0; c < n; c++)
+                            H[a * n + c] += v * x[a] * x[c] / n_obs;
+                    }
+                }
+                for (int a = 1; a < n; a++) {
+                    g[a] += ridge * beta[a];
+                    H[a * n + a] += ridge;
+                }
+
+                solve(H, g);
+                double step = 0;
+                for (int a = 0; a < n; a++) {
+                    beta[a] -= g[a];
+                    step = std::max(step, std::abs(g[a]));
+                }
+                if (step < 1e-10)
+                    break;
+            }
+        }
+
+        // Least squares for the runs still to come in the innings
+        std::vector<double> A(n * n, 0), c(n, 0);
+        for (int r = 0; r < n_obs; r++) {
+            const double* x = &X[r * n];
+            for (int a = 0; a < n; a++) {
+                c[a] += y[2][r] * x[a] / n_obs;
+                for (int b = 0; b < n; b++)
+                    A[a * n + b] += x[a] * x[b] / n_obs;
+            }
+        }
+        for (int a = 1; a < n; a++)
+            A[a * n + a] += ridge;
+        solve(A, c);
+        output.coefs[i][2] = c;
+    }
+
+    return output;
+}
+
+EmulatorValidation
+Emulator::validate(const std::vector<EmulatorSample>& samples) {
+    // Baselines predict the average of the samples in the same innings
+    double n_inns[4] = {0}, win_mean[4] = {0}, total_mean[4] = {0};
+    for (const EmulatorSample& sample : samples) {
+        int i = sample.state.inns_no - 1;
+        n_inns[i]++;
+        win_mean[i] += win_share(sample);
+        total_mean[i] += sample.mean_total;
+    }
+    for (int i = 0; i < 4; i++) {
+        if (n_inns[i] > 0) {
+            win_mean[i] /= n_inns[i];
+            total_mean[i] /= n_inns[i];
+        }
+    }
+
+    EmulatorValidation output = {0, 0, 0, 0, 0};
+    for (const EmulatorSample& sample : samples) {
+        int i = sample.state.inns_no - 1;
+        EmulatorPrediction pred = predict(sample.state);
+        double win = sample.state.home_batting ? pred.home_win : pred.away_win;
+        double share = win_share(sample);
+
+        output.n_states++;
+        output.win_brier += (win - share) * (win - share);
+        output.baseline_win_brier +=
+            (win_mean[i] - share) * (win_mean[i] - share);
+        output.total_rmse += (pred.exp_total - sample.mean_total) *
+                             (pred.exp_total - sample.mean_total);
+        output.baseline_total_rmse += (total_mean[i] - sample.mean_total) *
+                                      (total_mean[i] - sample.mean_total);
+    }
+    if (output.n_states > 0) {
+        output.win_brier /= output.n_states;
+        output.baseline_win_brier /= output.n_states;
+        output.total_rmse = sqrt(output.total_rmse / output.n_states);
+        output.baseline_total_rmse =
+            sqrt(output.baseline_total_rmse / output.n_states);
+    }
+
+    validation = output;
+    return output;
+}
+
+const EmulatorValidation& Emulator::get_validation() const {
+    return validation;
+}
+
+EmulatorPrediction Emulator::predict(const EmulatorState& state) const {
+    int i = std::min(std::max(state.inns_no, 1), 4) - 1;
+    double x[NUM_FEATURES];
+    features(state, x);
+
+    double win = sigmoid(dot(coefs[i][0], x));
+    double draw = sigmoid(dot(coefs[i][1], x));
+    if (win + draw > 1) {
+        win /= win + draw;
+        draw = 1 - win;
+    }
+    double loss = 1 - win - draw;
+
+    EmulatorPrediction output;
+    output.home_win = state.home_batting ? win : loss;
+    output.away_win = state.home_batting ? loss : win;
+    output.draw = draw;
+    output.exp_total = state.score + std::max(0.0, dot(coefs[i][2], x));
+    return output;
+}
+
+EmulatorPrediction Emulator::predict(Match& match) const {
+    MatchResult* result = match.get_result();
+    if (result == nullptr)
+        return predict(EmulatorState::from_match(match));
+
+    EmulatorPrediction output = {0, 0, 0, 0};
+    output.exp_total = match.get_current_innings()->get_team_score();
+    if (result->get_type() == draw)
+        output.draw = 1;
+    else if (result->get_type() == tie)
+        output.home_win = output.away_win = 0.5;
+    else if (result->get_winner() == match.get_home_team())
+        output.home_win = 1;
+    else
+        output.away_win = 1;
+    return output;
+}
+
+void Emulator::save(std::string path) const {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file)
+        throw std::runtime_error("Unable to write emulator: " + path);
+
+    file << "TMEMULATOR 2\n"
+         << std::setprecision(17) << validation.n_states << " "
+         << validation.win_brier << " " << validation.baseline_win_brier
+         << " " << validation.total_rmse << " "
+         << validation.baseline_total_rmse << "\n";
+    for (int i = 0; i < 4; i++) {
+        for (int k = 0; k < 3; k++) {
+            for (int j = 0; j < NUM_FEATURES; j++)
+                file << (j > 0 ? " " : "") << coefs[i][k][j];
+            file << "\n";
+        }
+    }
+    if (!file)
+        throw std::runtime_error("Unable to write emulator: " + path);
+}
+
+//~~~~~~~~~~~~~~ EmulatorTrainer implementations ~~~~~~~~~~~~~~//
+EmulatorTrainer::EmulatorTrainer(std::vector<Pregame> c_fixtures,
+                                 EmulatorTrainerOptions c_opts)
+    : fixtures(c_fixtures), opts(c_opts) {}
+
+std::vector<EmulatorSample> EmulatorTrainer::sample(unsigned int n_states,
+                                                    unsigned long long seed) {
+    // Simulate matches from the start, capturing states at random deliveries,
+    // on a separate stream from the continuations
+    RngState saved = rng_state();
+    std::vector<MatchSnapshot> states;
+    std::vector<EmulatorSample> output;
+
+    for (unsigned int m = 0; states.size() < n_states; m++) {
+        seed_rng(mix_seed(mix_seed(seed, 0), m));
+        Match match(fixtures[m % fixtures.size()]);
+        match.pregame();
+        match.advance([&](Match& curr) {
+            if (curr.get_result() != nullptr || runif() >= CAPTURE_PROB)
+                return false;
+            EmulatorSample sample = {EmulatorState::from_match(curr), 0, 0,
+                                     0, 0, 0};
+            output.push_back(sample);
+            states.push_back(MatchSnapshot(curr));
+            return states.size() == n_states;
+        });
+    }
+    rng_state() = saved;
+
+    // Continuations of every state are scheduled as a single loop, with
+    // totals kept by each worker
+    unsigned int n_sims = opts.n_sims;
+    WorkerPool pool(opts.n_threads);
+    std::vector<std::vector<double>> totals(
+        pool.size(), std::vector<double>(4 * n_states, 0));
+
+    pool.parallel_for(
+        0, n_states * n_sims,
+        [&states, &output, &totals, n_sims, seed](unsigned int i,
+                                                  unsigned int worker) {
+            unsigned int s = i / n_sims;
+            seed_rng(mix_seed(mix_seed(seed, 1), i));
+            Match cont = states[s].clone();
+            cont.advance();
+
+            // Innings in progress at the time of the snapshot
+            const EmulatorState& state = output[s].state;
+            double* shard = &totals[worker][4 * s];
+            shard[3] += cont.get_innings(state.inns_no - 1)->get_team_score();
+
+            MatchResult* result = cont.get_result();
+            if (result->get_type() == draw)
+                shard[1]++;
+            else if (result->get_type() == tie)
+                shard[2]++;
+            else if ((result->get_winner() == cont.get_home_team()) ==
+                     state.home_batting)
+                shard[0]++;
+        });
+
+    // Merge
+    for (unsigned int s = 0; s < n_states; s++) {
+        double merged[4] = {0};
+        for (std::vector<double>& shard : totals) {
+            for (int k = 0; k < 4; k++)
+                merged[k] += shard[4 * s + k];
+        }
+        output[s].n_sims = n_sims;
+        output[s].wins = merged[0];
+        output[s].draws = merged[1];
+        output[s].ties = merged[2];
+        output[s].mean_total = n_sims > 0 ? merged[3] / n_sims : 0;
+    }
+
+    return output;
+}
+
+Emulator EmulatorTrainer::train() {
+    Emulator output =
+        Emulator::fit(sample(opts.n_states, opts.seed), opts.ridge);
+    output.validate(sample(opts.n_states, mix_seed(opts.seed, 2)));
+    return output;
+}
@@ -84,6 +84,24 @@ std::string long_str(Arm arm, BowlType bowltype) {
     return str_arm + " " + str_bt;
 }
 
+BowlType str_to_bowltype(std::string str) {
+    // Accept the enum names as well as the short forms
+    if (str == "m" || str == "med")
+        return med;
+    else if (str == "mf" || str == "med_fast")
+        return med_fast;
+    else if (str == "fm" || str == "fast_med")
+        return fast_med;
+    else if (str == "f" || str == "fast")
+        return fast;
+    else if (str == "ob" || str == "offbreak")
+        return offbreak;
+    else if (str == "lb" || str == "legbreak")
+        return legbreak;
+    else
+        throw(std::invalid_argument("Undefined BowlType string: " + str));
+}
+
 std::string str(DismType dismtype) {
     switch (dismtype) {
         case bowled:
@@ -104,6 +122,23 @@ std::string str(DismType dismtype) {
     }
 }
 
+DismType str_to_dism(std::string str) {
+    if (str == "b")
+        return bowled;
+    else if (str == "lbw")
+        return lbw;
+    else if (str == "c")
+        return caught;
+    else if (str == "c&b")
+        return c_and_b;
+    else if (str == "ro")
+        return run_out;
+    else if (str == "st")
+        return stumped;
+    else
+        throw(std::invalid_argument("Undefined DismType string: " + str));
+}
+
 std::string str(TossChoice tosschoice) {
     switch (tosschoice) {
         case bat:
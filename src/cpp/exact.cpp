@@ -0,0 +1,449 @@
+#include "testmatch/exact.hpp"
+
+#include "testmatch/helpers.hpp"
+#include "testmatch/models.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// As for the logit kernel, the shift of each score vector is vectorised for
+// AVX2 where the processor supports it
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define EXACT_AVX2
+#include <immintrin.h>
+#endif
+
+// Largest number of runs from extras before a legal delivery which is tracked
+static const int MAX_EXTRAS = 60;
+
+// Longest innings calculated without an over limit, in legal deliveries
+static const unsigned int MAX_BALLS = 6000;
+
+// Transitions are grouped by their order of magnitude, and a transition of
+// level k (with probability at most 10^-k) is only applied to scores with
+// probability at least ExactOptions::min_prob * 10^k
+static const int NUM_LEVELS = 17;
+
+static const int NUM_STATES = BallKernels::NUM_STATES;
+
+static int state_index(int w, int a, int s) {
+    return BallKernels::state_index(w, a, s);
+}
+
+// Add p times each score probability of src to dst, which is offset by the
+// runs scored
+static void shift_add(double* dst, const double* src, double p, int n) {
+    for (int i = 0; i < n; i++)
+        dst[i] += p * src[i];
+}
+
+#ifdef EXACT_AVX2
+__attribute__((target("avx2,fma"))) static void
+shift_add_avx2(double* dst, const double* src, double p, int n) {
+    __m256d weight = _mm256_set1_pd(p);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256d lo = _mm256_loadu_pd(dst + i);
+        __m256d hi = _mm256_loadu_pd(dst + i + 4);
+        lo = _mm256_fmadd_pd(weight, _mm256_loadu_pd(src + i), lo);
+        hi = _mm256_fmadd_pd(weight, _mm256_loadu_pd(src + i + 4), hi);
+        _mm256_storeu_pd(dst + i, lo);
+        _mm256_storeu_pd(dst + i + 4, hi);
+    }
+    for (; i < n; i++)
+        dst[i] += p * src[i];
+}
+#endif
+
+// Shift with the fastest kernel available
+static void shift_add_any(double* dst, const double* src, double p, int n) {
+#ifdef EXACT_AVX2
+    if (avx2_available())
+        return shift_add_avx2(dst, src, p, n);
+#endif
+    shift_add(dst, src, p, n);
+}
+
+//~~~~~~~~~~~~~~ InningsDistribution implementations ~~~~~~~~~~~~~~//
+double InningsDistribution::mean_runs() const {
+    double output = 0;
+    for (unsigned int r = 0; r < runs.size(); r++)
+        output += r * runs[r];
+    return output;
+}
+
+double InningsDistribution::mean_wkts() const {
+    double output = 0;
+    for (unsigned int w = 0; w < wkts.size(); w++)
+        output += w * wkts[w];
+    return output;
+}
+
+double InningsDistribution::prob_runs_at_least(int n_runs) const {
+    double output = 0;
+    for (unsigned int r = std::max(n_runs, 0); r < runs.size(); r++)
+        output += runs[r];
+    return output;
+}
+
+int InningsDistribution::runs_quantile(double q) const {
+    double cum = 0;
+    for (unsigned int r = 0; r < runs.size(); r++) {
+        cum += runs[r];
+        if (cum >= q)
+            return r;
+    }
+    return runs.size() - 1;
+}
+
+std::string InningsDistribution::print() const {
+    std::stringstream output;
+    output << std::fixed << std::setprecision(2) << "Mean runs: " << mean_runs()
+           << " (median " << runs_quantile(0.5) << ", 90% interval "
+           << runs_quantile(0.05) << "-" << runs_quantile(0.95) << ")\n"
+           << "Mean wickets: " << mean_wkts() << "\n"
+           << std::setprecision(4) << "P(all out): " << p_all_out
+           << ", P(target reached): " << p_target
+           << ", P(in progress): " << p_in_progress << "\n"
+           << "Wickets   Probability\n";
+    for (unsigned int w = 0; w < wkts.size(); w++)
+        output << std::setw(7) << w << "   " << wkts[w] << "\n";
+    return output.str();
+}
+
+//~~~~~~~~~~~~~~ BallKernels implementations ~~~~~~~~~~~~~~//
+BallKernels::BallKernels(std::shared_ptr<const MatchupTable> c_table,
+                         double c_min_prob)
+    : table(c_table), min_prob(c_min_prob) {}
+
+int BallKernels::state_index(int w, int a, int s) {
+    return (w * (w + 1) / 2 + a) * 2 + s;
+}
+
+void BallKernels::destinations(int w, int a, int s, bool end_over,
+                               int* dests) {
+    dests[0] = state_index(w, a, s);
+    dests[1] = state_index(w, a, s ^ 1);
+    dests[2] = dests[3] = -1;
+    if (w < 9) {
+        // New batter takes strike, alongside the survivor
+        dests[2] = state_index(w + 1, s ? a : w + 1, 1);
+        dests[3] = state_index(w + 1, s ? w + 1 : a, 1);
+    }
+    for (int k = 0; k < 4; k++) {
+        if (dests[k] >= 0 && end_over)
+            dests[k] ^= 1;
+    }
+}
+
+std::vector<int> BallKernels::default_rotation() const {
+    double strength[11];
+    int order[11];
+    for (int j = 0; j < 11; j++) {
+        strength[j] = 0;
+        for (int i = 0; i < 11; i++)
+            strength[j] += table->expected_wkts(i, j);
+        order[j] = j;
+    }
+    std::stable_sort(order, order + 11, [&strength](int x, int y) {
+        return strength[x] > strength[y];
+    });
+
+    return std::vector<int>(order, order + 4);
+}
+
+const std::vector<BallTransition>& BallKernels::get(int striker,
+                                                    int nonstriker,
+                                                    int bowler) {
+    int key = (striker * 11 + nonstriker) * 11 + bowler;
+    auto found = kernels.find(key);
+    if (found != kernels.end())
+        return found->second;
+
+    int n = Model::NUM_DELIV_OUTCOMES;
+    std::vector<int> runs(n);
+    std::vector<bool> legal(n);
+    for (int k = 0; k < n; k++) {
+        std::string outcome = Model::DELIV_OUTCOMES[k];
+        std::string query = outcome.substr(1, 2);
+        runs[k] = outcome.front() - '0';
+        legal[k] = query != "nb" && query != "wd";
+    }
+
+    // Probability of the legal delivery ending in each way, by runs scored
+    std::vector<double> acc[4];
+    for (int type = 0; type < 4; type++)
+        acc[type].assign(MAX_EXTRAS + 7, 0);
+
+    // Probability of reaching the next delivery with the original striker
+    // (s = 0) or non-striker (s = 1) on strike, by runs from extras so far
+    std::vector<double> mass[2] = {std::vector<double>(MAX_EXTRAS + 1, 0),
+                                   std::vector<double>(MAX_EXTRAS + 1, 0)};
+    mass[0][0] = 1;
+    double remaining = 1;
+    while (remaining > 1e-16) {
+        std::vector<double> next[2] = {std::vector<double>(MAX_EXTRAS + 1, 0),
+                                       std::vector<double>(MAX_EXTRAS + 1, 0)};
+        remaining = 0;
+        for (int s = 0; s < 2; s++) {
+            const double* cdf = table->cdf(s ? nonstriker : striker, bowler);
+            for (int e = 0; e <= MAX_EXTRAS; e++) {
+                if (mass[s][e] == 0)
+                    continue;
+                for (int k = 0; k < n; k++) {
+                    double p = mass[s][e] * ((k < n - 1 ? cdf[k + 1] : 1) -
+                                             cdf[k]);
+                    if (k == n - 1) {
+                        acc[2 + s][e] += p;
+                    } else if (legal[k]) {
+                        // Same strike rotation as Innings::update_state
+                        bool rotate = runs[k] % 2 == 1 && runs[k] != 5;
+                        acc[s ^ rotate][e + runs[k]] += p;
+                    } else {
+                        int s2 = s ^ (runs[k] == 2);
+                        next[s2][std::min(e + runs[k], MAX_EXTRAS)] += p;
+                        remaining += p;
+                    }
+                }
+            }
+        }
+        mass[0].swap(next[0]);
+        mass[1].swap(next[1]);
+    }
+
+    // Discard negligible transitions, and rescale the rest so no probability
+    // is lost
+    std::vector<BallTransition>& output = kernels[key];
+    double total = 0;
+    for (int type = 0; type < 4; type++) {
+        for (unsigned int r = 0; r < acc[type].size(); r++) {
+            double p = acc[type][r];
+            if (p < min_prob)
+                continue;
+            int level = std::min((int)floor(-log10(p)), NUM_LEVELS - 1);
+            output.push_back({(int)r, type, p, std::max(level, 0)});
+            total += p;
+        }
+    }
+    for (BallTransition& tr : output)
+        tr.prob /= total;
+
+    return output;
+}
+
+//~~~~~~~~~~~~~~ ExactInnings implementations ~~~~~~~~~~~~~~//
+ExactInnings::ExactInnings(std::shared_ptr<const MatchupTable> c_table,
+                           ExactOptions c_opts)
+    : opts(c_opts), kernels(c_table, c_opts.min_prob) {
+    if (opts.rotation.empty())
+        opts.rotation = kernels.default_rotation();
+}
+
+InningsDistribution ExactInnings::run() {
+    int width = opts.max_score + 1;
+    int target = opts.target;
+
+    // Score distribution of every state, and the range of scores in use
+    std::vector<double> curr(NUM_STATES * width, 0), next(curr.size(), 0);
+    std::vector<int> lo(NUM_STATES, width), hi(NUM_STATES, 0);
+    std::vector<int> next_lo(NUM_STATES, width), next_hi(NUM_STATES, 0);
+
+    InningsDistribution output = {std::vector<double>(width, 0),
+                                  std::vector<double>(11, 0),
+                                  0,
+                                  0,
+                                  0,
+                                  0};
+
+    std::vector<double> cum(width + 1, 0);
+
+    // Widen the range of scores in use by a state
+    auto extend = [&](int dest, int r_lo, int r_hi) {
+        next_lo[dest] = std::min(next_lo[dest], std::min(r_lo, width - 1));
+        next_hi[dest] = std::max(next_hi[dest], std::min(r_hi, width));
+    };
+
+    // Move probability from a single score, with w wickets down
+    auto move = [&](int dest, double* dst, int w, int runs, int r, double p) {
+        if (p <= 0)
+            return;
+        int score = std::min(r + runs, width - 1);
+        if (target > 0 && r + runs >= target) {
+            output.runs[score] += p;
+            output.wkts[w] += p;
+            output.p_target += p;
+        } else if (dest < 0) {
+            output.runs[score] += p;
+            output.wkts[10] += p;
+            output.p_all_out += p;
+        } else {
+            dst[score] += p;
+            extend(dest, score, score + 1);
+        }
+    };
+
+    // Openers at the crease, with the first on strike
+    curr[state_index(0, 0, 0) * width] = 1;
+    lo[state_index(0, 0, 0)] = 0;
+    hi[state_index(0, 0, 0)] = 1;
+    double open = 1;
+
+    unsigned int max_balls = opts.max_overs > 0 ? 6 * opts.max_overs
+                                                : MAX_BALLS;
+    unsigned int t = 0;
+    for (; t < max_balls && open > opts.tolerance; t++) {
+        int bowler = opts.rotation[(t / 6) % opts.rotation.size()];
+        bool end_over = t % 6 == 5;
+        open = 0;
+
+        for (int w = 0; w < 10; w++) {
+            for (int a = 0; a <= w; a++) {
+                for (int s = 0; s < 2; s++) {
+                    int from = state_index(w, a, s);
+                    if (lo[from] >= hi[from])
+                        continue;
+                    const double* src = &curr[from * width];
+                    int striker = s ? w + 1 : a;
+                    int nonstriker = s ? a : w + 1;
+                    int dests[4];
+                    BallKernels::destinations(w, a, s, end_over, dests);
+
+                    // Range of scores at or above the threshold of each level
+                    int level_lo[NUM_LEVELS], level_hi[NUM_LEVELS];
+                    int l = lo[from], h = hi[from];
+                    double threshold = opts.min_prob;
+                    for (int k = 0; k < NUM_LEVELS; k++) {
+                        while (l < h && src[l] < threshold)
+                            l++;
+                        while (h > l && src[h - 1] < threshold)
+                            h--;
+                        level_lo[k] = l;
+                        level_hi[k] = h;
+                        threshold *= 10;
+                    }
+
+                    // Cumulative probability over the scores in use
+                    cum[lo[from]] = 0;
+                    for (int r = lo[from]; r < hi[from]; r++)
+                        cum[r + 1] = cum[r] + src[r];
+
+                    for (const BallTransition& tr :
+                         kernels.get(striker, nonstriker, bowler)) {
+                        int dest = dests[tr.type];
+                        double* dst = dest >= 0 ? &next[dest * width] : nullptr;
+
+                        // Apply the transition to the scores at or above the
+                        // threshold of its level
+                        int r_begin = level_lo[tr.level];
+                        int r_max = level_hi[tr.level];
+
+                        // Scores from which the target is reached, closing
+                        // the innings before any wicket
+                        int r_end = r_max;
+                        if (target > 0)
+                            r_end = std::max(std::min(r_end, target - tr.runs),
+                                             r_begin);
+                        int r = r_begin;
+                        if (dest < 0) {
+                            for (; r < r_end; r++) {
+                                double p = tr.prob * src[r];
+                                output.runs[std::min(r + tr.runs, width - 1)] +=
+                                    p;
+                                output.wkts[10] += p;
+                                output.p_all_out += p;
+                            }
+                        } else {
+                            // Shift the score vector, gathering any scores
+                            // beyond the largest tracked
+                            int r_cap = std::min(r_end, width - 1 - tr.runs);
+                            if (r < r_cap) {
+                                shift_add_any(dst + r + tr.runs, src + r,
+                                              tr.prob, r_cap - r);
+                                r = r_cap;
+                            }
+                            for (; r < r_end; r++)
+                                dst[width - 1] += tr.prob * src[r];
+                            if (r_begin < r_end)
+                                extend(dest, r_begin + tr.runs,
+                                       r_end + tr.runs);
+                        }
+                        for (; r < r_max; r++) {
+                            double p = tr.prob * src[r];
+                            output.runs[std::min(r + tr.runs, width - 1)] += p;
+                            output.wkts[w] += p;
+                            output.p_target += p;
+                        }
+
+                        // Probability below the threshold is moved to the
+                        // nearest score above it, rather than discarded
+                        if (r_begin == r_max) {
+                            move(dest, dst, w, tr.runs, lo[from],
+                                 tr.prob * (cum[hi[from]] - cum[lo[from]]));
+                        } else {
+                            move(dest, dst, w, tr.runs, r_begin,
+                                 tr.prob * (cum[r_begin] - cum[lo[from]]));
+                            move(dest, dst, w, tr.runs, r_max - 1,
+                                 tr.prob * (cum[hi[from]] - cum[r_max]));
+                        }
+                    }
+
+                    std::fill(curr.begin() + from * width + lo[from],
+                              curr.begin() + from * width + hi[from], 0);
+                }
+            }
+        }
+
+        curr.swap(next);
+        lo.swap(next_lo);
+        hi.swap(next_hi);
+        std::fill(next_lo.begin(), next_lo.end(), width);
+        std::fill(next_hi.begin(), next_hi.end(), 0);
+
+        // Trim the tails of each score distribution, moving their
+        // probability to the nearest score kept
+        for (int i = 0; i < NUM_STATES; i++) {
+            if (lo[i] >= hi[i])
+                continue;
+            double* probs = &curr[i * width];
+            double tail = 0;
+            while (lo[i] < hi[i] - 1 && probs[lo[i]] < opts.min_prob) {
+                tail += probs[lo[i]];
+                probs[lo[i]++] = 0;
+            }
+            probs[lo[i]] += tail;
+            tail = 0;
+            while (hi[i] - 1 > lo[i] && probs[hi[i] - 1] < opts.min_prob) {
+                tail += probs[hi[i] - 1];
+                probs[--hi[i]] = 0;
+            }
+            probs[hi[i] - 1] += tail;
+
+            for (int r = lo[i]; r < hi[i]; r++)
+                open += probs[r];
+        }
+    }
+
+    // Innings still in progress at the over limit, or with negligible
+    // probability
+    for (int w = 0; w < 10; w++) {
+        for (int a = 0; a <= w; a++) {
+            for (int s = 0; s < 2; s++) {
+                int i = state_index(w, a, s);
+                for (int r = lo[i]; r < hi[i]; r++) {
+                    output.runs[r] += curr[i * width + r];
+                    output.wkts[w] += curr[i * width + r];
+                }
+            }
+        }
+    }
+    output.p_in_progress = open;
+    output.n_balls = t;
+
+    return output;
+}
@@ -3,6 +3,17 @@
 
 #include "testmatch/enums.hpp"
 
+#include <cmath>
+#include <random>
+#include <stdexcept>
+
+RngState& rng_state() {
+    static thread_local RngState state;
+    return state;
+}
+
+void seed_rng(unsigned long long seed) { rng_engine().seed(seed); }
+
 bool is_slow_bowler(BowlType bowl_type) {
     switch (bowl_type) {
         case med:
@@ -14,4 +25,54 @@ bool is_slow_bowler(BowlType bowl_type) {
         default:
             return false;
     }
-}
\ No newline at end of file
+}
+
+double qnorm(double p) {
+    if (p <= 0 || p >= 1)
+        throw std::invalid_argument("Probability must be between 0 and 1");
+
+    // Coefficients of the rational approximations
+    const double a[6] = {-3.969683028665376e+01, 2.209460984245205e+02,
+                         -2.759285104469687e+02, 1.383577518672690e+02,
+                         -3.066479806614716e+01, 2.506628277459239e+00};
+    const double b[5] = {-5.447609879822406e+01, 1.615858368580409e+02,
+                         -1.556989798598866e+02, 6.680131188771972e+01,
+                         -1.328068155288572e+01};
+    const double c[6] = {-7.784894002430293e-03, -3.223964580411365e-01,
+                         -2.400758277161838e+00, -2.549732539343734e+00,
+                         4.374664141464968e+00,  2.938163982698783e+00};
+    const double d[4] = {7.784695709041462e-03, 3.224671290700398e-01,
+                         2.445134137142996e+00, 3.754408661907416e+00};
+    const double p_low = 0.02425;
+
+    double q, r;
+    if (p < p_low) {
+        // Lower tail
+        q = sqrt(-2 * log(p));
+        return (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q +
+                c[5]) /
+               ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+    } else if (p <= 1 - p_low) {
+        // Central region
+        q = p - 0.5;
+        r = q * q;
+        return (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r +
+                a[5]) *
+               q /
+               (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r +
+                1);
+    } else {
+        // Upper tail, by symmetry
+        return -qnorm(1 - p);
+    }
+}
+
+bool avx2_available() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    static const bool available =
+        __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    return available;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,146 @@
+#include "testmatch/live.hpp"
+
+#include "testmatch/batch.hpp"
+#include "testmatch/enums.hpp"
+#include "testmatch/helpers.hpp"
+#include "testmatch/simulation.hpp"
+#include "testmatch/snapshot.hpp"
+
+#include <cctype>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <istream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+bool parse_feed_line(std::string line, FeedBall& ball) {
+    // Strip trailing whitespace, including carriage returns
+    while (!line.empty() && isspace(line.back()))
+        line.pop_back();
+    if (line.empty() || line.front() == '#')
+        return false;
+
+    std::vector<std::string> fields = split_str(line, ",");
+    if (fields.size() > 3)
+        throw std::invalid_argument("Malformed feed line: " + line);
+
+    ball = {fields[0], false, bowled, ""};
+    if (fields.size() > 1 && !fields[1].empty()) {
+        if (ball.outcome != "W") {
+            throw std::invalid_argument(
+                "Dismissal given for a delivery which is not a wicket: " +
+                line);
+        }
+        ball.has_dism = true;
+        ball.dism = str_to_dism(fields[1]);
+    }
+    if (fields.size() > 2)
+        ball.bowler = fields[2];
+
+    return true;
+}
+
+bool apply_feed_ball(Match& match, const FeedBall& ball) {
+    Innings* inns = match.get_current_innings();
+    if (!ball.bowler.empty()) {
+        Team* team = inns->get_bowl_team();
+        Player* bowler = nullptr;
+        for (int i = 0; i < 11; i++) {
+            if (team->players[i]->get_last_name() == ball.bowler)
+                bowler = team->players[i];
+        }
+        if (bowler == nullptr) {
+            throw std::invalid_argument(ball.bowler + " is not in the " +
+                                        team->name + " XI.");
+        }
+        inns->set_bowler(bowler);
+    }
+
+    if (ball.has_dism)
+        return match.apply_delivery(ball.outcome, ball.dism);
+    else
+        return match.apply_delivery(ball.outcome);
+}
+
+std::string LiveUpdate::print() {
+    std::stringstream output;
+    output << ball << "," << state << "," << std::fixed << std::setprecision(4)
+           << result.win_prob(result.get_home_team()) << ","
+           << result.win_prob(result.get_away_team()) << ","
+           << result.result_prob(draw) << "," << result.result_prob(tie) << ","
+           << std::setprecision(1) << elapsed_ms;
+    return output.str();
+}
+
+//~~~~~~~~~~~~~~ LiveMatch implementations ~~~~~~~~~~~~~~//
+LiveMatch::LiveMatch(Pregame detail, TossResult toss, BatchOptions c_opts)
+    : match(detail), opts(c_opts), pool(c_opts.n_threads), n_balls(0) {
+    // Deliveries applied from the feed still sample some details (e.g. the
+    // fielder for a catch), so use a reproducible stream for them and restore
+    // the caller's afterwards
+    RngState saved = rng_state();
+    seed_rng(mix_seed(opts.seed, -1));
+    match.pregame(toss);
+    feed_rng = rng_state();
+    rng_state() = saved;
+}
+
+bool LiveMatch::apply(const FeedBall& ball) {
+    std::swap(rng_state(), feed_rng);
+    bool over;
+    try {
+        over = apply_feed_ball(match, ball);
+    } catch (...) {
+        std::swap(rng_state(), feed_rng);
+        throw;
+    }
+    std::swap(rng_state(), feed_rng);
+
+    n_balls++;
+    return over;
+}
+
+LiveUpdate LiveMatch::update() {
+    auto begin = std::chrono::steady_clock::now();
+
+    // The calling thread also simulates continuations, so restore its random
+    // stream afterwards and later deliveries are unaffected by them
+    RngState saved = rng_state();
+    BatchResult result = BatchRunner(MatchSnapshot(match), opts).run(&pool);
+    rng_state() = saved;
+
+    Innings* inns = match.get_current_innings();
+    Over* over = inns->get_overs().back().get();
+    std::string state = inns->get_bat_team()->name + " " +
+                        std::to_string(inns->get_team_score()) + "/" +
+                        std::to_string(inns->get_wkts()) + " (" +
+                        std::to_string(inns->get_overs().size() - 1) + "." +
+                        std::to_string(over->get_num_legal_delivs()) + " ov)";
+
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - begin;
+    return {n_balls, state, result, elapsed.count()};
+}
+
+unsigned int LiveMatch::follow(std::istream& feed,
+                               std::function<void(LiveUpdate&)> callback) {
+    unsigned int start = n_balls;
+    std::string line;
+    FeedBall ball;
+    while (match.get_result() == nullptr && std::getline(feed, line)) {
+        if (!parse_feed_line(line, ball))
+            continue;
+
+        apply(ball);
+        LiveUpdate live = update();
+        callback(live);
+    }
+
+    return n_balls - start;
+}
+
+Match& LiveMatch::get_match() { return match; }
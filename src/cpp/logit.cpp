@@ -0,0 +1,243 @@
+#include "testmatch/logit.hpp"
+
+#include "testmatch/helpers.hpp"
+#include "testmatch/models.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+// The AVX2 kernel is compiled for its own target, so the library as a whole
+// still runs on processors without it
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LOGIT_AVX2
+#include <immintrin.h>
+#endif
+
+static const int NUM_OUTCOMES = 22;
+static const int NUM_FEATURES = LogitCoefficients::NUM_FEATURES;
+
+// Smallest outcome probability of the default coefficients, so that outcomes
+// which never occur in the data have a finite coefficient
+static const double MIN_PROB = 1e-12;
+
+// Constants of exp(x) by reduction to 2^n exp(r), with |r| <= log(2) / 2 and
+// log(2) split so that n * LN2_HI is exact, followed by a degree 12 Taylor
+// polynomial in r. Inputs below -708 are clamped, keeping 2^n normal
+static const double LOG2E = 1.4426950408889634;
+static const double LN2_HI = 6.93145751953125e-1;
+static const double LN2_LO = 1.42860682030941723212e-6;
+static const double MIN_EXP_ARG = -708;
+static const double EXP_COEFS[13] = {1.0,
+                                     1.0,
+                                     1.0 / 2,
+                                     1.0 / 6,
+                                     1.0 / 24,
+                                     1.0 / 120,
+                                     1.0 / 720,
+                                     1.0 / 5040,
+                                     1.0 / 40320,
+                                     1.0 / 362880,
+                                     1.0 / 3628800,
+                                     1.0 / 39916800,
+                                     1.0 / 479001600};
+
+static double exp_scalar(double x) {
+    x = std::max(x, MIN_EXP_ARG);
+    double n = std::nearbyint(x * LOG2E);
+    double r = (x - n * LN2_HI) - n * LN2_LO;
+    double p = EXP_COEFS[12];
+    for (int i = 11; i >= 0; i--)
+        p = p * r + EXP_COEFS[i];
+    return std::ldexp(p, (int)n);
+}
+
+// Cumulative distribution, in the form of Model::MODEL_DELIVERY, from the
+// unnormalised probability of each outcome
+static void to_cdf(const double* weights, double* dist) {
+    double total = 0;
+    for (int k = 0; k < NUM_OUTCOMES; k++)
+        total += weights[k];
+
+    double cumulative = 0;
+    dist[0] = 0;
+    for (int k = 1; k < NUM_OUTCOMES; k++) {
+        cumulative += weights[k - 1];
+        dist[k] = cumulative / total;
+    }
+}
+
+//~~~~~~~~~~~~~~ LogitDeliveryModel implementations ~~~~~~~~~~~~~~//
+LogitDeliveryModel::LogitDeliveryModel(LogitCoefficients c_coefs, bool c_simd)
+    : use_simd(c_simd && simd_available()) {
+    for (int f = 0; f < NUM_FEATURES; f++) {
+        for (int k = 0; k < NUM_PADDED; k++)
+            weights[f][k] = k < NUM_OUTCOMES ? c_coefs.weights[k][f] : 0;
+    }
+}
+
+LogitCoefficients LogitDeliveryModel::default_coefficients() {
+    const Model::Coefficients& coefs = Model::COEFFICIENTS;
+
+    // Wicket probability of the reference matchup under Model::prob_wkt
+    double p_wkt = 0.5 * (50.0 / (100 * 30) + 1 / 60.0);
+
+    // Outcome probabilities of the built-in model against pace and spin
+    double probs[2][NUM_OUTCOMES];
+    for (int s = 0; s < 2; s++) {
+        const double* base = s == 0 ? coefs.pace_cdf : coefs.spin_cdf;
+        for (int k = 0; k < NUM_OUTCOMES - 1; k++) {
+            double upper = k < NUM_OUTCOMES - 2 ? base[k + 1] : 1;
+            probs[s][k] = std::max((upper - base[k]) * (1 - p_wkt), MIN_PROB);
+        }
+        probs[s][NUM_OUTCOMES - 1] = p_wkt;
+    }
+
+    LogitCoefficients output = {};
+    for (int k = 0; k < NUM_OUTCOMES; k++) {
+        double* w = output.weights[k];
+        w[0] = log(probs[0][k] / probs[0][0]);
+        w[5] = log(probs[1][k] / probs[1][0]) - w[0];
+
+        std::string outcome = Model::DELIV_OUTCOMES[k];
+        if (outcome == "W") {
+            // Half from each player, as in Model::prob_wkt, and more often
+            // on a pitch which suits the bowler
+            w[1] = -0.5;
+            w[2] = 0.5;
+            w[4] = -0.5;
+            w[6] = 0.5;
+        } else if (outcome.size() == 1 && outcome != "0") {
+            // Runs off the bat, at a rate proportional to the batter's strike
+            // rate and the bowler's economy
+            w[2] = 1;
+            w[3] = 0.5;
+            w[4] = -0.5;
+        }
+    }
+    return output;
+}
+
+void LogitDeliveryModel::features(const Matchup& matchup, double* x) {
+    // Placeholders for players without a record, as in Model::prob_wkt
+    double bat_avg = matchup.bat.career_bat_avg > 0
+                         ? matchup.bat.career_bat_avg
+                         : 5;
+    double bat_sr = matchup.bat.career_strike_rate > 0
+                        ? matchup.bat.career_strike_rate
+                        : 50;
+    double bowl_avg = matchup.bowl.bowl_avg > 0 ? matchup.bowl.bowl_avg : 1000;
+    double bowl_sr =
+        matchup.bowl.strike_rate > 0 ? matchup.bowl.strike_rate : 1000;
+
+    bool is_slow = is_slow_bowler(matchup.bowl.bowl_type);
+    const PitchFactors& pitch = matchup.pitch;
+    bool pitch_known = pitch.seam + pitch.spin > 0;
+
+    x[0] = 1;
+    x[1] = log(bat_avg / 30);
+    x[2] = log(bat_sr / 50);
+    x[3] = log(bowl_avg / 30);
+    x[4] = log(bowl_sr / 60);
+    x[5] = is_slow ? 1 : 0;
+    x[6] = pitch_known ? (is_slow ? pitch.spin : pitch.seam) - 0.5 : 0;
+    x[7] = matchup.bat.bat_arm == matchup.bowl.bowl_arm ? 1 : 0;
+}
+
+bool LogitDeliveryModel::simd_available() {
+#ifdef LOGIT_AVX2
+    return avx2_available();
+#else
+    return false;
+#endif
+}
+
+bool LogitDeliveryModel::get_use_simd() const { return use_simd; }
+
+void LogitDeliveryModel::evaluate_scalar(const double* x,
+                                         double* dist) const {
+    double eta[NUM_OUTCOMES];
+    for (int k = 0; k < NUM_OUTCOMES; k++) {
+        eta[k] = 0;
+        for (int f = 0; f < NUM_FEATURES; f++)
+            eta[k] += x[f] * weights[f][k];
+    }
+
+    // Relative to the largest predictor, so that no exponential overflows
+    double max_eta = *std::max_element(eta, eta + NUM_OUTCOMES);
+    double unnorm[NUM_OUTCOMES];
+    for (int k = 0; k < NUM_OUTCOMES; k++)
+        unnorm[k] = exp_scalar(eta[k] - max_eta);
+
+    to_cdf(unnorm, dist);
+}
+
+#ifdef LOGIT_AVX2
+__attribute__((target("avx2,fma"))) static __m256d exp_avx2(__m256d x) {
+    x = _mm256_max_pd(x, _mm256_set1_pd(MIN_EXP_ARG));
+    __m256d n = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(LOG2E)),
+                                _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256d r = _mm256_fnmadd_pd(n, _mm256_set1_pd(LN2_HI), x);
+    r = _mm256_fnmadd_pd(n, _mm256_set1_pd(LN2_LO), r);
+
+    __m256d p = _mm256_set1_pd(EXP_COEFS[12]);
+    for (int i = 11; i >= 0; i--)
+        p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(EXP_COEFS[i]));
+
+    // 2^n, by writing n straight into the exponent bits
+    __m256i bits = _mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(n));
+    bits = _mm256_slli_epi64(
+        _mm256_add_epi64(bits, _mm256_set1_epi64x(1023)), 52);
+    return _mm256_mul_pd(p, _mm256_castsi256_pd(bits));
+}
+
+__attribute__((target("avx2,fma"))) void
+LogitDeliveryModel::evaluate_avx2(const double* x, double* dist) const {
+    const int n_vecs = NUM_PADDED / 4;
+
+    // Linear predictors of every outcome, four at a time
+    __m256d eta[n_vecs];
+    for (int v = 0; v < n_vecs; v++)
+        eta[v] = _mm256_setzero_pd();
+    for (int f = 0; f < NUM_FEATURES; f++) {
+        __m256d x_f = _mm256_set1_pd(x[f]);
+        for (int v = 0; v < n_vecs; v++)
+            eta[v] =
+                _mm256_fmadd_pd(x_f, _mm256_loadu_pd(&weights[f][4 * v]),
+                                eta[v]);
+    }
+
+    // Padding must not contribute to the largest predictor
+    eta[n_vecs - 1] = _mm256_blend_pd(eta[n_vecs - 1],
+                                      _mm256_set1_pd(-HUGE_VAL), 0b1100);
+    __m256d max_eta = eta[0];
+    for (int v = 1; v < n_vecs; v++)
+        max_eta = _mm256_max_pd(max_eta, eta[v]);
+    max_eta = _mm256_max_pd(max_eta,
+                            _mm256_permute2f128_pd(max_eta, max_eta, 1));
+    max_eta = _mm256_max_pd(max_eta, _mm256_permute_pd(max_eta, 0b0101));
+
+    double unnorm[NUM_PADDED];
+    for (int v = 0; v < n_vecs; v++)
+        _mm256_storeu_pd(&unnorm[4 * v],
+                         exp_avx2(_mm256_sub_pd(eta[v], max_eta)));
+
+    to_cdf(unnorm, dist);
+}
+#else
+void LogitDeliveryModel::evaluate_avx2(const double* x, double* dist) const {
+    evaluate_scalar(x, dist);
+}
+#endif
+
+void LogitDeliveryModel::evaluate(const Matchup* matchups, int n,
+                                  double* output) const {
+    double x[NUM_FEATURES];
+    for (int m = 0; m < n; m++) {
+        features(matchups[m], x);
+        if (use_simd)
+            evaluate_avx2(x, output + m * NUM_OUTCOMES);
+        else
+            evaluate_scalar(x, output + m * NUM_OUTCOMES);
+    }
+}
@@ -2,10 +2,12 @@
 
 #include "testmatch/helpers.hpp"
 
+#include <algorithm>
 #include <cmath>
 #include <exception>
 #include <iomanip>
 #include <iostream>
+#include <stdexcept>
 #include <string>
 #include <utility>
 
@@ -13,16 +15,10 @@ TimeOfDay::TimeOfDay() : _sec(0), _min(0), _hrs(0) {}
 
 TimeOfDay::TimeOfDay(uint sec, uint min, uint hrs)
     : _sec(sec), _min(min), _hrs(hrs) {
-    // Round appropriately
+    rounder();
 }
 
-TimeOfDay::TimeOfDay(double dr) : _sec(0), _hrs((uint)dr) {
-    if (dr < 0) {
-        // Raise exception
-    }
-
-    _min = dr - _hrs;
-}
+TimeOfDay::TimeOfDay(double dr) : _sec(0), _min(0), _hrs(0) { set(dr); }
 
 std::string TimeOfDay::two_digits(int val) {
     std::string output;
@@ -33,6 +29,13 @@ std::string TimeOfDay::two_digits(int val) {
     return output;
 }
 
+void TimeOfDay::rounder() {
+    _min += _sec / 60;
+    _sec %= 60;
+    _hrs += _min / 60;
+    _min %= 60;
+}
+
 // Explicit casts
 TimeOfDay::operator std::string() {
     return two_digits(_hrs) + ":" + two_digits(_min) + ":" + two_digits(_sec);
@@ -45,7 +48,16 @@ uint TimeOfDay::sec() { return _sec; }
 uint TimeOfDay::min() { return _min; }
 uint TimeOfDay::hrs() { return _hrs; }
 
-void TimeOfDay::set(double dr) {}
+void TimeOfDay::set(double dr) {
+    if (dr < 0)
+        throw std::invalid_argument("Time of day cannot be negative.");
+
+    // Minutes are written after the decimal point, so 10.30 is 10:30
+    _hrs = (uint)dr;
+    _min = (uint)std::round((dr - _hrs) * 100);
+    _sec = 0;
+    rounder();
+}
 
 // Overloaded operators
 TimeOfDay& TimeOfDay::operator++() {
@@ -55,167 +67,187 @@ TimeOfDay& TimeOfDay::operator++() {
 
 TimeOfDay TimeOfDay::operator++(int) {
     TimeOfDay old = *this;
-    (*this)++;
+    ++(*this);
     return old;
 }
 
-TimeOfDay& TimeOfDay::operator+=(const TimeOfDay& rhs) { return *this; }
+TimeOfDay& TimeOfDay::operator+=(const TimeOfDay& rhs) {
+    _sec += rhs._sec;
+    _min += rhs._min;
+    _hrs += rhs._hrs;
+    rounder();
+    return *this;
+}
 
 TimeOfDay& TimeOfDay::operator+=(const int& rhs) {
-    return *this += TimeOfDay(rhs);
+    if (rhs < 0)
+        throw std::invalid_argument("Time of day cannot go backwards.");
+    return *this += TimeOfDay(rhs, 0, 0);
 }
 
 bool operator==(const TimeOfDay& lhs, const TimeOfDay& rhs) {
     return ((lhs._hrs == rhs._hrs) && (lhs._min == rhs._min) &&
             (lhs._sec == rhs._sec));
 }
-bool operator==(const TimeOfDay& lhs, const TimeOfDay& rhs);
-
-TimeOfDay operator+(TimeOfDay lhs, const TimeOfDay& rhs);
-TimeOfDay operator+(TimeOfDay lhs, const int& rhs);
-
-/*
-    MatchTime implementations
-*/
-// Parameters
-// Session time details
-float MatchTime::START_TIME = 10.30;
-float MatchTime::LUNCH_START = 12.30;
-int MatchTime::LUNCH_DUR = 2400; // 40 minutes
-float MatchTime::TEA_START = 15.10;
-int MatchTime::TEA_DUR = 1200; // 20 minutes
-float MatchTime::CLOSE_PLAY = 17.30;
 
-int MatchTime::OVERCHA_DUR = 30;
-int MatchTime::DRINKS_DUR = 300; // 5 minutes
-int MatchTime::INNBRE_DUR = 600; // 10 minutes
+TimeOfDay operator+(TimeOfDay lhs, const TimeOfDay& rhs) {
+    lhs += rhs;
+    return lhs;
+}
 
-// Maximum amount of time which a session can be extended by
-int MatchTime::MAXIMUM_EXTEND = 1800; // 30 minutes
+TimeOfDay operator+(TimeOfDay lhs, const int& rhs) {
+    lhs += rhs;
+    return lhs;
+}
 
+//~~~~~~~~~~~~~~ MatchTime implementations ~~~~~~~~~~~~~~//
 // Delivery duration statistics
-double MatchTime::PACE_MINDUR = 25;
-double MatchTime::PACE_MAXDUR = 60;
-double MatchTime::SPIN_MINDUR = 15;
-double MatchTime::SPIN_MAXDUR = 40;
-double MatchTime::PACE_MEANDUR = 45;
-double MatchTime::SPIN_MEANDUR = 30;
-// const double DEL_STDDUR = 0.5;
-double MatchTime::RUN_DUR = 10;
+thread_local double MatchTime::PACE_MINDUR = 25;
+thread_local double MatchTime::PACE_MAXDUR = 60;
+thread_local double MatchTime::SPIN_MINDUR = 15;
+thread_local double MatchTime::SPIN_MAXDUR = 40;
+thread_local double MatchTime::PACE_MEANDUR = 45;
+thread_local double MatchTime::SPIN_MEANDUR = 30;
+thread_local double MatchTime::RUN_DUR = 10;
+
+// Breaks in the schedule of each day, in the order they fall due
+enum BreakType { drinks, interval, stumps };
+
+struct ScheduledBreak {
+    int start;
+    int duration;
+    BreakType type;
+};
+
+static const ScheduledBreak SCHEDULE[] = {
+    {11 * 3600 + 30 * 60, MatchTime::DRINKS_DUR, drinks},
+    {MatchTime::LUNCH_START, MatchTime::LUNCH_DUR, interval},
+    {14 * 3600 + 10 * 60, MatchTime::DRINKS_DUR, drinks},
+    {MatchTime::TEA_START, MatchTime::TEA_DUR, interval},
+    {16 * 3600 + 30 * 60, MatchTime::DRINKS_DUR, drinks},
+    {MatchTime::CLOSE_PLAY, 0, stumps}};
+static const int NUM_BREAKS = sizeof(SCHEDULE) / sizeof(ScheduledBreak);
+
+// Scheduled playing time in a full day
+static const int DAY_PLAY = MatchTime::CLOSE_PLAY - MatchTime::START_TIME -
+                            MatchTime::LUNCH_DUR - MatchTime::TEA_DUR;
 
 // Default constructor - start of match, day 1
-MatchTime::MatchTime() : time(START_TIME) {
-    day = 1;
-    state = "Match Start";
-}
-
-// Private utility functions
-bool MatchTime::take_lunch() {
-    if (state != "Session 1") {
-        // Cannot take lunch if not in Session 1
-        return false;
+MatchTime::MatchTime()
+    : time(START_TIME), day(1), next(0), day_overs(0),
+      mean_dur{PACE_MEANDUR, SPIN_MEANDUR}, min_dur{PACE_MINDUR, SPIN_MINDUR},
+      max_dur{PACE_MAXDUR, SPIN_MAXDUR}, run_dur(RUN_DUR) {}
+
+bool MatchTime::take_breaks() {
+    bool stopped = false;
+    while (day <= NUM_DAYS && time >= SCHEDULE[next].start) {
+        const ScheduledBreak& brk = SCHEDULE[next];
+
+        if (brk.type == stumps) {
+            // Play goes on until the day's overs are bowled, or the extension
+            // runs out
+            if (day_overs < MIN_OVERS &&
+                time < CLOSE_PLAY + MAXIMUM_EXTEND)
+                return stopped;
+
+            day++;
+            time = START_TIME;
+            next = 0;
+            day_overs = 0;
+            return true;
+        }
+
+        // Drinks are skipped if the interval is due as well
+        next++;
+        if (brk.type == drinks && time >= SCHEDULE[next].start)
+            continue;
+
+        time += brk.duration;
+        stopped = stopped || brk.type == interval;
     }
-
-    // Push time to end of break
-    time += LUNCH_DUR;
-    state = "Lunch";
+    return stopped;
 }
 
-bool MatchTime::take_tea() {
-    if (state != "Session 2") {
-        // Cannot take tea if not in Session 2
-        return false;
-    }
-
-    // Push time to end of break
-    time += TEA_DUR;
-    state = "Tea";
+// Time controls for use by simulation
+void MatchTime::delivery(bool is_spin, int runs) {
+    int k = is_spin ? 1 : 0;
+    double s = rtexp(mean_dur[k], min_dur[k], max_dur[k]);
+    time += (int)std::round(s + runs * run_dur);
 }
 
-bool MatchTime::close_day() {
-    if (state != "Session 3") {
-        // Cannot close if not in Session 3
-        return false;
-    }
-
-    // Push time to end of break
-    day += 1;
-    time.set(START_TIME);
-    state = "Stumps";
+void MatchTime::dots(bool is_spin, int n) {
+    // Each duration is sampled and rounded as for a single delivery, so the
+    // clock runs exactly as if the balls were bowled one at a time
+    for (int k = 0; k < n; k++)
+        delivery(is_spin, 0);
 }
 
-void MatchTime::check_state_change() {
-
-    // Switch through each possible match state
-    if (state == "Match Start") {
-        // if (time > START_TIME)
-    } else if (state == "Session 1") {
-
-    } else if (state == "Drinks 1") {
-
-    } else if (state == "Lunch") {
-
-    } else if (state == "Session 2") {
-
-    } else if (state == "Drinks 2") {
-
-    } else if (state == "Tea") {
-
-    } else if (state == "Session 3") {
-
-    } else if (state == "Drinks 3") {
-
-    } else if (state == "Innings Break") {
+void MatchTime::wicket(bool is_spin) {
+    delivery(is_spin, 0);
+    time += WICKET_DUR;
+}
 
-    } else if (state == "Stumps") {
+bool MatchTime::end_over() {
+    time += OVERCHA_DUR;
+    day_overs++;
+    return take_breaks();
+}
 
-    } else {
-        // Raise exception - unknown match state
-    }
+bool MatchTime::end_innings() {
+    time += INNBRE_DUR;
+    return take_breaks();
 }
 
-// Time controls for use by simulation
-std::pair<int, std::string> MatchTime::delivery(bool type, int runs) {
-
-    // Randomnly generate time elapsed by delivery
-    double s;
-    if (type) {
-        // Spin bowler
-        s = rtexp(SPIN_MEANDUR, SPIN_MINDUR, SPIN_MAXDUR) + runs * RUN_DUR;
-    } else {
-        // Pace bowler
-        s = rtexp(PACE_MEANDUR, PACE_MINDUR, PACE_MAXDUR) + runs * RUN_DUR;
-    }
+bool MatchTime::is_over() const { return day > NUM_DAYS; }
 
-    int elapsed = (int)round(s);
+int MatchTime::get_session() const {
+    if (is_over())
+        return NUM_DAYS * SESSIONS_PER_DAY - 1;
 
-    check_state_change();
-    std::pair<int, std::string> output = {elapsed, state};
+    int output = (day - 1) * SESSIONS_PER_DAY;
+    for (int i = 0; i < next; i++) {
+        if (SCHEDULE[i].type == interval)
+            output++;
+    }
     return output;
 }
 
-std::pair<int, std::string> MatchTime::end_over() { return {0, state}; }
-
-std::pair<int, std::string> MatchTime::drinks() {
-    time += DRINKS_DUR;
+int MatchTime::play_left_today() const {
+    if (is_over())
+        return 0;
 
-    check_state_change();
-    return {DRINKS_DUR, state};
+    int output = CLOSE_PLAY - time;
+    for (int i = next; i < NUM_BREAKS; i++) {
+        if (SCHEDULE[i].type == interval)
+            output -= SCHEDULE[i].duration;
+    }
+    return std::max(output, 0);
 }
 
-std::string MatchTime::force_early_break() {
-    check_state_change();
-    return state;
+int MatchTime::play_left() const {
+    if (is_over())
+        return 0;
+    return play_left_today() + (NUM_DAYS - day) * DAY_PLAY;
 }
 
-std::string MatchTime::extend_session() {
-    check_state_change();
-    return state;
+double MatchTime::overs_left() const {
+    return (double)play_left() / NOMINAL_OVER_DUR;
 }
 
 // Getters
-TimeOfDay MatchTime::get_time() { return time; }
+TimeOfDay MatchTime::get_time() { return TimeOfDay(time, 0, 0); }
+
+int MatchTime::get_seconds() const { return time; }
 
-int MatchTime::get_day() { return day; }
+int MatchTime::get_day() const { return day; }
 
-std::string MatchTime::get_state() { return state; }
+std::string MatchTime::get_state() const {
+    if (is_over())
+        return "Stumps";
+    return "Session " + std::to_string(get_session() % SESSIONS_PER_DAY + 1);
+}
+
+MatchTime::operator std::string() {
+    return "Day " + std::to_string(std::min(day, (int)NUM_DAYS)) + ", " +
+           std::string(get_time()) + ", " + get_state();
+}
@@ -11,10 +11,17 @@
 
 #include "testmatch/models.hpp"
 
+#include "testmatch/calibration.hpp"
 #include "testmatch/helpers.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstdlib>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <string>
 #include <vector>
 namespace Model {
@@ -40,9 +47,10 @@ std::vector<DismType> DISM_MODES_STATIC = {bowled, caught,  c_and_b,
  * be eventually improved.
  **/
 double MODEL_TOSS_ELECT(double spin_factor) {
-    // Exponential model
-    double a = 0.05;
-    return a * exp(log(0.9 / a) * spin_factor);
+    // Exponential model, between the probabilities at either extreme
+    const double* coefs = COEFFICIENTS.toss_elect;
+    double a = coefs[0];
+    return a * exp(log(coefs[1] / a) * spin_factor);
 }
 
 double prob_wkt(BatStats bat, BowlStats bowl, MatchStats match) {
@@ -69,10 +77,21 @@ double OBJ_AVG_FATIG(double bowl_avg, double bowl_sr, double fatigue) {
 }
 
 /**
- *
+ * A heuristic rather than a fitted model: a logistic curve in the lead, with
+ * midpoint at a lead which depends on the innings and falls by one run for
+ * every three overs already bowled in the match, and a scale of 40 runs.
+ * Captains are a little more likely to declare just after losing a wicket.
+ * The fourth innings is never declared.
  */
 double MODEL_DECLARATION(int lead, int match_balls, bool is_wkt, int innings) {
-    return 0;
+    // Midpoint of the curve at the start of the match, for each innings
+    static const double MIDPOINT[3] = {600, 300, 450};
+    if (innings < 1 || innings > 3)
+        return 0;
+
+    double midpoint = MIDPOINT[innings - 1] - match_balls / 18.0;
+    double p = 1.0 / (1 + exp(-(lead - midpoint) / 40.0));
+    return is_wkt ? std::min(1.0, 1.5 * p) : p;
 }
 
 /**
@@ -84,114 +103,496 @@ double MODEL_DECLARATION(int lead, int match_balls, bool is_wkt, int innings) {
  * \f[
  *  p = \frac{1}{1 + \exp{-1101.903 + 1058.466 \times\text{t_lead}}}.
  * \f]
+ * with the default coefficients.
  */
 double MODEL_FOLLOW_ON(int lead) {
     // Logistic regression, fitted in R
+    const double* coefs = COEFFICIENTS.follow_on;
 
     // Preprocessing of lead value
-    double t_lead = boxcox(lead, -0.9561039); // Box-Cox transform
+    double t_lead = boxcox(lead, coefs[0]); // Box-Cox transform
 
     // Fitted model
-    double logit = -1101.903 + 1058.466 * t_lead;
+    double logit = coefs[1] + coefs[2] * t_lead;
     return 1 / (1 + exp(logit));
 }
 
+// Placeholder data proportions, published until replaced by
+// load_coefficients()
+const Coefficients DEFAULT_COEFFICIENTS = {
+    {0, 0.72505691, 0.844465522, 0.845466186, 0.851517595, 0.859254956,
+     0.862496443, 0.899248316, 0.899452243, 0.900194442, 0.900244238,
+     0.900298776, 0.910843688, 0.910879256, 0.910912454, 0.978537892,
+     0.979818363, 0.98124585, 0.981426065, 0.981497202, 0.981855259},
+    {0, 0.700414129, 0.878619915, 0.879463788, 0.881999123, 0.884047465,
+     0.884303973, 0.919880445, 0.920519855, 0.921326553, 0.92133027,
+     0.921341423, 0.92863144, 0.928873077, 0.929029212, 0.976230307,
+     0.977791656, 0.978115079, 0.978234039, 0.978241474, 0.978267496},
+    {0, 0.175, 0.815, 0.8291, 0.9731, 1},
+    {0, 0.157, 0.692, 0.7274, 0.9286, 0.9613},
+    {0.05, 0.9},
+    {-0.9561039, -1101.903, 1058.466},
+    {0.5, 0.5, 0.05}};
+
+// Published coefficients, and the number of times they have been replaced.
+// Constructed on first use, as threads may simulate during static
+// initialisation of other files
+struct Publication {
+    std::atomic<std::shared_ptr<const Coefficients>> coefs;
+    std::atomic<unsigned long long> generation;
+    std::mutex mutex;
+
+    Publication()
+        : coefs(std::make_shared<const Coefficients>(DEFAULT_COEFFICIENTS)),
+          generation(0) {}
+};
+
+static Publication& publication() {
+    static Publication output;
+    return output;
+}
+
+thread_local Coefficients COEFFICIENTS = *published_coefficients();
+
+// Generation of the published coefficients last copied by the thread, none
+// until it first prepares a match, and whether it keeps its own
+static thread_local unsigned long long SYNCED = -1;
+static thread_local bool PINNED = false;
+
+std::shared_ptr<const Coefficients> published_coefficients() {
+    return publication().coefs.load(std::memory_order_acquire);
+}
+
+void publish_coefficients(std::shared_ptr<const Coefficients> coefs) {
+    if (coefs == nullptr)
+        throw std::invalid_argument("No coefficients to publish");
+
+    // Publishers are serialised, so generations are in the order of the
+    // coefficients they count; readers never take the lock
+    Publication& pub = publication();
+    std::lock_guard<std::mutex> lock(pub.mutex);
+    pub.coefs.store(std::move(coefs), std::memory_order_release);
+    pub.generation.fetch_add(1, std::memory_order_release);
+}
+
+bool sync_coefficients() {
+    Publication& pub = publication();
+    unsigned long long generation =
+        pub.generation.load(std::memory_order_acquire);
+    if (PINNED || generation == SYNCED)
+        return false;
+
+    // A publication between the two loads is copied now, and again by the
+    // next call, which is harmless
+    COEFFICIENTS = *pub.coefs.load(std::memory_order_acquire);
+    SYNCED = generation;
+    return true;
+}
+
+void pin_coefficients(bool pinned) { PINNED = pinned; }
+
+bool coefficients_pinned() { return PINNED; }
+
+// Load fitted coefficients at startup, if a coefficient file is given. A bad
+// file is reported rather than aborting before main() is entered
+static const bool LOADED = [] {
+    const char* path = std::getenv("TESTMATCH_COEFFICIENTS");
+    if (path == nullptr || *path == '\0')
+        return false;
+    try {
+        load_coefficients(path);
+    } catch (std::runtime_error& e) {
+        std::cerr << e.what() << ", using placeholder coefficients"
+                  << std::endl;
+        return false;
+    }
+    return true;
+}();
+
 // Generates probability distribution for each possible outcome
 double* MODEL_DELIVERY(BatStats bat, BowlStats bowl) {
     double* output = new double[NUM_DELIV_OUTCOMES];
+    Matchup matchup = {bat, bowl, {}, {}};
+    DeliveryModel::builtin()->evaluate(&matchup, 1, output);
+    return output;
+}
 
-    // PLACEHOLDER - data proportions, hard-coded model
-    if (is_slow_bowler(bowl.bowl_type)) {
-        output[0] = 0;
-        output[1] = 0.700414129;
-        output[2] = 0.878619915;
-        output[3] = 0.879463788;
-        output[4] = 0.881999123;
-        output[5] = 0.884047465;
-        output[6] = 0.884303973;
-        output[7] = 0.919880445;
-        output[8] = 0.920519855;
-        output[9] = 0.921326553;
-        output[10] = 0.92133027;
-        output[11] = 0.921341423;
-        output[12] = 0.92863144;
-        output[13] = 0.928873077;
-        output[14] = 0.929029212;
-        output[15] = 0.976230307;
-        output[16] = 0.977791656;
-        output[17] = 0.978115079;
-        output[18] = 0.978234039;
-        output[19] = 0.978241474;
-        output[20] = 0.978267496;
-    } else {
-        output[0] = 0;
-        output[1] = 0.72505691;
-        output[2] = 0.844465522;
-        output[3] = 0.845466186;
-        output[4] = 0.851517595;
-        output[5] = 0.859254956;
-        output[6] = 0.862496443;
-        output[7] = 0.899248316;
-        output[8] = 0.899452243;
-        output[9] = 0.900194442;
-        output[10] = 0.900244238;
-        output[11] = 0.900298776;
-        output[12] = 0.910843688;
-        output[13] = 0.910879256;
-        output[14] = 0.910912454;
-        output[15] = 0.978537892;
-        output[16] = 0.979818363;
-        output[17] = 0.98124585;
-        output[18] = 0.981426065;
-        output[19] = 0.981497202;
-        output[20] = 0.981855259;
+double expected_runs(const double* dist) {
+    // Probability of each outcome is the step in the CDF; the final outcome
+    // is a wicket, which scores no runs
+    static const std::vector<int> RUNS = [] {
+        std::vector<int> output;
+        for (const std::string& outcome : DELIV_OUTCOMES)
+            output.push_back(outcome.front() - '0');
+        return output;
+    }();
+
+    double output = 0;
+    for (int i = 0; i < NUM_DELIV_OUTCOMES - 1; i++)
+        output += RUNS[i] * (dist[i + 1] - dist[i]);
+    return output;
+}
+
+DismType MODEL_WICKET_TYPE(BowlType bowltype) {
+    double dist[6];
+    dism_cdf(bowltype, {0, 0}, dist);
+    return sample_cdf<DismType>(DISM_MODES_STATIC.data(), NUM_DISM_MODES,
+                                dist);
+}
+
+// Suitability of the pitch for the type of bowler, from -0.5 to 0.5, or zero
+// if the pitch is unknown
+static double pitch_suitability(BowlType bowltype, PitchFactors pitch) {
+    if (pitch.seam + pitch.spin <= 0)
+        return 0;
+    return (is_slow_bowler(bowltype) ? pitch.spin : pitch.seam) - 0.5;
+}
+
+void dism_cdf(BowlType bowltype, PitchFactors pitch, double* output) {
+    // Seamer model by default, for which stumpings are impossible
+    bool is_spinner = is_slow_bowler(bowltype);
+    const double* base = is_spinner ? COEFFICIENTS.spin_dism_cdf
+                                    : COEFFICIENTS.pace_dism_cdf;
+
+    // Edges carry to the keeper and slips off a seaming pitch, while turn
+    // and bounce beat the bat
+    double mult =
+        1 + COEFFICIENTS.pitch[1] * pitch_suitability(bowltype, pitch);
+    double probs[6];
+    double total = 0;
+    for (int i = 0; i < NUM_DISM_MODES; i++) {
+        double upper = i < NUM_DISM_MODES - 1 ? base[i + 1] : 1;
+        DismType mode = DISM_MODES_STATIC[i];
+        bool favoured = is_spinner
+                            ? mode == bowled || mode == lbw || mode == stumped
+                            : mode == caught;
+        probs[i] = (upper - base[i]) * (favoured ? mult : 1);
+        total += probs[i];
     }
 
-    // Wicket probability
-    double wkt_value = 1 - prob_wkt(bat, bowl, {});
-    output[21] = wkt_value;
+    double cumulative = 0;
+    for (int i = 0; i < NUM_DISM_MODES; i++) {
+        output[i] = cumulative / total;
+        cumulative += probs[i];
+    }
+}
+
+PitchFactors MODEL_PITCH_WEAR(PitchFactors pitch, int session) {
+    if (pitch.seam + pitch.spin <= 0)
+        return pitch;
+
+    double wear_rate = COEFFICIENTS.pitch[2];
+    double spin = 1 - (1 - pitch.spin) * pow(1 - wear_rate, session);
+    return {1 - spin, spin};
+}
+} // namespace Model
+
+//~~~~~~~~~~~~~~ DeliveryModel implementations ~~~~~~~~~~~~~~//
+const DeliveryModel* DeliveryModel::builtin() {
+    static const BuiltinDeliveryModel model;
+    return &model;
+}
+
+//~~~~~~~~~~~~~~ BuiltinDeliveryModel implementations ~~~~~~~~~~~~~~//
+void BuiltinDeliveryModel::evaluate(const Matchup* matchups, int n,
+                                    double* output) const {
+    int n_outcomes = Model::NUM_DELIV_OUTCOMES;
+    for (int m = 0; m < n; m++) {
+        double* dist = output + m * n_outcomes;
+
+        // Data proportions, placeholders unless fitted coefficients are
+        // loaded
+        const double* base = is_slow_bowler(matchups[m].bowl.bowl_type)
+                                 ? Model::COEFFICIENTS.spin_cdf
+                                 : Model::COEFFICIENTS.pace_cdf;
 
-    // Rescale fixed probabilities
-    for (int i = 0; i < NUM_DELIV_OUTCOMES - 1; i++) {
-        output[i] = output[i] * wkt_value;
+        // Rescale by the probability of surviving the delivery, with more
+        // wickets on a pitch which suits the bowler
+        double p_wkt = Model::prob_wkt(matchups[m].bat, matchups[m].bowl,
+                                       matchups[m].situation);
+        p_wkt *= 1 + Model::COEFFICIENTS.pitch[0] *
+                         Model::pitch_suitability(matchups[m].bowl.bowl_type,
+                                                  matchups[m].pitch);
+        double wkt_value = 1 - p_wkt;
+        for (int i = 0; i < n_outcomes - 1; i++)
+            dist[i] = base[i] * wkt_value;
+        dist[n_outcomes - 1] = wkt_value;
     }
+}
+
+// Fill in the distributions derived from the cumulative distribution
+static void derive_dists(DeliveryDists& dists) {
+    int n = Model::NUM_DELIV_OUTCOMES;
+    const double* probs = dists.cdf;
+    dists.exp_runs = Model::expected_runs(probs);
+    dists.exp_wkts = 1 - probs[n - 1];
+
+    // The first outcome is a dot ball, so the remaining outcomes start from
+    // its cumulative probability
+    double p_dot = probs[1] - probs[0];
+    dists.dot_prob = p_dot;
+    double scale = p_dot < 1 ? 1 / (1 - p_dot) : 0;
+    dists.scoring_cdf[0] = 0;
+    for (int k = 1; k < n; k++)
+        dists.scoring_cdf[k] = (probs[k] - probs[1]) * scale;
+}
 
+// Matchup of every pairing of batter and bowler from two XIs, indexed by
+// batter, then bowler
+static std::vector<Matchup> pairings(BatterCard** batters,
+                                     BowlerCard** bowlers,
+                                     const PitchFactors* pitch) {
+    PitchFactors conditions = pitch != nullptr ? *pitch : PitchFactors{0, 0};
+    std::vector<Matchup> output;
+    output.reserve(11 * 11);
+    for (int i = 0; i < 11; i++) {
+        for (int j = 0; j < 11; j++)
+            output.push_back({batters[i]->get_sim_stats(),
+                              bowlers[j]->get_sim_stats(), conditions, {}});
+    }
     return output;
 }
 
-DismType MODEL_WICKET_TYPE(BowlType bowltype) {
-    // This desperately needs cleaning up
+//~~~~~~~~~~~~~~ MatchupTable implementations ~~~~~~~~~~~~~~//
+MatchupTable::MatchupTable(BatterCard** batters, BowlerCard** bowlers,
+                           const DeliveryModel* model,
+                           const PitchFactors* pitch)
+    : dists(11 * 11), dism_cdfs(11 * Model::NUM_DISM_MODES) {
+    evaluate(pairings(batters, bowlers, pitch), model);
+}
 
-    DismType* DISM_MODES = new DismType[NUM_DISM_MODES];
-    double* DISM_MODE_DIST = new double[NUM_DISM_MODES];
+MatchupTable::MatchupTable(const std::vector<Matchup>& matchups,
+                           const DeliveryModel* model)
+    : dists(11 * 11), dism_cdfs(11 * Model::NUM_DISM_MODES) {
+    evaluate(matchups, model);
+}
 
-    double DISM_MODE_SPINNER[6] = {0, 0.157, 0.692, 0.7274, 0.9286, 0.9613};
-    double DISM_MODE_SEAMER[6] = {0, 0.175, 0.815, 0.8291, 0.9731, 1};
+void MatchupTable::evaluate(const std::vector<Matchup>& matchups,
+                            const DeliveryModel* model) {
+    if (model == nullptr)
+        model = DeliveryModel::builtin();
 
-    bool is_spinner = is_slow_bowler(bowltype);
+    // Every pairing in one batch, then copied into the table
+    int n = Model::NUM_DELIV_OUTCOMES;
+    std::vector<double> cdfs(11 * 11 * n);
+    model->evaluate(matchups.data(), 11 * 11, cdfs.data());
 
-    // Check if "f" is in bowl_type - indicates whether stumpings are possible
-    for (int i = 0; i < NUM_DISM_MODES; i++) {
-        DISM_MODES[i] = DISM_MODES_STATIC[i];
-        if (is_spinner) {
-            // Spinner model
-            // double DISM_MODE_DIST [8] = {0.157, 0.534, 0.0359, 0.201, 0.0326,
-            // 0.0387};
-            DISM_MODE_DIST[i] = DISM_MODE_SPINNER[i];
-        } else {
-            // Seamer model
-            // double DISM_MODE_DIST [8] = {0.175, 0.640, 0.0141, 0.144, 0.0242,
-            // 0};
-            DISM_MODE_DIST[i] = DISM_MODE_SEAMER[i];
+    for (int m = 0; m < 11 * 11; m++) {
+        std::copy(&cdfs[m * n], &cdfs[(m + 1) * n], dists[m].cdf);
+        derive_dists(dists[m]);
+    }
+
+    // Dismissals depend only on the bowler, the first batter's row
+    for (int j = 0; j < 11; j++)
+        Model::dism_cdf(matchups[j].bowl.bowl_type, matchups[j].pitch,
+                        &dism_cdfs[j * Model::NUM_DISM_MODES]);
+}
+
+const double* MatchupTable::cdf(int bat, int bowl) const {
+    return dists[bat * 11 + bowl].cdf;
+}
+
+double MatchupTable::expected_runs(int bat, int bowl) const {
+    return dists[bat * 11 + bowl].exp_runs;
+}
+
+double MatchupTable::expected_wkts(int bat, int bowl) const {
+    return dists[bat * 11 + bowl].exp_wkts;
+}
+
+double MatchupTable::dot_prob(int bat, int bowl) const {
+    return dists[bat * 11 + bowl].dot_prob;
+}
+
+const double* MatchupTable::scoring_cdf(int bat, int bowl) const {
+    return dists[bat * 11 + bowl].scoring_cdf;
+}
+
+const DeliveryDists& MatchupTable::get(int bat, int bowl) const {
+    return dists[bat * 11 + bowl];
+}
+
+const double* MatchupTable::dism_cdf(int bowl) const {
+    return &dism_cdfs[bowl * Model::NUM_DISM_MODES];
+}
+
+unsigned long long MatchupTable::fingerprint() const {
+    // FNV-1a over the bytes of the distributions
+    unsigned long long output = 14695981039346656037ull;
+    for (const DeliveryDists& pairing : dists) {
+        const unsigned char* bytes = (const unsigned char*)pairing.cdf;
+        for (size_t i = 0; i < sizeof(pairing.cdf); i++) {
+            output ^= bytes[i];
+            output *= 1099511628211ull;
         }
     }
+    return output;
+}
+
+// Swaps in the given coefficients on the calling thread for its lifetime, so
+// a table evaluated lazily uses those of the match it belongs to
+class CoefficientScope {
+  private:
+    Model::Coefficients saved;
+
+  public:
+    CoefficientScope(const Model::Coefficients& coefs)
+        : saved(Model::COEFFICIENTS) {
+        Model::COEFFICIENTS = coefs;
+    }
+    ~CoefficientScope() { Model::COEFFICIENTS = saved; }
+};
 
-    // Sample from distribution
-    DismType dism_mode =
-        sample_cdf<DismType>(DISM_MODES, NUM_DISM_MODES, DISM_MODE_DIST);
+//~~~~~~~~~~~~~~ SessionTables implementations ~~~~~~~~~~~~~~//
+SessionTables::SessionTables(BatterCard** batters, BowlerCard** bowlers,
+                             const DeliveryModel* c_model,
+                             const PitchFactors* pitch)
+    : model(c_model), coefs(Model::COEFFICIENTS),
+      matchups(pairings(batters, bowlers, pitch)) {}
 
-    delete[] DISM_MODE_DIST;
-    delete[] DISM_MODES;
-    return dism_mode;
+int SessionTables::session_of(int match_balls) {
+    return std::min(match_balls / SESSION_BALLS, NUM_SESSIONS - 1);
+}
+
+std::shared_ptr<const MatchupTable> SessionTables::get(int session) const {
+    // Only called when an innings starts or moves to a new session, so a lock
+    // costs nothing per ball
+    std::lock_guard<std::mutex> lock(mutex);
+    if (tables[session] != nullptr)
+        return tables[session];
+
+    // Wear and tables both use the coefficients of the match
+    CoefficientScope scope(coefs);
+    PitchFactors start = matchups[0].pitch;
+    PitchFactors worn = Model::MODEL_PITCH_WEAR(start, session);
+    for (int s = 0; s < NUM_SESSIONS; s++) {
+        PitchFactors other = Model::MODEL_PITCH_WEAR(start, s);
+        if (tables[s] != nullptr && other.seam == worn.seam &&
+            other.spin == worn.spin) {
+            tables[session] = tables[s];
+            return tables[session];
+        }
+    }
+
+    std::vector<Matchup> worn_matchups = matchups;
+    for (Matchup& matchup : worn_matchups)
+        matchup.pitch = worn;
+    tables[session] =
+        std::make_shared<const MatchupTable>(worn_matchups, model);
+    return tables[session];
+}
+
+int SessionTables::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    int output = 0;
+    for (int s = 0; s < NUM_SESSIONS; s++) {
+        bool is_new = tables[s] != nullptr;
+        for (int t = 0; t < s && is_new; t++)
+            is_new = tables[t] != tables[s];
+        output += is_new;
+    }
+    return output;
+}
+
+//~~~~~~~~~~~~~~ SituationTable implementations ~~~~~~~~~~~~~~//
+// Upper bounds of each bucket but the last: overs bowled with the ball, balls
+// faced by the batter and required rate, with a bucket for each day of play
+static const int AGE_BOUNDS[3] = {10 * 6, 30 * 6, 60 * 6};
+static const int FACED_BOUNDS[3] = {10, 30, 100};
+static const double RATE_BOUNDS[4] = {2, 3, 4, 5};
+static const int BALLS_PER_DAY = 90 * 6;
+
+// Representative value of each bucket
+static const int AGE_VALUES[4] = {5 * 6, 20 * 6, 45 * 6, 70 * 6};
+static const int FACED_VALUES[4] = {5, 20, 60, 150};
+static const double RATE_VALUES[5] = {1.5, 2.5, 3.5, 4.5, 6};
+
+// Index of the first bound greater than the value
+template <class T> static int bucket_of(T value, const T* bounds, int n) {
+    int output = 0;
+    while (output < n && value >= bounds[output])
+        output++;
+    return output;
+}
+
+SituationTable::SituationTable(BatterCard** batters, BowlerCard** bowlers,
+                               const DeliveryModel* c_model,
+                               const PitchFactors* pitch)
+    : model(c_model), coefs(Model::COEFFICIENTS),
+      matchups(pairings(batters, bowlers, pitch)) {
+    for (int b = 0; b < 4 * NUM_BUCKETS; b++)
+        buckets[b].store(nullptr, std::memory_order_relaxed);
+}
+
+int SituationTable::bucket(const MatchStats& situation) {
+    int age = bucket_of(situation.ball_age, AGE_BOUNDS, AGE_BUCKETS - 1);
+    int faced = bucket_of(situation.bat_balls, FACED_BOUNDS, FACED_BUCKETS - 1);
+    int rate = bucket_of(situation.req_rate, RATE_BOUNDS, RATE_BUCKETS - 1);
+    int day = std::min(situation.match_balls / BALLS_PER_DAY, DAY_BUCKETS - 1);
+    return ((age * FACED_BUCKETS + faced) * RATE_BUCKETS + rate) * DAY_BUCKETS +
+           day;
+}
+
+MatchStats SituationTable::representative(int bucket, int innings) {
+    MatchStats output = {};
+    output.innings = innings;
+    output.match_balls = (bucket % DAY_BUCKETS) * BALLS_PER_DAY +
+                         BALLS_PER_DAY / 2;
+    bucket /= DAY_BUCKETS;
+    output.req_rate = innings == 4 ? RATE_VALUES[bucket % RATE_BUCKETS] : 0;
+    bucket /= RATE_BUCKETS;
+    output.bat_balls = FACED_VALUES[bucket % FACED_BUCKETS];
+    output.ball_age = AGE_VALUES[bucket / FACED_BUCKETS];
+    return output;
+}
+
+const DeliveryDists& SituationTable::get(int bat, int bowl,
+                                         const MatchStats& situation) {
+    int innings = std::clamp(situation.innings, 1, 4);
+    int b = bucket(situation);
+    int slot = (innings - 1) * NUM_BUCKETS + b;
+    Bucket* dists = buckets[slot].load(std::memory_order_acquire);
+    if (dists != nullptr) {
+        const DeliveryDists* output =
+            dists->dists[bat * 11 + bowl].load(std::memory_order_acquire);
+        if (output != nullptr)
+            return *output;
+    }
+    return fill(bat, bowl, innings, b);
+}
+
+const DeliveryDists& SituationTable::fill(int bat, int bowl, int innings,
+                                          int b) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::atomic<Bucket*>& bucket_slot =
+        buckets[(innings - 1) * NUM_BUCKETS + b];
+    Bucket* dists = bucket_slot.load(std::memory_order_relaxed);
+    if (dists == nullptr) {
+        dists = &bucket_store.emplace_back();
+        for (int m = 0; m < 11 * 11; m++)
+            dists->dists[m].store(nullptr, std::memory_order_relaxed);
+        bucket_slot.store(dists, std::memory_order_release);
+    }
+
+    std::atomic<const DeliveryDists*>& slot = dists->dists[bat * 11 + bowl];
+    const DeliveryDists* existing = slot.load(std::memory_order_relaxed);
+    if (existing != nullptr)
+        return *existing;
+
+    DeliveryDists& output = dists_store.emplace_back();
+    Matchup matchup = matchups[bat * 11 + bowl];
+    matchup.situation = representative(b, innings);
+    matchup.pitch = Model::MODEL_PITCH_WEAR(
+        matchup.pitch,
+        SessionTables::session_of(matchup.situation.match_balls));
+    CoefficientScope scope(coefs);
+    model->evaluate(&matchup, 1, output.cdf);
+    derive_dists(output);
+    slot.store(&output, std::memory_order_release);
+    return output;
+}
+
+int SituationTable::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return dists_store.size();
 }
-} // namespace Model
@@ -0,0 +1,156 @@
+#include "testmatch/params.hpp"
+
+#include "testmatch/cards.hpp"
+#include "testmatch/matchtime.hpp"
+#include "testmatch/models.hpp"
+#include "testmatch/simulation.hpp"
+
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//~~~~~~~~~~~~~~ ParamRegistry implementations ~~~~~~~~~~~~~~//
+std::vector<ParamRegistry::Entry>& ParamRegistry::entries() {
+    static std::vector<Entry> output = [] {
+        std::vector<Entry> reg;
+        auto add = [&reg](std::string name, std::function<double*()> locate) {
+            reg.push_back({name, locate, *locate(), nullptr});
+        };
+
+        add("fatigue.mean_pace", [] { return &Fatigue::MEAN_PACE_FATIGUE; });
+        add("fatigue.mean_spin", [] { return &Fatigue::MEAN_SPIN_FATIGUE; });
+        add("fatigue.extra_pace_penalty",
+            [] { return &Fatigue::EXTRA_PACE_PENALTY; });
+        add("fatigue.var_pace", [] { return &Fatigue::VAR_PACE_FATIGUE; });
+        add("fatigue.var_spin", [] { return &Fatigue::VAR_SPIN_FATIGUE; });
+        add("bowling.inflation_factor",
+            [] { return &BowlerCard::INFLATION_FACTOR; });
+        add("bowling.take_off_midpoint",
+            [] { return &BowlingManager::TAKE_OFF_MIDPOINT; });
+        add("bowling.take_off_rate",
+            [] { return &BowlingManager::TAKE_OFF_RATE; });
+        add("fielding.wk_catch_prob",
+            [] { return &FieldingManager::C_WK_PROB; });
+        add("time.pace_mean_dur", [] { return &MatchTime::PACE_MEANDUR; });
+        add("time.spin_mean_dur", [] { return &MatchTime::SPIN_MEANDUR; });
+        add("time.run_dur", [] { return &MatchTime::RUN_DUR; });
+
+        // Coefficients take their defaults from the published coefficients,
+        // which may be replaced by a fitted coefficient file
+        using Table = double* (*)(Model::Coefficients&);
+        auto add_coefficient = [&reg](std::string name, Table table, int i) {
+            reg.push_back(
+                {name, [table, i] { return &table(Model::COEFFICIENTS)[i]; },
+                 0, [table, i] {
+                     Model::Coefficients coefs =
+                         *Model::published_coefficients();
+                     return table(coefs)[i];
+                 }});
+        };
+        auto add_table = [&add_coefficient](std::string name, int n,
+                                            Table table) {
+            // The first entry of each table is always zero, so is not
+            // registered
+            for (int i = 1; i < n; i++)
+                add_coefficient(name + "." + std::to_string(i), table, i);
+        };
+        add_table("delivery.pace_cdf", 21,
+                  [](Model::Coefficients& c) { return c.pace_cdf; });
+        add_table("delivery.spin_cdf", 21,
+                  [](Model::Coefficients& c) { return c.spin_cdf; });
+        add_table("dismissal.pace_cdf", 6,
+                  [](Model::Coefficients& c) { return c.pace_dism_cdf; });
+        add_table("dismissal.spin_cdf", 6,
+                  [](Model::Coefficients& c) { return c.spin_dism_cdf; });
+
+        Table toss = [](Model::Coefficients& c) { return c.toss_elect; };
+        add_coefficient("toss.field_prob_seam", toss, 0);
+        add_coefficient("toss.field_prob_spin", toss, 1);
+        Table follow_on = [](Model::Coefficients& c) { return c.follow_on; };
+        add_coefficient("follow_on.boxcox_lambda", follow_on, 0);
+        add_coefficient("follow_on.intercept", follow_on, 1);
+        add_coefficient("follow_on.slope", follow_on, 2);
+        Table pitch = [](Model::Coefficients& c) { return c.pitch; };
+        add_coefficient("pitch.wkt_effect", pitch, 0);
+        add_coefficient("pitch.dism_effect", pitch, 1);
+        add_coefficient("pitch.wear_rate", pitch, 2);
+        return reg;
+    }();
+    return output;
+}
+
+// Build the registry during static initialisation, so the defaults are those
+// of the main thread before any are changed
+static const bool REGISTERED = !ParamRegistry::names().empty();
+
+ParamRegistry::Entry& ParamRegistry::find(const std::string& name) {
+    for (Entry& entry : entries()) {
+        if (entry.name == name)
+            return entry;
+    }
+    throw std::invalid_argument("Unknown model parameter: " + name);
+}
+
+std::vector<std::string> ParamRegistry::names() {
+    std::vector<std::string> output;
+    for (Entry& entry : entries())
+        output.push_back(entry.name);
+    return output;
+}
+
+bool ParamRegistry::has(const std::string& name) {
+    for (Entry& entry : entries()) {
+        if (entry.name == name)
+            return true;
+    }
+    return false;
+}
+
+double ParamRegistry::get(const std::string& name) {
+    return *find(name).locate();
+}
+
+void ParamRegistry::set(const std::string& name, double value) {
+    Entry& entry = find(name);
+    *entry.locate() = value;
+
+    // The thread keeps its own coefficients until reset
+    if (entry.shared_default)
+        Model::pin_coefficients(true);
+}
+
+double ParamRegistry::Entry::get_default() const {
+    return shared_default ? shared_default() : default_value;
+}
+
+double ParamRegistry::get_default(const std::string& name) {
+    return find(name).get_default();
+}
+
+void ParamRegistry::reset() {
+    for (Entry& entry : entries())
+        *entry.locate() = entry.get_default();
+    Model::pin_coefficients(false);
+}
+
+//~~~~~~~~~~~~~~ ParamOverride implementations ~~~~~~~~~~~~~~//
+ParamOverride::ParamOverride(const std::vector<std::string>& c_names,
+                             const std::vector<double>& values)
+    : names(c_names), was_pinned(Model::coefficients_pinned()) {
+    if (values.size() != names.size())
+        throw std::invalid_argument("Parameter override needs " +
+                                    std::to_string(names.size()) + " values");
+
+    // Look every name up before changing anything
+    for (std::string& name : names)
+        saved.push_back(ParamRegistry::get(name));
+    for (unsigned int j = 0; j < names.size(); j++)
+        ParamRegistry::set(names[j], values[j]);
+}
+
+ParamOverride::~ParamOverride() {
+    for (unsigned int j = 0; j < names.size(); j++)
+        ParamRegistry::set(names[j], saved[j]);
+    Model::pin_coefficients(was_pinned);
+}
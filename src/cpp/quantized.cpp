@@ -0,0 +1,353 @@
+#include "testmatch/quantized.hpp"
+
+#include "testmatch/helpers.hpp"
+#include "testmatch/models.hpp"
+#include "testmatch/pregame.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// As for the logit kernel, interpolation is vectorised for AVX2 where the
+// processor supports it
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define QUANT_AVX2
+#include <immintrin.h>
+#endif
+
+static const char QUANT_MAGIC[8] = "TMQUANT";
+static const unsigned int QUANT_VERSION = 1;
+
+static const int NUM_INPUTS = 4;
+static const int NUM_CORNERS = 1 << NUM_INPUTS;
+static const int NUM_OUTCOMES = 22;
+
+// Values stored for each grid point, padded to a whole number of vectors so
+// that vector loads never run past the end of the table
+static const int ROW_SIZE = 24;
+static const double FIXED_SCALE = 65535;
+
+// Number of grid points of each bowling type
+static size_t points_per_type(const QuantizedTableHeader& header) {
+    size_t output = 1;
+    for (int a = 0; a < NUM_INPUTS; a++)
+        output *= header.n_points[a];
+    return output;
+}
+
+static size_t value_size(const QuantizedTableHeader& header) {
+    return header.fixed_point ? sizeof(uint16_t) : sizeof(float);
+}
+
+static size_t values_size(const QuantizedTableHeader& header) {
+    return QuantizedDeliveryModel::NUM_TYPES * points_per_type(header) *
+           ROW_SIZE * value_size(header);
+}
+
+// Weighted sum of the distributions at the corners of a grid cell
+template <class T>
+static void interpolate(const T* values, const size_t* offsets,
+                        const double* weights, int n_corners, double* dist) {
+    double sum[NUM_OUTCOMES] = {0};
+    for (int c = 0; c < n_corners; c++) {
+        const T* cdf = values + offsets[c];
+        for (int k = 0; k < NUM_OUTCOMES; k++)
+            sum[k] += weights[c] * cdf[k];
+    }
+    std::copy(sum, sum + NUM_OUTCOMES, dist);
+}
+
+#ifdef QUANT_AVX2
+// Widened values of a row, four at a time
+__attribute__((target("avx2,fma"))) static inline void
+load_row(const uint16_t* row, __m256d* out) {
+    for (int h = 0; h < ROW_SIZE / 8; h++) {
+        __m256i wide = _mm256_cvtepu16_epi32(
+            _mm_loadu_si128((const __m128i*)(row + 8 * h)));
+        out[2 * h] = _mm256_cvtepi32_pd(_mm256_castsi256_si128(wide));
+        out[2 * h + 1] = _mm256_cvtepi32_pd(_mm256_extracti128_si256(wide, 1));
+    }
+}
+
+__attribute__((target("avx2,fma"))) static inline void
+load_row(const float* row, __m256d* out) {
+    for (int v = 0; v < ROW_SIZE / 4; v++)
+        out[v] = _mm256_cvtps_pd(_mm_loadu_ps(row + 4 * v));
+}
+
+template <class T>
+__attribute__((target("avx2,fma"))) static void
+interpolate_avx2(const T* values, const size_t* offsets,
+                 const double* weights, int n_corners, double* dist) {
+    const int n_vecs = ROW_SIZE / 4;
+    __m256d sum[n_vecs], row[n_vecs];
+    for (int v = 0; v < n_vecs; v++)
+        sum[v] = _mm256_setzero_pd();
+    for (int c = 0; c < n_corners; c++) {
+        load_row(values + offsets[c], row);
+        __m256d weight = _mm256_set1_pd(weights[c]);
+        for (int v = 0; v < n_vecs; v++)
+            sum[v] = _mm256_fmadd_pd(weight, row[v], sum[v]);
+    }
+
+    double output[ROW_SIZE];
+    for (int v = 0; v < n_vecs; v++)
+        _mm256_storeu_pd(&output[4 * v], sum[v]);
+    std::copy(output, output + NUM_OUTCOMES, dist);
+}
+#endif
+
+// Interpolation with the fastest kernel available
+template <class T>
+static void interpolate_any(const T* values, const size_t* offsets,
+                            const double* weights, int n_corners,
+                            double* dist) {
+#ifdef QUANT_AVX2
+    if (avx2_available())
+        return interpolate_avx2(values, offsets, weights, n_corners, dist);
+#endif
+    interpolate(values, offsets, weights, n_corners, dist);
+}
+
+// Inputs of a matchup, with the placeholders of LogitDeliveryModel::features
+// for players without a record, so a bowler who has never taken a wicket is
+// treated as the weakest rather than the strongest
+static void inputs(const Matchup& matchup, double* x) {
+    x[0] = matchup.bat.career_bat_avg > 0 ? matchup.bat.career_bat_avg : 5;
+    x[1] =
+        matchup.bat.career_strike_rate > 0 ? matchup.bat.career_strike_rate
+                                           : 50;
+    x[2] = matchup.bowl.bowl_avg > 0 ? matchup.bowl.bowl_avg : 1000;
+    x[3] = matchup.bowl.strike_rate > 0 ? matchup.bowl.strike_rate : 1000;
+}
+
+//~~~~~~~~~~~~~~ QuantizedDeliveryModel implementations ~~~~~~~~~~~~~~//
+QuantizedDeliveryModel::QuantizedDeliveryModel(const DeliveryModel& source,
+                                               QuantizedTableOptions opts)
+    : mapping(nullptr), mapping_size(0) {
+    QuantizedTableHeader head;
+    memset(&head, 0, sizeof(head));
+    memcpy(head.magic, QUANT_MAGIC, sizeof(head.magic));
+    head.version = QUANT_VERSION;
+    head.fixed_point = opts.fixed_point;
+    head.n_outcomes = Model::NUM_DELIV_OUTCOMES;
+    head.n_types = NUM_TYPES;
+    for (int a = 0; a < NUM_INPUTS; a++) {
+        if (opts.n_points[a] < 2 || opts.low[a] <= 0 ||
+            opts.high[a] <= opts.low[a])
+            throw std::invalid_argument(
+                "Quantized tables need at least two points over a positive "
+                "range for each input.");
+        head.n_points[a] = opts.n_points[a];
+        head.low[a] = opts.low[a];
+        head.high[a] = opts.high[a];
+    }
+    head.pitch_seam = opts.pitch.seam;
+    head.pitch_spin = opts.pitch.spin;
+
+    buffer.assign(sizeof(head) + values_size(head), 0);
+    memcpy(buffer.data(), &head, sizeof(head));
+
+    // Grid points of each input
+    std::vector<double> grid[NUM_INPUTS];
+    for (int a = 0; a < NUM_INPUTS; a++) {
+        double log_step =
+            log(head.high[a] / head.low[a]) / (head.n_points[a] - 1);
+        for (unsigned int i = 0; i < head.n_points[a]; i++)
+            grid[a].push_back(head.low[a] * exp(i * log_step));
+    }
+
+    // Every point of a bowling type in one batch, in the order of the table
+    size_t n_points = points_per_type(head);
+    int n = head.n_outcomes;
+    std::vector<Matchup> matchups(n_points);
+    std::vector<double> dists(n_points * n);
+    std::vector<double> row(ROW_SIZE, 0);
+    char* out = buffer.data() + sizeof(head);
+    for (int t = 0; t < NUM_TYPES; t++) {
+        for (size_t p = 0; p < n_points; p++) {
+            size_t rest = p;
+            double x[NUM_INPUTS];
+            for (int a = NUM_INPUTS - 1; a >= 0; a--) {
+                x[a] = grid[a][rest % head.n_points[a]];
+                rest /= head.n_points[a];
+            }
+
+            Matchup& matchup = matchups[p];
+            matchup = {};
+            matchup.bat.career_bat_avg = x[0];
+            matchup.bat.career_strike_rate = x[1];
+            matchup.bat.bat_arm = right;
+            matchup.bowl.bowl_avg = x[2];
+            matchup.bowl.strike_rate = x[3];
+            matchup.bowl.bowl_arm = left;
+            matchup.bowl.bowl_type = (BowlType)t;
+            matchup.pitch = opts.pitch;
+        }
+        source.evaluate(matchups.data(), n_points, dists.data());
+
+        for (size_t p = 0; p < n_points; p++) {
+            std::copy(&dists[p * n], &dists[p * n] + n, row.begin());
+            size_t offset = (t * n_points + p) * ROW_SIZE;
+            for (int k = 0; k < ROW_SIZE; k++) {
+                double value = std::clamp(row[k], 0.0, 1.0);
+                if (head.fixed_point)
+                    ((uint16_t*)out)[offset + k] =
+                        (uint16_t)std::lround(value * FIXED_SCALE);
+                else
+                    ((float*)out)[offset + k] = (float)value;
+            }
+        }
+    }
+
+    attach(buffer.data(), buffer.size());
+}
+
+QuantizedDeliveryModel::QuantizedDeliveryModel(std::string path)
+    : mapping(nullptr), mapping_size(0) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Unable to open quantized table: " + path);
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw std::runtime_error("Unable to read quantized table: " + path);
+    }
+    mapping_size = st.st_size;
+    mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        throw std::runtime_error("Unable to map quantized table: " + path);
+    }
+
+    try {
+        attach((const char*)mapping, mapping_size);
+    } catch (...) {
+        munmap(mapping, mapping_size);
+        throw;
+    }
+}
+
+void QuantizedDeliveryModel::attach(const char* data, size_t size) {
+    header = (const QuantizedTableHeader*)data;
+    if (size < sizeof(QuantizedTableHeader) ||
+        memcmp(header->magic, QUANT_MAGIC, sizeof(QUANT_MAGIC)) != 0)
+        throw std::runtime_error("Not a quantized table file.");
+    if (header->version != QUANT_VERSION)
+        throw std::runtime_error("Unsupported quantized table version.");
+    if (header->n_outcomes != (unsigned int)Model::NUM_DELIV_OUTCOMES ||
+        header->n_outcomes != NUM_OUTCOMES ||
+        header->n_types != NUM_TYPES)
+        throw std::runtime_error(
+            "Quantized table does not match the delivery outcomes.");
+    for (int a = 0; a < NUM_INPUTS; a++) {
+        if (header->n_points[a] < 2)
+            throw std::runtime_error("Quantized table has an empty grid.");
+    }
+    if (size != sizeof(QuantizedTableHeader) + values_size(*header))
+        throw std::runtime_error("Quantized table file is truncated.");
+
+    values = data + sizeof(QuantizedTableHeader);
+    size_t stride = ROW_SIZE;
+    for (int a = NUM_INPUTS - 1; a >= 0; a--) {
+        log_low[a] = log(header->low[a]);
+        scale[a] = (header->n_points[a] - 1) / log(header->high[a] /
+                                                   header->low[a]);
+        strides[a] = stride;
+        stride *= header->n_points[a];
+    }
+
+    // Corners are numbered with a bit for each input, the first input
+    // highest, in the order of the weights built by evaluate()
+    for (int corner = 0; corner < NUM_CORNERS; corner++) {
+        corner_offsets[corner] = 0;
+        for (int a = 0; a < NUM_INPUTS; a++) {
+            if ((corner >> (NUM_INPUTS - 1 - a)) & 1)
+                corner_offsets[corner] += strides[a];
+        }
+    }
+}
+
+void QuantizedDeliveryModel::save(std::string path) const {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+        throw std::runtime_error("Unable to write quantized table: " + path);
+
+    file.write((const char*)header, sizeof(QuantizedTableHeader));
+    file.write((const char*)values, values_size(*header));
+    if (!file)
+        throw std::runtime_error("Unable to write quantized table: " + path);
+}
+
+const QuantizedTableHeader& QuantizedDeliveryModel::get_header() const {
+    return *header;
+}
+
+size_t QuantizedDeliveryModel::size() const {
+    return sizeof(QuantizedTableHeader) + values_size(*header);
+}
+
+void QuantizedDeliveryModel::evaluate(const Matchup* matchups, int n,
+                                      double* output) const {
+    size_t type_stride = points_per_type(*header) * ROW_SIZE;
+
+    for (int m = 0; m < n; m++) {
+        // Lowest corner of the surrounding cell, and the weight of each
+        // corner, doubling the number of corners with each input
+        double x[NUM_INPUTS];
+        inputs(matchups[m], x);
+        size_t lowest = matchups[m].bowl.bowl_type * type_stride;
+        double weights[NUM_CORNERS];
+        weights[0] = header->fixed_point ? 1 / FIXED_SCALE : 1;
+        for (int a = 0; a < NUM_INPUTS; a++) {
+            int n_grid = header->n_points[a];
+            double pos = x[a] > 0 ? (log(x[a]) - log_low[a]) * scale[a] : 0;
+            pos = std::clamp(pos, 0.0, (double)(n_grid - 1));
+            int index = std::min((int)pos, n_grid - 2);
+            double frac = pos - index;
+            lowest += index * strides[a];
+
+            for (int c = (1 << a) - 1; c >= 0; c--) {
+                weights[2 * c + 1] = weights[c] * frac;
+                weights[2 * c] = weights[c] * (1 - frac);
+            }
+        }
+
+        // Corners with any weight, e.g. only one for a point on the grid
+        size_t offsets[NUM_CORNERS];
+        double used[NUM_CORNERS];
+        int n_corners = 0;
+        for (int c = 0; c < NUM_CORNERS; c++) {
+            if (weights[c] != 0) {
+                offsets[n_corners] = lowest + corner_offsets[c];
+                used[n_corners] = weights[c];
+                n_corners++;
+            }
+        }
+
+        double* dist = output + m * NUM_OUTCOMES;
+        if (header->fixed_point)
+            interpolate_any((const uint16_t*)values, offsets, used, n_corners,
+                            dist);
+        else
+            interpolate_any((const float*)values, offsets, used, n_corners,
+                            dist);
+    }
+}
+
+QuantizedDeliveryModel::~QuantizedDeliveryModel() {
+    if (mapping != nullptr)
+        munmap(mapping, mapping_size);
+}
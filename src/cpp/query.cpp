@@ -0,0 +1,210 @@
+#include "testmatch/query.hpp"
+
+#include "testmatch/cards.hpp"
+#include "testmatch/simulation.hpp"
+#include "testmatch/team.hpp"
+
+#include <cmath>
+#include <functional>
+#include <string>
+
+//~~~~~~~~~~~~~~ MatchQuery implementations ~~~~~~~~~~~~~~//
+MatchQuery::MatchQuery(std::string c_name, std::function<int(Match&)> c_rule,
+                       bool c_by_delivery)
+    : name(c_name), rule(c_rule), by_delivery(c_by_delivery) {}
+
+std::string MatchQuery::get_name() const { return name; }
+
+bool MatchQuery::is_by_delivery() const { return by_delivery; }
+
+int MatchQuery::settle(Match& match) const {
+    int answer = rule(match);
+    if (answer == UNSETTLED && match.get_result() != nullptr)
+        return 0;
+    return answer;
+}
+
+MatchQuery MatchQuery::operator&&(const MatchQuery& rhs) const {
+    std::function<int(Match&)> a = rule, b = rhs.rule;
+    return MatchQuery(
+        "(" + name + " and " + rhs.name + ")",
+        [a, b](Match& match) {
+            int x = a(match);
+            if (x == 0)
+                return 0;
+            int y = b(match);
+            if (y == 0)
+                return 0;
+            return x == 1 && y == 1 ? 1 : UNSETTLED;
+        },
+        by_delivery || rhs.by_delivery);
+}
+
+MatchQuery MatchQuery::operator||(const MatchQuery& rhs) const {
+    std::function<int(Match&)> a = rule, b = rhs.rule;
+    return MatchQuery(
+        "(" + name + " or " + rhs.name + ")",
+        [a, b](Match& match) {
+            int x = a(match);
+            if (x == 1)
+                return 1;
+            int y = b(match);
+            if (y == 1)
+                return 1;
+            return x == 0 && y == 0 ? 0 : UNSETTLED;
+        },
+        by_delivery || rhs.by_delivery);
+}
+
+MatchQuery MatchQuery::operator!() const {
+    std::function<int(Match&)> a = rule;
+    return MatchQuery(
+        "not " + name,
+        [a](Match& match) {
+            int x = a(match);
+            return x == UNSETTLED ? UNSETTLED : 1 - x;
+        },
+        by_delivery);
+}
+
+MatchQuery MatchQuery::team_runs_at_least(Team* team, int team_inns,
+                                          int runs) {
+    std::string name = team->name + " score " + std::to_string(runs) +
+                       "+ in innings " + std::to_string(team_inns);
+    return MatchQuery(name, [team, team_inns, runs](Match& match) {
+        // Find the innings, if it has started
+        Innings* inns = nullptr;
+        int count = 0;
+        for (int i = 0; i < match.get_num_innings(); i++) {
+            Innings* candidate = match.get_innings(i);
+            if (candidate->get_bat_team() == team && ++count == team_inns) {
+                inns = candidate;
+                break;
+            }
+        }
+
+        if (inns != nullptr && inns->get_team_score() >= runs)
+            return 1;
+        if (match.get_result() != nullptr ||
+            (inns != nullptr && !inns->get_is_open()))
+            return 0;
+        return UNSETTLED;
+    });
+}
+
+MatchQuery MatchQuery::player_runs_at_least(Player* player, int runs) {
+    std::string name =
+        player->get_full_name() + " scores " + std::to_string(runs) + "+";
+    return MatchQuery(name, [player, runs](Match& match) {
+        int batted = 0;
+        bool can_bat = false;
+        for (int i = 0; i < match.get_num_innings(); i++) {
+            Innings* inns = match.get_innings(i);
+            BatterCard** batters = inns->get_batters();
+            for (int j = 0; j < 11; j++) {
+                if (batters[j]->get_player_ptr() != player)
+                    continue;
+
+                batted++;
+                if (batters[j]->get_sim_stats().runs >= runs)
+                    return 1;
+                if (inns->get_is_open() && !batters[j]->is_out())
+                    can_bat = true;
+                break;
+            }
+        }
+
+        // Out of innings once out (or the innings closed) in the second
+        if (match.get_result() != nullptr || (batted == 2 && !can_bat))
+            return 0;
+        return UNSETTLED;
+    });
+}
+
+MatchQuery MatchQuery::wins(Team* team) {
+    // The result is only decided when an innings closes
+    return MatchQuery(
+        team->name + " win",
+        [team](Match& match) {
+            MatchResult* result = match.get_result();
+            if (result == nullptr)
+                return UNSETTLED;
+            return result->get_winner() == team ? 1 : 0;
+        },
+        false);
+}
+
+//~~~~~~~~~~~~~~ QueryResult implementations ~~~~~~~~~~~~~~//
+QueryResult::QueryResult(std::string c_name)
+    : name(c_name), stratified(false), innings(0) {
+    for (int s = 0; s < 4; s++) {
+        n_sims[s] = 0;
+        n_true[s] = 0;
+        stratum_weights[s] = 0.25;
+    }
+}
+
+QueryResult& QueryResult::operator+=(const QueryResult& rhs) {
+    for (int s = 0; s < 4; s++) {
+        n_sims[s] += rhs.n_sims[s];
+        n_true[s] += rhs.n_true[s];
+    }
+    innings += rhs.innings;
+    return *this;
+}
+
+std::string QueryResult::get_name() { return name; }
+
+unsigned int QueryResult::get_n_sims() {
+    return n_sims[0] + n_sims[1] + n_sims[2] + n_sims[3];
+}
+
+unsigned int QueryResult::get_n_true() {
+    return n_true[0] + n_true[1] + n_true[2] + n_true[3];
+}
+
+double QueryResult::mean_innings() {
+    unsigned int total = get_n_sims();
+    return total > 0 ? (double)innings / total : 0;
+}
+
+double QueryResult::prob() {
+    if (!stratified) {
+        unsigned int total = get_n_sims();
+        return total > 0 ? (double)get_n_true() / total : 0;
+    }
+
+    // Weight the strata which were sampled
+    double total_weight = 0, output = 0;
+    for (int s = 0; s < 4; s++) {
+        if (n_sims[s] > 0) {
+            total_weight += stratum_weights[s];
+            output += stratum_weights[s] * n_true[s] / n_sims[s];
+        }
+    }
+    return total_weight > 0 ? output / total_weight : 0;
+}
+
+double QueryResult::std_error() {
+    if (!stratified) {
+        unsigned int total = get_n_sims();
+        double p = prob();
+        return total > 0 ? sqrt(p * (1 - p) / total) : 0;
+    }
+
+    double total_weight = 0;
+    for (int s = 0; s < 4; s++) {
+        if (n_sims[s] > 0)
+            total_weight += stratum_weights[s];
+    }
+
+    double var = 0;
+    for (int s = 0; s < 4; s++) {
+        if (n_sims[s] == 0)
+            continue;
+        double w = stratum_weights[s] / total_weight;
+        double p = (double)n_true[s] / n_sims[s];
+        var += w * w * p * (1 - p) / n_sims[s];
+    }
+    return sqrt(var);
+}
@@ -0,0 +1,397 @@
+#include "testmatch/series.hpp"
+
+#include "testmatch/cards.hpp"
+#include "testmatch/enums.hpp"
+#include "testmatch/helpers.hpp"
+#include "testmatch/simulation.hpp"
+#include "testmatch/team.hpp"
+#include "testmatch/workers.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Columns of the result of each match: home win, away win, draw and tie
+static const int NUM_MATCH_RESULTS = 4;
+
+// Column of a match result, from the point of view of the home team
+static int result_column(MatchResult* result, Team* home_team) {
+    switch (result->get_type()) {
+    case draw:
+        return 2;
+    case tie:
+        return 3;
+    default:
+        return result->get_winner() == home_team ? 0 : 1;
+    }
+}
+
+//~~~~~~~~~~~~~~ SeriesResult implementations ~~~~~~~~~~~~~~//
+SeriesResult::SeriesResult(const Series& series)
+    : home_team(series.home_team), away_team(series.away_team),
+      n_matches(series.venues.size()), n_sims(0),
+      scorelines((n_matches + 1) * (n_matches + 1), 0),
+      match_results(n_matches * NUM_MATCH_RESULTS, 0) {}
+
+void SeriesResult::record(const std::vector<MatchResult*>& results) {
+    unsigned int wins[2] = {0, 0};
+    for (unsigned int j = 0; j < n_matches; j++) {
+        int column = result_column(results[j], home_team);
+        match_results[j * NUM_MATCH_RESULTS + column]++;
+        if (column < 2)
+            wins[column]++;
+    }
+
+    scorelines[wins[0] * (n_matches + 1) + wins[1]]++;
+    n_sims++;
+}
+
+SeriesResult& SeriesResult::operator+=(const SeriesResult& rhs) {
+    n_sims += rhs.n_sims;
+    for (unsigned int s = 0; s < scorelines.size(); s++)
+        scorelines[s] += rhs.scorelines[s];
+    for (unsigned int m = 0; m < match_results.size(); m++)
+        match_results[m] += rhs.match_results[m];
+    return *this;
+}
+
+Team* SeriesResult::get_home_team() { return home_team; }
+
+Team* SeriesResult::get_away_team() { return away_team; }
+
+unsigned int SeriesResult::get_n_matches() { return n_matches; }
+
+unsigned int SeriesResult::get_n_sims() { return n_sims; }
+
+double SeriesResult::scoreline_prob(unsigned int home_wins,
+                                    unsigned int away_wins) {
+    if (n_sims == 0 || home_wins + away_wins > n_matches)
+        return 0;
+    return (double)scorelines[home_wins * (n_matches + 1) + away_wins] /
+           n_sims;
+}
+
+double SeriesResult::win_prob(Team* team) {
+    double output = 0;
+    for (unsigned int h = 0; h <= n_matches; h++) {
+        for (unsigned int a = 0; h + a <= n_matches; a++) {
+            if ((team == home_team && h > a) || (team == away_team && a > h))
+                output += scoreline_prob(h, a);
+        }
+    }
+    return output;
+}
+
+double SeriesResult::drawn_prob() {
+    double output = 0;
+    for (unsigned int h = 0; 2 * h <= n_matches; h++)
+        output += scoreline_prob(h, h);
+    return output;
+}
+
+double SeriesResult::mean_wins(Team* team) {
+    double output = 0;
+    for (unsigned int j = 0; j < n_matches; j++)
+        output += match_win_prob(j, team);
+    return output;
+}
+
+double SeriesResult::match_win_prob(unsigned int i, Team* team) {
+    if (n_sims == 0 || i >= n_matches ||
+        (team != home_team && team != away_team))
+        return 0;
+    int column = team == home_team ? 0 : 1;
+    return (double)match_results[i * NUM_MATCH_RESULTS + column] / n_sims;
+}
+
+double SeriesResult::match_result_prob(unsigned int i, ResultType type) {
+    if (n_sims == 0 || i >= n_matches)
+        return 0;
+
+    unsigned int* counts = &match_results[i * NUM_MATCH_RESULTS];
+    if (type == draw)
+        return (double)counts[2] / n_sims;
+    if (type == tie)
+        return (double)counts[3] / n_sims;
+
+    // Wins of every kind, by either team
+    return (double)(counts[0] + counts[1]) / n_sims;
+}
+
+std::string SeriesResult::print() {
+    std::stringstream output;
+    output << std::fixed << std::setprecision(3);
+
+    output << home_team->name << " v " << away_team->name << ", "
+           << n_matches << " matches\n"
+           << home_team->name << " win: " << win_prob(home_team) << "\n"
+           << away_team->name << " win: " << win_prob(away_team) << "\n"
+           << "Drawn: " << drawn_prob() << "\n";
+
+    // Scorelines from most to least likely
+    std::vector<unsigned int> order(scorelines.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [this](unsigned int a, unsigned int b) {
+                         return scorelines[a] > scorelines[b];
+                     });
+
+    output << "Scoreline   Prob\n";
+    for (unsigned int s : order) {
+        if (scorelines[s] == 0)
+            break;
+        output << s / (n_matches + 1) << "-" << s % (n_matches + 1) << "   "
+               << (double)scorelines[s] / n_sims << "\n";
+    }
+    return output.str();
+}
+
+//~~~~~~~~~~~~~~ Standing implementations ~~~~~~~~~~~~~~//
+Standing::Standing(Team* c_team, unsigned int n_teams)
+    : team(c_team), n_sims(0), total_points(0), total_pct(0),
+      positions(n_teams, 0) {}
+
+void Standing::record(double points, double pct, unsigned int position) {
+    n_sims++;
+    total_points += points;
+    total_pct += pct;
+    positions[position]++;
+}
+
+Standing& Standing::operator+=(const Standing& rhs) {
+    n_sims += rhs.n_sims;
+    total_points += rhs.total_points;
+    total_pct += rhs.total_pct;
+    for (unsigned int p = 0; p < positions.size(); p++)
+        positions[p] += rhs.positions[p];
+    return *this;
+}
+
+Team* Standing::get_team() { return team; }
+
+double Standing::mean_points() {
+    return n_sims > 0 ? total_points / n_sims : 0;
+}
+
+double Standing::mean_pct() { return n_sims > 0 ? total_pct / n_sims : 0; }
+
+double Standing::position_prob(unsigned int position) {
+    if (n_sims == 0 || position >= positions.size())
+        return 0;
+    return (double)positions[position] / n_sims;
+}
+
+double Standing::top_prob(unsigned int n_places) {
+    double output = 0;
+    for (unsigned int p = 0; p < n_places && p < positions.size(); p++)
+        output += position_prob(p);
+    return output;
+}
+
+//~~~~~~~~~~~~~~ TournamentResult implementations ~~~~~~~~~~~~~~//
+TournamentResult::TournamentResult(const std::vector<Series>& fixtures)
+    : n_sims(0) {
+    std::vector<Team*> teams;
+    for (const Series& s : fixtures) {
+        series.emplace_back(s);
+        for (Team* team : {s.home_team, s.away_team}) {
+            if (std::find(teams.begin(), teams.end(), team) == teams.end())
+                teams.push_back(team);
+        }
+    }
+
+    for (Team* team : teams)
+        standings.emplace_back(team, teams.size());
+}
+
+TournamentResult& TournamentResult::operator+=(const TournamentResult& rhs) {
+    n_sims += rhs.n_sims;
+    for (unsigned int k = 0; k < series.size(); k++)
+        series[k] += rhs.series[k];
+    for (unsigned int t = 0; t < standings.size(); t++)
+        standings[t] += rhs.standings[t];
+    return *this;
+}
+
+unsigned int TournamentResult::get_n_sims() { return n_sims; }
+
+std::vector<SeriesResult>& TournamentResult::get_series() { return series; }
+
+std::vector<Standing>& TournamentResult::get_standings() { return standings; }
+
+Standing* TournamentResult::get_standing(Team* team) {
+    for (Standing& standing : standings) {
+        if (standing.get_team() == team)
+            return &standing;
+    }
+    return nullptr;
+}
+
+std::string TournamentResult::print() {
+    std::stringstream output;
+    output << std::fixed << std::setprecision(3);
+
+    output << n_sims << " simulations\n"
+           << "Team   Mean pts   Mean pct   P(1st)   P(top 2)\n";
+    for (Standing& standing : standings) {
+        output << standing.get_team()->name << "   "
+               << standing.mean_points() << "   " << standing.mean_pct()
+               << "   " << standing.position_prob(0) << "   "
+               << standing.top_prob(2) << "\n";
+    }
+
+    for (SeriesResult& s : series)
+        output << "\n" << s.print();
+    return output.str();
+}
+
+//~~~~~~~~~~~~~~ TournamentRunner implementations ~~~~~~~~~~~~~~//
+TournamentRunner::TournamentRunner(std::vector<Series> c_fixtures,
+                                   TournamentOptions c_opts)
+    : fixtures(c_fixtures), opts(c_opts) {
+    if (fixtures.empty())
+        throw std::invalid_argument("A tournament needs at least one series.");
+
+    unsigned int n_matches = 0;
+    for (Series& s : fixtures) {
+        if (s.home_team == nullptr || s.away_team == nullptr ||
+            s.home_team == s.away_team)
+            throw std::invalid_argument("Series " + s.name +
+                                        " needs two different teams.");
+        if (s.venues.empty())
+            throw std::invalid_argument("Series " + s.name +
+                                        " has no matches.");
+        first_match.push_back(n_matches);
+        n_matches += s.venues.size();
+    }
+}
+
+std::unique_ptr<MatchResult>
+TournamentRunner::simulate_match(unsigned int i, unsigned int k,
+                                 unsigned int j) {
+    seed_rng(mix_seed(mix_seed(opts.seed, i), first_match[k] + j));
+
+    Series& series = fixtures[k];
+    Match match({series.venues[j], series.home_team, series.away_team});
+    match.set_tactics(opts.tactics);
+    match.set_delivery_model(opts.delivery_model);
+    match.pregame();
+    match.start_with<SummaryCommentary>();
+    return std::make_unique<MatchResult>(*match.get_result());
+}
+
+void TournamentRunner::simulate_one(unsigned int i, TaskScheduler& scheduler,
+                                    TournamentResult& shard) {
+    // Every match of the replicate is a task of its series, so the matches of
+    // a long series run in parallel with each other. Results are owned here,
+    // so those already finished are freed if another match throws
+    std::vector<std::vector<std::unique_ptr<MatchResult>>> results(
+        fixtures.size());
+    TaskGroup series_group(scheduler);
+    for (unsigned int k = 0; k < fixtures.size(); k++) {
+        series_group.run([this, i, k, &scheduler, &results](unsigned int) {
+            std::vector<std::unique_ptr<MatchResult>>& series = results[k];
+            series.resize(fixtures[k].venues.size());
+
+            TaskGroup match_group(scheduler);
+            for (unsigned int j = 0; j < series.size(); j++) {
+                match_group.run([this, i, k, j, &series](unsigned int) {
+                    series[j] = simulate_match(i, k, j);
+                });
+            }
+            match_group.wait();
+        });
+    }
+    series_group.wait();
+
+    // Points of each team, and points contested
+    unsigned int n_teams = shard.standings.size();
+    std::vector<double> points(n_teams, 0), contested(n_teams, 0);
+    for (unsigned int k = 0; k < fixtures.size(); k++) {
+        std::vector<MatchResult*> series_results;
+        for (std::unique_ptr<MatchResult>& result : results[k])
+            series_results.push_back(result.get());
+        shard.series[k].record(series_results);
+
+        Team* home_team = fixtures[k].home_team;
+        Team* away_team = fixtures[k].away_team;
+        int home = 0, away = 0;
+        for (unsigned int t = 0; t < n_teams; t++) {
+            if (shard.standings[t].get_team() == home_team)
+                home = t;
+            if (shard.standings[t].get_team() == away_team)
+                away = t;
+        }
+
+        const PointsRules& rules = opts.points;
+        for (MatchResult* result : series_results) {
+            switch (result_column(result, home_team)) {
+            case 0:
+                points[home] += rules.win;
+                points[away] += rules.loss;
+                break;
+            case 1:
+                points[home] += rules.loss;
+                points[away] += rules.win;
+                break;
+            case 2:
+                points[home] += rules.draw;
+                points[away] += rules.draw;
+                break;
+            default:
+                points[home] += rules.tie;
+                points[away] += rules.tie;
+            }
+            contested[home] += rules.win;
+            contested[away] += rules.win;
+        }
+    }
+
+    std::vector<double> pct(n_teams, 0);
+    for (unsigned int t = 0; t < n_teams; t++) {
+        if (contested[t] > 0)
+            pct[t] = 100 * points[t] / contested[t];
+    }
+
+    // Rank by percentage, then points
+    std::vector<unsigned int> order(n_teams);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [&pct, &points](unsigned int a, unsigned int b) {
+                         if (pct[a] != pct[b])
+                             return pct[a] > pct[b];
+                         return points[a] > points[b];
+                     });
+    for (unsigned int p = 0; p < n_teams; p++)
+        shard.standings[order[p]].record(points[order[p]], pct[order[p]], p);
+    shard.n_sims++;
+}
+
+TournamentResult TournamentRunner::run(TaskScheduler* scheduler) {
+    std::unique_ptr<TaskScheduler> own;
+    if (scheduler == nullptr) {
+        own = std::make_unique<TaskScheduler>(opts.n_threads);
+        scheduler = own.get();
+    }
+
+    // Each worker records the replicates it finishes in its own shard
+    std::vector<TournamentResult> shards(scheduler->size(),
+                                         TournamentResult(fixtures));
+    TaskGroup group(*scheduler);
+    for (unsigned int i = 0; i < opts.n_sims; i++) {
+        group.run([this, i, scheduler, &shards](unsigned int worker) {
+            simulate_one(i, *scheduler, shards[worker]);
+        });
+    }
+    group.wait();
+
+    TournamentResult output(fixtures);
+    for (TournamentResult& shard : shards)
+        output += shard;
+    return output;
+}
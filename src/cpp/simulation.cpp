@@ -6,19 +6,25 @@
 #include "testmatch/matchtime.hpp"
 #include "testmatch/models.hpp"
 #include "testmatch/pregame.hpp"
+#include "testmatch/tactics.hpp"
 #include "testmatch/team.hpp"
 
+#include <algorithm>
 #include <cmath>
 #include <exception>
 #include <functional>
 #include <iomanip>
+#include <memory>
 #include <sstream>
+#include <stdexcept>
 #include <stdlib.h>
 #include <string>
 #include <utility>
 
 //~~~~~~~~~~~~~~ Parameters ~~~~~~~~~~~~~~//
-double FieldingManager::C_WK_PROB = 0.5;
+thread_local double FieldingManager::C_WK_PROB = 0.5;
+thread_local double BowlingManager::TAKE_OFF_MIDPOINT = 180;
+thread_local double BowlingManager::TAKE_OFF_RATE = 0.2;
 
 //~~~~~~~~~~~~~~ BattingManager implementations ~~~~~~~~~~~~~~//
 BattingManager::BattingManager() {
@@ -48,9 +54,39 @@ BatterCard* BattingManager::next_ordered() {
     }
 }
 
-BatterCard* BattingManager::nightwatch() { return nullptr; }
+BatterCard* BattingManager::nightwatch() {
+    // The last player yet to bat, as long as they are not next in anyway
+    int last = 10;
+    while (last >= 0 && batted[last])
+        last--;
 
-BatterCard* BattingManager::promote_hitter() { return nullptr; }
+    int n_left = 0;
+    for (int i = 0; i < 11; i++)
+        n_left += !batted[i];
+
+    return n_left >= 2 ? cards[last] : nullptr;
+}
+
+BatterCard* BattingManager::promote_hitter() {
+    // The fastest scorer yet to bat, as long as they are not next in anyway
+    BatterCard* best = nullptr;
+    double best_sr = 0;
+    BatterCard* next = nullptr;
+    for (int i = 0; i < 11; i++) {
+        if (batted[i])
+            continue;
+        if (next == nullptr)
+            next = cards[i];
+
+        double sr = cards[i]->get_sim_stats().career_strike_rate;
+        if (best == nullptr || sr > best_sr) {
+            best = cards[i];
+            best_sr = sr;
+        }
+    }
+
+    return best != next ? best : nullptr;
+}
 
 BatterCard* BattingManager::next_in(Innings* inns_obj) {
     // Start of innings
@@ -58,7 +94,26 @@ BatterCard* BattingManager::next_in(Innings* inns_obj) {
         return next_ordered();
     }
 
-    // For now, send next in
+    // Promotions up the order are only made by tactics, which decide by
+    // rollouts whether the alternative does better than the next in order
+    Match* match = inns_obj->match;
+    if (match != nullptr && match->tactics != nullptr) {
+        BatterCard* alt = nullptr;
+        if (match->tactics->is_close_of_day(*match))
+            alt = nightwatch();
+        else if (match->tactics->wants_quick_runs(*match))
+            alt = promote_hitter();
+
+        if (alt != nullptr && match->tactics->send_in(*match, alt)) {
+            for (int i = 0; i < 11; i++) {
+                if (cards[i] == alt)
+                    batted[i] = true;
+            }
+            return alt;
+        }
+    }
+
+    // Otherwise, send next in
     return next_ordered();
 }
 
@@ -73,18 +128,19 @@ void BowlingManager::set_cards(BowlerCard* c_cards[11]) {
         Player* ply_ptr = cards[i]->get_player_ptr();
         if (ply_ptr->get_innings() > 0 &&
             ply_ptr->get_balls_bowled() / ply_ptr->get_innings() < 1) {
-            ply_ptr->inflate_bowl_avg();
+            cards[i]->inflate_bowl_avg();
         }
     }
 }
 
 /**
  *
- * Logistic curve model with midpoint at x = 180 and growth rate k = 0.2
+ * Logistic curve model with midpoint at x = 180 and growth rate k = 0.2 by
+ * default
  *
  */
 double BowlingManager::take_off_prob(double fatigue) {
-    return 1.0 / (1 + exp(-0.2 * (fatigue - 180)));
+    return 1.0 / (1 + exp(-TAKE_OFF_RATE * (fatigue - TAKE_OFF_MIDPOINT)));
 }
 
 BowlerCard* BowlingManager::new_pacer(BowlerCard* ignore1,
@@ -154,7 +210,7 @@ BowlerCard* BowlingManager::end_over(Innings* inns_obj) {
     // bowler increases
     // if (inns_obj->bowl1->get_competency() == 0 &&
     //     inns_obj->bowl2->get_competency() == 0 &&
-    //     (double)rand() / (RAND_MAX) <
+    //     runif() <
     //         1.0 / (1 +
     //                exp(-0.01 *
     //                    (inns_obj->bat_parts[inns_obj->wkts]->get_runs() -
@@ -168,7 +224,7 @@ BowlerCard* BowlingManager::end_over(Innings* inns_obj) {
     double top = take_off_prob(inns_obj->bowl1->get_tiredness());
     if (inns_obj->bowl1->get_competency() != 0)
         top *= 3; // Penalty for being a part time bowler
-    if (((double)rand() / (RAND_MAX)) < top) {
+    if (runif() < top) {
         // Change bowler
         // For now, just get the best full-time bowler
         return any_fulltime(inns_obj->bowl1, inns_obj->bowl2);
@@ -235,8 +291,6 @@ Player* FieldingManager::select_catcher(Player* bowler, DismType dism_type) {
 }
 
 //~~~~~~~~~~~~~~ Innings implementations ~~~~~~~~~~~~~~//
-int Innings::NO_INNS = 0;
-
 // Printing variables
 bool Innings::AUSTRALIAN_STYLE = false;
 std::string Innings::DIVIDER =
@@ -245,13 +299,16 @@ std::string Innings::BUFFER = "   ";
 
 // Constructor
 Innings::Innings(Team* c_team_bat, Team* c_team_bowl, int c_lead,
-                 PitchFactors* c_pitch)
-    : overs(0), balls(0), legal_delivs(0), team_score(0), team_bat(c_team_bat),
-      team_bowl(c_team_bowl), lead(c_lead), wkts(0), pitch(c_pitch),
-      man_field(c_team_bowl->i_wk), is_open(true) {
-
-    NO_INNS++;
-    inns_no = NO_INNS;
+                 PitchFactors* c_pitch, int c_inns_no,
+                 std::shared_ptr<const MatchupTable> c_table,
+                 const DeliveryModel* c_model,
+                 std::shared_ptr<SituationTable> c_situations)
+    : team_bat(c_team_bat), team_bowl(c_team_bowl), inns_no(c_inns_no),
+      is_quiet(true), overs(0), balls(0), legal_delivs(0), team_score(0),
+      lead(c_lead), wkts(0), exp_runs(0), exp_wkts(0), is_open(true),
+      time(nullptr), pitch(c_pitch), table(c_table), situations(c_situations),
+      prior_balls(0), session(0), match(nullptr),
+      man_field(c_team_bowl->i_wk) {
 
     // Create BatterCards/BowlerCards for each player
     batters = create_batting_cards(team_bat);
@@ -262,12 +319,22 @@ Innings::Innings(Team* c_team_bat, Team* c_team_bowl, int c_lead,
     man_bowl.set_cards(bowlers);
     man_field.set_cards(team_bowl->players);
 
+    // Evaluate the delivery model for each pairing, after any inflation of
+    // bowling averages by the bowling manager
+    if (table == nullptr)
+        table = std::make_shared<const MatchupTable>(batters, bowlers,
+                                                     c_model, pitch);
+    if (situations == nullptr && c_model != nullptr &&
+        c_model->uses_situation())
+        situations = std::make_shared<SituationTable>(batters, bowlers,
+                                                      c_model, pitch);
+
     // Get opening batters
     BatterCard* bat1 = man_bat.next_in(this);
     BatterCard* bat2 = man_bat.next_in(this);
 
     // First on strike is chosen randomly
-    if (((double)rand() / (RAND_MAX)) < 0.5) {
+    if (runif() < 0.5) {
         striker = bat1;
         nonstriker = bat2;
     } else {
@@ -289,7 +356,8 @@ Innings::Innings(Team* c_team_bat, Team* c_team_bowl, int c_lead,
         temp_outcomes[i] = Model::DELIV_OUTCOMES.at(i);
 
     // Set-up the first over
-    first_over = last_over = new Over(1);
+    over_log.push_back(std::make_shared<Over>(1));
+    last_over = over_log.back().get();
 
     // Set up partnership for first wicket
     bat_parts[0] =
@@ -301,37 +369,198 @@ Innings::Innings(Team* c_team_bat, Team* c_team_bowl, int c_lead,
     fow = new FOW[10];
 }
 
+Innings::Innings(const Innings& other)
+    : team_bat(other.team_bat), team_bowl(other.team_bowl),
+      inns_no(other.inns_no), is_quiet(other.is_quiet), overs(other.overs),
+      balls(other.balls), legal_delivs(other.legal_delivs),
+      team_score(other.team_score), lead(other.lead), wkts(other.wkts),
+      exp_runs(other.exp_runs), exp_wkts(other.exp_wkts),
+      is_open(other.is_open), time(other.time), pitch(other.pitch),
+      table(other.table), situations(other.situations),
+      prior_balls(other.prior_balls), sessions(other.sessions),
+      session(other.session), match(other.match), man_bat(other.man_bat),
+      man_bowl(other.man_bowl), man_field(other.man_field),
+      extras(other.extras) {
+
+    // Duplicate scorecards, keeping track of which card each pointer refers to
+    batters = new BatterCard*[11];
+    bowlers = new BowlerCard*[11];
+    for (int i = 0; i < 11; i++) {
+        batters[i] = new BatterCard(*other.batters[i]);
+        bowlers[i] = new BowlerCard(*other.bowlers[i]);
+
+        if (other.striker == other.batters[i])
+            striker = batters[i];
+        if (other.nonstriker == other.batters[i])
+            nonstriker = batters[i];
+        if (other.bowl1 == other.bowlers[i])
+            bowl1 = bowlers[i];
+        if (other.bowl2 == other.bowlers[i])
+            bowl2 = bowlers[i];
+
+        man_bat.cards[i] = batters[i];
+        man_bowl.cards[i] = bowlers[i];
+    }
+
+    temp_outcomes = new std::string[Model::NUM_DELIV_OUTCOMES];
+    for (int i = 0; i < Model::NUM_DELIV_OUTCOMES; i++)
+        temp_outcomes[i] = other.temp_outcomes[i];
+
+    // Completed overs are shared, while the current over is duplicated
+    over_log = other.over_log;
+    over_log.back() = std::make_shared<Over>(*other.last_over);
+    last_over = over_log.back().get();
+    events = other.events;
+
+    for (int i = 0; i < 10; i++) {
+        if (other.bat_parts[i] != nullptr)
+            bat_parts[i] = new Partnership(*other.bat_parts[i]);
+        else
+            bat_parts[i] = nullptr;
+    }
+
+    fow = new FOW[10];
+    for (int i = 0; i < 10; i++)
+        fow[i] = other.fow[i];
+}
+
 // Private methods used in simulation process
 void Innings::simulate_delivery() {
     // Pass game information to delivery model
 
-    // Get outcome probabilities
-    double* probs =
-        Model::MODEL_DELIVERY(striker->get_sim_stats(), bowl1->get_sim_stats());
+    // Get outcome probabilities for the current striker and bowler
+    int bat_i = 0, bowl_i = 0;
+    while (batters[bat_i] != striker)
+        bat_i++;
+    while (bowlers[bowl_i] != bowl1)
+        bowl_i++;
+    const DeliveryDists& dists = current_dists(bat_i, bowl_i);
+
+    // Track the model's expectation alongside the realised outcome
+    exp_runs += dists.exp_runs;
+    exp_wkts += dists.exp_wkts;
 
     // Simulate
     std::string outcome = sample_cdf<std::string>(
-        temp_outcomes, Model::NUM_DELIV_OUTCOMES, probs);
-    delete[] probs;
+        temp_outcomes, Model::NUM_DELIV_OUTCOMES, dists.cdf);
+
+    update_state(outcome, nullptr);
+}
+
+const DeliveryDists& Innings::current_dists(int bat_i, int bowl_i) {
+    if (situations != nullptr)
+        return situations->get(bat_i, bowl_i, get_situation());
+    return table->get(bat_i, bowl_i);
+}
+
+template <class Commentary> std::string Innings::step_to_event() {
+    // Declarations are considered at the start of each over
+    if (check_declaration()) {
+        is_open = false;
+        return "dec";
+    }
+
+    int bat_i = 0, bowl_i = 0;
+    while (batters[bat_i] != striker)
+        bat_i++;
+    while (bowlers[bowl_i] != bowl1)
+        bowl_i++;
+
+    // Dot balls change neither the striker nor the bowler, so the run of dot
+    // balls before the next event is geometric. It is cut short at the end
+    // of the over, which is exact as the distribution is memoryless
+    const DeliveryDists& dists = current_dists(bat_i, bowl_i);
+    double p_dot = dists.dot_prob;
+    int n_left = 6 - last_over->get_num_legal_delivs();
+
+    // Likewise where the situation moves to another bucket, so that every
+    // ball in the run has the same distribution
+    if (situations != nullptr) {
+        int bucket = SituationTable::bucket(get_situation());
+        int n_same = 1;
+        while (n_same < n_left &&
+               SituationTable::bucket(get_situation(n_same)) == bucket)
+            n_same++;
+        n_left = n_same;
+    }
+
+    int n_dots = 0;
+    if (p_dot >= 1)
+        n_dots = n_left;
+    else if (p_dot > 0)
+        n_dots = std::min((double)n_left,
+                          floor(log(1 - runif()) / log(p_dot)));
+
+    if (n_dots > 0) {
+        exp_runs += n_dots * dists.exp_runs;
+        exp_wkts += n_dots * dists.exp_wkts;
+        update_dots<Commentary>(n_dots);
+        if (n_dots == n_left)
+            return check_state<Commentary>();
+    }
 
-    std::pair<int, std::string> t_output;
+    exp_runs += dists.exp_runs;
+    exp_wkts += dists.exp_wkts;
+    std::string outcome = sample_cdf<std::string>(
+        temp_outcomes, Model::NUM_DELIV_OUTCOMES, dists.scoring_cdf);
+    update_state<Commentary>(outcome, nullptr);
+    return check_state<Commentary>();
+}
+
+template <class Commentary> void Innings::update_dots(int n) {
+    Player* bowler = bowl1->get_player_ptr();
+    Player* batter = striker->get_player_ptr();
+    bool scorer = bat_parts[wkts]->get_bat2() == batter;
+
+    for (int k = 0; k < n; k++) {
+        balls++;
+        if (Commentary::record) {
+            Ball* new_ball = new Ball;
+            *new_ball = {bowler, batter, "0", true, ""};
+            last_over->add_ball(new_ball);
+        } else {
+            last_over->count_ball(true);
+        }
+        bat_parts[wkts]->add_runs(0, scorer, true);
+
+        if (Commentary::enabled(is_quiet))
+            std::cout << comm_ball(overs, bowler, batter, "0") << std::endl;
+    }
+
+    striker->add_dots(n);
+    bowl1->add_dots(n);
+    legal_delivs += n;
+
+    if (time != nullptr)
+        time->dots(is_slow_bowler(bowler->get_bowl_type()), n);
+
+    if (Commentary::sink && events) {
+        for (int k = 0; k < n; k++)
+            events(*this, {bowler, batter, "0", true, ""});
+    }
+}
 
-    // Create a Ball object
+template <class Commentary>
+void Innings::update_state(std::string outcome, const DismType* dism_ptr) {
     balls++;
-    Ball* new_ball = new Ball;
-    *new_ball = {bowl1->get_player_ptr(), striker->get_player_ptr(), outcome,
-                 true, ""};
+    Player* bowler = bowl1->get_player_ptr();
+    Player* batter = striker->get_player_ptr();
 
     // Update cards
     striker->update_score(outcome);
     bowl1->update_score(outcome);
     bool is_legal = extras.update_score(outcome);
-    new_ball->legal = is_legal;
 
-    // Add ball to over
-    last_over->add_ball(new_ball);
+    // Add a Ball object to the over, or only count the ball
+    if (Commentary::record) {
+        Ball* new_ball = new Ball;
+        *new_ball = {bowler, batter, outcome, is_legal, ""};
+        last_over->add_ball(new_ball);
+    } else {
+        last_over->count_ball(is_legal);
+    }
 
-    if (!is_quiet) {
+    if (Commentary::enabled(is_quiet)) {
         // Print commentary
         std::cout << comm_ball(overs, bowl1->get_player_ptr(),
                                striker->get_player_ptr(), outcome)
@@ -342,9 +571,18 @@ void Innings::simulate_delivery() {
     if (outcome == "W") {
         wkts++;
 
-        // Randomly choose the type of dismissal
-        DismType dism =
-            Model::MODEL_WICKET_TYPE(bowl1->get_player_ptr()->get_bowl_type());
+        // Randomly choose the type of dismissal, unless it is already known
+        DismType dism;
+        if (dism_ptr != nullptr) {
+            dism = *dism_ptr;
+        } else {
+            int bowl_i = 0;
+            while (bowlers[bowl_i] != bowl1)
+                bowl_i++;
+            dism = sample_cdf<DismType>(Model::DISM_MODES_STATIC.data(),
+                                        Model::NUM_DISM_MODES,
+                                        table->dism_cdf(bowl_i));
+        }
 
         // Pick a fielder
         Player* fielder =
@@ -359,27 +597,17 @@ void Innings::simulate_delivery() {
                          (unsigned int)balls};
 
         // Print dismissal
-        std::cout << BUFFER + striker->print_card() << std::endl;
+        if (Commentary::enabled(is_quiet))
+            std::cout << BUFFER + striker->print_card() << std::endl;
 
-        // Update match time
-        // t_output = time->delivery(false, runs);
+        if (time != nullptr)
+            time->wicket(
+                is_slow_bowler(bowl1->get_player_ptr()->get_bowl_type()));
 
         // Determine next batter
-        if (wkts < 10) {
-            striker = man_bat.next_in(this);
-            striker->activate();
-
-            if (!is_quiet) {
-                std::cout << striker->get_player_ptr()->get_full_name()
-                          << +" is the new batter to the crease" << std::endl;
-            }
-
-            // Create new partnership tracker
-            bat_parts[wkts - 1]->end();
-            bat_parts[wkts] = new Partnership(striker->get_player_ptr(),
-                                              nonstriker->get_player_ptr());
-
-        } // All out is checked immediately after with check_state
+        if (wkts < 10)
+            bring_in<Commentary>(man_bat.next_in(this));
+        // All out is checked immediately after with check_state
 
     } else {
         // Update score trackers
@@ -402,15 +630,47 @@ void Innings::simulate_delivery() {
         if (is_rotation)
             swap_batters();
 
-        // Update MatchTime
+        if (time != nullptr)
+            time->delivery(
+                is_slow_bowler(bowl1->get_player_ptr()->get_bowl_type()),
+                runs);
     }
+
+    if (Commentary::sink && events)
+        events(*this, {bowler, batter, outcome, is_legal, ""});
+}
+
+template <class Commentary> void Innings::bring_in(BatterCard* card) {
+    striker = card;
+    striker->activate();
+
+    if (Commentary::enabled(is_quiet)) {
+        std::cout << striker->get_player_ptr()->get_full_name()
+                  << +" is the new batter to the crease" << std::endl;
+    }
+
+    // Create new partnership tracker
+    bat_parts[wkts - 1]->end();
+    bat_parts[wkts] = new Partnership(striker->get_player_ptr(),
+                                      nonstriker->get_player_ptr());
 }
 
 // Check for declaration
 bool Innings::check_declaration() {
-    // TODO: implement declaration checking
-    return false;
-    // AIS: never declare, may lead to some slightly absurd innings
+    // Only the tactics of a match declare, and never in the fourth innings.
+    // Without them, never declare, which may lead to some slightly absurd
+    // innings
+    if (match == nullptr || match->tactics == nullptr || inns_no == 4 ||
+        overs == 0 || last_over->get_num_balls() > 0)
+        return false;
+
+    return match->tactics->declare(*match);
+}
+
+void Innings::declare() {
+    if (!is_open)
+        throw std::logic_error("Innings has already closed.");
+    is_open = false;
 }
 
 /* Possible return values:
@@ -420,7 +680,7 @@ bool Innings::check_declaration() {
  *  dec - batting team has declared
  *
  **/
-std::string Innings::check_state() {
+template <class Commentary> std::string Innings::check_state() {
     // Check for close of innings
     // Match object distinguishes different types of win
     if ((inns_no == 4 && lead > 0)) {
@@ -435,26 +695,22 @@ std::string Innings::check_state() {
         return "allout";
     }
 
-    // Check for declaration
-    if (check_declaration()) {
-        is_open = false;
-        return "dec";
-    };
-
-    // Check for draw
-
-    // Check for end of day
-
-    // Check for end of over
+    // Check for end of over, when any break is taken
     if (last_over->get_num_legal_delivs() == 6) {
-        end_over();
+        end_over<Commentary>();
+
+        // Check for draw
+        if (time != nullptr && time->is_over()) {
+            is_open = false;
+            return "draw";
+        }
     }
 
     return "";
 }
 
-void Innings::end_over() {
-    if (!is_quiet) {
+template <class Commentary> void Innings::end_over() {
+    if (Commentary::enabled(is_quiet)) {
         std::cout << DIVIDER << std::endl
                   << comm_over(last_over) << std::endl
                   << DIVIDER << std::endl;
@@ -462,6 +718,22 @@ void Innings::end_over() {
 
     overs++;
 
+    // Take any break which is due
+    if (time != nullptr && time->end_over() &&
+        Commentary::enabled(is_quiet))
+        std::cout << std::string(*time) << std::endl;
+
+    // The pitch wears from one session to the next
+    if (sessions != nullptr) {
+        int now = time != nullptr
+                      ? time->get_session()
+                      : SessionTables::session_of(prior_balls + legal_delivs);
+        if (now != session) {
+            session = now;
+            table = sessions->get(session);
+        }
+    }
+
     // Apply rest to all bowlers
     for (int i = 0; i < 11; i++) {
         BowlerCard* curr = bowlers[i];
@@ -474,13 +746,12 @@ void Innings::end_over() {
     swap_bowlers();
 
     // Create a new over object
-    Over* new_over = new Over(overs + 1);
-    last_over->set_next(new_over);
-    last_over = new_over;
+    over_log.push_back(std::make_shared<Over>(overs + 1));
+    last_over = over_log.back().get();
 
     // Special case - second over
     if (overs == 1) {
-        if (!is_quiet) {
+        if (Commentary::enabled(is_quiet)) {
             std::cout << "Opening from the other end is " +
                              bowl1->get_player_ptr()->get_full_name() + ".\n";
         }
@@ -488,7 +759,7 @@ void Innings::end_over() {
         // Consult the bowling manager
         BowlerCard* new_bc = man_bowl.end_over(this);
 
-        if (!is_quiet && new_bc != bowl1) {
+        if (Commentary::enabled(is_quiet) && new_bc != bowl1) {
             std::cout << "Change of bowling, " +
                              new_bc->get_player_ptr()->get_full_name() +
                              " into the attack.\n";
@@ -553,11 +824,16 @@ std::string Innings::score() {
 }
 
 std::string Innings::simulate(bool quiet) {
-    is_quiet = quiet;
+    if (quiet)
+        return simulate_with<QuietCommentary>();
+    else
+        return simulate_with<FullCommentary>();
+}
 
-    if (is_quiet) {
-        std::cout << "Simulating innings..." << std::endl;
-    } else {
+template <class Commentary> std::string Innings::simulate_with() {
+    is_quiet = !Commentary::enabled(is_quiet);
+
+    if (Commentary::enabled(is_quiet)) {
         // Pre-innings chatter
         std::cout
             << "Here come the teams...\n"
@@ -575,14 +851,11 @@ std::string Innings::simulate(bool quiet) {
 
     std::string state;
     while (is_open) {
-        // Simulate a single delivery
-        simulate_delivery();
-
-        // Check match state
-        state = check_state();
+        // Simulate up to the next delivery which is not a dot ball
+        state = step_to_event<Commentary>();
     }
 
-    if (!is_quiet) {
+    if (Commentary::enabled(is_quiet)) {
         // Print lead
         std::cout << team_bat->name << " ";
         if (lead > 0)
@@ -596,6 +869,68 @@ std::string Innings::simulate(bool quiet) {
     return state;
 }
 
+std::string Innings::step() {
+    if (check_declaration()) {
+        is_open = false;
+        return "dec";
+    }
+
+    simulate_delivery();
+
+    // Check match state
+    return check_state();
+}
+
+std::string Innings::apply_delivery(std::string outcome) {
+    check_outcome(outcome);
+    update_state(outcome, nullptr);
+    return check_state();
+}
+
+std::string Innings::apply_delivery(std::string outcome, DismType dism) {
+    check_outcome(outcome);
+    update_state(outcome, &dism);
+    return check_state();
+}
+
+void Innings::check_outcome(std::string outcome) {
+    if (!is_open)
+        throw std::logic_error("Innings has already closed.");
+
+    for (int i = 0; i < Model::NUM_DELIV_OUTCOMES; i++) {
+        if (temp_outcomes[i] == outcome)
+            return;
+    }
+    throw std::invalid_argument("Unknown delivery outcome: " + outcome);
+}
+
+// The runtime-configured engine is also used by other translation units, and
+// the public loops are instantiated for every policy
+template void Innings::update_state<>(std::string, const DismType*);
+template void Innings::update_dots<>(int);
+template void Innings::bring_in<>(BatterCard*);
+template std::string Innings::step_to_event<>();
+template std::string Innings::simulate_with<QuietCommentary>();
+template std::string Innings::simulate_with<FullCommentary>();
+template std::string Innings::simulate_with<SummaryCommentary>();
+template std::string Innings::simulate_with<SinkCommentary>();
+template std::string Innings::simulate_with<RuntimeCommentary>();
+
+void Innings::set_event_sink(EventSink c_events) { events = c_events; }
+
+void Innings::set_bowler(Player* player) {
+    for (int i = 0; i < 11; i++) {
+        if (bowlers[i]->get_player_ptr() == player) {
+            if (bowlers[i] == bowl2)
+                bowl2 = bowl1;
+            bowl1 = bowlers[i];
+            return;
+        }
+    }
+    throw std::invalid_argument(player->get_full_name() +
+                                " is not in the bowling team.");
+}
+
 std::string Innings::print() {
     std::string output = "";
 
@@ -681,12 +1016,57 @@ BatterCard** Innings::get_batters() { return batters; }
 
 BowlerCard** Innings::get_bowlers() { return bowlers; }
 
+std::shared_ptr<const MatchupTable> Innings::get_table() { return table; }
+
+int Innings::get_session() { return session; }
+
+std::shared_ptr<SituationTable> Innings::get_situations() {
+    return situations;
+}
+
+MatchStats Innings::get_situation(int dots) {
+    // A new ball is taken as soon as it is due, every 80 overs
+    static const int NEW_BALL = 80 * 6;
+    // Balls in a nominal five days of 90 overs, for the required rate of an
+    // innings without a clock
+    static const int MATCH_LENGTH = 5 * 90 * 6;
+
+    MatchStats output = {};
+    output.innings = inns_no;
+    output.ball_age = (legal_delivs + dots) % NEW_BALL;
+    output.bat_balls = striker->get_sim_stats().balls + dots;
+    output.match_balls = prior_balls + legal_delivs + dots;
+    output.req_rate = 0;
+    if (inns_no == 4) {
+        int balls_left = time != nullptr
+                             ? (int)(time->overs_left() * 6) - dots
+                             : MATCH_LENGTH - output.match_balls;
+        balls_left = std::max(balls_left, 6);
+        output.req_rate = 6.0 * (1 - lead) / balls_left;
+    }
+    return output;
+}
+
+const std::vector<std::shared_ptr<Over>>& Innings::get_overs() {
+    return over_log;
+}
+
 bool Innings::get_is_open() { return is_open; }
 
+int Innings::get_inns_no() { return inns_no; }
+
+int Innings::get_team_score() { return team_score; }
+
+int Innings::get_balls() { return balls; }
+
 int Innings::get_lead() { return lead; }
 
 int Innings::get_wkts() { return wkts; }
 
+double Innings::get_exp_runs() { return exp_runs; }
+
+double Innings::get_exp_wkts() { return exp_wkts; }
+
 Team* Innings::get_bat_team() { return team_bat; }
 
 Team* Innings::get_bowl_team() { return team_bowl; }
@@ -695,15 +1075,15 @@ Team* Innings::get_bowl_team() { return team_bowl; }
 Innings::~Innings() {
     // Delete each dynamically allocated BatterCard and BowlerCard
     for (int i = 0; i < 11; i++) {
-        delete batters[i], bowlers[i];
+        delete batters[i];
+        delete bowlers[i];
     }
+    delete[] batters;
+    delete[] bowlers;
 
     delete[] temp_outcomes;
     delete[] fow;
 
-    // Delete each over iteratively
-    delete_linkedlist<Over>(first_over);
-
     // Delete each partnership
     for (int i = 0; i < 10; i++) {
         if (bat_parts[i] != nullptr)
@@ -716,10 +1096,36 @@ Innings::~Innings() {
 */
 Match::Match(Pregame detail)
     : team1(detail.home_team), team2(detail.away_team), venue(detail.venue),
-      ready(false), inns_i(0) {
+      ready(false), inns_i(0), lead(0), match_balls(0), result(nullptr),
+      tactics(nullptr), model(nullptr) {
+    for (int i = 0; i < 4; i++)
+        inns[i] = nullptr;
+}
+
+Match::Match(const Match& other)
+    : team1(other.team1), team2(other.team2), venue(other.venue),
+      ready(other.ready), toss(other.toss), time(other.time),
+      match_state(other.match_state), inns_i(other.inns_i), lead(other.lead),
+      match_balls(other.match_balls),
+      sessions{other.sessions[0], other.sessions[1]},
+      situations{other.situations[0], other.situations[1]}, result(nullptr),
+      tactics(other.tactics),
+      decisions(other.decisions != nullptr
+                    ? std::make_unique<DecisionCache>(*other.decisions)
+                    : nullptr),
+      model(other.model), events(other.events) {
+    for (int i = 0; i < 4; i++) {
+        if (other.inns[i] != nullptr) {
+            inns[i] = new Innings(*other.inns[i]);
+            inns[i]->match = this;
+            inns[i]->time = &time;
+        } else {
+            inns[i] = nullptr;
+        }
+    }
 
-    // Time object - default constructor to day 1, start time
-    // time = MatchTime();
+    if (other.result != nullptr)
+        result = new MatchResult(*other.result);
 }
 
 void Match::simulate_toss() {
@@ -728,25 +1134,21 @@ void Match::simulate_toss() {
     TossChoice choice;
 
     // Winner of toss is chosen randomly - 0.5 probability either way
-    if ((double)rand() / (RAND_MAX) < 0.5) {
+    if (runif() < 0.5) {
         winner = team1;
         loser = team2;
     } else {
-        winner = team1;
-        loser = team2;
+        winner = team2;
+        loser = team1;
     }
 
-    if ((double)rand() / (RAND_MAX) <
-        Model::MODEL_TOSS_ELECT(venue->pitch_factors->spin)) {
+    if (runif() < Model::MODEL_TOSS_ELECT(venue->pitch_factors->spin)) {
         choice = field;
     } else {
         choice = bat;
     }
 
     toss = {winner, loser, choice};
-
-    // Print toss result
-    std::cout << toss_str() << std::endl;
 }
 
 void Match::change_innings() {
@@ -764,7 +1166,55 @@ void Match::change_innings() {
     }
 
     inns_i++;
-    inns[inns_i] = new Innings(new_bat, new_bowl, lead, venue->pitch_factors);
+    inns[inns_i] = new_innings(new_bat, new_bowl, lead, inns_i + 1);
+}
+
+void Match::prepare_sessions(int k) {
+    if (sessions[k] != nullptr)
+        return;
+
+    // Cards as an innings would have them, after any inflation of bowling
+    // averages by the bowling manager
+    Team* bat_team = k == 0 ? team1 : team2;
+    Team* bowl_team = k == 0 ? team2 : team1;
+    BatterCard** batters = create_batting_cards(bat_team);
+    BowlerCard** bowlers = create_bowling_cards(bowl_team);
+    BowlingManager man_bowl;
+    man_bowl.set_cards(bowlers);
+
+    sessions[k] = std::make_shared<const SessionTables>(
+        batters, bowlers, model, venue->pitch_factors);
+
+    for (int i = 0; i < 11; i++) {
+        delete batters[i];
+        delete bowlers[i];
+    }
+    delete[] batters;
+    delete[] bowlers;
+}
+
+Innings* Match::new_innings(Team* bat_team, Team* bowl_team, int c_lead,
+                            int inns_no) {
+    int k = bat_team == team1 ? 0 : 1;
+    prepare_sessions(k);
+
+    int prior_balls = 0;
+    for (int i = 0; i < inns_no - 1; i++)
+        prior_balls += inns[i]->legal_delivs;
+    int session = time.get_session();
+
+    Innings* output = new Innings(bat_team, bowl_team, c_lead,
+                                  venue->pitch_factors, inns_no,
+                                  sessions[k]->get(session), model,
+                                  situations[k]);
+    output->match = this;
+    output->time = &time;
+    output->events = events;
+    output->prior_balls = prior_balls;
+    output->sessions = sessions[k];
+    output->session = session;
+    situations[k] = output->get_situations();
+    return output;
 }
 
 /**
@@ -777,22 +1227,52 @@ bool Match::DECIDE_FOLLOW_ON(int lead) {
         return false;
     else {
         // Use model to randomly decide whether or not to enforce the follow-on
-        double r = Model::MODEL_FOLLOW_ON(lead);
-        return (double)rand() / (RAND_MAX) < r;
+        double r = PROB_FOLLOW_ON(lead);
+        return runif() < r;
     }
 }
 
+double Match::PROB_FOLLOW_ON(int lead) {
+    return lead < 200 ? 0 : Model::MODEL_FOLLOW_ON(lead);
+}
+
 std::string Match::toss_str() { return std::string(toss); }
 
+double Match::PROB_TOSS(Venue* venue, TossChoice choice) {
+    double p_field = Model::MODEL_TOSS_ELECT(venue->pitch_factors->spin);
+    return 0.5 * (choice == field ? p_field : 1 - p_field);
+}
+
 void Match::pregame() {
+    // Pick up any newly published coefficients before the match starts
+    Model::sync_coefficients();
+
     // Toss
     simulate_toss();
 
+    setup_first_innings();
+}
+
+void Match::pregame(TossResult c_toss) {
+    Model::sync_coefficients();
+
+    // Toss has already been decided
+    toss = c_toss;
+
+    setup_first_innings();
+}
+
+void Match::setup_first_innings() {
+    // Tables of every session of the match, for both batting teams, evaluated
+    // as each session is reached
+    prepare_sessions(0);
+    prepare_sessions(1);
+
     // Set up Innings object
     if (toss.choice == bat)
-        inns[0] = new Innings(toss.winner, toss.loser, 0, venue->pitch_factors);
+        inns[0] = new_innings(toss.winner, toss.loser, 0, 1);
     else if (toss.choice == field)
-        inns[0] = new Innings(toss.loser, toss.winner, 0, venue->pitch_factors);
+        inns[0] = new_innings(toss.loser, toss.winner, 0, 1);
     else
         // Throw exception
         throw(std::invalid_argument("Undefined TossChoice value."));
@@ -800,62 +1280,191 @@ void Match::pregame() {
     ready = true;
 }
 
+bool Match::end_innings(std::string inns_state) {
+    lead = inns[inns_i]->get_lead();
+
+    // Determine if game has been won
+    if (inns_i == 2 && inns_state == "allout" && lead < 0) {
+        // Win by innings
+        result =
+            new MatchResult(win_innings, inns[inns_i]->get_bowl_team(), -lead);
+        return true;
+
+    } else if (inns_i == 3) {
+        // 4th innings scenarios
+        if (inns_state == "allout") {
+
+            if (lead == 0) {
+                // Tie
+                result = new MatchResult(tie);
+            } else {
+                // Bowled out
+                result = new MatchResult(win_bowling,
+                                         inns[inns_i]->get_bowl_team(), -lead);
+            }
+
+        } else if (inns_state == "win") {
+            // Win chasing
+            result = new MatchResult(win_chasing, inns[inns_i]->get_bat_team(),
+                                     10 - inns[inns_i]->get_wkts());
+
+        } else if (inns_state == "draw") {
+            // Draw
+            result = new MatchResult(draw);
+        } else {
+            // Raise an exception, Innings::simulate() has returned
+            // something unknown
+        }
+        return true;
+    } else {
+        // Time may run out during the innings, or at the change of innings
+        time.end_innings();
+        if (inns_state == "draw" || time.is_over()) {
+            result = new MatchResult(draw);
+            return true;
+        }
+
+        // Change innings
+        change_innings();
+        return false;
+    }
+}
+
 void Match::start(bool quiet) {
+    if (quiet)
+        start_with<QuietCommentary>();
+    else
+        start_with<FullCommentary>();
+}
+
+template <class Commentary> void Match::start_with() {
     std::string inns_state;
 
-    while (inns_i < 4) {
-        inns_state = inns[inns_i]->simulate(quiet);
-        lead = inns[inns_i]->get_lead();
+    // Print toss result
+    if (Commentary::enabled(inns[inns_i]->is_quiet))
+        std::cout << toss_str() << std::endl;
+
+    bool over = false;
+    while (!over) {
+        inns_state = inns[inns_i]->simulate_with<Commentary>();
 
-        if (!quiet) {
+        if (Commentary::enabled(inns[inns_i]->is_quiet)) {
             // Print lead
             std::cout << inns[inns_i]->get_bat_team()->name << " ";
-            if (lead > 0)
+            if (inns[inns_i]->get_lead() > 0)
                 std::cout << "lead by ";
             else
                 std::cout << "trail by ";
-            std::cout << std::to_string(abs(lead)) << " runs.\n";
+            std::cout << std::to_string(abs(inns[inns_i]->get_lead()))
+                      << " runs.\n";
         }
 
-        // Determine if game has been won
-        if (inns_i == 2 && inns_state == "allout" && lead < 0) {
-            // Win by innings
-            result = new MatchResult(win_innings, inns[inns_i]->get_bowl_team(),
-                                     -lead);
-            break;
-
-        } else if (inns_i == 3) {
-            // 4th innings scenarios
-            if (inns_state == "allout") {
-
-                if (lead == 0) {
-                    // Tie
-                    result = new MatchResult(tie);
-                } else {
-                    // Bowled out
-                    result = new MatchResult(
-                        win_bowling, inns[inns_i]->get_bowl_team(), -lead);
-                }
-
-            } else if (inns_state == "win") {
-                // Win chasing
-                result =
-                    new MatchResult(win_chasing, inns[inns_i]->get_bat_team(),
-                                    10 - inns[inns_i]->get_wkts());
-
-            } else if (inns_state == "draw") {
-                // Draw
-                result = new MatchResult(draw);
-            } else {
-                // Raise an exception, Innings::simulate() has returned
-                // something unknown
+        over = end_innings(inns_state);
+    }
+}
+
+template void Match::start_with<QuietCommentary>();
+template void Match::start_with<FullCommentary>();
+template void Match::start_with<SummaryCommentary>();
+template void Match::start_with<SinkCommentary>();
+template void Match::start_with<RuntimeCommentary>();
+
+void Match::set_event_sink(EventSink c_events) {
+    events = c_events;
+    for (int i = 0; i < 4; i++) {
+        if (inns[i] != nullptr)
+            inns[i]->events = c_events;
+    }
+}
+
+bool Match::apply_delivery(std::string outcome) {
+    if (result != nullptr)
+        throw std::logic_error("Match is already over.");
+
+    std::string inns_state = inns[inns_i]->apply_delivery(outcome);
+    if (!inns[inns_i]->get_is_open())
+        return end_innings(inns_state);
+    return false;
+}
+
+bool Match::apply_delivery(std::string outcome, DismType dism) {
+    if (result != nullptr)
+        throw std::logic_error("Match is already over.");
+
+    std::string inns_state = inns[inns_i]->apply_delivery(outcome, dism);
+    if (!inns[inns_i]->get_is_open())
+        return end_innings(inns_state);
+    return false;
+}
+
+void Match::declare() {
+    if (result != nullptr)
+        throw std::logic_error("Match is already over.");
+    if (inns_i == 3)
+        throw std::logic_error("The fourth innings cannot be declared.");
+
+    inns[inns_i]->declare();
+    end_innings("dec");
+}
+
+void Match::set_tactics(RolloutTactics* c_tactics) { tactics = c_tactics; }
+
+RolloutTactics* Match::get_tactics() { return tactics; }
+
+void Match::set_delivery_model(const DeliveryModel* c_model) {
+    // Later innings evaluate the new model, rather than reusing tables
+    if (c_model != model) {
+        sessions[0] = nullptr;
+        sessions[1] = nullptr;
+        situations[0] = nullptr;
+        situations[1] = nullptr;
+    }
+    model = c_model;
+}
+
+const DeliveryModel* Match::get_delivery_model() { return model; }
+
+bool Match::advance(std::function<bool(Match&)> until) {
+    if (until && until(*this))
+        return true;
+
+    bool over = result != nullptr;
+    while (!over) {
+        std::string inns_state = inns[inns_i]->step();
+        if (!inns[inns_i]->get_is_open())
+            over = end_innings(inns_state);
+
+        if (until && until(*this))
+            return true;
+    }
+
+    return false;
+}
+
+bool Match::simulate_until(std::function<bool(Match&)> until,
+                           bool by_delivery) {
+    if (until(*this))
+        return true;
+
+    while (result == nullptr) {
+        std::string inns_state;
+        if (by_delivery) {
+            inns_state = inns[inns_i]->step_to_event<QuietCommentary>();
+            if (inns[inns_i]->get_is_open()) {
+                if (until(*this))
+                    return true;
+                continue;
             }
-            break;
         } else {
-            // Change innings
-            change_innings();
+            inns_state = inns[inns_i]->simulate(true);
         }
+
+        end_innings(inns_state);
+        if (until(*this))
+            return true;
     }
+
+    return false;
 }
 
 std::string Match::print_all() {
@@ -870,6 +1479,23 @@ std::string Match::print_all() {
     return output;
 }
 
+// Getters
+Team* Match::get_home_team() { return team1; }
+
+Team* Match::get_away_team() { return team2; }
+
+Venue* Match::get_venue() { return venue; }
+
+int Match::get_num_innings() { return inns_i + 1; }
+
+Innings* Match::get_current_innings() { return inns[inns_i]; }
+
+Innings* Match::get_innings(int i) { return inns[i]; }
+
+MatchResult* Match::get_result() { return result; }
+
+const MatchTime& Match::get_time() { return time; }
+
 Match::~Match() {
     // Delete each innings
     for (int i = 0; i < 4; i++) {
@@ -0,0 +1,81 @@
+#include "testmatch/situation.hpp"
+
+#include "testmatch/helpers.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+static const int BALLS_PER_DAY = 90 * 6;
+
+//~~~~~~~~~~~~~~ SituationDeliveryModel implementations ~~~~~~~~~~~~~~//
+SituationDeliveryModel::SituationDeliveryModel(const DeliveryModel* c_base,
+                                               SituationEffects c_effects)
+    : base(c_base != nullptr ? c_base : DeliveryModel::builtin()),
+      effects(c_effects) {
+    for (int k = 0; k < Model::NUM_DELIV_OUTCOMES; k++) {
+        std::string outcome = Model::DELIV_OUTCOMES[k];
+        is_scoring[k] = outcome.size() == 1 && outcome != "0" &&
+                        outcome != "W";
+    }
+}
+
+void SituationDeliveryModel::multipliers(const Matchup& matchup,
+                                         double* wkt_mult,
+                                         double* runs_mult) const {
+    const MatchStats& situation = matchup.situation;
+    bool is_slow = is_slow_bowler(matchup.bowl.bowl_type);
+
+    double wkt = 1;
+    if (!is_slow)
+        wkt *= 1 + (effects.new_ball - 1) *
+                       exp(-situation.ball_age / (6 * effects.new_ball_overs));
+    wkt *= 1 + (effects.new_batter - 1) *
+                   exp(-situation.bat_balls / effects.new_batter_balls);
+
+    double days = (double)situation.match_balls / BALLS_PER_DAY;
+    wkt *= std::max(
+        1 + (is_slow ? effects.spin_wear : effects.pace_wear) * days, 0.0);
+
+    double runs = 1;
+    if (situation.innings == 4) {
+        double excess = std::max(situation.req_rate - effects.par_rate, 0.0);
+        wkt *= effects.fourth_innings * (1 + effects.chase_wkts * excess);
+        runs *= 1 + effects.chase_runs * excess;
+    }
+
+    *wkt_mult = wkt;
+    *runs_mult = runs;
+}
+
+bool SituationDeliveryModel::uses_situation() const { return true; }
+
+void SituationDeliveryModel::evaluate(const Matchup* matchups, int n,
+                                      double* output) const {
+    int n_outcomes = Model::NUM_DELIV_OUTCOMES;
+    base->evaluate(matchups, n, output);
+
+    double probs[22];
+    for (int m = 0; m < n; m++) {
+        double* dist = output + m * n_outcomes;
+        double wkt_mult, runs_mult;
+        multipliers(matchups[m], &wkt_mult, &runs_mult);
+
+        // Outcomes other than a wicket, reweighted
+        double total = 0;
+        for (int k = 0; k < n_outcomes - 1; k++) {
+            double mult = is_scoring[k] ? runs_mult : 1;
+            probs[k] = (dist[k + 1] - dist[k]) * mult;
+            total += probs[k];
+        }
+        double p_wkt = std::min((1 - dist[n_outcomes - 1]) * wkt_mult, 1.0);
+
+        // Survival shared in proportion to the reweighted outcomes
+        double cumulative = 0;
+        dist[0] = 0;
+        for (int k = 1; k < n_outcomes; k++) {
+            cumulative += probs[k - 1];
+            dist[k] = total > 0 ? cumulative / total * (1 - p_wkt) : 0;
+        }
+    }
+}
@@ -0,0 +1,26 @@
+#include "testmatch/snapshot.hpp"
+
+#include "testmatch/helpers.hpp"
+#include "testmatch/simulation.hpp"
+
+#include <memory>
+#include <stdexcept>
+
+MatchSnapshot::MatchSnapshot(const Match& match)
+    : state(std::make_shared<const Match>(match)),
+      rng(std::make_shared<const RngState>(rng_state())) {}
+
+bool MatchSnapshot::is_empty() const { return state == nullptr; }
+
+Match MatchSnapshot::clone() const {
+    if (is_empty())
+        throw std::logic_error("Cannot clone an empty MatchSnapshot.");
+
+    return Match(*state);
+}
+
+Match MatchSnapshot::resume() const {
+    Match output = clone();
+    rng_state() = *rng;
+    return output;
+}
@@ -0,0 +1,238 @@
+#include "testmatch/splitting.hpp"
+
+#include "testmatch/cards.hpp"
+#include "testmatch/enums.hpp"
+#include "testmatch/helpers.hpp"
+#include "testmatch/pregame.hpp"
+#include "testmatch/simulation.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Whether any innings of the match so far satisfies a condition
+static bool any_innings(Match& match, std::function<bool(Innings*)> pred) {
+    for (int i = 0; i < match.get_num_innings(); i++) {
+        if (pred(match.get_innings(i)))
+            return true;
+    }
+    return false;
+}
+
+// Fourth innings of the match, or nullptr if it has not started
+static Innings* fourth_innings(Match& match) {
+    return match.get_num_innings() == 4 ? match.get_innings(3) : nullptr;
+}
+
+// Total number of deliveries bowled in the match so far
+static int count_deliveries(Match& match) {
+    int output = 0;
+    for (int i = 0; i < match.get_num_innings(); i++)
+        output += match.get_innings(i)->get_balls();
+    return output;
+}
+
+//~~~~~~~~~~~~~~ RareEvent implementations ~~~~~~~~~~~~~~//
+RareEvent RareEvent::tie() {
+    RareEvent output;
+    output.name = "Tie";
+
+    // A tie ends with the chasing team all out, level on runs, so each level
+    // holds at the moment it occurs
+    int wkts[4] = {5, 7, 8, 9};
+    int deficit[4] = {60, 30, 15, 6};
+    for (int k = 0; k < 4; k++) {
+        int w = wkts[k], d = deficit[k];
+        output.levels.push_back([w, d](Match& match) {
+            Innings* inns = fourth_innings(match);
+            return inns != nullptr && inns->get_wkts() >= w &&
+                   inns->get_lead() <= 0 && -inns->get_lead() <= d;
+        });
+    }
+
+    output.event = [](Match& match) {
+        return match.get_result() != nullptr &&
+               match.get_result()->get_type() == ResultType::tie;
+    };
+
+    return output;
+}
+
+RareEvent RareEvent::fourth_innings_chase(int target) {
+    RareEvent output;
+    output.name = std::to_string(target) + "+ fourth innings chase";
+
+    // Target of the chase is one more than the deficit at the start of the
+    // innings
+    auto chasing = [target](Match& match) {
+        Innings* inns = fourth_innings(match);
+        return inns != nullptr &&
+               inns->get_team_score() - inns->get_lead() + 1 >= target;
+    };
+
+    output.levels.push_back(chasing);
+    for (int k = 2; k <= 3; k++) {
+        int runs = k * target / 4;
+        output.levels.push_back([chasing, runs](Match& match) {
+            return chasing(match) &&
+                   fourth_innings(match)->get_team_score() >= runs;
+        });
+    }
+
+    output.event = [chasing](Match& match) {
+        return chasing(match) && match.get_result() != nullptr &&
+               match.get_result()->get_type() == win_chasing;
+    };
+
+    return output;
+}
+
+RareEvent RareEvent::bowled_out_under(int runs) {
+    RareEvent output;
+    output.name = "Bowled out for under " + std::to_string(runs);
+
+    // Completed innings are included, so that the levels still hold once the
+    // next innings has started
+    for (int wkts = 3; wkts <= 9; wkts += 2) {
+        output.levels.push_back([wkts, runs](Match& match) {
+            return any_innings(match, [wkts, runs](Innings* inns) {
+                return inns->get_wkts() >= wkts &&
+                       inns->get_team_score() < runs;
+            });
+        });
+    }
+
+    output.event = [runs](Match& match) {
+        return any_innings(match, [runs](Innings* inns) {
+            return inns->get_wkts() == 10 && inns->get_team_score() < runs;
+        });
+    };
+
+    return output;
+}
+
+//~~~~~~~~~~~~~~ SplittingResult implementations ~~~~~~~~~~~~~~//
+std::string SplittingResult::print() {
+    std::stringstream output;
+    output << std::scientific << std::setprecision(3);
+
+    output << "Estimate: " << estimate << " (std err " << std_error << ")\n"
+           << "Deliveries simulated: " << n_deliveries << "\n"
+           << "Stage   P(next | previous)\n";
+    for (unsigned int k = 0; k < stage_probs.size(); k++)
+        output << k + 1 << "   " << stage_probs[k] << "\n";
+
+    return output.str();
+}
+
+//~~~~~~~~~~~~~~ SplittingEstimator implementations ~~~~~~~~~~~~~~//
+SplittingEstimator::SplittingEstimator(Pregame c_detail, RareEvent c_event,
+                                       SplittingOptions c_opts)
+    : detail(c_detail), event(c_event), opts(c_opts) {
+    if (opts.n_threads == 0)
+        opts.n_threads = std::max(1u, std::thread::hardware_concurrency());
+}
+
+double SplittingEstimator::replicate(unsigned int r,
+                                     std::vector<double>& stage_probs,
+                                     unsigned long long& n_deliveries) {
+    // Each replication gets its own reproducible random stream
+    seed_rng(mix_seed(opts.seed, r));
+
+    int n_levels = event.levels.size();
+    stage_probs.assign(n_levels + 1, 0);
+
+    std::vector<Match*> entrance;
+    double output = 1;
+    for (int k = 0; k <= n_levels && output > 0; k++) {
+        bool last = k == n_levels;
+        std::function<bool(Match&)>& until =
+            last ? event.event : event.levels[k];
+
+        std::vector<Match*> hits;
+        unsigned int n_hits = 0;
+        for (unsigned int n = 0; n < opts.n_per_level; n++) {
+            Match* match;
+            if (k == 0) {
+                match = new Match(detail);
+                match->pregame();
+            } else {
+                // Continue a clone of a uniformly chosen entrance state
+                int i = std::min((int)(runif() * entrance.size()),
+                                 (int)entrance.size() - 1);
+                match = new Match(*entrance[i]);
+            }
+
+            int before = count_deliveries(*match);
+            bool hit = match->advance(until);
+            n_deliveries += count_deliveries(*match) - before;
+
+            if (hit)
+                n_hits++;
+            if (hit && !last)
+                hits.push_back(match);
+            else
+                delete match;
+        }
+
+        for (Match* match : entrance)
+            delete match;
+        entrance = hits;
+
+        stage_probs[k] = (double)n_hits / opts.n_per_level;
+        output *= stage_probs[k];
+    }
+
+    for (Match* match : entrance)
+        delete match;
+
+    return output;
+}
+
+SplittingResult SplittingEstimator::run() {
+    unsigned int n_reps = std::max(1u, opts.n_reps);
+    std::vector<double> estimates(n_reps);
+    std::vector<std::vector<double>> stage_probs(n_reps);
+    std::vector<unsigned long long> deliveries(n_reps, 0);
+
+    // Replications are handed out one at a time, and each writes only to its
+    // own slot
+    std::atomic<unsigned int> next(0);
+    auto worker = [&]() {
+        unsigned int r;
+        while ((r = next.fetch_add(1)) < n_reps)
+            estimates[r] = replicate(r, stage_probs[r], deliveries[r]);
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned int t = 1; t < std::min(opts.n_threads, n_reps); t++)
+        threads.emplace_back(worker);
+    worker();
+    for (std::thread& th : threads)
+        th.join();
+
+    // Average over replications
+    SplittingResult output = {0, 0, std::vector<double>(stage_probs[0].size()),
+                              0};
+    for (unsigned int r = 0; r < n_reps; r++) {
+        output.estimate += estimates[r] / n_reps;
+        output.n_deliveries += deliveries[r];
+        for (unsigned int k = 0; k < stage_probs[r].size(); k++)
+            output.stage_probs[k] += stage_probs[r][k] / n_reps;
+    }
+
+    if (n_reps > 1) {
+        double var = 0;
+        for (double est : estimates)
+            var += (est - output.estimate) * (est - output.estimate);
+        output.std_error = sqrt(var / (n_reps - 1) / n_reps);
+    }
+
+    return output;
+}
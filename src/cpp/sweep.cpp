@@ -0,0 +1,274 @@
+#include "testmatch/sweep.hpp"
+
+#include "testmatch/batch.hpp"
+#include "testmatch/enums.hpp"
+#include "testmatch/helpers.hpp"
+#include "testmatch/params.hpp"
+#include "testmatch/simulation.hpp"
+#include "testmatch/team.hpp"
+#include "testmatch/workers.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+//~~~~~~~~~~~~~~ SweepDesign implementations ~~~~~~~~~~~~~~//
+SweepDesign::SweepDesign(std::vector<std::string> c_names) : names(c_names) {
+    for (std::string& name : names) {
+        if (!ParamRegistry::has(name))
+            throw std::invalid_argument("Unknown model parameter: " + name);
+    }
+}
+
+void SweepDesign::add_point(std::vector<double> values) {
+    if (values.size() != names.size())
+        throw std::invalid_argument("Sweep point needs " +
+                                    std::to_string(names.size()) + " values");
+    points.push_back(values);
+}
+
+SweepDesign SweepDesign::grid(std::vector<SweepAxis> axes) {
+    std::vector<std::string> names;
+    for (SweepAxis& axis : axes) {
+        if (axis.values.empty())
+            throw std::invalid_argument("Sweep axis has no values: " +
+                                        axis.name);
+        names.push_back(axis.name);
+    }
+    SweepDesign output(names);
+
+    // Count through the combinations like an odometer
+    std::vector<unsigned int> counter(axes.size(), 0);
+    while (true) {
+        std::vector<double> values;
+        for (unsigned int j = 0; j < axes.size(); j++)
+            values.push_back(axes[j].values[counter[j]]);
+        output.add_point(values);
+
+        int j = (int)axes.size() - 1;
+        while (j >= 0 && ++counter[j] == axes[j].values.size())
+            counter[j--] = 0;
+        if (j < 0)
+            break;
+    }
+    return output;
+}
+
+SweepDesign SweepDesign::random(std::vector<SweepRange> ranges,
+                                unsigned int n_points,
+                                unsigned long long seed) {
+    std::vector<std::string> names;
+    for (SweepRange& range : ranges)
+        names.push_back(range.name);
+    SweepDesign output(names);
+
+    RngState saved = rng_state();
+    seed_rng(seed);
+
+    // Shuffle the strata of each parameter independently, then sample within
+    // each stratum
+    std::vector<std::vector<double>> columns;
+    for (SweepRange& range : ranges) {
+        std::vector<unsigned int> strata(n_points);
+        for (unsigned int k = 0; k < n_points; k++)
+            strata[k] = k;
+        for (unsigned int k = n_points; k > 1; k--) {
+            unsigned int r = std::min(k - 1, (unsigned int)(runif() * k));
+            std::swap(strata[k - 1], strata[r]);
+        }
+
+        std::vector<double> column;
+        for (unsigned int k = 0; k < n_points; k++) {
+            double u = (strata[k] + runif()) / n_points;
+            column.push_back(range.low + u * (range.high - range.low));
+        }
+        columns.push_back(column);
+    }
+    rng_state() = saved;
+
+    for (unsigned int k = 0; k < n_points; k++) {
+        std::vector<double> values;
+        for (std::vector<double>& column : columns)
+            values.push_back(column[k]);
+        output.add_point(values);
+    }
+    return output;
+}
+
+std::vector<std::string> SweepDesign::get_names() const { return names; }
+
+unsigned int SweepDesign::size() const { return points.size(); }
+
+const std::vector<double>& SweepDesign::get_point(unsigned int k) const {
+    return points.at(k);
+}
+
+//~~~~~~~~~~~~~~ SweepResult implementations ~~~~~~~~~~~~~~//
+SweepResult::SweepResult(SweepDesign c_design) : design(c_design) {}
+
+SweepDesign& SweepResult::get_design() { return design; }
+
+unsigned int SweepResult::size() { return results.size(); }
+
+BatchResult& SweepResult::get_result(unsigned int k) { return results.at(k); }
+
+Estimate SweepResult::win_diff(unsigned int k, Team* team) {
+    BatchResult& base = results.at(0);
+    BatchResult& other = results.at(k);
+    int side = team == base.get_home_team() ? 0 : 1;
+
+    // Paired differences, each match at point k against the match with the
+    // same random stream at the first point
+    unsigned int n = winners[0].size();
+    double sum = 0, sum_sq = 0;
+    for (unsigned int i = 0; i < n; i++) {
+        double d = (winners[k][i] == side) - (winners[0][i] == side);
+        sum += d;
+        sum_sq += d * d;
+    }
+
+    Estimate output = {0, 0, 0, 1};
+    if (n == 0)
+        return output;
+    double mean = sum / n;
+    double var = n > 1 ? std::max(0.0, sum_sq - n * mean * mean) / (n - 1) : 0;
+    double p0 = base.win_prob(team), pk = other.win_prob(team);
+
+    output.value = mean;
+    output.std_error = sqrt(var / n);
+    output.plain_std_error = sqrt((p0 * (1 - p0) + pk * (1 - pk)) / n);
+    if (output.std_error > 0)
+        output.variance_reduction = pow(output.plain_std_error, 2) /
+                                    pow(output.std_error, 2);
+    return output;
+}
+
+std::string SweepResult::to_csv() {
+    std::stringstream output;
+    for (std::string& name : design.get_names())
+        output << name << ",";
+    output << "n_sims,home_win,away_win,draw,tie\n" << std::setprecision(6);
+
+    for (unsigned int k = 0; k < size(); k++) {
+        BatchResult& result = results[k];
+        for (double value : design.get_point(k))
+            output << value << ",";
+        output << result.get_n_sims() << ","
+               << result.win_prob(result.get_home_team()) << ","
+               << result.win_prob(result.get_away_team()) << ","
+               << result.result_prob(draw) << "," << result.result_prob(tie)
+               << "\n";
+    }
+    return output.str();
+}
+
+std::string SweepResult::print() {
+    std::stringstream output;
+    output << std::setprecision(4);
+    if (size() == 0)
+        return "Empty sweep\n";
+
+    Team* home = results[0].get_home_team();
+    Team* away = results[0].get_away_team();
+    output << size() << " points, " << results[0].get_n_sims()
+           << " simulations each\n";
+    for (std::string& name : design.get_names())
+        output << name << "   ";
+    output << home->name << " win   " << away->name
+           << " win   Draw   Tie   Change   Std err\n";
+
+    for (unsigned int k = 0; k < size(); k++) {
+        BatchResult& result = results[k];
+        Estimate diff = win_diff(k, home);
+        for (double value : design.get_point(k))
+            output << value << "   ";
+        output << result.win_prob(home) << "   " << result.win_prob(away)
+               << "   " << result.result_prob(draw) << "   "
+               << result.result_prob(tie) << "   " << diff.value << "   "
+               << diff.std_error << "\n";
+    }
+    return output.str();
+}
+
+//~~~~~~~~~~~~~~ SweepRunner implementations ~~~~~~~~~~~~~~//
+SweepRunner::SweepRunner(Pregame c_detail, SweepDesign c_design,
+                         BatchOptions c_opts)
+    : design(c_design), opts(c_opts) {
+    opts.target_half_width = 0;
+    if (opts.n_threads == 0)
+        opts.n_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    // Runners are built under the parameters of their point, which decide
+    // the weights of the toss strata
+    for (unsigned int k = 0; k < design.size(); k++) {
+        ParamOverride point(design.get_names(), design.get_point(k));
+        runners.emplace_back(c_detail, opts);
+    }
+}
+
+SweepRunner::SweepRunner(MatchSnapshot c_start, SweepDesign c_design,
+                         BatchOptions c_opts)
+    : design(c_design), opts(c_opts) {
+    opts.target_half_width = 0;
+    if (opts.n_threads == 0)
+        opts.n_threads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned int k = 0; k < design.size(); k++) {
+        ParamOverride point(design.get_names(), design.get_point(k));
+        runners.emplace_back(c_start, opts);
+    }
+}
+
+SweepResult SweepRunner::run(WorkerPool* pool) {
+    SweepResult output(design);
+    unsigned int n_points = design.size();
+    if (n_points == 0)
+        return output;
+
+    std::unique_ptr<WorkerPool> own;
+    if (pool == nullptr) {
+        own.reset(new WorkerPool(
+            std::min(opts.n_threads, std::max(1u, n_points * opts.n_sims))));
+        pool = own.get();
+    }
+
+    // A shard for each worker at each point
+    std::vector<std::vector<BatchResult>> shards(pool->size());
+    for (unsigned int t = 0; t < pool->size(); t++) {
+        for (unsigned int k = 0; k < n_points; k++)
+            shards[t].push_back(runners[k].empty_result());
+    }
+    output.winners.assign(n_points,
+                          std::vector<signed char>(opts.n_sims, -1));
+
+    // Every (point, match) pair is a single task, with the points of each
+    // match adjacent, so all points progress together and workers never sit
+    // idle waiting for the slowest batch
+    std::vector<std::string> names = design.get_names();
+    Team* home = runners[0].detail.home_team;
+    Team* away = runners[0].detail.away_team;
+    pool->parallel_for(
+        0, n_points * opts.n_sims,
+        [&](unsigned int task, unsigned int worker) {
+            unsigned int k = task % n_points, i = task / n_points;
+
+            // Switch the constants of this worker to the point, and back
+            // again afterwards, as worker 0 is the calling thread
+            ParamOverride point(names, design.get_point(k));
+            Team* winner = runners[k].simulate_one(i, shards[worker][k]);
+            output.winners[k][i] = winner == home ? 0 : winner == away ? 1 : -1;
+        });
+
+    for (unsigned int k = 0; k < n_points; k++) {
+        std::vector<BatchResult> point_shards;
+        for (unsigned int t = 0; t < pool->size(); t++)
+            point_shards.push_back(shards[t][k]);
+        output.results.push_back(BatchRunner::merge(point_shards));
+    }
+    return output;
+}
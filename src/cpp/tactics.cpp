@@ -0,0 +1,196 @@
+#include "testmatch/tactics.hpp"
+
+#include "testmatch/cards.hpp"
+#include "testmatch/helpers.hpp"
+#include "testmatch/models.hpp"
+#include "testmatch/simulation.hpp"
+#include "testmatch/team.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <map>
+#include <memory>
+#include <tuple>
+
+// Types of decision
+static const int DECISION_DECLARE = 0;
+static const int DECISION_PROMOTE = 1;
+
+//~~~~~~~~~~~~~~ DecisionKey implementations ~~~~~~~~~~~~~~//
+bool DecisionKey::operator<(const DecisionKey& rhs) const {
+    return std::tie(fingerprint, kind, candidate, inns_no, lead_bucket,
+                    wkts_bucket, day) < std::tie(rhs.fingerprint, rhs.kind,
+                                                 rhs.candidate, rhs.inns_no,
+                                                 rhs.lead_bucket,
+                                                 rhs.wkts_bucket, rhs.day);
+}
+
+//~~~~~~~~~~~~~~ RolloutTactics implementations ~~~~~~~~~~~~~~//
+RolloutTactics::RolloutTactics(TacticsOptions c_opts)
+    : opts(c_opts), n_decisions(0), n_hits(0), n_rollouts(0) {}
+
+int RolloutTactics::match_balls(Match& match) {
+    int output = 0;
+    for (int i = 0; i <= match.inns_i; i++)
+        output += match.inns[i]->balls;
+    return output;
+}
+
+DecisionKey RolloutTactics::make_key(Match& match, int kind, int candidate) {
+    Innings* inns = match.inns[match.inns_i];
+    DecisionKey key;
+    key.fingerprint = inns->table->fingerprint();
+    key.kind = kind;
+    key.candidate = candidate;
+    key.inns_no = inns->inns_no;
+    key.lead_bucket = (int)floor((double)inns->lead / opts.lead_bucket);
+    key.wkts_bucket = inns->wkts / 3;
+    key.day = match.time.get_day() - 1;
+    return key;
+}
+
+double RolloutTactics::value(Match& match, Team* team) {
+    Team* winner = match.result->get_winner();
+    if (winner == nullptr)
+        return 0.5;
+    return winner == team ? 1 : 0;
+}
+
+bool RolloutTactics::prefer_alternative(Match& match, const DecisionKey& key,
+                                        std::function<void(Match&)> base,
+                                        std::function<void(Match&)> alt) {
+    n_decisions++;
+    if (match.decisions == nullptr)
+        match.decisions = std::make_unique<DecisionCache>();
+    std::map<DecisionKey, bool>& cache = match.decisions->decisions;
+    auto it = cache.find(key);
+    if (it != cache.end()) {
+        n_hits++;
+        return it->second;
+    }
+
+    // Each rollout plays out both options from the match with the same
+    // random stream, derived from the key, so the decision depends only on
+    // the match and not on the thread it is simulated on
+    unsigned long long stream = key.fingerprint;
+    int fields[6] = {key.kind,        key.candidate,   key.inns_no,
+                     key.lead_bucket, key.wkts_bucket, key.day};
+    for (int field : fields)
+        stream = mix_seed(stream, field);
+    unsigned long long seed = mix_seed(opts.seed, stream);
+
+    Team* team = match.inns[match.inns_i]->team_bat;
+    auto play_out = [team](Match& copy, std::function<void(Match&)>& option) {
+        // Rollouts never make decisions of their own, print or keep the
+        // deliveries
+        copy.tactics = nullptr;
+        for (int i = 0; i <= copy.inns_i; i++)
+            copy.inns[i]->is_quiet = true;
+        option(copy);
+        if (copy.result == nullptr)
+            copy.start_with<SummaryCommentary>();
+        return value(copy, team);
+    };
+
+    RngState saved = rng_state();
+    auto start = std::chrono::steady_clock::now();
+    double sum = 0, sum_sq = 0;
+    unsigned int n = 0;
+    while (n < std::max(1u, opts.n_rollouts)) {
+        seed_rng(mix_seed(seed, n));
+        Match base_copy(match);
+        double base_value = play_out(base_copy, base);
+
+        seed_rng(mix_seed(seed, n));
+        Match alt_copy(match);
+        double alt_value = play_out(alt_copy, alt);
+
+        sum += alt_value - base_value;
+        sum_sq += (alt_value - base_value) * (alt_value - base_value);
+        n++;
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start);
+        if (opts.budget_us > 0 && elapsed.count() >= opts.budget_us)
+            break;
+    }
+    rng_state() = saved;
+    n_rollouts += n;
+
+    // Only take the alternative if it is better by the margin with some
+    // confidence, as a handful of rollouts is noisy
+    double mean = sum / n;
+    double var = n > 1 ? std::max(0.0, sum_sq - n * mean * mean) / (n - 1) : 0;
+    bool output = mean - opts.z * sqrt(var / n) > opts.margin;
+    cache.emplace(key, output);
+    return output;
+}
+
+bool RolloutTactics::declare(Match& match) {
+    Innings* inns = match.inns[match.inns_i];
+    if (inns->inns_no == 4 ||
+        Model::MODEL_DECLARATION(inns->lead, match_balls(match), false,
+                                 inns->inns_no) < opts.consider_prob)
+        return false;
+
+    return prefer_alternative(
+        match, make_key(match, DECISION_DECLARE, -1), [](Match&) {},
+        [](Match& copy) { copy.declare(); });
+}
+
+bool RolloutTactics::is_close_of_day(Match& match) {
+    return match.time.play_left_today() <
+           opts.nightwatch_overs * MatchTime::NOMINAL_OVER_DUR;
+}
+
+bool RolloutTactics::wants_quick_runs(Match& match) {
+    Innings* inns = match.inns[match.inns_i];
+    return inns->inns_no < 4 &&
+           Model::MODEL_DECLARATION(inns->lead, match_balls(match), true,
+                                    inns->inns_no) >= opts.consider_prob;
+}
+
+bool RolloutTactics::send_in(Match& match, BatterCard* card) {
+    Innings* inns = match.inns[match.inns_i];
+    int k = 0;
+    while (k < 11 && inns->batters[k] != card)
+        k++;
+    if (k == 11)
+        return false;
+
+    // Options take over from the wicket, which is part-way through being
+    // applied, once the batter has been chosen
+    auto finish_ball = [](Match& copy, Innings* copy_inns) {
+        std::string state = copy_inns->check_state();
+        if (!copy_inns->is_open)
+            copy.end_innings(state);
+    };
+    auto base = [finish_ball](Match& copy) {
+        Innings* copy_inns = copy.inns[copy.inns_i];
+        copy_inns->bring_in(copy_inns->man_bat.next_ordered());
+        finish_ball(copy, copy_inns);
+    };
+    auto alt = [finish_ball, k](Match& copy) {
+        Innings* copy_inns = copy.inns[copy.inns_i];
+        copy_inns->man_bat.batted[k] = true;
+        copy_inns->bring_in(copy_inns->batters[k]);
+        finish_ball(copy, copy_inns);
+    };
+
+    return prefer_alternative(match, make_key(match, DECISION_PROMOTE, k),
+                              base, alt);
+}
+
+unsigned long long RolloutTactics::get_decisions() { return n_decisions; }
+
+unsigned long long RolloutTactics::get_hits() { return n_hits; }
+
+unsigned long long RolloutTactics::get_rollouts() { return n_rollouts; }
+
+void RolloutTactics::clear() {
+    n_decisions = 0;
+    n_hits = 0;
+    n_rollouts = 0;
+}
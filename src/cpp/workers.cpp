@@ -0,0 +1,280 @@
+#include "testmatch/workers.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+WorkerPool::WorkerPool(unsigned int n_threads)
+    : next(0), end(0), generation(0), n_busy(0), stopping(false) {
+    if (n_threads == 0)
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (unsigned int t = 1; t < n_threads; t++)
+        threads.emplace_back(&WorkerPool::work, this, t);
+}
+
+unsigned int WorkerPool::size() { return threads.size() + 1; }
+
+void WorkerPool::drain(unsigned int worker) {
+    unsigned int i;
+    while ((i = next.fetch_add(1)) < end) {
+        try {
+            task(i, worker);
+        } catch (...) {
+            // Keep the first exception, and hand out no more iterations
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!error)
+                error = std::current_exception();
+            next = end;
+        }
+    }
+}
+
+void WorkerPool::work(unsigned int worker) {
+    unsigned long long seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            start_cv.wait(
+                lock, [this, seen] { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+        }
+
+        drain(worker);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--n_busy == 0)
+                done_cv.notify_one();
+        }
+    }
+}
+
+void WorkerPool::parallel_for(
+    unsigned int begin, unsigned int c_end,
+    std::function<void(unsigned int, unsigned int)> f) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        task = f;
+        next = begin;
+        end = c_end;
+        n_busy = threads.size();
+        generation++;
+    }
+    start_cv.notify_all();
+
+    drain(0);
+
+    // Wait for the other workers to finish their last iteration
+    std::exception_ptr thrown;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        done_cv.wait(lock, [this] { return n_busy == 0; });
+        std::swap(thrown, error);
+    }
+    if (thrown)
+        std::rethrow_exception(thrown);
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    start_cv.notify_all();
+
+    for (std::thread& th : threads)
+        th.join();
+}
+
+//~~~~~~~~~~~~~~ TaskScheduler implementations ~~~~~~~~~~~~~~//
+// Scheduler and worker of the calling thread, if it belongs to a pool, and
+// the depth of the task it is running (0 outside any task)
+static thread_local const TaskScheduler* WORKER_OWNER = nullptr;
+static thread_local unsigned int WORKER_INDEX = 0;
+static thread_local unsigned int TASK_DEPTH = 0;
+
+TaskScheduler::TaskScheduler(unsigned int n_threads)
+    : n_queued(0), stopping(false), events(0), n_waiting(0) {
+    if (n_threads == 0)
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (unsigned int t = 0; t < n_threads; t++)
+        queues.push_back(std::make_unique<Queue>());
+    for (unsigned int t = 1; t < n_threads; t++)
+        threads.emplace_back(&TaskScheduler::work, this, t);
+}
+
+unsigned int TaskScheduler::size() { return queues.size(); }
+
+unsigned int TaskScheduler::current_worker() {
+    return WORKER_OWNER == this ? WORKER_INDEX : 0;
+}
+
+void TaskScheduler::push(std::function<void(unsigned int)> f) {
+    Queue& queue = *queues[current_worker()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.by_depth.size() <= TASK_DEPTH)
+            queue.by_depth.resize(TASK_DEPTH + 1);
+        queue.by_depth[TASK_DEPTH].push_back(std::move(f));
+    }
+
+    // Taking the lock orders the count before any idle worker's check
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        n_queued++;
+    }
+    wake_cv.notify_one();
+    notify_waiting();
+}
+
+void TaskScheduler::notify_waiting() {
+    bool any_waiting;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        events++;
+        any_waiting = n_waiting > 0;
+    }
+    if (any_waiting)
+        wait_cv.notify_all();
+}
+
+void TaskScheduler::park(unsigned long long seen,
+                         const std::atomic<unsigned int>& pending) {
+    std::unique_lock<std::mutex> lock(mutex);
+    n_waiting++;
+    wait_cv.wait(lock, [this, seen, &pending] {
+        return events != seen || pending.load(std::memory_order_acquire) == 0;
+    });
+    n_waiting--;
+}
+
+bool TaskScheduler::run_one(unsigned int worker, unsigned int min_depth) {
+    std::function<void(unsigned int)> task;
+    unsigned int depth = 0;
+
+    // Newest of the most deeply nested tasks of the worker's own queue
+    {
+        Queue& own = *queues[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        for (unsigned int d = own.by_depth.size(); d > min_depth; d--) {
+            auto& tasks = own.by_depth[d - 1];
+            if (!tasks.empty()) {
+                task = std::move(tasks.back());
+                tasks.pop_back();
+                depth = d;
+                break;
+            }
+        }
+    }
+
+    // Otherwise steal the oldest of the least deeply nested tasks of another
+    // worker, which is likely to hold the most work
+    unsigned int n = queues.size();
+    for (unsigned int k = 1; depth == 0 && k < n; k++) {
+        Queue& other = *queues[(worker + k) % n];
+        std::lock_guard<std::mutex> lock(other.mutex);
+        for (unsigned int d = min_depth + 1; d <= other.by_depth.size(); d++) {
+            auto& tasks = other.by_depth[d - 1];
+            if (!tasks.empty()) {
+                task = std::move(tasks.front());
+                tasks.pop_front();
+                depth = d;
+                break;
+            }
+        }
+    }
+
+    if (depth == 0)
+        return false;
+
+    n_queued--;
+    unsigned int saved = TASK_DEPTH;
+    TASK_DEPTH = depth;
+    task(worker);
+    TASK_DEPTH = saved;
+    return true;
+}
+
+void TaskScheduler::work(unsigned int worker) {
+    WORKER_OWNER = this;
+    WORKER_INDEX = worker;
+
+    while (true) {
+        if (run_one(worker, 0))
+            continue;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        wake_cv.wait(lock, [this] { return stopping || n_queued > 0; });
+        if (stopping)
+            return;
+    }
+}
+
+TaskScheduler::~TaskScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake_cv.notify_all();
+
+    for (std::thread& th : threads)
+        th.join();
+}
+
+//~~~~~~~~~~~~~~ TaskGroup implementations ~~~~~~~~~~~~~~//
+TaskGroup::TaskGroup(TaskScheduler& c_scheduler)
+    : scheduler(c_scheduler), pending(0) {}
+
+void TaskGroup::run(std::function<void(unsigned int)> f) {
+    pending++;
+    TaskScheduler* owner = &scheduler;
+    scheduler.push([this, owner, f](unsigned int worker) {
+        try {
+            f(worker);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error)
+                error = std::current_exception();
+        }
+
+        // The group may be destroyed as soon as its last task is done, so
+        // only the scheduler is used after that
+        if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            owner->notify_waiting();
+    });
+}
+
+void TaskGroup::join() {
+    unsigned int worker = scheduler.current_worker();
+    unsigned int depth = TASK_DEPTH;
+    while (pending.load(std::memory_order_acquire) > 0) {
+        unsigned long long seen = scheduler.events;
+        if (!scheduler.run_one(worker, depth))
+            scheduler.park(seen, pending);
+    }
+}
+
+void TaskGroup::wait() {
+    join();
+
+    std::exception_ptr thrown;
+    {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        std::swap(thrown, error);
+    }
+    if (thrown)
+        std::rethrow_exception(thrown);
+}
+
+TaskGroup::~TaskGroup() { join(); }
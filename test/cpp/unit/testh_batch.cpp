@@ -0,0 +1,208 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/parameterized_test.hpp>
+#include <boost/test/unit_test.hpp>
+#include <string>
+#include <vector>
+
+#include "fixtures.hpp"
+#include "testmatch/batch.hpp"
+#include "testmatch/cards.hpp"
+#include "testmatch/models.hpp"
+#include "testmatch/simulation.hpp"
+#include "testmatch/team.hpp"
+
+using namespace boost::unit_test;
+
+BOOST_AUTO_TEST_SUITE(test_header_batch)
+
+BOOST_FIXTURE_TEST_CASE(testclass_playerprojection, F_TeamAus) {
+    PlayerProjection proj(&a3);
+
+    // Batter who did not come to the crease is ignored
+    BatterCard dnb(&a3);
+    proj.record_batting(&dnb);
+    BOOST_TEST(proj.get_bat_innings() == 0);
+    BOOST_TEST(proj.mean_runs() == 0);
+
+    // Dismissed for a half-century
+    BatterCard fifty(&a3);
+    fifty.activate();
+    for (int i = 0; i < 13; i++)
+        fifty.update_score("4");
+    fifty.update_score("W");
+    fifty.dismiss(caught, &a8, &a7);
+    proj.record_batting(&fifty);
+
+    // Unbeaten century, in another shard
+    PlayerProjection shard(&a3);
+    BatterCard ton(&a3);
+    ton.activate();
+    for (int i = 0; i < 17; i++)
+        ton.update_score("6");
+    shard.record_batting(&ton);
+
+    proj += shard;
+    BOOST_TEST(proj.get_bat_innings() == 2);
+    BOOST_TEST(proj.mean_runs() == 77);
+    BOOST_TEST(proj.mean_balls() == 15.5);
+    BOOST_TEST(proj.prob_fifty() == 1);
+    BOOST_TEST(proj.prob_hundred() == 0.5);
+    BOOST_TEST(proj.prob_not_out() == 0.5);
+    BOOST_TEST(proj.prob_dism(caught) == 0.5);
+    BOOST_TEST(proj.prob_dism(bowled) == 0);
+    BOOST_TEST(proj.prob_runs_at_least(52) == 1);
+    BOOST_TEST(proj.prob_runs_at_least(53) == 0.5);
+    BOOST_TEST(proj.runs_quantile(0.5) == 52);
+    BOOST_TEST(proj.runs_quantile(1) == 102);
+
+    // Bowling figures
+    BowlerCard bc(&a3);
+    proj.record_bowling(&bc);
+    BOOST_TEST(proj.get_bowl_innings() == 0);
+
+    for (int i = 0; i < 5; i++)
+        bc.update_score("W");
+    bc.update_score("1");
+    proj.record_bowling(&bc);
+    BOOST_TEST(proj.get_bowl_innings() == 1);
+    BOOST_TEST(proj.mean_wickets() == 5);
+    BOOST_TEST(proj.economy() == 1);
+    BOOST_TEST(proj.prob_five_for() == 1);
+}
+
+BOOST_FIXTURE_TEST_CASE(testclass_batchrunner, F_Pregame) {
+    BatchOptions opts;
+    opts.n_sims = 40;
+    opts.n_threads = 3;
+    opts.seed = 2021;
+
+    BatchResult res = BatchRunner(pregame, opts).run();
+    BOOST_TEST(res.get_n_sims() == 40);
+
+    // Every match has exactly one result
+    unsigned int total = 0;
+    for (ResultType type : {draw, win_chasing, win_bowling, win_innings, tie})
+        total += res.get_result_count(type);
+    BOOST_TEST(total == 40);
+    BOOST_TEST(res.get_wins(&aus) + res.get_wins(&nz) +
+                   res.get_result_count(draw) + res.get_result_count(tie) ==
+               40);
+
+    // Openers bat in every first innings
+    BOOST_TEST(res.get_projection(&a1)->get_bat_innings() >= 40);
+    BOOST_TEST(res.get_projection(&b1)->get_bat_innings() >= 40);
+    BOOST_TEST(res.get_projection(nullptr) == nullptr);
+
+    // Results do not depend on the number of threads
+    opts.n_threads = 1;
+    BatchResult res_serial = BatchRunner(pregame, opts).run();
+    BOOST_TEST(res_serial.get_wins(&aus) == res.get_wins(&aus));
+    BOOST_TEST(res_serial.get_projection(&a4)->get_runs_hist() ==
+                   res.get_projection(&a4)->get_runs_hist(),
+               boost::test_tools::per_element());
+    BOOST_TEST(res_serial.get_projection(&b8)->get_wickets_hist() ==
+                   res.get_projection(&b8)->get_wickets_hist(),
+               boost::test_tools::per_element());
+}
+
+BOOST_FIXTURE_TEST_CASE(testfeature_adaptive_precision, F_Pregame) {
+    BatchOptions opts;
+    opts.n_sims = 1000;
+    opts.n_threads = 2;
+    opts.seed = 7;
+    opts.target_half_width = 0.15;
+    opts.check_every = 10;
+
+    // Loose target is met long before the maximum number of matches
+    BatchResult res = BatchRunner(pregame, opts).run();
+    BOOST_TEST(res.is_converged());
+    BOOST_TEST(res.get_n_sims() < 1000);
+    BOOST_TEST(res.get_n_sims() % 10 == 0);
+    BOOST_TEST(res.max_half_width(opts.confidence) <= 0.15);
+
+    // Stopping point is reproducible
+    opts.n_threads = 1;
+    BOOST_TEST(BatchRunner(pregame, opts).run().get_n_sims() ==
+               res.get_n_sims());
+
+    // Unreachable target runs the full batch
+    opts.n_sims = 20;
+    opts.target_half_width = 1e-4;
+    res = BatchRunner(pregame, opts).run();
+    BOOST_TEST(!res.is_converged());
+    BOOST_TEST(res.get_n_sims() == 20);
+}
+
+BOOST_FIXTURE_TEST_CASE(testfeature_variance_reduction, F_Pregame) {
+    BatchOptions opts;
+    opts.n_sims = 200;
+    opts.n_threads = 2;
+    opts.seed = 11;
+
+    // Without variance reduction, estimates are the plain proportions
+    BatchResult plain = BatchRunner(pregame, opts).run();
+    Estimate est = plain.win_estimate(&aus);
+    BOOST_TEST(est.value == plain.win_prob(&aus));
+    BOOST_TEST(est.variance_reduction == 1);
+
+    opts.stratify_toss = true;
+    opts.antithetic = true;
+    opts.control_variates = true;
+    BatchResult res = BatchRunner(pregame, opts).run();
+    BOOST_TEST(res.get_n_sims() == 200);
+
+    // Estimates remain valid probabilities with sensible standard errors
+    double total = 0;
+    for (Estimate e : {res.win_estimate(&aus), res.win_estimate(&nz),
+                       res.result_estimate(draw), res.result_estimate(tie)}) {
+        BOOST_TEST(e.value > -0.1);
+        BOOST_TEST(e.value < 1.1);
+        BOOST_TEST(e.std_error >= 0);
+        BOOST_TEST(e.plain_std_error >= 0);
+        BOOST_TEST(e.variance_reduction > 0);
+        total += e.value;
+    }
+    BOOST_TEST(total == 1, boost::test_tools::tolerance(0.05));
+
+    // Reproducible regardless of the number of threads
+    opts.n_threads = 1;
+    BatchResult res_serial = BatchRunner(pregame, opts).run();
+    BOOST_TEST(res_serial.win_estimate(&aus).value ==
+               res.win_estimate(&aus).value);
+}
+
+// Every delivery is a wicket, so every match has the same result
+class WicketsModel : public DeliveryModel {
+  public:
+    void evaluate(const Matchup*, int n, double* output) const override {
+        for (int k = 0; k < n * Model::NUM_DELIV_OUTCOMES; k++)
+            output[k] = 0;
+    }
+};
+
+BOOST_FIXTURE_TEST_CASE(testfeature_lopsided_precision, F_Pregame) {
+    WicketsModel model;
+    BatchOptions opts;
+    opts.n_sims = 1000;
+    opts.n_threads = 2;
+    opts.seed = 3;
+    opts.delivery_model = &model;
+    opts.stratify_toss = true;
+    opts.antithetic = true;
+    opts.control_variates = true;
+    opts.target_half_width = 0.01;
+    opts.check_every = 100;
+
+    // Reduced standard errors of identical outcomes are zero, but the batch
+    // runs on until the Wilson interval of the counts is narrow enough
+    BatchResult res = BatchRunner(pregame, opts).run();
+    BOOST_TEST(res.result_estimate(tie).std_error == 0);
+    BOOST_TEST(res.result_prob(tie) == 1);
+    BOOST_TEST(res.is_converged());
+    BOOST_TEST(res.get_n_sims() > 100);
+    BOOST_TEST(res.max_half_width(opts.confidence) <= 0.01);
+    BOOST_TEST(res.max_half_width(opts.confidence) > 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,189 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/parameterized_test.hpp>
+#include <boost/test/unit_test.hpp>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "testmatch/calibration.hpp"
+#include "testmatch/enums.hpp"
+#include "testmatch/models.hpp"
+#include "testmatch/params.hpp"
+#include "testmatch/workers.hpp"
+
+using namespace boost::unit_test;
+
+// A Test match in the Cricsheet format, cut down to a few deliveries: a dot
+// ball and a four from pace, a wide and a caught from spin in the 21st over,
+// and a delivery by a bowler of unknown type
+static const char* TEST_MATCH = R"({
+    "meta": {"data_version": "1.0.0", "revision": 1},
+    "info": {"match_type": "Test", "teams": ["A", "B"],
+             "players": {"A": ["X \"Y\" Z"]}},
+    "innings": [
+        {"team": "A", "overs": [
+            {"over": 0, "deliveries": [
+                {"batter": "A1", "bowler": "Quick", "non_striker": "A2",
+                 "runs": {"batter": 0, "extras": 0, "total": 0}},
+                {"batter": "A1", "bowler": "Quick", "non_striker": "A2",
+                 "runs": {"batter": 4, "extras": 0, "total": 4}}
+            ]},
+            {"over": 20, "deliveries": [
+                {"batter": "A1", "bowler": "Slow", "non_striker": "A2",
+                 "extras": {"wides": 1},
+                 "runs": {"batter": 0, "extras": 1, "total": 1}},
+                {"batter": "A1", "bowler": "Slow", "non_striker": "A2",
+                 "runs": {"batter": 0, "extras": 0, "total": 0},
+                 "wickets": [{"player_out": "A1", "kind": "caught",
+                              "fielders": [{"name": "B1"}]}]},
+                {"batter": "A2", "bowler": "Who", "non_striker": "A3",
+                 "runs": {"batter": 1, "extras": 0, "total": 1}}
+            ]}
+        ]}
+    ]
+})";
+
+BOOST_AUTO_TEST_SUITE(test_header_calibration)
+
+BOOST_AUTO_TEST_CASE(testclass_cricsheetreader) {
+    CricsheetReader reader;
+    std::stringstream styles("name,type\nQuick,fm\nSlow,ob\nOdd,xx\n");
+    BOOST_TEST(reader.read_styles(styles) == 2);
+
+    CalibrationTables tables;
+    std::stringstream input(TEST_MATCH);
+    BOOST_TEST(reader.read(input, tables));
+    BOOST_TEST(tables.get_n_matches() == 1);
+    BOOST_TEST(tables.get_n_deliveries() == 5);
+
+    int wide = 5, wkt = Model::NUM_DELIV_OUTCOMES - 1;
+    BOOST_TEST(tables.get_outcome_count(fast_med, 0, 0) == 1);
+    BOOST_TEST(tables.get_outcome_count(fast_med, 0, 14) == 1);
+    BOOST_TEST(tables.get_outcome_count(offbreak, 1, wide) == 1);
+    BOOST_TEST(tables.get_outcome_count(offbreak, 1, wkt) == 1);
+    BOOST_TEST(tables.get_dism_count(offbreak, 1, 1) == 1);
+    BOOST_TEST(tables.get_outcome_count(CalibrationTables::UNKNOWN_TYPE, 1,
+                                        1) == 1);
+
+    // Other types of match are not counted, and bad JSON throws
+    CricsheetReader odi_reader;
+    std::string odi = TEST_MATCH;
+    odi.replace(odi.find("\"Test\""), 6, "\"ODI\"");
+    std::stringstream odi_input(odi);
+    BOOST_TEST(!odi_reader.read(odi_input, tables));
+    BOOST_TEST(tables.get_n_matches() == 1);
+    std::stringstream bad("{\"info\": [1, 2");
+    BOOST_CHECK_THROW(odi_reader.read(bad, tables), std::runtime_error);
+
+    // Fitted tables are the proportions of each outcome other than a wicket
+    Model::Coefficients coefs = tables.fit();
+    BOOST_TEST(coefs.pace_cdf[0] == 0);
+    BOOST_TEST(coefs.pace_cdf[1] == 0.5);
+    BOOST_TEST(coefs.pace_cdf[14] == 0.5);
+    BOOST_TEST(coefs.pace_cdf[15] == 1);
+    BOOST_TEST(coefs.spin_cdf[5] == 0);
+    BOOST_TEST(coefs.spin_cdf[6] == 1);
+    BOOST_TEST(coefs.spin_dism_cdf[1] == 0);
+    BOOST_TEST(coefs.spin_dism_cdf[2] == 1);
+
+    // No pace bowlers in the middle overs, so bowlers of unknown type are
+    // used, and no dismissals, so the default is kept
+    Model::Coefficients middle = tables.fit(1);
+    BOOST_TEST(middle.pace_cdf[1] == 0);
+    BOOST_TEST(middle.pace_cdf[2] == 1);
+    BOOST_TEST(middle.pace_dism_cdf[1] ==
+               Model::published_coefficients()->pace_dism_cdf[1]);
+}
+
+BOOST_AUTO_TEST_CASE(testfeature_calibration_file) {
+    std::filesystem::path dir =
+        std::filesystem::temp_directory_path() / "testmatch_calibration";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    for (int i = 0; i < 8; i++) {
+        std::ofstream file(dir / (std::to_string(i) + ".json"));
+        file << TEST_MATCH;
+    }
+    std::ofstream(dir / "broken.json") << "{\"innings\": [";
+    std::ofstream(dir / "README.txt") << "Not a match";
+
+    CricsheetReader reader;
+    reader.add_style("Quick", fast);
+    reader.add_style("Slow", legbreak);
+    WorkerPool pool(3);
+    CalibrationTables tables = reader.read_dir(dir.string(), &pool);
+    BOOST_TEST(tables.get_n_files() == 9);
+    BOOST_TEST(tables.get_n_failed() == 1);
+    BOOST_TEST(tables.get_n_matches() == 8);
+    BOOST_TEST(tables.get_n_deliveries() == 40);
+
+    // Tables survive the round trip through the coefficient file
+    std::string path = (dir / "coefficients.bin").string();
+    tables.save(path);
+    CalibrationTables loaded = CalibrationTables::load(path);
+    BOOST_TEST(loaded.get_n_deliveries() == 40);
+    BOOST_TEST(loaded.get_outcome_count(fast, 0, 14) == 8);
+    BOOST_TEST(loaded.get_dism_count(legbreak, 1, 1) == 8);
+
+    // Coefficients are read straight from the mapped file
+    CoefficientFile mapped(path);
+    BOOST_TEST(mapped.get().pace_cdf[1] == 0.5);
+    BOOST_TEST(mapped.get(1).pace_cdf[2] == 1);
+    BOOST_TEST(mapped.get().follow_on[2] ==
+               Model::published_coefficients()->follow_on[2]);
+    BOOST_CHECK_THROW(mapped.get(3), std::invalid_argument);
+
+    // Saving over a mapped file replaces it, leaving the mapping intact
+    std::filesystem::path single = dir / "single";
+    std::filesystem::create_directory(single);
+    std::ofstream(single / "0.json") << TEST_MATCH;
+    reader.read_dir(single.string()).save(path);
+    BOOST_TEST(CalibrationTables::load(path).get_n_files() == 1);
+    BOOST_TEST(mapped.get().pace_cdf[1] == 0.5);
+    BOOST_TEST(mapped.get(1).pace_cdf[2] == 1);
+    tables.save(path);
+    int n_entries = 0;
+    for (auto& entry : std::filesystem::directory_iterator(dir))
+        n_entries += entry.path().filename().string().rfind("coef", 0) == 0;
+    BOOST_TEST(n_entries == 1);
+
+    // Loading the coefficients publishes them, until restored
+    std::shared_ptr<const Model::Coefficients> saved =
+        Model::published_coefficients();
+    load_coefficients(path);
+    BOOST_TEST(Model::COEFFICIENTS.pace_cdf[1] == 0.5);
+    BOOST_TEST(Model::published_coefficients()->pace_cdf[1] == 0.5);
+    BOOST_TEST(ParamRegistry::get_default("delivery.pace_cdf.1") == 0.5);
+    Model::publish_coefficients(saved);
+    ParamRegistry::reset();
+    BOOST_TEST(Model::COEFFICIENTS.pace_cdf[1] == saved->pace_cdf[1]);
+
+    // Damaged files are rejected, leaving the coefficients in use unchanged
+    std::ofstream(dir / "junk.bin") << "junk";
+    BOOST_CHECK_THROW(load_coefficients((dir / "junk.bin").string()),
+                      std::runtime_error);
+    std::string corrupt = (dir / "corrupt.bin").string();
+    std::filesystem::copy_file(path, corrupt);
+    {
+        std::fstream file(corrupt,
+                          std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(-1, std::ios::end);
+        file.put('\x7f');
+    }
+    BOOST_CHECK_THROW(load_coefficients(corrupt), std::runtime_error);
+    std::string truncated = (dir / "truncated.bin").string();
+    std::filesystem::copy_file(path, truncated);
+    std::filesystem::resize_file(truncated,
+                                 std::filesystem::file_size(path) - 8);
+    BOOST_CHECK_THROW(CoefficientFile{truncated}, std::runtime_error);
+    BOOST_TEST(Model::published_coefficients() == saved);
+    BOOST_CHECK_THROW(CalibrationTables::load((dir / "none.bin").string()),
+                      std::runtime_error);
+    std::filesystem::remove_all(dir);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
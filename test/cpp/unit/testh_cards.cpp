@@ -158,6 +158,16 @@ BOOST_AUTO_TEST_CASE(testclass_over) {
     BOOST_TEST(o.get_num_balls() == 2);
     BOOST_TEST(o.get_num_legal_delivs() == 1);
     BOOST_TEST(b1->next == b2);
+
+    // Balls which are only counted are kept by copies
+    o.count_ball(true);
+    BOOST_TEST(o.get_last() == b2);
+    BOOST_TEST(o.get_num_balls() == 3);
+    BOOST_TEST(o.get_num_legal_delivs() == 2);
+    Over copy(o);
+    BOOST_TEST(copy.get_num_balls() == 3);
+    BOOST_TEST(copy.get_num_legal_delivs() == 2);
+    BOOST_TEST(copy.get_last()->outcome == "W");
 }
 
 BOOST_AUTO_TEST_CASE(teststruct_fow) {
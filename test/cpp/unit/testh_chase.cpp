@@ -0,0 +1,117 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/parameterized_test.hpp>
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+
+#include "fixtures.hpp"
+#include "testmatch/chase.hpp"
+#include "testmatch/exact.hpp"
+#include "testmatch/models.hpp"
+#include "testmatch/simulation.hpp"
+
+using namespace boost::unit_test;
+
+BOOST_AUTO_TEST_SUITE(test_header_chase)
+
+BOOST_FIXTURE_TEST_CASE(testclass_chasetable, F_Pregame) {
+    ChaseTableOptions opts;
+    opts.max_runs = 200;
+    opts.max_overs = 40;
+    opts.rotation = {10};
+    ChaseTable table(&aus, &nz, &venue, opts);
+    BOOST_TEST(table.get_header().max_runs == 200);
+    BOOST_TEST(table.matches(&aus, &nz, &venue));
+    BOOST_TEST(!table.matches(&nz, &aus, &venue));
+
+    // Finished chases
+    BOOST_TEST(table.win_prob(0, 3, 10) == 1);
+    BOOST_TEST(table.win_prob(10, 0, 10) == 0);
+    BOOST_TEST(table.draw_prob(10, 5, 0) == 1);
+
+    // Probabilities sum to at most one and are monotone in runs and time
+    for (int w = 1; w <= 10; w++) {
+        for (int o = 0; o <= 40; o += 5) {
+            for (int r = 1; r <= 200; r += 7) {
+                double win = table.win_prob(r, w, 6 * o);
+                double draw = table.draw_prob(r, w, 6 * o);
+                BOOST_TEST(win >= 0);
+                BOOST_TEST(draw >= 0);
+                BOOST_TEST(win + draw <= 1 + 1e-5);
+                BOOST_TEST(table.win_prob(r + 1, w, 6 * o) <= win + 1e-6);
+                BOOST_TEST(table.win_prob(r, w, 6 * o + 6) >= win - 1e-6);
+            }
+        }
+    }
+
+    // The batters at the crease change with the wickets, so only the extremes
+    // are compared
+    BOOST_TEST(table.win_prob(100, 10, 120) > table.win_prob(100, 1, 120));
+
+    // Interpolated between overs, and clamped beyond the table
+    double mid = table.win_prob(100, 6, 63);
+    BOOST_TEST(mid == (table.win_prob(100, 6, 60) +
+                       table.win_prob(100, 6, 66)) / 2,
+               boost::test_tools::tolerance(1e-6));
+    BOOST_TEST(table.win_prob(100, 6, 1000) == table.win_prob(100, 6, 240));
+
+    // Agrees with the forward calculation from the start of the chase on the
+    // worn pitch, up to the weighting of which opener is on strike
+    PitchFactors worn = Model::MODEL_PITCH_WEAR(pf, opts.session);
+    Innings inns(&aus, &nz, 0, &worn, 4);
+    ExactOptions exact;
+    exact.rotation = {10};
+    exact.max_overs = 40;
+    exact.target = 150;
+    InningsDistribution dist = ExactInnings(inns.get_table(), exact).run();
+    BOOST_TEST(std::abs(table.win_prob(150, 10, 240) - dist.p_target) < 0.01);
+    BOOST_TEST(std::abs(table.draw_prob(150, 10, 240) - dist.p_in_progress) <
+               0.01);
+
+    // Saved and mapped back from a file
+    std::string path = "testh_chase_table.bin";
+    table.save(path);
+    {
+        ChaseTable mapped(path);
+        BOOST_TEST(mapped.matches(&aus, &nz, &venue));
+        for (int w = 1; w <= 10; w += 3) {
+            for (int r = 1; r <= 200; r += 13) {
+                BOOST_TEST(mapped.win_prob(r, w, 100) ==
+                           table.win_prob(r, w, 100));
+                BOOST_TEST(mapped.draw_prob(r, w, 100) ==
+                           table.draw_prob(r, w, 100));
+            }
+        }
+    }
+    std::remove(path.c_str());
+    BOOST_CHECK_THROW(ChaseTable(std::string("no_such_table.bin")),
+                      std::runtime_error);
+
+    // Tables are built for the pitch of one session
+    BOOST_TEST(table.get_header().session == 9);
+    ChaseTableOptions first_day = opts;
+    first_day.max_overs = 2;
+    first_day.session = 0;
+    ChaseTable fresh(&aus, &nz, &venue, first_day);
+    BOOST_TEST(fresh.get_header().fingerprint !=
+               table.get_header().fingerprint);
+    BOOST_TEST(fresh.matches(&aus, &nz, &venue));
+    first_day.session = SessionTables::NUM_SESSIONS;
+    BOOST_CHECK_THROW(ChaseTable(&aus, &nz, &venue, first_day),
+                      std::invalid_argument);
+
+    // Names are never cut short, so a stored table always matches its teams
+    Venue long_name = venue;
+    long_name.name = std::string(64, 'L');
+    BOOST_CHECK_THROW(ChaseTable(&aus, &nz, &long_name, opts),
+                      std::invalid_argument);
+    long_name.name = std::string(63, 'L');
+    opts.max_overs = 2;
+    BOOST_TEST(ChaseTable(&aus, &nz, &long_name, opts)
+                   .matches(&aus, &nz, &long_name));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
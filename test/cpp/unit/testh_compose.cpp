@@ -0,0 +1,105 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/parameterized_test.hpp>
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+#include <numeric>
+
+#include "fixtures.hpp"
+#include "testmatch/batch.hpp"
+#include "testmatch/compose.hpp"
+#include "testmatch/simulation.hpp"
+
+using namespace boost::unit_test;
+
+BOOST_AUTO_TEST_SUITE(test_header_compose)
+
+BOOST_FIXTURE_TEST_CASE(testclass_inningscache, F_Pregame) {
+    InningsCacheOptions opts;
+    opts.n_sims = 200;
+    opts.n_threads = 2;
+    InningsCache cache(opts);
+
+    const InningsTotals& totals = cache.get(&aus, &nz, &venue, 1);
+    BOOST_TEST(cache.get_misses() == 1);
+    BOOST_TEST(totals.n_sims == 200);
+    BOOST_TEST(std::accumulate(totals.runs.begin(), totals.runs.end(), 0.0) ==
+                   1.0, boost::test_tools::tolerance(1e-12));
+    BOOST_TEST(totals.wkts[10] == 1.0, boost::test_tools::tolerance(1e-12));
+    BOOST_TEST(totals.prob_runs_above(-1) == 1.0,
+               boost::test_tools::tolerance(1e-12));
+    BOOST_TEST(totals.mean_runs() > 0);
+    BOOST_TEST(totals.play.size() == totals.runs.size());
+    BOOST_TEST(totals.play_per_run() > 0);
+
+    // Repeated requests are served from the cache
+    const InningsTotals& again = cache.get(&aus, &nz, &venue, 1);
+    BOOST_TEST(&again == &totals);
+    BOOST_TEST(cache.get_hits() == 1);
+
+    // Pitches within the same bucket share entries
+    PitchFactors close = {pf.seam + 0.01, pf.spin - 0.01};
+    Venue other = {"Other", "City", "AUS", &close};
+    cache.get(&aus, &nz, &other, 1);
+    BOOST_TEST(cache.get_hits() == 2);
+    BOOST_TEST(cache.size() == 1);
+
+    // Different innings and pairings are separate entries, and do not depend
+    // on the order they are requested in
+    cache.get(&nz, &aus, &venue, 2);
+    BOOST_TEST(cache.size() == 2);
+    InningsCache fresh(opts);
+    BOOST_TEST(fresh.get(&nz, &aus, &venue, 2).runs ==
+                   cache.get(&nz, &aus, &venue, 2).runs,
+               boost::test_tools::per_element());
+
+    // An innings starting late in the match is played on the worn pitch
+    cache.get(&nz, &aus, &venue, 2, 12);
+    BOOST_TEST(cache.size() == 3);
+    cache.get(&nz, &aus, &venue, 2, 0);
+    BOOST_TEST(cache.size() == 3);
+
+    cache.clear();
+    BOOST_TEST(cache.size() == 0);
+    BOOST_TEST(cache.get_misses() == 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(testclass_matchevaluator, F_Pregame) {
+    InningsCacheOptions opts;
+    opts.n_sims = 1000;
+    opts.n_threads = 2;
+    InningsCache cache(opts);
+    MatchEvaluator evaluator(&cache);
+
+    MatchEstimate est = evaluator.evaluate(pregame);
+    BOOST_TEST(est.home_win + est.away_win + est.draw + est.tie == 1.0,
+               boost::test_tools::tolerance(1e-9));
+    unsigned int misses = cache.get_misses();
+    evaluator.evaluate(pregame);
+    BOOST_TEST(cache.get_misses() == misses);
+
+    TossResult toss = {&aus, &nz, bat};
+    MatchEstimate after = evaluator.evaluate(pregame, toss);
+    BOOST_TEST(after.home_win + after.away_win + after.draw + after.tie == 1.0,
+               boost::test_tools::tolerance(1e-9));
+    BOOST_TEST(after.draw > 0);
+
+    // Close to full simulation of the same fixture, drawn matches included
+    BatchOptions batch_opts;
+    batch_opts.n_sims = 1000;
+    batch_opts.n_threads = 2;
+    batch_opts.seed = 6;
+    BatchResult result = BatchRunner(pregame, batch_opts).run();
+    double n = result.get_n_sims();
+    double p_home = result.get_wins(&aus) / n;
+    double se = sqrt(p_home * (1 - p_home) / n);
+    BOOST_TEST(std::abs(est.home_win - p_home) < 6 * se);
+
+    // With the pitch worn as in a match, innings last long enough to draw
+    // about as often
+    double p_draw = result.result_prob(draw);
+    double se_draw = sqrt(p_draw * (1 - p_draw) / n);
+    BOOST_TEST(std::abs(est.draw - p_draw) < 6 * se_draw);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
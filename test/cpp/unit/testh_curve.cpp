@@ -0,0 +1,71 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/parameterized_test.hpp>
+#include <boost/test/unit_test.hpp>
+#include <sstream>
+#include <string>
+
+#include "fixtures.hpp"
+#include "testmatch/batch.hpp"
+#include "testmatch/curve.hpp"
+#include "testmatch/simulation.hpp"
+#include "testmatch/snapshot.hpp"
+
+using namespace boost::unit_test;
+
+BOOST_AUTO_TEST_SUITE(test_header_curve)
+
+BOOST_FIXTURE_TEST_CASE(testclass_wincurverunner, F_Pregame) {
+    std::string feed = "# First over\n"
+                       "0,,Boult\n1\n4\n1lb\n2wd\nW,b\n0\n"
+                       "\n"
+                       "6,,Southee\n";
+
+    WinCurveOptions opts;
+    opts.n_sims = 6;
+    opts.n_threads = 1;
+    opts.seed = 4;
+    TossResult toss = {&nz, &aus, field};
+
+    std::stringstream feed1(feed);
+    WinCurve curve = WinCurveRunner(pregame, toss, opts).run(feed1);
+
+    // One row before the first ball, and one after each delivery
+    BOOST_TEST(curve.size() == 9);
+    BOOST_TEST(curve.ball[8] == 8);
+    BOOST_TEST(curve.innings[8] == 1);
+    BOOST_TEST(curve.score[0] == 0);
+    BOOST_TEST(curve.score[8] == 14);
+    BOOST_TEST(curve.wkts[8] == 1);
+    for (unsigned int k = 0; k < curve.size(); k++) {
+        BOOST_TEST(curve.home_win[k] + curve.away_win[k] + curve.draw[k] +
+                       curve.tie[k] ==
+                   1.0, boost::test_tools::tolerance(1e-12));
+    }
+    BOOST_TEST(curve.to_csv().find(
+                   "ball,innings,score,wkts,home_win,away_win,draw,tie\n"
+                   "0,1,0,0,") == 0);
+
+    // Independent of the number of threads
+    opts.n_threads = 3;
+    std::stringstream feed2(feed);
+    WinCurve curve2 = WinCurveRunner(pregame, toss, opts).run(feed2);
+    BOOST_TEST(curve2.home_win == curve.home_win,
+               boost::test_tools::per_element());
+    BOOST_TEST(curve2.draw == curve.draw, boost::test_tools::per_element());
+
+    // Continuations from the first state use the same random streams as a
+    // batch continuing that state
+    Match match(pregame);
+    match.pregame(toss);
+    BatchOptions batch_opts;
+    batch_opts.n_sims = opts.n_sims;
+    batch_opts.n_threads = 1;
+    batch_opts.seed = opts.seed;
+    BatchResult result = BatchRunner(MatchSnapshot(match), batch_opts).run();
+    BOOST_TEST(curve.home_win[0] == result.win_prob(&aus));
+    BOOST_TEST(curve.away_win[0] == result.win_prob(&nz));
+    BOOST_TEST(curve.draw[0] == result.result_prob(draw));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,85 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/parameterized_test.hpp>
+#include <boost/test/unit_test.hpp>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "fixtures.hpp"
+#include "testmatch/emulator.hpp"
+#include "testmatch/simulation.hpp"
+
+using namespace boost::unit_test;
+
+BOOST_AUTO_TEST_SUITE(test_header_emulator)
+
+BOOST_FIXTURE_TEST_CASE(testclass_emulator, F_Pregame) {
+    EmulatorTrainerOptions opts;
+    opts.n_states = 500;
+    opts.n_sims = 10;
+    opts.n_threads = 2;
+    opts.seed = 8;
+    EmulatorTrainer trainer({pregame}, opts);
+
+    // Samples are reproducible, and reach beyond the first innings
+    std::vector<EmulatorSample> samples = trainer.sample(50, 3);
+    BOOST_TEST(samples.size() == 50);
+    std::vector<EmulatorSample> again = trainer.sample(50, 3);
+    bool innings[4] = {false};
+    for (unsigned int s = 0; s < samples.size(); s++) {
+        BOOST_TEST(samples[s].n_sims == 10);
+        BOOST_TEST(samples[s].wins + samples[s].draws + samples[s].ties <= 10);
+        BOOST_TEST(samples[s].mean_total >= samples[s].state.score);
+        BOOST_TEST(samples[s].wins == again[s].wins);
+        BOOST_TEST(samples[s].mean_total == again[s].mean_total);
+        innings[samples[s].state.inns_no - 1] = true;
+    }
+    BOOST_TEST(innings[0]);
+    BOOST_TEST(innings[2]);
+
+    Emulator emulator = trainer.train();
+    const EmulatorValidation& valid = emulator.get_validation();
+    BOOST_TEST(valid.n_states == 500);
+    BOOST_TEST(valid.win_brier < valid.baseline_win_brier);
+    BOOST_TEST(valid.total_rmse < valid.baseline_total_rmse);
+    BOOST_TEST(valid.print().find("Validation on 500 states") == 0);
+
+    // Probabilities are consistent, and follow the state of a chase
+    EmulatorState easy = {4, 280, 1, 2, 400, true, 150};
+    EmulatorState hard = {4, 20, -259, 8, 100, true, 150};
+    EmulatorPrediction p_easy = emulator.predict(easy);
+    EmulatorPrediction p_hard = emulator.predict(hard);
+    BOOST_TEST(p_easy.home_win + p_easy.away_win + p_easy.draw == 1.0,
+               boost::test_tools::tolerance(1e-12));
+    BOOST_TEST(p_easy.home_win > p_hard.home_win);
+    BOOST_TEST(p_hard.exp_total >= 20);
+
+    // Predictions from a match, and from its result
+    Match match(pregame);
+    match.pregame();
+    EmulatorPrediction start = emulator.predict(match);
+    BOOST_TEST(start.home_win + start.away_win + start.draw == 1.0,
+               boost::test_tools::tolerance(1e-12));
+    match.advance();
+    EmulatorPrediction end = emulator.predict(match);
+    BOOST_TEST(end.home_win + end.away_win + end.draw == 1.0);
+    BOOST_TEST(end.exp_total == match.get_current_innings()->get_team_score());
+
+    // Saved and loaded
+    std::string path = "testh_emulator.txt";
+    emulator.save(path);
+    Emulator loaded(path);
+    std::remove(path.c_str());
+    BOOST_TEST(loaded.predict(hard).home_win == p_hard.home_win,
+               boost::test_tools::tolerance(1e-12));
+    BOOST_TEST(loaded.predict(easy).exp_total == p_easy.exp_total,
+               boost::test_tools::tolerance(1e-12));
+    BOOST_TEST(loaded.get_validation().win_brier == valid.win_brier,
+               boost::test_tools::tolerance(1e-12));
+    BOOST_CHECK_THROW(Emulator(std::string("no_such_emulator.txt")),
+                      std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
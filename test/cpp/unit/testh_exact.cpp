@@ -0,0 +1,116 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/parameterized_test.hpp>
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+#include "fixtures.hpp"
+#include "testmatch/exact.hpp"
+#include "testmatch/helpers.hpp"
+#include "testmatch/simulation.hpp"
+
+using namespace boost::unit_test;
+
+// Monte Carlo innings with the same fixed bowling rotation
+struct MonteCarloInnings {
+    std::vector<double> runs;
+    std::vector<double> wkts;
+    unsigned int n_target;
+
+    MonteCarloInnings(F_Pregame& f, ExactOptions opts, unsigned int n) {
+        seed_rng(21);
+        n_target = 0;
+        Innings first(&f.aus, &f.nz, 0, &f.pf);
+        for (unsigned int i = 0; i < n; i++) {
+            Innings inns(&f.aus, &f.nz, -opts.target + 1, &f.pf,
+                         opts.target > 0 ? 4 : 1, first.get_table());
+            while (inns.get_is_open()) {
+                int over = inns.get_overs().size() - 1;
+                if (opts.max_overs > 0 && over == opts.max_overs)
+                    break;
+                if (inns.get_overs().back()->get_num_legal_delivs() == 0) {
+                    int k = opts.rotation[over % opts.rotation.size()];
+                    inns.set_bowler(f.nz.players[k]);
+                }
+                if (inns.step() == "win")
+                    n_target++;
+            }
+            runs.push_back(inns.get_team_score());
+            wkts.push_back(inns.get_wkts());
+        }
+    }
+};
+
+static double mean(const std::vector<double>& x) {
+    return std::accumulate(x.begin(), x.end(), 0.0) / x.size();
+}
+
+static double std_error(const std::vector<double>& x) {
+    double m = mean(x), ss = 0;
+    for (double v : x)
+        ss += (v - m) * (v - m);
+    return sqrt(ss / (x.size() - 1) / x.size());
+}
+
+BOOST_AUTO_TEST_SUITE(test_header_exact)
+
+BOOST_FIXTURE_TEST_CASE(testclass_exactinnings, F_Pregame) {
+    Innings first(&aus, &nz, 0, &pf);
+
+    // Limited overs, checked against Monte Carlo
+    ExactOptions opts;
+    opts.rotation = {10, 9, 8, 7};
+    opts.max_overs = 20;
+    InningsDistribution dist = ExactInnings(first.get_table(), opts).run();
+    BOOST_TEST(dist.n_balls == 120);
+    BOOST_TEST(std::accumulate(dist.runs.begin(), dist.runs.end(), 0.0) == 1.0,
+               boost::test_tools::tolerance(1e-9));
+    BOOST_TEST(std::accumulate(dist.wkts.begin(), dist.wkts.end(), 0.0) == 1.0,
+               boost::test_tools::tolerance(1e-9));
+    BOOST_TEST(dist.p_all_out + dist.p_in_progress == 1.0,
+               boost::test_tools::tolerance(1e-9));
+
+    MonteCarloInnings mc(*this, opts, 2000);
+    BOOST_TEST(std::abs(dist.mean_runs() - mean(mc.runs)) <
+               4 * std_error(mc.runs));
+    BOOST_TEST(std::abs(dist.mean_wkts() - mean(mc.wkts)) <
+               4 * std_error(mc.wkts));
+
+    // Full innings
+    opts.max_overs = 0;
+    opts.min_prob = 1e-12;
+    opts.tolerance = 1e-8;
+    dist = ExactInnings(first.get_table(), opts).run();
+    BOOST_TEST(dist.p_all_out > 1 - 1e-6);
+    BOOST_TEST(dist.wkts[10] > 1 - 1e-6);
+    BOOST_TEST(dist.runs_quantile(0.05) < dist.runs_quantile(0.5));
+    BOOST_TEST(dist.prob_runs_at_least(0) == 1.0,
+               boost::test_tools::tolerance(1e-6));
+
+    MonteCarloInnings mc_full(*this, opts, 200);
+    BOOST_TEST(std::abs(dist.mean_runs() - mean(mc_full.runs)) <
+               4 * std_error(mc_full.runs));
+
+    // Fourth innings chase
+    opts.target = 150;
+    dist = ExactInnings(first.get_table(), opts).run();
+    BOOST_TEST(dist.p_target + dist.p_all_out == 1.0,
+               boost::test_tools::tolerance(1e-6));
+    BOOST_TEST(dist.prob_runs_at_least(150) == dist.p_target,
+               boost::test_tools::tolerance(1e-6));
+
+    MonteCarloInnings mc_chase(*this, opts, 1000);
+    double p = (double)mc_chase.n_target / 1000;
+    BOOST_TEST(std::abs(dist.p_target - p) <
+               4 * sqrt(dist.p_target * (1 - dist.p_target) / 1000));
+
+    // Default rotation uses four bowlers
+    ExactOptions defaults;
+    defaults.max_overs = 10;
+    BOOST_TEST(ExactInnings(first.get_table(), defaults).run().n_balls == 60);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
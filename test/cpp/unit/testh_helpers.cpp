@@ -88,4 +88,26 @@ BOOST_AUTO_TEST_CASE(testfunc_is_slow_bowler) {
     }
 }
 
+BOOST_AUTO_TEST_CASE(testfunc_qnorm) {
+    double eps = 1e-6;
+    BOOST_TEST(std::abs(qnorm(0.5)) < eps);
+    BOOST_TEST(std::abs(qnorm(0.975) - 1.959964) < eps);
+    BOOST_TEST(std::abs(qnorm(0.01) + 2.326348) < eps);
+    BOOST_TEST(std::abs(qnorm(0.999) - 3.090232) < eps);
+
+    BOOST_CHECK_THROW(qnorm(0), std::invalid_argument);
+    BOOST_CHECK_THROW(qnorm(1), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(testfunc_wilson_half_width) {
+    // No trials gives a trivial interval
+    BOOST_TEST(wilson_half_width(0, 0, 1.96) == 1);
+
+    // Interval shrinks with more trials, and is non-zero at the boundary
+    BOOST_TEST(wilson_half_width(50, 100, 1.96) >
+               wilson_half_width(500, 1000, 1.96));
+    BOOST_TEST(wilson_half_width(100, 100, 1.96) > 0);
+    BOOST_TEST(std::abs(wilson_half_width(50, 100, 1.96) - 0.09617) < 1e-4);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
@@ -0,0 +1,138 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/parameterized_test.hpp>
+#include <boost/test/unit_test.hpp>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "fixtures.hpp"
+#include "testmatch/helpers.hpp"
+#include "testmatch/live.hpp"
+#include "testmatch/simulation.hpp"
+#include "testmatch/workers.hpp"
+
+using namespace boost::unit_test;
+
+BOOST_AUTO_TEST_SUITE(test_header_live)
+
+BOOST_AUTO_TEST_CASE(testfunc_parse_feed_line) {
+    FeedBall ball;
+    BOOST_TEST(!parse_feed_line("", ball));
+    BOOST_TEST(!parse_feed_line("# Day 1, session 1", ball));
+
+    BOOST_TEST(parse_feed_line("4\r", ball));
+    BOOST_TEST(ball.outcome == "4");
+    BOOST_TEST(!ball.has_dism);
+    BOOST_TEST(ball.bowler == "");
+
+    BOOST_TEST(parse_feed_line("W,lbw", ball));
+    BOOST_TEST(ball.outcome == "W");
+    BOOST_TEST(ball.has_dism);
+    BOOST_TEST(ball.dism == lbw);
+
+    BOOST_TEST(parse_feed_line("1lb,,Boult", ball));
+    BOOST_TEST(ball.outcome == "1lb");
+    BOOST_TEST(!ball.has_dism);
+    BOOST_TEST(ball.bowler == "Boult");
+
+    BOOST_CHECK_THROW(parse_feed_line("4,c", ball), std::invalid_argument);
+    BOOST_CHECK_THROW(parse_feed_line("W,x", ball), std::invalid_argument);
+    BOOST_CHECK_THROW(parse_feed_line("1,,a,b", ball), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(testclass_workerpool) {
+    WorkerPool pool(3);
+    BOOST_TEST(pool.size() == 3);
+
+    // Every iteration runs exactly once, on a valid worker, however many
+    // loops the pool is reused for
+    for (int rep = 0; rep < 20; rep++) {
+        std::vector<int> counts(100, 0);
+        std::vector<int> bad_worker(100, 0);
+        pool.parallel_for(0, 100, [&](unsigned int i, unsigned int worker) {
+            counts[i]++;
+            bad_worker[i] = worker >= 3;
+        });
+        BOOST_TEST(counts == std::vector<int>(100, 1),
+                   boost::test_tools::per_element());
+        BOOST_TEST(bad_worker == std::vector<int>(100, 0),
+                   boost::test_tools::per_element());
+    }
+
+    // Empty loop returns immediately
+    pool.parallel_for(5, 5, [](unsigned int, unsigned int) {});
+
+    // An exception on any worker is rethrown once the loop has stopped, and
+    // the pool can still be used afterwards
+    for (int rep = 0; rep < 20; rep++) {
+        BOOST_CHECK_THROW(
+            pool.parallel_for(0, 100,
+                              [](unsigned int i, unsigned int) {
+                                  if (i % 7 == 3)
+                                      throw std::runtime_error("Failed.");
+                              }),
+            std::runtime_error);
+    }
+    std::vector<int> counts(50, 0);
+    pool.parallel_for(0, 50, [&](unsigned int i, unsigned int) {
+        counts[i]++;
+    });
+    BOOST_TEST(counts == std::vector<int>(50, 1),
+               boost::test_tools::per_element());
+}
+
+BOOST_FIXTURE_TEST_CASE(testclass_livematch, F_Pregame) {
+    BatchOptions opts;
+    opts.n_sims = 8;
+    opts.n_threads = 2;
+    opts.seed = 17;
+
+    seed_rng(23);
+    LiveMatch live(pregame, {&nz, &aus, field}, opts);
+    Innings* inns = live.get_match().get_current_innings();
+    BOOST_TEST(inns->get_bat_team() == &aus);
+
+    std::stringstream feed;
+    feed << "# First over\n"
+         << "0,,Boult\n1\n4\n1lb\n2wd\nW,b\n0\n"
+         << "\n"
+         << "6,,Southee\n";
+
+    std::vector<LiveUpdate> updates;
+    unsigned int n = live.follow(
+        feed, [&updates](LiveUpdate& update) { updates.push_back(update); });
+    BOOST_TEST(n == 8);
+    BOOST_TEST(updates.size() == 8);
+
+    // Feed is applied exactly
+    BOOST_TEST(inns->get_team_score() == 14);
+    BOOST_TEST(inns->get_wkts() == 1);
+    BOOST_TEST(inns->get_overs().size() == 2);
+    BOOST_TEST(inns->get_balls() == 8);
+    BOOST_TEST(inns->get_overs()[0]->get_first()->bowler == &b11);
+    BOOST_TEST(inns->get_overs()[1]->get_first()->bowler == &b9);
+    BOOST_TEST(updates.back().state == "Australia 14/1 (1.1 ov)");
+
+    // Each update is a full batch of continuations
+    for (LiveUpdate& update : updates) {
+        BOOST_TEST(update.result.get_n_sims() == 8);
+        BOOST_TEST(update.elapsed_ms >= 0);
+    }
+    BOOST_TEST(updates[2].ball == 3);
+    BOOST_TEST(updates[0].print().find("1,Australia 0/0 (0.1 ov),") == 0);
+
+    // The random stream of the calling thread is left alone
+    double u = runif();
+    seed_rng(23);
+    BOOST_TEST(u == runif());
+
+    // Unknown outcome or bowler
+    FeedBall ball = {"7", false, bowled, ""};
+    BOOST_CHECK_THROW(live.apply(ball), std::invalid_argument);
+    ball = {"0", false, bowled, "Cummins"};
+    BOOST_CHECK_THROW(live.apply(ball), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
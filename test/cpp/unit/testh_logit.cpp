@@ -0,0 +1,107 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/parameterized_test.hpp>
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+#include <vector>
+
+#include "fixtures.hpp"
+#include "testmatch/helpers.hpp"
+#include "testmatch/logit.hpp"
+#include "testmatch/models.hpp"
+#include "testmatch/simulation.hpp"
+
+using namespace boost::unit_test;
+
+BOOST_AUTO_TEST_SUITE(test_header_logit)
+
+static Matchup make_matchup(double bat_avg, double bat_sr, double bowl_avg,
+                            double bowl_sr, BowlType type) {
+    Matchup output = {};
+    output.bat.career_bat_avg = bat_avg;
+    output.bat.career_strike_rate = bat_sr;
+    output.bat.bat_arm = right;
+    output.bowl.bowl_avg = bowl_avg;
+    output.bowl.strike_rate = bowl_sr;
+    output.bowl.bowl_arm = left;
+    output.bowl.bowl_type = type;
+    return output;
+}
+
+BOOST_AUTO_TEST_CASE(testclass_logitdeliverymodel) {
+    int n = Model::NUM_DELIV_OUTCOMES;
+    LogitDeliveryModel model;
+    BuiltinDeliveryModel builtin;
+
+    // Default coefficients reproduce the built-in model for the reference
+    // matchup, against pace and spin
+    Matchup reference[2] = {make_matchup(30, 50, 30, 60, fast_med),
+                            make_matchup(30, 50, 30, 60, offbreak)};
+    std::vector<double> logit(2 * n), expected(2 * n);
+    model.evaluate(reference, 2, logit.data());
+    builtin.evaluate(reference, 2, expected.data());
+    BOOST_TEST(logit == expected, boost::test_tools::tolerance(1e-9) <<
+                                      boost::test_tools::per_element());
+
+    // Distributions are valid, and wickets likelier for weaker batters and
+    // stronger bowlers
+    Matchup matchups[4] = {make_matchup(30, 50, 30, 60, fast_med),
+                           make_matchup(15, 50, 30, 60, fast_med),
+                           make_matchup(30, 50, 20, 45, fast_med),
+                           make_matchup(0, 0, 0, 0, legbreak)};
+    matchups[3].pitch = {0.3, 0.7};
+    std::vector<double> dists(4 * n);
+    model.evaluate(matchups, 4, dists.data());
+    for (int m = 0; m < 4; m++) {
+        BOOST_TEST(dists[m * n] == 0);
+        for (int k = 1; k < n; k++)
+            BOOST_TEST(dists[m * n + k] >= dists[m * n + k - 1]);
+        BOOST_TEST(dists[m * n + n - 1] < 1);
+    }
+    BOOST_TEST(dists[2 * n - 1] < dists[n - 1]);
+    BOOST_TEST(dists[3 * n - 1] < dists[n - 1]);
+
+    // Vectorised and scalar kernels agree
+    LogitDeliveryModel scalar(LogitDeliveryModel::default_coefficients(),
+                              false);
+    BOOST_TEST(!scalar.get_use_simd());
+    BOOST_TEST(model.get_use_simd() == LogitDeliveryModel::simd_available());
+    std::vector<double> scalar_dists(4 * n);
+    scalar.evaluate(matchups, 4, scalar_dists.data());
+    BOOST_TEST(dists == scalar_dists, boost::test_tools::tolerance(1e-12) <<
+                                          boost::test_tools::per_element());
+
+    // Extreme predictors neither overflow nor underflow to nothing
+    LogitCoefficients extreme = {};
+    for (int k = 0; k < n; k++)
+        extreme.weights[k][0] = k == 3 ? 2000 : -2000;
+    LogitDeliveryModel peaked(extreme);
+    std::vector<double> peaked_dist(n);
+    peaked.evaluate(matchups, 1, peaked_dist.data());
+    BOOST_TEST(peaked_dist[3] < 1e-300);
+    BOOST_TEST(peaked_dist[4] == 1, boost::test_tools::tolerance(1e-15));
+}
+
+BOOST_FIXTURE_TEST_CASE(testfeature_logit_match, F_Pregame) {
+    seed_rng(44);
+    LogitDeliveryModel model;
+    Match match(pregame);
+    match.set_delivery_model(&model);
+    match.pregame();
+    match.start(true);
+    BOOST_TEST(match.get_result() != nullptr);
+
+    // Tables see the pitch of the venue, as worn by the current session
+    Innings* inns = match.get_innings(0);
+    const double* probs = inns->get_table()->cdf(0, 0);
+    Matchup matchup = {};
+    matchup.bat = inns->get_batters()[0]->get_sim_stats();
+    matchup.bowl = inns->get_bowlers()[0]->get_sim_stats();
+    matchup.pitch = Model::MODEL_PITCH_WEAR(pf, inns->get_session());
+    std::vector<double> expected(Model::NUM_DELIV_OUTCOMES);
+    model.evaluate(&matchup, 1, expected.data());
+    for (int k = 0; k < Model::NUM_DELIV_OUTCOMES; k++)
+        BOOST_TEST(probs[k] == expected[k]);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
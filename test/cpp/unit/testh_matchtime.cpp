@@ -1,9 +1,14 @@
 #define BOOST_TEST_DYN_LINK
 
+#include "fixtures.hpp"
+#include "testmatch/helpers.hpp"
 #include "testmatch/matchtime.hpp"
+#include "testmatch/params.hpp"
+#include "testmatch/simulation.hpp"
 
 #include <boost/test/output_test_stream.hpp>
 #include <boost/test/unit_test.hpp>
+#include <cstdlib>
 #include <iostream>
 #include <string>
 
@@ -22,16 +27,152 @@ BOOST_AUTO_TEST_CASE(testclass_timeofday_constructors) {
     BOOST_TEST(t2.min() == 2);
     BOOST_TEST(t2.hrs() == 3);
 
+    // Seconds and minutes carry over
+    TimeOfDay t3(75, 59, 1);
+    BOOST_TEST(t3.sec() == 15);
+    BOOST_TEST(t3.min() == 0);
+    BOOST_TEST(t3.hrs() == 2);
+
     // Float constructor
+    TimeOfDay t4(10.30);
+    BOOST_TEST(t4.sec() == 0);
+    BOOST_TEST(t4.min() == 30);
+    BOOST_TEST(t4.hrs() == 10);
+    BOOST_CHECK_THROW(TimeOfDay(-1.0), std::invalid_argument);
 }
 
-BOOST_AUTO_TEST_CASE(testclass_timeofday_setters) {}
+BOOST_AUTO_TEST_CASE(testclass_timeofday_setters) {
+    TimeOfDay t1;
+    t1.set(17.05);
+    BOOST_TEST(t1.min() == 5);
+    BOOST_TEST(t1.hrs() == 17);
+}
 
 BOOST_AUTO_TEST_CASE(testclass_timeofday_operators) {
     TimeOfDay t1;
 
     // Casts
-    // BOOST_TEST(std::string(t1) == "00:00:00");
+    BOOST_TEST(std::string(t1) == "00:00:00");
+
+    t1 += 3725;
+    BOOST_TEST(std::string(t1) == "01:02:05");
+    BOOST_TEST(int(t1) == 3725);
+
+    t1++;
+    ++t1;
+    BOOST_TEST(int(t1) == 3727);
+
+    TimeOfDay t2 = t1 + TimeOfDay(10.58);
+    BOOST_TEST(std::string(t2) == "12:00:07");
+    BOOST_TEST((t2 + 53 == TimeOfDay(12.01)));
+}
+
+BOOST_AUTO_TEST_CASE(testclass_matchtime) {
+    MatchTime clock;
+    BOOST_TEST(clock.get_day() == 1);
+    BOOST_TEST(clock.get_seconds() == MatchTime::START_TIME);
+    BOOST_TEST(clock.get_session() == 0);
+    BOOST_TEST(clock.get_state() == "Session 1");
+    BOOST_TEST(std::string(clock) == "Day 1, 10:30:00, Session 1");
+    BOOST_TEST(clock.overs_left() == 5 * 90);
+
+    // The clock only stops for intervals at the end of an over
+    int overs = 0;
+    while (clock.get_session() == 0) {
+        clock.dots(false, 6);
+        bool stopped = clock.end_over();
+        BOOST_TEST(stopped == (clock.get_session() == 1));
+        overs++;
+    }
+    BOOST_TEST(overs > 20);
+    BOOST_TEST(overs < 30);
+    BOOST_TEST(clock.get_seconds() >=
+               MatchTime::LUNCH_START + MatchTime::LUNCH_DUR);
+    BOOST_TEST(clock.get_state() == "Session 2");
+
+    // Play is extended at the close, as the overs were bowled too slowly
+    while (clock.get_day() == 1) {
+        clock.dots(false, 6);
+        clock.end_over();
+        overs++;
+    }
+    BOOST_TEST(overs < MatchTime::MIN_OVERS);
+    BOOST_TEST(clock.get_seconds() == MatchTime::START_TIME);
+    BOOST_TEST(clock.get_session() == 3);
+    BOOST_TEST(clock.play_left_today() == 6 * 3600);
+    BOOST_TEST(clock.overs_left() == 4 * 90);
+
+    // Spinners bowl more quickly, and time runs out after the fifth day
+    int days[5] = {overs};
+    while (!clock.is_over()) {
+        int day = clock.get_day();
+        clock.dots(true, 6);
+        clock.end_over();
+        days[day - 1]++;
+    }
+    BOOST_TEST(days[1] > overs);
+    BOOST_TEST(days[1] > MatchTime::MIN_OVERS);
+    BOOST_TEST(std::abs(days[4] - days[1]) <= 2);
+    BOOST_TEST(clock.get_session() == 14);
+    BOOST_TEST(clock.play_left() == 0);
+    BOOST_TEST(clock.get_state() == "Stumps");
+
+    // Delivery durations follow the truncated exponential, and runs and
+    // wickets take longer
+    seed_rng(11);
+    MatchTime sampled;
+    int start = sampled.get_seconds();
+    for (int i = 0; i < 1000; i++)
+        sampled.delivery(false, 0);
+    double mean = (sampled.get_seconds() - start) / 1000.0;
+    BOOST_TEST(mean == rtexp_mean(45, 25, 60),
+               boost::test_tools::tolerance(0.02));
+
+    start = sampled.get_seconds();
+    sampled.delivery(true, 4);
+    BOOST_TEST(sampled.get_seconds() - start >= 15 + 40);
+    BOOST_TEST(sampled.get_seconds() - start <= 40 + 40);
+    start = sampled.get_seconds();
+    sampled.wicket(true);
+    BOOST_TEST(sampled.get_seconds() - start >= 15 + MatchTime::WICKET_DUR);
+}
+
+BOOST_FIXTURE_TEST_CASE(testfeature_matchtime_draws, F_Pregame) {
+    // Matches are played to a result or to the end of the fifth day, and
+    // draw more often when play is slower
+    seed_rng(12);
+    int draws[2] = {0, 0};
+    for (int slow = 0; slow < 2; slow++) {
+        if (slow) {
+            ParamRegistry::set("time.pace_mean_dur", 80);
+            ParamRegistry::set("time.run_dur", 20);
+        }
+
+        for (int i = 0; i < 20; i++) {
+            Match match(pregame);
+            match.pregame();
+            match.start(true);
+
+            MatchResult* result = match.get_result();
+            BOOST_TEST(result != nullptr);
+            if (result->get_type() == draw) {
+                draws[slow]++;
+                BOOST_TEST(match.get_time().is_over());
+            } else {
+                BOOST_TEST(!match.get_time().is_over());
+            }
+
+            // The clock caps the length of every match
+            int overs = 0;
+            for (int k = 0; k < match.get_num_innings(); k++)
+                overs += match.get_innings(k)->get_overs().size();
+            BOOST_TEST(overs <= MatchTime::NUM_DAYS * 100);
+        }
+    }
+    ParamRegistry::reset();
+
+    BOOST_TEST(draws[1] > draws[0]);
+    BOOST_TEST(draws[1] > 0);
 }
 
-BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
+BOOST_AUTO_TEST_SUITE_END()
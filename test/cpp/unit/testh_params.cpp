@@ -0,0 +1,135 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/parameterized_test.hpp>
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fixtures.hpp"
+#include "testmatch/models.hpp"
+#include "testmatch/params.hpp"
+#include "testmatch/simulation.hpp"
+
+using namespace boost::unit_test;
+
+BOOST_AUTO_TEST_SUITE(test_header_params)
+
+BOOST_AUTO_TEST_CASE(testclass_paramregistry) {
+    std::vector<std::string> names = ParamRegistry::names();
+    BOOST_TEST(names.size() == 70);
+    BOOST_TEST(ParamRegistry::has("fatigue.mean_pace"));
+    BOOST_TEST(ParamRegistry::has("delivery.spin_cdf.20"));
+    BOOST_TEST(!ParamRegistry::has("delivery.spin_cdf.0"));
+    BOOST_TEST(ParamRegistry::has("dismissal.pace_cdf.5"));
+    BOOST_TEST(ParamRegistry::has("follow_on.slope"));
+    BOOST_TEST(ParamRegistry::has("pitch.wear_rate"));
+    BOOST_CHECK_THROW(ParamRegistry::get("nonsense"), std::invalid_argument);
+    BOOST_CHECK_THROW(ParamRegistry::set("nonsense", 1),
+                      std::invalid_argument);
+
+    BOOST_TEST(ParamRegistry::get("fatigue.mean_pace") == 5);
+    BOOST_TEST(ParamRegistry::get("bowling.take_off_midpoint") == 180);
+    BOOST_TEST(ParamRegistry::get("fielding.wk_catch_prob") == 0.5);
+
+    // Changes only apply to the calling thread
+    ParamRegistry::set("fatigue.mean_pace", 7);
+    ParamRegistry::set("delivery.pace_cdf.1", 0.7);
+    double other = 0;
+    std::thread th(
+        [&other] { other = ParamRegistry::get("fatigue.mean_pace"); });
+    th.join();
+    BOOST_TEST(other == 5);
+    BOOST_TEST(ParamRegistry::get("fatigue.mean_pace") == 7);
+    BOOST_TEST(ParamRegistry::get_default("fatigue.mean_pace") == 5);
+
+    ParamRegistry::reset();
+    BOOST_TEST(ParamRegistry::get("fatigue.mean_pace") == 5);
+    BOOST_TEST(ParamRegistry::get("delivery.pace_cdf.1") ==
+               ParamRegistry::get_default("delivery.pace_cdf.1"));
+
+    // Toss and follow-on models read their coefficients from the thread
+    BOOST_TEST(Model::MODEL_TOSS_ELECT(0) == 0.05);
+    ParamRegistry::set("toss.field_prob_seam", 0.1);
+    BOOST_TEST(Model::MODEL_TOSS_ELECT(0) == 0.1);
+    ParamRegistry::set("follow_on.intercept", -HUGE_VAL);
+    BOOST_TEST(Model::MODEL_FOLLOW_ON(200) == 1);
+    ParamRegistry::reset();
+
+    // Overrides are undone when they go out of scope, including pinning
+    {
+        ParamOverride over({"fatigue.mean_pace", "delivery.pace_cdf.1"},
+                           {9, 0.6});
+        BOOST_TEST(ParamRegistry::get("fatigue.mean_pace") == 9);
+        BOOST_TEST(Model::coefficients_pinned());
+    }
+    BOOST_TEST(ParamRegistry::get("fatigue.mean_pace") == 5);
+    BOOST_TEST(ParamRegistry::get("delivery.pace_cdf.1") ==
+               ParamRegistry::get_default("delivery.pace_cdf.1"));
+    BOOST_TEST(!Model::coefficients_pinned());
+    BOOST_CHECK_THROW(ParamOverride({"nonsense"}, {1}), std::invalid_argument);
+    BOOST_CHECK_THROW(ParamOverride({"fatigue.mean_pace"}, {}),
+                      std::invalid_argument);
+    BOOST_TEST(ParamRegistry::get("fatigue.mean_pace") == 5);
+}
+
+BOOST_FIXTURE_TEST_CASE(testfeature_publish_coefficients, F_Pregame) {
+    std::shared_ptr<const Model::Coefficients> original =
+        Model::published_coefficients();
+    Model::Coefficients changed = *original;
+    changed.pace_cdf[1] = changed.spin_cdf[1] = 0.5;
+
+    // Tables made before publication, on a thread which has not synced
+    Match match(pregame);
+    match.pregame();
+    Innings* inns = match.get_innings(0);
+    SessionTables early(inns->get_batters(), inns->get_bowlers(), nullptr,
+                        &pf);
+    SessionTables late(inns->get_batters(), inns->get_bowlers(), nullptr,
+                       &pf);
+    unsigned long long expected = early.get(3)->fingerprint();
+    Model::publish_coefficients(
+        std::make_shared<const Model::Coefficients>(changed));
+    BOOST_TEST(Model::published_coefficients()->pace_cdf[1] == 0.5);
+    BOOST_TEST(Model::COEFFICIENTS.pace_cdf[1] == original->pace_cdf[1]);
+    BOOST_TEST(ParamRegistry::get_default("delivery.pace_cdf.1") == 0.5);
+
+    // Another thread picks up the new coefficients, but tables made before
+    // publication keep the old ones when it evaluates them
+    bool synced = false;
+    unsigned long long late_table = 0, new_table = 0;
+    std::thread th([&] {
+        synced = Model::sync_coefficients();
+        late_table = late.get(3)->fingerprint();
+        SessionTables fresh(inns->get_batters(), inns->get_bowlers(),
+                            nullptr, &pf);
+        new_table = fresh.get(3)->fingerprint();
+    });
+    th.join();
+    BOOST_TEST(synced);
+    BOOST_TEST(late_table == expected);
+    BOOST_TEST(new_table != expected);
+
+    // Threads which have changed a coefficient keep their own until reset
+    ParamRegistry::set("delivery.pace_cdf.2", 0.8);
+    BOOST_TEST(Model::coefficients_pinned());
+    BOOST_TEST(!Model::sync_coefficients());
+    BOOST_TEST(Model::COEFFICIENTS.pace_cdf[1] == original->pace_cdf[1]);
+    ParamRegistry::reset();
+    BOOST_TEST(!Model::coefficients_pinned());
+    BOOST_TEST(Model::COEFFICIENTS.pace_cdf[1] == 0.5);
+
+    // Preparing a match syncs the thread
+    Model::publish_coefficients(original);
+    Match next(pregame);
+    next.pregame();
+    BOOST_TEST(Model::COEFFICIENTS.pace_cdf[1] == original->pace_cdf[1]);
+    BOOST_TEST(!Model::sync_coefficients());
+    BOOST_CHECK_THROW(Model::publish_coefficients(nullptr),
+                      std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
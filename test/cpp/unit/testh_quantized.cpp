@@ -0,0 +1,121 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/parameterized_test.hpp>
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "fixtures.hpp"
+#include "testmatch/cards.hpp"
+#include "testmatch/helpers.hpp"
+#include "testmatch/logit.hpp"
+#include "testmatch/models.hpp"
+#include "testmatch/quantized.hpp"
+#include "testmatch/simulation.hpp"
+
+using namespace boost::unit_test;
+
+BOOST_AUTO_TEST_SUITE(test_header_quantized)
+
+BOOST_FIXTURE_TEST_CASE(testclass_quantizeddeliverymodel, F_Pregame) {
+    int n = Model::NUM_DELIV_OUTCOMES;
+    BuiltinDeliveryModel builtin;
+    QuantizedTableOptions opts;
+    opts.fixed_point = false;
+    QuantizedDeliveryModel floats(builtin, opts);
+    QuantizedDeliveryModel fixed(builtin);
+    BOOST_TEST(fixed.size() < floats.size());
+
+    // Exact at grid points, up to the precision of storage
+    Matchup corner = {};
+    corner.bat.career_bat_avg = 100;
+    corner.bat.career_strike_rate = 20;
+    corner.bat.bat_arm = right;
+    corner.bowl.bowl_avg = 15;
+    corner.bowl.strike_rate = 1000;
+    corner.bowl.bowl_type = offbreak;
+    std::vector<double> expected(n), actual(n);
+    builtin.evaluate(&corner, 1, expected.data());
+    floats.evaluate(&corner, 1, actual.data());
+    BOOST_TEST(actual == expected, boost::test_tools::tolerance(1e-7) <<
+                                       boost::test_tools::per_element());
+    fixed.evaluate(&corner, 1, actual.data());
+    BOOST_TEST(actual == expected, boost::test_tools::tolerance(1e-5) <<
+                                       boost::test_tools::per_element());
+
+    // Close to the source model between grid points, for every pairing of
+    // the two XIs
+    std::vector<Matchup> matchups;
+    for (Player* bat : aus.players) {
+        for (Player* bowl : nz.players) {
+            BatterCard bat_card(bat);
+            BowlerCard bowl_card(bowl);
+            Matchup matchup = {};
+            matchup.bat = bat_card.get_sim_stats();
+            matchup.bowl = bowl_card.get_sim_stats();
+            matchups.push_back(matchup);
+        }
+    }
+    int n_matchups = matchups.size();
+    std::vector<double> source(n_matchups * n), table(n_matchups * n);
+    builtin.evaluate(matchups.data(), n_matchups, source.data());
+    fixed.evaluate(matchups.data(), n_matchups, table.data());
+    for (int i = 0; i < n_matchups * n; i++)
+        BOOST_TEST(std::abs(source[i] - table[i]) < 1e-3);
+    for (int m = 0; m < n_matchups; m++) {
+        BOOST_TEST(table[m * n] == 0);
+        for (int k = 1; k < n; k++)
+            BOOST_TEST(table[m * n + k] >= table[m * n + k - 1]);
+    }
+
+    // Tables of other models take their pitch from the options
+    LogitDeliveryModel logit;
+    opts.pitch = pf;
+    QuantizedDeliveryModel quant_logit(logit, opts);
+    corner.pitch = pf;
+    logit.evaluate(&corner, 1, expected.data());
+    quant_logit.evaluate(&corner, 1, actual.data());
+    BOOST_TEST(actual == expected, boost::test_tools::tolerance(1e-7) <<
+                                       boost::test_tools::per_element());
+
+    // A bowler without a record takes the logit model's placeholders, at the
+    // weakest grid point, rather than the strongest
+    Matchup unknown = corner;
+    unknown.bowl.bowl_avg = 0;
+    unknown.bowl.strike_rate = 0;
+    logit.evaluate(&unknown, 1, expected.data());
+    quant_logit.evaluate(&unknown, 1, actual.data());
+    BOOST_TEST(actual == expected, boost::test_tools::tolerance(1e-7) <<
+                                       boost::test_tools::per_element());
+
+    // Saved and mapped back from a file
+    std::string path = "testh_quantized_table.bin";
+    fixed.save(path);
+    {
+        QuantizedDeliveryModel mapped(path);
+        BOOST_TEST(mapped.size() == fixed.size());
+        BOOST_TEST(mapped.get_header().n_points[2] == 12);
+        std::vector<double> from_file(n_matchups * n);
+        mapped.evaluate(matchups.data(), n_matchups, from_file.data());
+        BOOST_TEST(from_file == table, boost::test_tools::per_element());
+
+        seed_rng(45);
+        Match match(pregame);
+        match.set_delivery_model(&mapped);
+        match.pregame();
+        match.start(true);
+        BOOST_TEST(match.get_result() != nullptr);
+    }
+    std::remove(path.c_str());
+    BOOST_CHECK_THROW(QuantizedDeliveryModel(std::string("no_such_table.bin")),
+                      std::runtime_error);
+
+    opts.n_points[0] = 1;
+    BOOST_CHECK_THROW(QuantizedDeliveryModel(builtin, opts),
+                      std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,119 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/parameterized_test.hpp>
+#include <boost/test/unit_test.hpp>
+#include <vector>
+
+#include "fixtures.hpp"
+#include "testmatch/batch.hpp"
+#include "testmatch/helpers.hpp"
+#include "testmatch/query.hpp"
+#include "testmatch/simulation.hpp"
+
+using namespace boost::unit_test;
+
+BOOST_AUTO_TEST_SUITE(test_header_query)
+
+BOOST_FIXTURE_TEST_CASE(testclass_matchquery, F_Pregame) {
+    int yes = 1, no = 0, unsettled = MatchQuery::UNSETTLED;
+    auto constant = [](int answer) {
+        return MatchQuery("constant", [answer](Match&) { return answer; });
+    };
+
+    Match match(pregame);
+    match.pregame();
+    std::vector<int> answers = {yes, no, unsettled};
+    for (int x : answers) {
+        for (int y : answers) {
+            int both = (constant(x) && constant(y)).settle(match);
+            int either = (constant(x) || constant(y)).settle(match);
+            if (x == no || y == no)
+                BOOST_TEST(both == no);
+            else if (x == yes && y == yes)
+                BOOST_TEST(both == yes);
+            else
+                BOOST_TEST(both == unsettled);
+
+            if (x == yes || y == yes)
+                BOOST_TEST(either == yes);
+            else if (x == no && y == no)
+                BOOST_TEST(either == no);
+            else
+                BOOST_TEST(either == unsettled);
+        }
+        BOOST_TEST((!constant(x)).settle(match) ==
+                   (x == unsettled ? unsettled : 1 - x));
+    }
+
+    // Only queries which change mid-innings are checked by delivery
+    MatchQuery win = MatchQuery::wins(&aus);
+    MatchQuery runs = MatchQuery::team_runs_at_least(&aus, 1, 300);
+    BOOST_TEST(!win.is_by_delivery());
+    BOOST_TEST(runs.is_by_delivery());
+    BOOST_TEST((win || runs).is_by_delivery());
+
+    // Nothing is settled before a ball is bowled, and everything once the
+    // match is over
+    BOOST_TEST(runs.settle(match) == unsettled);
+    BOOST_TEST(win.settle(match) == unsettled);
+    match.start(true);
+    BOOST_TEST(runs.settle(match) != unsettled);
+    BOOST_TEST(win.settle(match) ==
+               (match.get_result()->get_winner() == &aus ? yes : no));
+}
+
+BOOST_FIXTURE_TEST_CASE(testfeature_short_circuit, F_Pregame) {
+    BatchOptions opts;
+    opts.n_sims = 200;
+    opts.n_threads = 2;
+    opts.seed = 3;
+    BatchRunner runner(pregame, opts);
+
+    std::vector<MatchQuery> queries = {
+        MatchQuery::team_runs_at_least(&aus, 1, 300),
+        MatchQuery::player_runs_at_least(&a4, 50),
+        MatchQuery::wins(&nz) && MatchQuery::team_runs_at_least(&nz, 2, 100)};
+
+    // The same matches simulated in full
+    std::vector<int> full(queries.size(), 0);
+    for (unsigned int i = 0; i < opts.n_sims; i++) {
+        seed_rng(mix_seed(opts.seed, i));
+        Match match(pregame);
+        match.pregame();
+        match.start(true);
+        for (unsigned int q = 0; q < queries.size(); q++)
+            full[q] += queries[q].settle(match);
+    }
+
+    WorkerPool pool(2);
+    for (unsigned int q = 0; q < queries.size(); q++) {
+        QueryResult result = runner.run_query(queries[q], &pool);
+        BOOST_TEST(result.get_n_sims() == opts.n_sims);
+        BOOST_TEST(result.get_n_true() == full[q]);
+        BOOST_TEST(result.prob() == (double)full[q] / opts.n_sims);
+        BOOST_TEST(result.mean_innings() <= 4);
+    }
+
+    // A first innings total is settled within the first two innings
+    QueryResult first = runner.run_query(queries[0]);
+    BOOST_TEST(first.mean_innings() <= 2);
+    QueryResult negated = runner.run_query(!queries[0]);
+    BOOST_TEST(negated.get_n_true() + first.get_n_true() == opts.n_sims);
+
+    // Stratified toss weights strata by probability
+    opts.stratify_toss = true;
+    QueryResult strat = BatchRunner(pregame, opts).run_query(queries[0]);
+    BOOST_TEST(strat.get_n_sims() == opts.n_sims);
+    BOOST_TEST(strat.prob() >= 0);
+    BOOST_TEST(strat.prob() <= 1);
+    BOOST_TEST(strat.std_error() > 0);
+
+    // Default result is empty, and merging into it gives the shard
+    QueryResult total;
+    BOOST_TEST(total.get_n_sims() == 0);
+    total += first;
+    BOOST_TEST(total.get_n_sims() == first.get_n_sims());
+    BOOST_TEST(total.get_n_true() == first.get_n_true());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
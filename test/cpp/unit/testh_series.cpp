@@ -0,0 +1,117 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "fixtures.hpp"
+#include "testmatch/series.hpp"
+#include "testmatch/simulation.hpp"
+#include "testmatch/team.hpp"
+#include "testmatch/workers.hpp"
+
+BOOST_AUTO_TEST_SUITE(test_header_series)
+
+BOOST_AUTO_TEST_CASE(testclass_taskscheduler) {
+    for (unsigned int n_threads : {1u, 3u}) {
+        TaskScheduler scheduler(n_threads);
+        BOOST_TEST(scheduler.size() == n_threads);
+
+        // Tasks nested three deep, each waiting on its own children
+        std::atomic<int> total(0);
+        TaskGroup outer(scheduler);
+        for (int i = 0; i < 8; i++) {
+            outer.run([&scheduler, &total](unsigned int) {
+                TaskGroup middle(scheduler);
+                for (int j = 0; j < 4; j++) {
+                    middle.run([&scheduler, &total](unsigned int) {
+                        TaskGroup inner(scheduler);
+                        for (int k = 0; k < 3; k++)
+                            inner.run([&total](unsigned int) { total++; });
+                        inner.wait();
+                    });
+                }
+                middle.wait();
+            });
+        }
+        outer.wait();
+        BOOST_TEST(total == 8 * 4 * 3);
+
+        // The first exception of a group is rethrown by wait
+        TaskGroup failing(scheduler);
+        for (int i = 0; i < 4; i++) {
+            failing.run([](unsigned int) {
+                throw std::runtime_error("Task failed.");
+            });
+        }
+        BOOST_CHECK_THROW(failing.wait(), std::runtime_error);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(testclass_tournamentrunner, F_Pregame) {
+    std::vector<Series> fixtures = {
+        {"Trans-Tasman Trophy", &aus, &nz, {&venue, &venue}},
+        {"Return series", &nz, &aus, {&venue}}};
+
+    TournamentOptions opts;
+    opts.n_sims = 12;
+    opts.n_threads = 3;
+    opts.seed = 2022;
+    TournamentResult res = TournamentRunner(fixtures, opts).run();
+    BOOST_TEST(res.get_n_sims() == 12);
+
+    // Every replicate of a series ends with one scoreline
+    SeriesResult& series = res.get_series()[0];
+    BOOST_TEST(series.get_n_sims() == 12);
+    BOOST_TEST(series.get_n_matches() == 2);
+    double total = 0;
+    for (unsigned int h = 0; h <= 2; h++) {
+        for (unsigned int a = 0; h + a <= 2; a++)
+            total += series.scoreline_prob(h, a);
+    }
+    BOOST_TEST(total == 1, boost::test_tools::tolerance(1e-9));
+    BOOST_TEST(series.win_prob(&aus) + series.win_prob(&nz) +
+                       series.drawn_prob() ==
+                   1,
+               boost::test_tools::tolerance(1e-9));
+    BOOST_TEST(series.mean_wins(&aus) ==
+                   series.match_win_prob(0, &aus) +
+                       series.match_win_prob(1, &aus),
+               boost::test_tools::tolerance(1e-9));
+    BOOST_TEST(series.scoreline_prob(2, 1) == 0);
+
+    // Every replicate ranks both teams
+    Standing* first = res.get_standing(&aus);
+    Standing* second = res.get_standing(&nz);
+    BOOST_TEST(res.get_standing(nullptr) == nullptr);
+    BOOST_TEST(first->position_prob(0) + second->position_prob(0) == 1,
+               boost::test_tools::tolerance(1e-9));
+    BOOST_TEST(first->top_prob(2) == 1, boost::test_tools::tolerance(1e-9));
+    BOOST_TEST(first->mean_points() >= 0);
+    BOOST_TEST(first->mean_points() <= 3 * opts.points.win);
+    BOOST_TEST(first->mean_pct() <= 100);
+    BOOST_TEST(res.print().find(aus.name + " v " + nz.name) !=
+               std::string::npos);
+
+    // Results do not depend on the number of threads
+    opts.n_threads = 1;
+    TournamentResult res_serial = TournamentRunner(fixtures, opts).run();
+    BOOST_TEST(res_serial.get_series()[1].match_win_prob(0, &nz) ==
+               res.get_series()[1].match_win_prob(0, &nz));
+    BOOST_TEST(res_serial.get_standing(&aus)->mean_points() ==
+                   first->mean_points(),
+               boost::test_tools::tolerance(1e-9));
+    BOOST_TEST(res_serial.get_standing(&nz)->position_prob(0) ==
+               second->position_prob(0));
+
+    // Invalid fixtures
+    std::vector<Series> no_matches = {{"Empty", &aus, &nz, {}}};
+    BOOST_CHECK_THROW(TournamentRunner(no_matches, opts),
+                      std::invalid_argument);
+    std::vector<Series> one_team = {{"Intra-squad", &aus, &aus, {&venue}}};
+    BOOST_CHECK_THROW(TournamentRunner(one_team, opts), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -5,13 +5,16 @@
 #include <cmath>
 #include <exception>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #define private public // Illegal command :(
 
 #include "fixtures.hpp"
 #include "testmatch/cards.hpp"
+#include "testmatch/helpers.hpp"
 #include "testmatch/models.hpp"
 #include "testmatch/simulation.hpp"
 #include "testmatch/team.hpp"
@@ -70,6 +73,252 @@ BOOST_FIXTURE_TEST_CASE(testclass_innings, F_Pregame) {
     // Simulate a delivery
 }
 
+BOOST_FIXTURE_TEST_CASE(testfeature_clone_match, F_Pregame) {
+    seed_rng(5);
+    Match match(pregame);
+    match.pregame();
+
+    // Play into the second innings
+    BOOST_TEST(match.advance([](Match& m) {
+        return m.get_num_innings() == 2 && m.get_innings(1)->get_wkts() == 3;
+    }));
+    BOOST_TEST(match.get_innings(0)->get_is_open() == false);
+
+    // Clone has the same state, but its own scorecards
+    Match* clone = new Match(match);
+    Innings* inns = match.get_innings(1);
+    Innings* clone_inns = clone->get_innings(1);
+    BOOST_TEST(clone_inns != inns);
+    BOOST_TEST(clone_inns->get_batters()[0] != inns->get_batters()[0]);
+    BOOST_TEST(clone_inns->get_team_score() == inns->get_team_score());
+    BOOST_TEST(clone_inns->get_balls() == inns->get_balls());
+    for (int i = 0; i < 11; i++) {
+        BOOST_TEST((clone_inns->batters[i] == clone_inns->striker) ==
+                   (inns->batters[i] == inns->striker));
+        BOOST_TEST((clone_inns->bowlers[i] == clone_inns->bowl1) ==
+                   (inns->bowlers[i] == inns->bowl1));
+    }
+
+    // With the same random stream, both continue identically
+    seed_rng(6);
+    match.advance([](Match& m) { return false; });
+    seed_rng(6);
+    clone->advance([](Match& m) { return false; });
+    BOOST_TEST(match.get_result() != nullptr);
+    BOOST_TEST(clone->get_result()->get_type() ==
+               match.get_result()->get_type());
+    BOOST_TEST(clone->get_num_innings() == match.get_num_innings());
+    for (int i = 0; i < match.get_num_innings(); i++) {
+        BOOST_TEST(clone->get_innings(i)->get_team_score() ==
+                   match.get_innings(i)->get_team_score());
+    }
+
+    // Original is unaffected by deleting the clone
+    delete clone;
+    BOOST_TEST(match.print_all().size() > 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(testclass_matchuptable, F_Pregame) {
+    seed_rng(8);
+    Match match(pregame);
+    match.pregame();
+    match.advance([](Match& m) { return m.get_num_innings() == 3; });
+
+    // Table matches the delivery model for every pairing, on the pitch of
+    // the session
+    Innings* inns = match.get_innings(0);
+    std::shared_ptr<const MatchupTable> table = inns->get_table();
+    PitchFactors worn = Model::MODEL_PITCH_WEAR(pf, inns->session);
+    for (int i = 0; i < 11; i++) {
+        for (int j = 0; j < 11; j++) {
+            double* probs = new double[Model::NUM_DELIV_OUTCOMES];
+            Matchup matchup = {};
+            matchup.bat = inns->batters[i]->get_sim_stats();
+            matchup.bowl = inns->bowlers[j]->get_sim_stats();
+            matchup.pitch = worn;
+            DeliveryModel::builtin()->evaluate(&matchup, 1, probs);
+            for (int k = 0; k < Model::NUM_DELIV_OUTCOMES; k++)
+                BOOST_TEST(table->cdf(i, j)[k] == probs[k]);
+            BOOST_TEST(table->expected_runs(i, j) ==
+                       Model::expected_runs(probs));
+
+            // Outcomes other than a dot ball, rescaled
+            double p_dot = table->dot_prob(i, j);
+            BOOST_TEST(p_dot == probs[1] - probs[0]);
+            const double* scoring = table->scoring_cdf(i, j);
+            BOOST_TEST(scoring[1] == 0.0);
+            for (int k = 2; k < Model::NUM_DELIV_OUTCOMES; k++)
+                BOOST_TEST(scoring[k] * (1 - p_dot) == probs[k] - probs[1],
+                           boost::test_tools::tolerance(1e-12));
+            delete[] probs;
+        }
+    }
+
+    // Tables of every session shared with later innings by the same batting
+    // team, and with clones
+    Innings* third = match.get_innings(2);
+    BOOST_TEST((third->sessions == inns->sessions) ==
+               (third->get_bat_team() == inns->get_bat_team()));
+    BOOST_TEST(third->get_table() == third->sessions->get(third->session));
+    BOOST_TEST(match.get_innings(1)->sessions != inns->sessions);
+    Match clone(match);
+    BOOST_TEST(clone.get_innings(0)->get_table() == table);
+}
+
+// Every delivery is a four, or a wicket one time in ten
+class FoursModel : public DeliveryModel {
+  public:
+    mutable int n_calls = 0;
+    mutable int n_matchups = 0;
+
+    void evaluate(const Matchup* matchups, int n,
+                  double* output) const override {
+        n_calls++;
+        n_matchups += n;
+        for (int m = 0; m < n; m++) {
+            for (int k = 0; k < Model::NUM_DELIV_OUTCOMES; k++)
+                output[m * Model::NUM_DELIV_OUTCOMES + k] = k <= 14 ? 0 : 0.9;
+        }
+    }
+};
+
+BOOST_FIXTURE_TEST_CASE(testclass_deliverymodel, F_Pregame) {
+    // A batch of the built-in model matches one at a time
+    Match match(pregame);
+    match.pregame();
+    match.advance([](Match& m) { return m.get_num_innings() == 1; });
+    Innings* inns = match.get_innings(0);
+    Matchup matchups[3] = {};
+    for (int m = 0; m < 3; m++) {
+        matchups[m].bat = inns->batters[m]->get_sim_stats();
+        matchups[m].bowl = inns->bowlers[10 - m]->get_sim_stats();
+    }
+    double batch[3 * 22];
+    DeliveryModel::builtin()->evaluate(matchups, 3, batch);
+    for (int m = 0; m < 3; m++) {
+        double* probs = Model::MODEL_DELIVERY(matchups[m].bat, matchups[m].bowl);
+        for (int k = 0; k < Model::NUM_DELIV_OUTCOMES; k++)
+            BOOST_TEST(batch[m * Model::NUM_DELIV_OUTCOMES + k] == probs[k]);
+        delete[] probs;
+    }
+
+    // Matches evaluate their model once per table, for every pairing at once,
+    // with a table for each batting team and session that is reached
+    FoursModel fours;
+    Match custom(pregame);
+    custom.set_delivery_model(&fours);
+    custom.pregame();
+    BOOST_TEST(fours.n_calls == 1);
+    custom.start(true);
+    BOOST_TEST(fours.n_calls ==
+               custom.sessions[0]->size() + custom.sessions[1]->size());
+    BOOST_TEST(fours.n_calls <= 2 * SessionTables::NUM_SESSIONS);
+    BOOST_TEST(fours.n_matchups == fours.n_calls * 121);
+    for (int i = 0; i < custom.get_num_innings(); i++)
+        BOOST_TEST(custom.get_innings(i)->get_team_score() % 4 == 0);
+
+    Match clone(custom);
+    BOOST_TEST(clone.get_delivery_model() == &fours);
+}
+
+BOOST_FIXTURE_TEST_CASE(testfeature_event_skipping, F_Pregame) {
+    // Dot balls applied together match those applied one at a time
+    seed_rng(12);
+    Innings inns(&aus, &nz, 0, &pf);
+    inns.step();
+    Innings copy(inns);
+    inns.update_dots(3);
+    for (int k = 0; k < 3; k++)
+        copy.update_state("0", nullptr);
+    BOOST_TEST(inns.get_balls() == copy.get_balls());
+    BOOST_TEST(inns.legal_delivs == copy.legal_delivs);
+    BOOST_TEST(inns.last_over->get_num_balls() ==
+               copy.last_over->get_num_balls());
+    BOOST_TEST(inns.striker->stats.balls == copy.striker->stats.balls);
+    BOOST_TEST(inns.bowl1->stats.balls == copy.bowl1->stats.balls);
+    BOOST_TEST(inns.bowl1->stats.over_balls == copy.bowl1->stats.over_balls);
+    BOOST_TEST(inns.bat_parts[0]->get_balls() ==
+               copy.bat_parts[0]->get_balls());
+
+    // Whole innings have the same distribution as innings simulated one
+    // delivery at a time, in both the runs scored and the time taken
+    Innings first(&aus, &nz, 0, &pf);
+    double sum[2][2] = {{0}}, sum_sq[2][2] = {{0}};
+    int n = 2000;
+    for (int i = 0; i < n; i++) {
+        MatchTime skip_clock, each_clock;
+        Innings skip(&aus, &nz, 0, &pf, 1, first.get_table());
+        skip.time = &skip_clock;
+        skip.simulate(true);
+        Innings each(&aus, &nz, 0, &pf, 1, first.get_table());
+        each.time = &each_clock;
+        while (each.get_is_open())
+            each.step();
+
+        double x[2][2] = {
+            {(double)skip.get_team_score(), (double)each.get_team_score()},
+            {(double)(MatchTime().play_left() - skip_clock.play_left()),
+             (double)(MatchTime().play_left() - each_clock.play_left())}};
+        for (int j = 0; j < 2; j++) {
+            for (int k = 0; k < 2; k++) {
+                sum[j][k] += x[j][k];
+                sum_sq[j][k] += x[j][k] * x[j][k];
+            }
+        }
+    }
+    for (int j = 0; j < 2; j++) {
+        double var = 0;
+        for (int k = 0; k < 2; k++)
+            var += (sum_sq[j][k] / n - sum[j][k] * sum[j][k] / n / n) / n;
+        BOOST_TEST(std::abs(sum[j][0] - sum[j][1]) / n < 4 * sqrt(var));
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(testfeature_commentary_policies, F_Pregame) {
+    // Every instantiation of the engine uses the same random numbers
+    std::vector<int> scores[5];
+    int n_events = 0, n_balls = 0;
+    for (int k = 0; k < 5; k++) {
+        seed_rng(14);
+        Match match(pregame);
+        match.set_event_sink(
+            [&n_events](Innings&, const Ball&) { n_events++; });
+        match.pregame();
+        if (k == 0)
+            match.start(true);
+        else if (k == 1)
+            match.start_with<QuietCommentary>();
+        else if (k == 2)
+            match.start_with<RuntimeCommentary>();
+        else if (k == 3)
+            match.start_with<SummaryCommentary>();
+        else
+            match.start_with<SinkCommentary>();
+
+        for (int i = 0; i < match.get_num_innings(); i++) {
+            Innings* inns = match.get_innings(i);
+            scores[k].push_back(inns->get_team_score());
+            scores[k].push_back(inns->get_wkts());
+            scores[k].push_back(inns->get_balls());
+            BOOST_TEST(inns->is_quiet);
+
+            // Only the recording policies keep each ball
+            Over* first = inns->get_overs()[0].get();
+            BOOST_TEST(first->get_num_legal_delivs() == 6);
+            BOOST_TEST((first->get_first() != nullptr) == (k < 3));
+            if (k == 4)
+                n_balls += inns->get_balls();
+        }
+    }
+    BOOST_TEST(scores[0] == scores[1]);
+    BOOST_TEST(scores[0] == scores[2]);
+    BOOST_TEST(scores[0] == scores[3]);
+    BOOST_TEST(scores[0] == scores[4]);
+
+    // Only the sink policy passes deliveries to the sink, every one of them
+    BOOST_TEST(n_events == n_balls);
+}
+
 BOOST_AUTO_TEST_CASE(testfeature_followon) {
 
     // Cases where follow-on is not an option
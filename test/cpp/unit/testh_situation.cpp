@@ -0,0 +1,145 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/parameterized_test.hpp>
+#include <boost/test/unit_test.hpp>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define private public // Illegal command :(
+
+#include "fixtures.hpp"
+#include "testmatch/cards.hpp"
+#include "testmatch/helpers.hpp"
+#include "testmatch/models.hpp"
+#include "testmatch/simulation.hpp"
+#include "testmatch/situation.hpp"
+
+using namespace boost::unit_test;
+
+BOOST_AUTO_TEST_SUITE(test_header_situation)
+
+BOOST_AUTO_TEST_CASE(testclass_situationtable_buckets) {
+    // Every representative situation lies in its own bucket
+    for (int b = 0; b < SituationTable::NUM_BUCKETS; b++) {
+        BOOST_TEST(SituationTable::bucket(SituationTable::representative(
+                       b, 4)) == b);
+    }
+
+    MatchStats fresh = {1, 0, 0, 0, 0};
+    MatchStats set = {1, 0, 50, 0, 0};
+    MatchStats old_ball = {1, 400, 0, 0, 0};
+    MatchStats day_five = {1, 0, 0, 0, 2500};
+    MatchStats chase = {4, 0, 0, 5.5, 0};
+    BOOST_TEST(SituationTable::bucket(fresh) == 0);
+    BOOST_TEST(SituationTable::bucket(set) != SituationTable::bucket(fresh));
+    BOOST_TEST(SituationTable::bucket(old_ball) !=
+               SituationTable::bucket(fresh));
+    BOOST_TEST(SituationTable::bucket(day_five) !=
+               SituationTable::bucket(fresh));
+    BOOST_TEST(SituationTable::bucket(chase) != SituationTable::bucket(fresh));
+}
+
+BOOST_AUTO_TEST_CASE(testclass_situationdeliverymodel) {
+    int n = Model::NUM_DELIV_OUTCOMES;
+    BuiltinDeliveryModel builtin;
+    SituationDeliveryModel model;
+    BOOST_TEST(model.uses_situation());
+    BOOST_TEST(!builtin.uses_situation());
+
+    Matchup base = {};
+    base.bat.career_bat_avg = 30;
+    base.bat.career_strike_rate = 50;
+    base.bat.bat_arm = right;
+    base.bowl.bowl_avg = 30;
+    base.bowl.strike_rate = 60;
+    base.bowl.bowl_type = fast_med;
+    base.situation = {1, 300, 100, 0, 0};
+
+    // Neutral effects leave the wrapped model unchanged
+    SituationEffects neutral = {1, 15, 1, 15, 0, 0, 1, 3, 0, 0};
+    SituationDeliveryModel unchanged(&builtin, neutral);
+    std::vector<double> expected(n), actual(n);
+    builtin.evaluate(&base, 1, expected.data());
+    unchanged.evaluate(&base, 1, actual.data());
+    BOOST_TEST(actual == expected, boost::test_tools::tolerance(1e-12) <<
+                                       boost::test_tools::per_element());
+
+    // New batters, new balls and chases at a high rate bring more wickets,
+    // and chases more runs
+    Matchup matchups[4] = {base, base, base, base};
+    matchups[1].situation.bat_balls = 0;
+    matchups[2].situation.ball_age = 0;
+    matchups[3].situation = {4, 300, 100, 6, 2000};
+    std::vector<double> dists(4 * n);
+    model.evaluate(matchups, 4, dists.data());
+    for (int m = 0; m < 4; m++) {
+        BOOST_TEST(dists[m * n] == 0);
+        for (int k = 1; k < n; k++)
+            BOOST_TEST(dists[m * n + k] >= dists[m * n + k - 1]);
+    }
+    for (int m = 1; m < 4; m++)
+        BOOST_TEST(dists[m * n + n - 1] < dists[n - 1]);
+
+    double runs[4];
+    for (int m = 0; m < 4; m++)
+        runs[m] = Model::expected_runs(&dists[m * n]) / dists[m * n + n - 1];
+    BOOST_TEST(runs[3] > runs[0]);
+    BOOST_TEST(runs[1] == runs[0], boost::test_tools::tolerance(1e-12));
+}
+
+BOOST_FIXTURE_TEST_CASE(testfeature_situation_match, F_Pregame) {
+    seed_rng(46);
+    SituationDeliveryModel model;
+    Match match(pregame);
+    match.set_delivery_model(&model);
+    match.pregame();
+    match.start(true);
+    BOOST_TEST(match.get_result() != nullptr);
+
+    // Distributions are evaluated for the pairings and buckets which occur,
+    // rather than all of them
+    Innings* inns = match.get_innings(0);
+    BOOST_TEST(inns->situations != nullptr);
+    int n_evaluated = inns->situations->size();
+    BOOST_TEST(n_evaluated > 0);
+    BOOST_TEST(n_evaluated < SituationTable::NUM_BUCKETS * 11 * 11);
+
+    // Later innings know how long the match has gone on
+    Innings* second = match.get_innings(1);
+    BOOST_TEST(second->prior_balls == inns->legal_delivs);
+    MatchStats situation = second->get_situation(2);
+    BOOST_TEST(situation.innings == 2);
+    BOOST_TEST(situation.match_balls ==
+               inns->legal_delivs + second->legal_delivs + 2);
+    BOOST_TEST(situation.req_rate == 0);
+
+    // Clones and later innings of the same batting team share the cache, and
+    // the cache does not depend on the order in which it is filled
+    Innings clone(*second);
+    BOOST_TEST(clone.situations == second->situations);
+    BOOST_TEST(match.situations[0] != match.situations[1]);
+    for (int i = 0; i < match.get_num_innings(); i++) {
+        Innings* later = match.get_innings(i);
+        if (later->get_bat_team() == inns->get_bat_team())
+            BOOST_TEST(later->situations == inns->situations);
+    }
+    MatchStats at_start = {2, 0, 0, 0, 0};
+    const DeliveryDists& cached = second->situations->get(0, 0, at_start);
+    SituationTable fresh(second->batters, second->bowlers, &model,
+                         second->pitch);
+    const DeliveryDists& evaluated = fresh.get(0, 0, at_start);
+    for (int k = 0; k < Model::NUM_DELIV_OUTCOMES; k++)
+        BOOST_TEST(cached.cdf[k] == evaluated.cdf[k]);
+
+    // Models which ignore the situation are evaluated once per pairing
+    Match plain(pregame);
+    plain.pregame();
+    plain.start(true);
+    BOOST_TEST(plain.get_innings(0)->situations == nullptr);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
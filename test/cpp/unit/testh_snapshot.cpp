@@ -0,0 +1,98 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/parameterized_test.hpp>
+#include <boost/test/unit_test.hpp>
+#include <string>
+#include <vector>
+
+#include "fixtures.hpp"
+#include "testmatch/batch.hpp"
+#include "testmatch/helpers.hpp"
+#include "testmatch/simulation.hpp"
+#include "testmatch/snapshot.hpp"
+
+using namespace boost::unit_test;
+
+BOOST_AUTO_TEST_SUITE(test_header_snapshot)
+
+BOOST_FIXTURE_TEST_CASE(testclass_matchsnapshot, F_Pregame) {
+    BOOST_TEST(MatchSnapshot().is_empty());
+    BOOST_CHECK_THROW(MatchSnapshot().clone(), std::logic_error);
+
+    seed_rng(21);
+    Match match(pregame);
+    match.pregame();
+    match.advance([](Match& m) { return m.get_num_innings() == 2; });
+    match.advance([](Match& m) {
+        return m.get_innings(1)->get_overs().size() == 10;
+    });
+
+    MatchSnapshot snap(match);
+    BOOST_TEST(!snap.is_empty());
+
+    // Completed overs are shared with clones, but the current over is not
+    Match clone = snap.clone();
+    const auto& overs = match.get_innings(1)->get_overs();
+    const auto& clone_overs = clone.get_innings(1)->get_overs();
+    BOOST_TEST(clone_overs.size() == overs.size());
+    BOOST_TEST(clone_overs.front() == overs.front());
+    BOOST_TEST(clone_overs.back() != overs.back());
+    BOOST_TEST(clone.get_innings(0)->get_team_score() ==
+               match.get_innings(0)->get_team_score());
+
+    // Resuming reproduces the original match, however many times
+    match.advance();
+    for (int i = 0; i < 2; i++) {
+        Match resumed = snap.resume();
+        resumed.advance();
+        BOOST_TEST(resumed.get_num_innings() == match.get_num_innings());
+        BOOST_TEST(resumed.get_result()->get_type() ==
+                   match.get_result()->get_type());
+        for (int j = 0; j < match.get_num_innings(); j++) {
+            BOOST_TEST(resumed.get_innings(j)->get_team_score() ==
+                       match.get_innings(j)->get_team_score());
+            BOOST_TEST(resumed.get_innings(j)->get_balls() ==
+                       match.get_innings(j)->get_balls());
+        }
+    }
+
+    // Continuing the clone does not change the snapshot
+    clone.advance();
+    BOOST_TEST(snap.clone().get_result() == nullptr);
+    BOOST_TEST(snap.clone().get_innings(1)->get_overs().size() == 10);
+}
+
+BOOST_FIXTURE_TEST_CASE(testfeature_fork_continuations, F_Pregame) {
+    seed_rng(8);
+    Match match(pregame);
+    match.pregame();
+    match.advance([](Match& m) { return m.get_num_innings() == 3; });
+    MatchSnapshot snap(match);
+
+    BatchOptions opts;
+    opts.n_sims = 30;
+    opts.n_threads = 3;
+    opts.seed = 4;
+    opts.control_variates = true;
+    BatchResult res = BatchRunner(snap, opts).run();
+    BOOST_TEST(res.get_n_sims() == 30);
+
+    // Both first innings are common to every continuation
+    Team* first_bat = match.get_innings(0)->get_bat_team();
+    Player* opener = first_bat->players[0];
+    BOOST_TEST(res.get_projection(opener)->get_bat_innings() >= 30);
+    BatterCard* card = match.get_innings(0)->get_batters()[0];
+    BOOST_TEST(res.get_projection(opener)->get_runs_hist()[std::min(
+                   card->get_sim_stats().runs,
+                   PlayerProjection::RUNS_BINS - 1)] >= 30);
+
+    // Estimates are valid, and do not depend on the number of threads
+    Estimate est = res.win_estimate(&aus);
+    BOOST_TEST(est.value > -0.1);
+    BOOST_TEST(est.value < 1.1);
+    opts.n_threads = 1;
+    BOOST_TEST(BatchRunner(snap, opts).run().get_wins(&aus) ==
+               res.get_wins(&aus));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
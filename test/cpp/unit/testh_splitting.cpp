@@ -0,0 +1,87 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/parameterized_test.hpp>
+#include <boost/test/unit_test.hpp>
+#include <string>
+#include <vector>
+
+#include "fixtures.hpp"
+#include "testmatch/helpers.hpp"
+#include "testmatch/simulation.hpp"
+#include "testmatch/splitting.hpp"
+
+using namespace boost::unit_test;
+
+BOOST_AUTO_TEST_SUITE(test_header_splitting)
+
+BOOST_FIXTURE_TEST_CASE(testfeature_rare_events, F_Pregame) {
+    // Every level holds at the end of a match in which the event occurred
+    RareEvent events[3] = {RareEvent::tie(), RareEvent::fourth_innings_chase(),
+                           RareEvent::bowled_out_under(150)};
+    int n_events = 0;
+    for (int i = 0; i < 100; i++) {
+        seed_rng(mix_seed(3, i));
+        Match match(pregame);
+        match.pregame();
+        match.start(true);
+
+        for (RareEvent& event : events) {
+            if (event.event(match)) {
+                n_events++;
+                for (auto& level : event.levels)
+                    BOOST_TEST(level(match));
+            }
+        }
+    }
+    BOOST_TEST(n_events > 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(testclass_splittingestimator, F_Pregame) {
+    SplittingOptions opts;
+    opts.n_per_level = 20;
+    opts.n_reps = 3;
+    opts.n_threads = 2;
+    opts.seed = 13;
+
+    RareEvent event = RareEvent::bowled_out_under(150);
+    SplittingResult res = SplittingEstimator(pregame, event, opts).run();
+    BOOST_TEST(res.stage_probs.size() == event.levels.size() + 1);
+    BOOST_TEST(res.estimate >= 0);
+    BOOST_TEST(res.estimate <= 1);
+    BOOST_TEST(res.n_deliveries > 0);
+    double estimate = res.estimate;
+
+    // Estimate is the product of the stage probabilities in each replication,
+    // so with a single replication they agree exactly
+    opts.n_reps = 1;
+    res = SplittingEstimator(pregame, event, opts).run();
+    double product = 1;
+    for (double p : res.stage_probs)
+        product *= p;
+    BOOST_TEST(res.estimate == product, boost::test_tools::tolerance(1e-12));
+    BOOST_TEST(res.std_error == 0);
+
+    // Without levels, splitting reduces to plain Monte Carlo
+    RareEvent all_out = {"All out", {}, [](Match& match) {
+                             return match.get_innings(0)->get_wkts() == 10;
+                         }};
+    res = SplittingEstimator(pregame, all_out, opts).run();
+    BOOST_TEST(res.stage_probs.size() == 1);
+
+    unsigned int n_all_out = 0;
+    seed_rng(mix_seed(opts.seed, 0));
+    for (unsigned int i = 0; i < opts.n_per_level; i++) {
+        Match match(pregame);
+        match.pregame();
+        n_all_out += match.advance(all_out.event);
+    }
+    BOOST_TEST(res.estimate == (double)n_all_out / opts.n_per_level);
+
+    // Reproducible regardless of the number of threads
+    opts.n_reps = 3;
+    opts.n_threads = 1;
+    BOOST_TEST(SplittingEstimator(pregame, event, opts).run().estimate ==
+               estimate);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
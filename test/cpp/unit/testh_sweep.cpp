@@ -0,0 +1,135 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/parameterized_test.hpp>
+#include <boost/test/unit_test.hpp>
+#include <stdexcept>
+#include <vector>
+
+#include "fixtures.hpp"
+#include "testmatch/batch.hpp"
+#include "testmatch/params.hpp"
+#include "testmatch/simulation.hpp"
+#include "testmatch/snapshot.hpp"
+#include "testmatch/sweep.hpp"
+#include "testmatch/workers.hpp"
+
+using namespace boost::unit_test;
+
+BOOST_AUTO_TEST_SUITE(test_header_sweep)
+
+BOOST_AUTO_TEST_CASE(testclass_sweepdesign) {
+    SweepDesign grid = SweepDesign::grid(
+        {{"fatigue.mean_pace", {3, 5, 7}}, {"fielding.wk_catch_prob", {0, 1}}});
+    BOOST_TEST(grid.size() == 6);
+    BOOST_TEST(grid.get_point(0) == std::vector<double>({3, 0}),
+               boost::test_tools::per_element());
+    BOOST_TEST(grid.get_point(1) == std::vector<double>({3, 1}),
+               boost::test_tools::per_element());
+    BOOST_TEST(grid.get_point(5) == std::vector<double>({7, 1}),
+               boost::test_tools::per_element());
+
+    // Each tenth of each range is sampled exactly once
+    SweepDesign lhs = SweepDesign::random(
+        {{"fatigue.mean_pace", 0, 10}, {"bowling.take_off_rate", 0, 1}}, 10,
+        2);
+    BOOST_TEST(lhs.size() == 10);
+    std::vector<int> pace(10, 0), rate(10, 0);
+    for (unsigned int k = 0; k < lhs.size(); k++) {
+        pace[(int)lhs.get_point(k)[0]]++;
+        rate[(int)(lhs.get_point(k)[1] * 10)]++;
+    }
+    for (int j = 0; j < 10; j++) {
+        BOOST_TEST(pace[j] == 1);
+        BOOST_TEST(rate[j] == 1);
+    }
+
+    BOOST_CHECK_THROW(SweepDesign({"nonsense"}), std::invalid_argument);
+    BOOST_CHECK_THROW(grid.add_point({1}), std::invalid_argument);
+}
+
+BOOST_FIXTURE_TEST_CASE(testfeature_sweep, F_Pregame) {
+    BatchOptions opts;
+    opts.n_sims = 40;
+    opts.n_threads = 3;
+    opts.seed = 6;
+
+    // The default values, then heavy fatigue
+    SweepDesign design = SweepDesign::grid(
+        {{"fatigue.mean_pace", {5, 50}}, {"bowling.take_off_midpoint", {180}}});
+    SweepResult result = SweepRunner(pregame, design, opts).run();
+    BOOST_TEST(result.size() == 2);
+    BOOST_TEST(ParamRegistry::get("fatigue.mean_pace") == 5);
+
+    // Each point matches a plain batch with the same parameters, regardless
+    // of the threads it ran on
+    BatchResult plain = BatchRunner(pregame, opts).run();
+    BOOST_TEST(result.get_result(0).get_wins(&aus) == plain.get_wins(&aus));
+    BOOST_TEST(result.get_result(0).get_wins(&nz) == plain.get_wins(&nz));
+
+    ParamRegistry::set("fatigue.mean_pace", 50);
+    WorkerPool pool(1);
+    BatchResult tired = BatchRunner(pregame, opts).run(&pool);
+    ParamRegistry::reset();
+    BOOST_TEST(result.get_result(1).get_wins(&aus) == tired.get_wins(&aus));
+    BOOST_TEST(result.get_result(1).get_n_sims() == opts.n_sims);
+
+    // Paired differences against the first point
+    Estimate same = result.win_diff(0, &aus);
+    BOOST_TEST(same.value == 0);
+    BOOST_TEST(same.std_error == 0);
+    Estimate diff = result.win_diff(1, &aus);
+    BOOST_TEST(diff.value == result.get_result(1).win_prob(&aus) -
+                                 result.get_result(0).win_prob(&aus),
+               boost::test_tools::tolerance(1e-9));
+
+    BOOST_TEST(result.to_csv().find("fatigue.mean_pace,") == 0);
+    BOOST_TEST(!result.print().empty());
+}
+
+BOOST_FIXTURE_TEST_CASE(testfeature_sweep_toss, F_Pregame) {
+    BatchOptions opts;
+    opts.n_sims = 40;
+    opts.n_threads = 3;
+    opts.seed = 4;
+    opts.stratify_toss = true;
+
+    // Toss strata of each point are weighted under its own parameters
+    SweepDesign design =
+        SweepDesign::grid({{"toss.field_prob_seam", {0.1, 0.9}}});
+    SweepResult result = SweepRunner(pregame, design, opts).run();
+    for (unsigned int k = 0; k < 2; k++) {
+        ParamRegistry::set("toss.field_prob_seam", design.get_point(k)[0]);
+        BatchResult plain = BatchRunner(pregame, opts).run();
+        ParamRegistry::reset();
+        BOOST_TEST(result.get_result(k).get_wins(&aus) ==
+                   plain.get_wins(&aus));
+        BOOST_TEST(result.get_result(k).win_estimate(&aus).value ==
+                   plain.win_estimate(&aus).value);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(testfeature_sweep_snapshot, F_Pregame) {
+    seed_rng(8);
+    Match match(pregame);
+    match.pregame();
+    match.advance([](Match& m) { return m.get_num_innings() == 2; });
+    MatchSnapshot snap(match);
+
+    BatchOptions opts;
+    opts.n_sims = 20;
+    opts.n_threads = 3;
+    opts.seed = 5;
+
+    // Each point continues the snapshot, as a plain batch would
+    SweepDesign design = SweepDesign::grid({{"fatigue.mean_pace", {5, 50}}});
+    SweepResult result = SweepRunner(snap, design, opts).run();
+    BatchResult plain = BatchRunner(snap, opts).run();
+    BOOST_TEST(result.get_result(0).get_wins(&aus) == plain.get_wins(&aus));
+    BOOST_TEST(result.get_result(0).get_wins(&nz) == plain.get_wins(&nz));
+    BOOST_TEST(result.get_result(0).result_prob(draw) ==
+               plain.result_prob(draw));
+    BOOST_TEST(result.get_result(1).get_n_sims() == opts.n_sims);
+    BOOST_TEST(ParamRegistry::get("fatigue.mean_pace") == 5);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,181 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <atomic>
+#include <boost/test/parameterized_test.hpp>
+#include <boost/test/unit_test.hpp>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+#define private public // Illegal command :(
+
+#include "fixtures.hpp"
+#include "testmatch/batch.hpp"
+#include "testmatch/cards.hpp"
+#include "testmatch/helpers.hpp"
+#include "testmatch/models.hpp"
+#include "testmatch/simulation.hpp"
+#include "testmatch/tactics.hpp"
+
+using namespace boost::unit_test;
+
+BOOST_AUTO_TEST_SUITE(test_header_tactics)
+
+BOOST_AUTO_TEST_CASE(testmodel_declaration) {
+    for (int innings = 1; innings <= 3; innings++) {
+        double last = 0;
+        for (int lead = -200; lead <= 1000; lead += 50) {
+            double p = Model::MODEL_DECLARATION(lead, 0, false, innings);
+            BOOST_TEST(p >= last);
+            BOOST_TEST(p <= 1);
+            last = p;
+        }
+
+        // More willing to declare as the match goes on, and after a wicket
+        BOOST_TEST(Model::MODEL_DECLARATION(300, 1800, false, innings) >
+                   Model::MODEL_DECLARATION(300, 0, false, innings));
+        BOOST_TEST(Model::MODEL_DECLARATION(300, 0, true, innings) >
+                   Model::MODEL_DECLARATION(300, 0, false, innings));
+    }
+    BOOST_TEST(Model::MODEL_DECLARATION(1000, 2000, true, 4) == 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(testclass_battingmanager, F_Pregame) {
+    BattingManager man;
+    BatterCard** cards = create_batting_cards(&aus);
+    man.set_cards(cards);
+
+    // Nightwatchman is the last to bat, promoted only while two remain
+    BOOST_TEST(man.nightwatch() == cards[10]);
+    for (int i = 0; i < 4; i++)
+        man.next_ordered();
+    BOOST_TEST(man.nightwatch() == cards[10]);
+
+    // Hitter is the fastest scorer yet to bat, unless already next in
+    BatterCard* fastest = cards[4];
+    for (int i = 5; i < 11; i++) {
+        if (cards[i]->get_sim_stats().career_strike_rate >
+            fastest->get_sim_stats().career_strike_rate)
+            fastest = cards[i];
+    }
+    BOOST_TEST(man.promote_hitter() ==
+               (fastest == cards[4] ? nullptr : fastest));
+
+    for (int i = 4; i < 10; i++)
+        man.next_ordered();
+    BOOST_TEST(man.nightwatch() == nullptr);
+    BOOST_TEST(man.promote_hitter() == nullptr);
+
+    for (int i = 0; i < 11; i++)
+        delete cards[i];
+    delete[] cards;
+}
+
+BOOST_FIXTURE_TEST_CASE(testclass_match_declare, F_Pregame) {
+    Match match(pregame);
+    match.pregame({&aus, &nz, bat});
+    for (int i = 0; i < 6; i++)
+        match.apply_delivery("1");
+
+    match.declare();
+    BOOST_TEST(match.get_num_innings() == 2);
+    BOOST_TEST(!match.get_innings(0)->get_is_open());
+    BOOST_TEST(match.get_current_innings()->get_bat_team() == &nz);
+    BOOST_TEST(match.get_current_innings()->get_lead() == -6);
+
+    // On to the fourth innings, which cannot be declared
+    match.declare();
+    match.declare();
+    BOOST_TEST(match.get_num_innings() == 4);
+    BOOST_CHECK_THROW(match.declare(), std::logic_error);
+}
+
+BOOST_FIXTURE_TEST_CASE(testclass_rollouttactics, F_Pregame) {
+    TacticsOptions opts;
+    opts.n_rollouts = 4;
+    BOOST_TEST(opts.budget_us == 0);
+    RolloutTactics tactics(opts);
+
+    // A huge first innings, at the start of an over
+    Match match(pregame);
+    match.pregame({&aus, &nz, bat});
+    for (int i = 0; i < 102; i++)
+        match.apply_delivery("6");
+    BOOST_TEST(match.get_current_innings()->get_balls() % 6 == 0);
+
+    RngState before = rng_state();
+    bool decision = tactics.declare(match);
+    BOOST_TEST(tactics.get_decisions() == 1);
+    BOOST_TEST(tactics.get_rollouts() == 4);
+
+    // The caller's random stream is untouched
+    double u = runif();
+    rng_state() = before;
+    BOOST_TEST(runif() == u);
+
+    // Repeated situations are served from the cache of the match, which its
+    // clones copy, but other matches roll out again
+    BOOST_TEST(tactics.declare(match) == decision);
+    BOOST_TEST(tactics.get_hits() == 1);
+    BOOST_TEST(tactics.get_rollouts() == 4);
+    Match clone(match);
+    BOOST_TEST(tactics.declare(clone) == decision);
+    BOOST_TEST(tactics.get_hits() == 2);
+    Match other(pregame);
+    other.pregame({&aus, &nz, bat});
+    for (int i = 0; i < 102; i++)
+        other.apply_delivery("6");
+    tactics.declare(other);
+    BOOST_TEST(tactics.get_hits() == 2);
+    BOOST_TEST(tactics.get_rollouts() == 8);
+
+    // No rollouts where a declaration is implausible
+    Match early(pregame);
+    early.pregame({&aus, &nz, bat});
+    BOOST_TEST(!tactics.declare(early));
+    BOOST_TEST(tactics.get_decisions() == 4);
+
+    // The time budget cuts rollouts short, but always makes one
+    opts.n_rollouts = 1000;
+    opts.budget_us = 1;
+    RolloutTactics hurried(opts);
+    Match fresh(pregame);
+    fresh.pregame({&aus, &nz, bat});
+    for (int i = 0; i < 102; i++)
+        fresh.apply_delivery("6");
+    hurried.declare(fresh);
+    BOOST_TEST(hurried.get_rollouts() == 1);
+
+    tactics.clear();
+    BOOST_TEST(tactics.get_decisions() == 0);
+    BOOST_TEST(tactics.get_rollouts() == 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(testfeature_batch_tactics, F_Pregame) {
+    TacticsOptions tactics_opts;
+    tactics_opts.n_rollouts = 2;
+
+    // Without a time limit, the default, decisions and so results are reproducible, and
+    // do not depend on the number of threads
+    BatchOptions opts;
+    opts.n_sims = 20;
+    opts.seed = 4;
+    unsigned int wins[3], draws[3];
+    for (int k = 0; k < 3; k++) {
+        RolloutTactics tactics(tactics_opts);
+        opts.tactics = &tactics;
+        opts.n_threads = k == 2 ? 1 : 3;
+        BatchResult result = BatchRunner(pregame, opts).run();
+        BOOST_TEST(result.get_n_sims() == opts.n_sims);
+        BOOST_TEST(tactics.get_hits() <= tactics.get_decisions());
+        wins[k] = result.get_wins(&aus);
+        draws[k] = result.get_result_count(draw);
+    }
+    BOOST_TEST(wins[0] == wins[1]);
+    BOOST_TEST(wins[0] == wins[2]);
+    BOOST_TEST(draws[0] == draws[2]);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
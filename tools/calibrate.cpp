@@ -0,0 +1,75 @@
+// -*- lsst-c++ -*-
+/* calibrate.cpp
+ *
+ * Fitting the delivery and dismissal models to a directory of Cricsheet JSON
+ * match files (e.g. the "tests_json" download from cricsheet.org), and
+ * writing the coefficients to a binary coefficient file. The engine loads the
+ * file at startup when TESTMATCH_COEFFICIENTS is set to its path.
+ *
+ * Bowling types are read from an optional CSV file of "name,type" lines, with
+ * names as they appear in the match files and types as accepted by
+ * str_to_bowltype() (e.g. "fm" or "offbreak"), or "-" for none. Only Test
+ * matches are used, unless another match type (or "any") is given.
+ *
+ * Usage: calibrate <match dir> <output file> [styles.csv|-] [match type]
+ *        [n_threads]
+ */
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <testmatch/calibration.hpp>
+#include <testmatch/enums.hpp>
+#include <testmatch/models.hpp>
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: calibrate <match dir> <output file> "
+                     "[styles.csv|-] [match type] [n_threads]"
+                  << std::endl;
+        return 1;
+    }
+
+    CalibrationOptions opts;
+    if (argc > 4)
+        opts.match_type = std::string(argv[4]) == "any" ? "" : argv[4];
+    if (argc > 5)
+        opts.n_threads = std::stoi(argv[5]);
+    CricsheetReader reader(opts);
+
+    std::string styles_path = argc > 3 ? argv[3] : "-";
+    if (styles_path != "-") {
+        std::ifstream styles(styles_path);
+        if (!styles) {
+            std::cerr << "Could not open " << styles_path << std::endl;
+            return 1;
+        }
+        std::cout << reader.read_styles(styles) << " bowling types read"
+                  << std::endl;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    CalibrationTables tables = reader.read_dir(argv[1]);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    std::cout << tables.get_n_files() << " files read in " << elapsed.count()
+              << " ms: " << tables.get_n_matches() << " matches, "
+              << tables.get_n_deliveries() << " deliveries ("
+              << tables.get_n_skipped() << " skipped), "
+              << tables.get_n_failed() << " files failed" << std::endl;
+
+    unsigned long long unknown = 0;
+    for (int p = 0; p < CalibrationTables::NUM_PHASES; p++) {
+        for (int i = 0; i < Model::NUM_DELIV_OUTCOMES; i++)
+            unknown += tables.get_outcome_count(CalibrationTables::UNKNOWN_TYPE,
+                                                p, i);
+    }
+    std::cout << unknown << " deliveries by bowlers of unknown type"
+              << std::endl;
+
+    tables.save(argv[2]);
+    std::cout << "Coefficients written to " << argv[2] << std::endl;
+    return 0;
+}
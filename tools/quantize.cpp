@@ -0,0 +1,59 @@
+// -*- lsst-c++ -*-
+/* quantize.cpp
+ *
+ * Building a quantized table of delivery outcome distributions from the
+ * built-in or multinomial logit delivery model, with the coefficients loaded
+ * from TESTMATCH_COEFFICIENTS if set. The table is written to a file which
+ * simulations on the same machine can map into memory and share (see
+ * quantized.hpp).
+ *
+ * Usage: quantize <output file> [builtin|logit] [n_points] [fixed|float]
+ */
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <testmatch/logit.hpp>
+#include <testmatch/models.hpp>
+#include <testmatch/quantized.hpp>
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: quantize <output file> [builtin|logit] "
+                     "[n_points] [fixed|float]"
+                  << std::endl;
+        return 1;
+    }
+
+    std::string source_name = argc > 2 ? argv[2] : "builtin";
+    BuiltinDeliveryModel builtin;
+    LogitDeliveryModel logit;
+    const DeliveryModel* source;
+    if (source_name == "builtin")
+        source = &builtin;
+    else if (source_name == "logit")
+        source = &logit;
+    else {
+        std::cerr << "Unknown delivery model: " << source_name << std::endl;
+        return 1;
+    }
+
+    QuantizedTableOptions opts;
+    if (argc > 3) {
+        for (unsigned int& n : opts.n_points)
+            n = std::stoi(argv[3]);
+    }
+    if (argc > 4)
+        opts.fixed_point = std::string(argv[4]) != "float";
+
+    auto start = std::chrono::steady_clock::now();
+    QuantizedDeliveryModel table(*source, opts);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    table.save(argv[1]);
+    std::cout << "Table of " << table.size() << " bytes built in "
+              << elapsed.count() << " ms and written to " << argv[1]
+              << std::endl;
+    return 0;
+}